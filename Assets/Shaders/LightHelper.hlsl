@@ -257,6 +257,42 @@ float CalcShadowFactor(SamplerComparisonState samShadow,
 }
 
 
+//---------------------------------------------------------------------------------------
+// Performs a shadow map test against one slice of a cascaded shadow map array.
+// shadowPosT is already in the cascade's texture space.
+//---------------------------------------------------------------------------------------
+
+// Must match ShadowCascades::MaxCascades
+#define MAX_CASCADES 4
+
+float CalcCascadeShadowFactor(SamplerComparisonState samShadow,
+	Texture2DArray shadowMap,
+	float3 shadowPosT,
+	int cascade,
+	float texelSize)
+{
+	// Texel size.
+	const float dx = texelSize;
+
+	float percentLit = 0.0f;
+	const float2 offsets[9] =
+	{
+		float2(-dx,  -dx), float2(0.0f,  -dx), float2(dx,  -dx),
+		float2(-dx, 0.0f), float2(0.0f, 0.0f), float2(dx, 0.0f),
+		float2(-dx,  +dx), float2(0.0f,  +dx), float2(dx,  +dx)
+	};
+
+	[unroll]
+	for (int i = 0; i < 9; ++i)
+	{
+		percentLit += shadowMap.SampleCmpLevelZero(samShadow,
+			float3(shadowPosT.xy + offsets[i], cascade), shadowPosT.z).r;
+	}
+
+	return percentLit /= 9.0f;
+}
+
+
 float CalcShadowFactor2(SamplerState samShadow,
 	Texture2D shadowMap,
 	float4 shadowPosH)
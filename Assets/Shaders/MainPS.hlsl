@@ -26,8 +26,8 @@ cbuffer cbPerObject : register(b1)
     float4x4 gWorldViewProj;
     float4x4 gTexTransform;
     float4x4 gWorldViewProjTex;
-    float4x4 gShadowTransform;
     Material gMaterial;
+    float4 gProbeBlend;
 };
 
 cbuffer cbPSParams : register(b2)
@@ -41,11 +41,19 @@ cbuffer cbPSParams : register(b2)
 	int2 pad2;
 };
 
+cbuffer cbShadow : register(b3)
+{
+	float4x4 gShadowTransforms[MAX_CASCADES];
+	int gCascadeCount;
+	float gShadowTexelSize;
+	int2 pad3;
+};
+
 Texture2D gDiffuseMap;
 Texture2D gNormalMap;
-Texture2D gShadowMap;
+Texture2DArray gShadowMap;
 Texture2D gSSAOMap;
-TextureCube gCubeMap;
+TextureCubeArray gCubeMaps;
 
 SamplerState samLinear
 {
@@ -81,14 +89,54 @@ struct VertexOut
 	float3 NormalW    : NORMAL;
 	float3 TangentW   : TANGENT;
 	float2 Tex        : TEXCOORD;
-    float4 ShadowPosH : TEXCOORD1;
-    float4 SSAOPosH   : TEXCOORD2;
+    float4 SSAOPosH   : TEXCOORD1;
+#ifdef INSTANCED
+	nointerpolation float4 MatAmbient  : MATERIAL0;
+	nointerpolation float4 MatDiffuse  : MATERIAL1;
+	nointerpolation float4 MatSpecular : MATERIAL2;
+	nointerpolation float4 MatReflect  : MATERIAL3;
+	nointerpolation float4 ProbeBlend  : PROBEBLEND;
+#endif
 };
 
+//---------------------------------------------------------------------------------------
+// Picks the first (finest) cascade that contains the point and returns its shadow factor.
+// Points outside every cascade are treated as lit.
+//---------------------------------------------------------------------------------------
+float CalcCascadedShadow(float3 posW)
+{
+	[loop]
+	for (int i = 0; i < gCascadeCount; ++i)
+	{
+		float4 shadowPosT = mul(float4(posW, 1.0f), gShadowTransforms[i]);
+		shadowPosT.xyz /= shadowPosT.w;
+
+		if (all(shadowPosT.xyz >= 0.0f) && all(shadowPosT.xyz <= 1.0f))
+		{
+#ifdef CAPTURE
+			// Probes are blurry anyway; one tap instead of the 3x3 PCF kernel
+			return gShadowMap.SampleCmpLevelZero(samShadow, float3(shadowPosT.xy, i), shadowPosT.z).r;
+#else
+			return CalcCascadeShadowFactor(samShadow, gShadowMap, shadowPosT.xyz, i, gShadowTexelSize);
+#endif
+		}
+	}
+
+	return 1.0f;
+}
+
 float4 PS(VertexOut pin) : SV_Target
 {
 	int gLightCount = 3;
 
+#ifdef INSTANCED
+	Material material = { pin.MatAmbient, pin.MatDiffuse, pin.MatSpecular, pin.MatReflect };
+	float4 probeBlend = pin.ProbeBlend;
+#else
+	Material material = gMaterial;
+	float4 probeBlend = gProbeBlend;
+#endif
+
 	// Interpolating normal can unnormalize it, so normalize it.
 	pin.NormalW = normalize(pin.NormalW);
 
@@ -121,11 +169,13 @@ float4 PS(VertexOut pin) : SV_Target
 	// Normal mapping
 	//
 	float3 bumpedNormalW = float3(0, 0, 0);
+#ifndef CAPTURE
 	if (gUseNormal > 0)
 	{
 		float3 normalMapSample = gNormalMap.Sample(samLinear, pin.Tex).rgb;
 		bumpedNormalW = NormalSampleToWorldSpace(normalMapSample, pin.NormalW, pin.TangentW);
 	}
+#endif
 
 	//
 	// Lighting.
@@ -133,10 +183,12 @@ float4 PS(VertexOut pin) : SV_Target
 
     pin.SSAOPosH /= pin.SSAOPosH.w;
     float ambientAccess = 1.0f;
+#ifndef CAPTURE
     if (gUseAO > 0)
     {
         ambientAccess = gSSAOMap.Sample(samLinear, pin.SSAOPosH.xy, 0.0f).r;
     }
+#endif
     
 	float4 litColor = texColor;
 	if (gLightCount > 0)
@@ -148,7 +200,7 @@ float4 PS(VertexOut pin) : SV_Target
 
    		// Only the first light casts a shadow.
         float3 shadow = float3(1.0f, 1.0f, 1.0f);
-        shadow[0] = CalcShadowFactor(samShadow, gShadowMap, pin.ShadowPosH);
+        shadow[0] = CalcCascadedShadow(pin.PosW);
 
 		// Sum the light contribution from each light source.  
 		[unroll]
@@ -157,11 +209,11 @@ float4 PS(VertexOut pin) : SV_Target
 			float4 A, D, S;
 			if (gUseNormal)
 			{
-				ComputeDirectionalLight(gMaterial, gDirLights[i], bumpedNormalW, toEye, A, D, S);
+				ComputeDirectionalLight(material, gDirLights[i], bumpedNormalW, toEye, A, D, S);
 			}
 			else
 			{
-				ComputeDirectionalLight(gMaterial, gDirLights[i], pin.NormalW, toEye, A, D, S);
+				ComputeDirectionalLight(material, gDirLights[i], pin.NormalW, toEye, A, D, S);
 			}
 
 			ambient += ambientAccess*A;
@@ -172,18 +224,24 @@ float4 PS(VertexOut pin) : SV_Target
 		// Modulate with late add.
 		litColor = texColor*(ambient + diffuse) + spec;
 
+#ifndef CAPTURE
 		if (gReflectionEnabled > 0)
 		{
 			float3 incident = -toEye;
 			float3 reflectionVector = reflect(incident, pin.NormalW);
-			float4 reflectionColor = gCubeMap.Sample(samLinear, reflectionVector);
 
-			litColor += gMaterial.Reflect*reflectionColor;
+			// Blend the two probes picked for this object
+			float4 reflectionColor = lerp(gCubeMaps.Sample(samLinear, float4(reflectionVector, probeBlend.x)),
+			                              gCubeMaps.Sample(samLinear, float4(reflectionVector, probeBlend.y)),
+			                              probeBlend.z);
+
+			litColor += material.Reflect*reflectionColor;
 		}
+#endif
 	}
 
 	// Common to take alpha from diffuse material and texture.
-	litColor.a = gMaterial.Diffuse.a * texColor.a;
+	litColor.a = material.Diffuse.a * texColor.a;
 
 	return litColor; 
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 
 #include "LightHelper.hlsl"
 
+// With INSTANCED defined the world, texture and material values come from the
+// instance data, and gWorldViewProj/gWorldViewProjTex hold the view transforms only.
 cbuffer cbPerObject : register(b1)
 {
 	float4x4 gWorld;
@@ -13,8 +15,8 @@ cbuffer cbPerObject : register(b1)
 	float4x4 gWorldViewProj;
 	float4x4 gTexTransform;
 	float4x4 gWorldViewProjTex;
-    float4x4 gShadowTransform;
 	Material gMaterial;
+	float4 gProbeBlend;
 };
 
 struct VertexIn
@@ -23,6 +25,18 @@ struct VertexIn
 	float3 NormalL  : NORMAL;
 	float2 Tex      : TEXCOORD;
 	float3 TangentL : TANGENT;
+#ifdef INSTANCED
+
+	// Per instance
+	row_major float4x4 World             : WORLD;
+	row_major float4x4 WorldInvTranspose : WORLDINVTRANSPOSE;
+	row_major float4x4 TexTransform      : TEXTRANSFORM;
+	float4 MatAmbient  : MATERIAL0;
+	float4 MatDiffuse  : MATERIAL1;
+	float4 MatSpecular : MATERIAL2;
+	float4 MatReflect  : MATERIAL3;
+	float4 ProbeBlend  : PROBEBLEND;
+#endif
 };
 
 struct VertexOut
@@ -32,14 +46,39 @@ struct VertexOut
     float3 NormalW    : NORMAL;
 	float3 TangentW   : TANGENT;
 	float2 Tex        : TEXCOORD0;
-    float4 ShadowPosH : TEXCOORD1;
-	float4 SSAOPosH   : TEXCOORD2;
+	float4 SSAOPosH   : TEXCOORD1;
+#ifdef INSTANCED
+	nointerpolation float4 MatAmbient  : MATERIAL0;
+	nointerpolation float4 MatDiffuse  : MATERIAL1;
+	nointerpolation float4 MatSpecular : MATERIAL2;
+	nointerpolation float4 MatReflect  : MATERIAL3;
+	nointerpolation float4 ProbeBlend  : PROBEBLEND;
+#endif
 };
 
 VertexOut VS(VertexIn vin)
 {
 	VertexOut vout;
 
+#ifdef INSTANCED
+	float4 posW = mul(float4(vin.PosL, 1.0f), vin.World);
+
+	vout.PosW = posW.xyz;
+	vout.NormalW = mul(vin.NormalL, (float3x3)vin.WorldInvTranspose);
+	vout.TangentW = mul(vin.TangentL, (float3x3)vin.World);
+
+	vout.PosH = mul(posW, gWorldViewProj);
+	vout.Tex = mul(float4(vin.Tex, 0.0f, 1.0f), vin.TexTransform).xy;
+	vout.SSAOPosH = mul(posW, gWorldViewProjTex);
+
+	vout.MatAmbient = vin.MatAmbient;
+	vout.MatDiffuse = vin.MatDiffuse;
+	vout.MatSpecular = vin.MatSpecular;
+	vout.MatReflect = vin.MatReflect;
+	vout.ProbeBlend = vin.ProbeBlend;
+
+	return vout;
+#else
 	vout.PosW = mul(float4(vin.PosL, 1.0f), gWorld).xyz;
 	vout.NormalW = mul(vin.NormalL, (float3x3)gWorldInvTranspose);
 	vout.TangentW = mul(vin.TangentL, (float3x3)gWorld);
@@ -49,9 +88,10 @@ VertexOut VS(VertexIn vin)
 	
 	vout.Tex = mul(float4(vin.Tex, 0.0f, 1.0f), gTexTransform).xy;
 
-	// Generate projective tex-coords to project shadow map onto scene.
+	// Generate projective tex-coords to project SSAO map onto scene.
+	// Shadow coordinates are computed per cascade in the pixel shader.
 	vout.SSAOPosH = mul(float4(vin.PosL, 1.0f), gWorldViewProjTex);
-    vout.ShadowPosH = mul(float4(vin.PosL, 1.0f), gShadowTransform);
 
     return vout;
+#endif
 }
@@ -0,0 +1,35 @@
+//***************************************************************************************
+//***************************************************************************************
+
+// Compact SSAO normal/depth encoding. Must match NormalDepthEncoding on the CPU.
+
+float2 SignNotZero(float2 v)
+{
+	return float2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+// Octahedral mapping of a unit vector onto the [-1,1] square
+float2 EncodeNormal(float3 n)
+{
+	float2 e = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+
+	// The lower hemisphere is folded over the diagonals onto the corners
+	return n.z < 0.0f ? (1.0f - abs(e.yx)) * SignNotZero(e) : e;
+}
+
+float3 DecodeNormal(float2 e)
+{
+	float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));
+	if (n.z < 0.0f)
+	{
+		n.xy = (1.0f - abs(e.yx)) * SignNotZero(e);
+	}
+
+	return normalize(n);
+}
+
+// View space depth from hardware depth; depthParams are _33 and _43 of the projection
+float ViewDepthFromHardware(float depth, float2 depthParams)
+{
+	return depthParams.y / (depth - depthParams.x);
+}
@@ -1,6 +1,10 @@
 //***************************************************************************************
 //***************************************************************************************
 
+#ifdef COMPACT_NORMAL_DEPTH
+#include "NormalDepthEncoding.hlsl"
+#endif
+
 struct VertexOut
 {
 	float4 PosH       : SV_POSITION;
@@ -8,8 +12,16 @@ struct VertexOut
 	float3 NormalV    : NORMAL;
 };
 
+#ifdef COMPACT_NORMAL_DEPTH
+// Depth is read back from the depth buffer, so only the normal is written
+float2 PS(VertexOut pin) : SV_Target
+{
+	return EncodeNormal(normalize(pin.NormalV));
+}
+#else
 float4 PS(VertexOut pin) : SV_Target
 {
 	pin.NormalV = normalize(pin.NormalV);
 	return float4(pin.NormalV, pin.PosV.z);
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 #include "LightHelper.hlsl"
 
+// Objects are drawn instanced, so the matrices hold the view transforms only and
+// the world transforms come from the instance data.
 cbuffer cbPerObject : register(b0)
 {
 	float4x4 gWorldView;
@@ -14,6 +16,10 @@ struct VertexIn
 {
 	float3 PosL     : POSITION;
 	float3 NormalL  : NORMAL;
+
+	// Per instance
+	row_major float4x4 World             : WORLD;
+	row_major float4x4 WorldInvTranspose : WORLDINVTRANSPOSE;
 };
 
 struct VertexOut
@@ -27,11 +33,14 @@ VertexOut VS(VertexIn vin)
 {
 	VertexOut vout;
 
-	vout.PosV = mul(float4(vin.PosL, 1.0f), gWorldView).xyz;
-	vout.NormalV = mul(vin.NormalL, (float3x3)gWorldInvTransposeView);
+	float4 posW = mul(float4(vin.PosL, 1.0f), vin.World);
+	float3 normalW = mul(vin.NormalL, (float3x3)vin.WorldInvTranspose);
+
+	vout.PosV = mul(posW, gWorldView).xyz;
+	vout.NormalV = mul(normalW, (float3x3)gWorldInvTransposeView);
 
 	// Do I need this?
-	vout.PosH = mul(float4(vin.PosL, 1.0f), gWorldViewProj);
+	vout.PosH = mul(posW, gWorldViewProj);
 	
     return vout;
 }
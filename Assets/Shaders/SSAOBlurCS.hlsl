@@ -0,0 +1,104 @@
+//***************************************************************************************
+//***************************************************************************************
+
+// One direction of the edge-aware SSAO blur. Define VERTICAL for the vertical pass.
+// Every thread group blurs a run of GROUP_SIZE texels along one row or column, cached
+// with their normals and depths in groupshared memory together with MAX_RADIUS texels
+// either side, so each texel is fetched once per group rather than once per tap.
+
+#define GROUP_SIZE 256
+
+// Must match SSAOBlur
+#define MAX_RADIUS 16
+#define CACHE_SIZE (GROUP_SIZE + 2 * MAX_RADIUS)
+
+cbuffer cbBlur : register(b0)
+{
+	// Kernel weights by distance from the centre, packed four to a register
+	float4 gWeights[5];
+	int gRadius;
+	float3 pad;
+};
+
+Texture2D gNormalDepthMap : register(t0);
+Texture2D gInputMap : register(t1);
+
+RWTexture2D<float> gOutputMap : register(u0);
+
+groupshared float gAmbientCache[CACHE_SIZE];
+groupshared float4 gNormalDepthCache[CACHE_SIZE];
+
+void CacheTexel(int index, int2 texel, int2 size)
+{
+	texel = clamp(texel, int2(0, 0), size - 1);
+
+	gAmbientCache[index] = gInputMap[texel].r;
+	gNormalDepthCache[index] = gNormalDepthMap[texel];
+}
+
+#ifdef VERTICAL
+[numthreads(1, GROUP_SIZE, 1)]
+#else
+[numthreads(GROUP_SIZE, 1, 1)]
+#endif
+void CS(int3 groupThreadID : SV_GroupThreadID, int3 dispatchThreadID : SV_DispatchThreadID)
+{
+	uint width, height;
+	gInputMap.GetDimensions(width, height);
+	int2 size = int2(width, height);
+
+#ifdef VERTICAL
+	int2 axis = int2(0, 1);
+	int local = groupThreadID.y;
+#else
+	int2 axis = int2(1, 0);
+	int local = groupThreadID.x;
+#endif
+
+	int2 texel = dispatchThreadID.xy;
+
+	// The first MAX_RADIUS threads also fetch the apron on both sides of the run
+	CacheTexel(local + MAX_RADIUS, texel, size);
+	if (local < MAX_RADIUS)
+	{
+		CacheTexel(local, texel - MAX_RADIUS * axis, size);
+		CacheTexel(local + GROUP_SIZE + MAX_RADIUS, texel + GROUP_SIZE * axis, size);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
+	if (any(texel >= size))
+	{
+		return;
+	}
+
+	int center = local + MAX_RADIUS;
+	int radius = min(gRadius, MAX_RADIUS);
+
+	float4 centerNormalDepth = gNormalDepthCache[center];
+
+	float color = gWeights[0].x * gAmbientCache[center];
+	float totalWeight = gWeights[0].x;
+
+	for (int i = -radius; i <= radius; ++i)
+	{
+		if (i == 0)
+		{
+			continue;
+		}
+
+		float4 neighborNormalDepth = gNormalDepthCache[center + i];
+
+		// Same edge test as BlurPS
+		if ((dot(neighborNormalDepth.xyz, centerNormalDepth.xyz) >= 0.8f) &&
+			(abs(neighborNormalDepth.a - centerNormalDepth.a) <= 0.2f))
+		{
+			uint offset = abs(i);
+			float weight = gWeights[offset >> 2][offset & 3];
+			color += weight * gAmbientCache[center + i];
+			totalWeight += weight;
+		}
+	}
+
+	gOutputMap[texel] = color / totalWeight;
+}
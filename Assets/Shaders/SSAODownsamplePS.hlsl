@@ -0,0 +1,77 @@
+//***************************************************************************************
+//***************************************************************************************
+
+#include "NormalDepthEncoding.hlsl"
+
+cbuffer cbResample : register(b0)
+{
+	uint gFactor;
+	uint gMode;
+	float2 gDepthParams;
+};
+
+struct VertexOut
+{
+	float4 PosH : SV_POSITION;
+	float2 Tex  : TEXCOORD;
+};
+
+Texture2D gNormalDepthMap : register(t0);
+
+// Compact normal/depth keeps an octahedral normal in gNormalDepthMap and depth in the
+// depth buffer; the reduced map is always full normal/depth.
+#ifdef COMPACT_NORMAL_DEPTH
+Texture2D gDepthMap : register(t1);
+
+float LoadDepth(int2 texel)
+{
+	return ViewDepthFromHardware(gDepthMap.Load(int3(texel, 0)).r, gDepthParams);
+}
+
+float4 LoadNormalDepth(int2 texel)
+{
+	return float4(DecodeNormal(gNormalDepthMap.Load(int3(texel, 0)).xy), LoadDepth(texel));
+}
+#else
+float LoadDepth(int2 texel)
+{
+	return gNormalDepthMap.Load(int3(texel, 0)).w;
+}
+
+float4 LoadNormalDepth(int2 texel)
+{
+	return gNormalDepthMap.Load(int3(texel, 0));
+}
+#endif
+
+// Keep one whole texel from each gFactor x gFactor block. Modes match SSAODownsampleMode:
+// 0 nearest depth, 1 farthest depth, 2 alternating between them in a checkerboard.
+float4 PS(VertexOut pin) : SV_Target
+{
+	uint width, height;
+	gNormalDepthMap.GetDimensions(width, height);
+
+	uint2 block = uint2(pin.PosH.xy);
+	uint2 start = block * gFactor;
+	uint2 end = min(start + gFactor, uint2(width, height));
+
+	bool isMax = (gMode == 1) || (gMode == 2 && ((block.x + block.y) & 1) != 0);
+
+	int2 best = int2(start);
+	float bestDepth = LoadDepth(best);
+
+	for (uint y = start.y; y < end.y; ++y)
+	{
+		for (uint x = start.x; x < end.x; ++x)
+		{
+			float depth = LoadDepth(int2(x, y));
+			if (isMax ? depth > bestDepth : depth < bestDepth)
+			{
+				best = int2(x, y);
+				bestDepth = depth;
+			}
+		}
+	}
+
+	return LoadNormalDepth(best);
+}
\ No newline at end of file
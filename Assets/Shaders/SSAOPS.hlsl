@@ -5,7 +5,10 @@ cbuffer cbPerObject : register(b0)
 {
 	float4x4 gViewToTexSpaceTransform;
 	float4 gFrustumFarCorners[4];
-	float4 gOffsets[14];
+	float4 gOffsets[32];
+	uint gSampleCount;
+	float2 gNoiseOffset;
+	float pad;
 };
 
 struct VertexOut
@@ -29,13 +32,6 @@ SamplerState samNormalDepth
 	BorderColor = float4(0.0f, 0.0f, 0.0f, 1e5f);
 };
 
-SamplerState samRandomVec
-{
-    Filter = MIN_MAG_LINEAR_MIP_POINT;
-    AddressU = WRAP;
-    AddressV = WRAP;
-};
-
 float PS(VertexOut pin) : SV_Target
 {
 	// Extract normal and depth info for p from the normal/depth map
@@ -46,13 +42,19 @@ float PS(VertexOut pin) : SV_Target
 	// Reconstruct 3D view space position for p
 	float3 p = (pz / pin.ToFarPlane.z) * pin.ToFarPlane;
 
-	// TODO: Sample from randomVecMap
-    float3 randVec = gRandomVectorMap.SampleLevel(samRandomVec, 4.0f * pin.Tex, 0.0f).rgb;
-    randVec = (2.0f * randVec) - 1.0f;
+	// The random vector tile repeats once per gRandomVectorMap size, one texel per pixel
+	uint noiseWidth, noiseHeight;
+	gRandomVectorMap.GetDimensions(noiseWidth, noiseHeight);
+
+	uint2 noiseSize = uint2(noiseWidth, noiseHeight);
+	uint2 noiseTexel = (uint2(pin.PosH.xy) + uint2(gNoiseOffset * noiseSize)) % noiseSize;
+
+	float3 randVec = gRandomVectorMap.Load(int3(noiseTexel, 0)).rgb;
+	randVec = normalize((2.0f * randVec) - 1.0f);
 
 	float occlusionSum = 0.0f;
 
-	for (int i = 0; i < 14; ++i)
+	for (uint i = 0; i < gSampleCount; ++i)
 	{
 		float3 offset = gOffsets[i].xyz;
 
@@ -92,7 +94,7 @@ float PS(VertexOut pin) : SV_Target
 		occlusionSum += occlusion;
 	}
 	
-	occlusionSum /= 14;
+	occlusionSum /= gSampleCount;
 	float access = 1.0f - occlusionSum;
 
 	return saturate(pow(access, 4.0f));
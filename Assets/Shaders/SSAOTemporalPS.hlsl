@@ -0,0 +1,94 @@
+//***************************************************************************************
+//***************************************************************************************
+
+cbuffer cbTemporal : register(b0)
+{
+	float4x4 gCurrentToPreviousView;
+	float4x4 gPreviousViewToTex;
+	float2 gTanHalfFov;
+	float gHistoryWeight;
+	float pad;
+};
+
+struct VertexOut
+{
+	float4 PosH : SV_POSITION;
+	float2 Tex  : TEXCOORD;
+};
+
+struct PixelOut
+{
+	float Ambient      : SV_Target0;
+	float4 NormalDepth : SV_Target1;
+};
+
+Texture2D gNormalDepthMap;
+Texture2D gAmbientMap;
+Texture2D gPreviousAmbientMap;
+Texture2D gPreviousNormalDepthMap;
+
+SamplerState samLinearClamp
+{
+	Filter = MIN_MAG_LINEAR_MIP_POINT;
+
+	AddressU = CLAMP;
+	AddressV = CLAMP;
+};
+
+// Must match SSAOTemporal
+static const float gDepthRejectTolerance = 0.05f;
+static const float gNormalRejectCosine = 0.9f;
+
+// Blends this frame's AO with the previous frame's at the same surface point. The
+// normals and depths are passed on so the next frame can check its history against them.
+PixelOut PS(VertexOut pin)
+{
+	PixelOut pout;
+
+	float4 normalDepth = gNormalDepthMap.Load(int3(pin.PosH.xy, 0));
+	float ambient = gAmbientMap.Load(int3(pin.PosH.xy, 0)).x;
+
+	pout.NormalDepth = normalDepth;
+
+	// Reconstruct the view space position and move it into the previous view
+	float2 ndc = float2(2.0f * pin.Tex.x - 1.0f, 1.0f - 2.0f * pin.Tex.y);
+	float3 p = float3(ndc * gTanHalfFov * normalDepth.w, normalDepth.w);
+
+	float3 previousPos = mul(float4(p, 1.0f), gCurrentToPreviousView).xyz;
+	float3 previousNormal = mul(normalDepth.xyz, (float3x3)gCurrentToPreviousView);
+
+	float4 previousTex = mul(float4(previousPos, 1.0f), gPreviousViewToTex);
+	previousTex.xy /= previousTex.w;
+
+	float historyWeight = gHistoryWeight;
+
+	// Reject points that were off screen or hidden by another surface last frame
+	if (any(previousTex.xy < 0.0f) || any(previousTex.xy > 1.0f))
+	{
+		historyWeight = 0.0f;
+	}
+	else
+	{
+		uint width, height;
+		gPreviousNormalDepthMap.GetDimensions(width, height);
+
+		int2 texel = min(int2(previousTex.xy * float2(width, height)), int2(width, height) - 1);
+		float4 historyNormalDepth = gPreviousNormalDepthMap.Load(int3(texel, 0));
+
+		if ((abs(historyNormalDepth.w - previousPos.z) > gDepthRejectTolerance * abs(previousPos.z)) ||
+			(dot(previousNormal, historyNormalDepth.xyz) < gNormalRejectCosine))
+		{
+			historyWeight = 0.0f;
+		}
+	}
+
+	// Rejected history is never read, so stale or uninitialised targets cannot leak in
+	pout.Ambient = ambient;
+	if (historyWeight > 0.0f)
+	{
+		float history = gPreviousAmbientMap.SampleLevel(samLinearClamp, previousTex.xy, 0.0f).x;
+		pout.Ambient = lerp(ambient, history, historyWeight);
+	}
+
+	return pout;
+}
\ No newline at end of file
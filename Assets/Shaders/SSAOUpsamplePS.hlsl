@@ -0,0 +1,91 @@
+//***************************************************************************************
+//***************************************************************************************
+
+#include "NormalDepthEncoding.hlsl"
+
+cbuffer cbResample : register(b0)
+{
+	uint gFactor;
+	uint gMode;
+	float2 gDepthParams;
+};
+
+struct VertexOut
+{
+	float4 PosH : SV_POSITION;
+	float2 Tex  : TEXCOORD;
+};
+
+Texture2D gNormalDepthMap : register(t0);
+Texture2D gReducedNormalDepthMap : register(t1);
+Texture2D gReducedAmbientMap : register(t2);
+
+// Compact normal/depth keeps an octahedral normal in gNormalDepthMap and depth in the
+// depth buffer
+#ifdef COMPACT_NORMAL_DEPTH
+Texture2D gDepthMap : register(t3);
+
+float4 LoadNormalDepth(int2 texel)
+{
+	float3 normal = DecodeNormal(gNormalDepthMap.Load(int3(texel, 0)).xy);
+	return float4(normal, ViewDepthFromHardware(gDepthMap.Load(int3(texel, 0)).r, gDepthParams));
+}
+#else
+float4 LoadNormalDepth(int2 texel)
+{
+	return gNormalDepthMap.Load(int3(texel, 0));
+}
+#endif
+
+// Must match SSAOResample
+static const float gDepthTolerance = 0.05f;
+static const float gNormalPower = 8.0f;
+
+// Joint bilateral upsample: blend the four nearest low resolution AO texels by bilinear
+// weight, scaled down where their depth or normal disagrees with this texel's own.
+float PS(VertexOut pin) : SV_Target
+{
+	uint width, height;
+	gReducedNormalDepthMap.GetDimensions(width, height);
+
+	float4 center = LoadNormalDepth(int2(pin.PosH.xy));
+
+	float2 uv = pin.PosH.xy / gFactor - 0.5f;
+	int2 base = int2(floor(uv));
+	float2 f = uv - base;
+
+	float sum = 0.0f;
+	float totalWeight = 0.0f;
+
+	float nearestAO = 0.0f;
+	float nearestDistance = 1e30f;
+
+	[unroll]
+	for (int k = 0; k < 4; ++k)
+	{
+		int2 offset = int2(k & 1, k >> 1);
+		float bilinear = (offset.x ? f.x : 1.0f - f.x) * (offset.y ? f.y : 1.0f - f.y);
+
+		int2 texel = clamp(base + offset, int2(0, 0), int2(width, height) - 1);
+
+		float4 sample = gReducedNormalDepthMap.Load(int3(texel, 0));
+		float sampleAO = gReducedAmbientMap.Load(int3(texel, 0)).x;
+
+		float distance = abs(sample.w - center.w);
+		float relative = distance / (gDepthTolerance * abs(center.w) + 1e-7f);
+		float depthWeight = 1.0f / (1.0f + relative * relative);
+		float normalWeight = pow(saturate(dot(sample.xyz, center.xyz)), gNormalPower);
+
+		float weight = bilinear * depthWeight * normalWeight;
+		sum += weight * sampleAO;
+		totalWeight += weight;
+
+		if (distance < nearestDistance)
+		{
+			nearestDistance = distance;
+			nearestAO = sampleAO;
+		}
+	}
+
+	return totalWeight > 1e-4f ? sum / totalWeight : nearestAO;
+}
\ No newline at end of file
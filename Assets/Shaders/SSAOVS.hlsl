@@ -5,7 +5,7 @@ cbuffer cbPerObject : register(b0)
 {
     float4x4 gViewToTexSpaceTransform;
 	float4 gFrustumFarCorners[4];
-	float4 gOffsets[14];
+	float4 gOffsets[32];
 };
 
 struct VertexIn
@@ -6,6 +6,7 @@
 
 #include "LightHelper.hlsl"
 
+// Casters are drawn instanced, so this holds the cascade's view-projection only.
 cbuffer cbPerObject : register(b0)
 {
 	float4x4 gWorldViewProj;
@@ -14,6 +15,9 @@ cbuffer cbPerObject : register(b0)
 struct VertexIn
 {
 	float3 PosL     : POSITION;
+
+	// Per instance
+	row_major float4x4 World : WORLD;
 };
 
 struct VertexOut
@@ -24,6 +28,7 @@ struct VertexOut
 VertexOut VS(VertexIn vin)
 {
 	VertexOut vout;
-	vout.PosH = mul(float4(vin.PosL, 1.0f), gWorldViewProj);
+	float4 posW = mul(float4(vin.PosL, 1.0f), vin.World);
+	vout.PosH = mul(posW, gWorldViewProj);
 	return vout;
 }
@@ -1,6 +1,8 @@
 #ifndef CONSTANTBUFFERS_H
 #define CONSTANTBUFFERS_H
 
+#include "ShadowCascades.h"
+
 struct ConstBufferPerObjectDebug
 {
 	DirectX::XMMATRIX world;
@@ -13,8 +15,8 @@ struct ConstBufferPerObject
 	DirectX::XMMATRIX worldViewProj;
 	DirectX::XMMATRIX texTransform;
 	DirectX::XMMATRIX worldViewProjTex;
-	DirectX::XMMATRIX shadowTransform;
 	Material material;
+	DirectX::XMFLOAT4 probeBlend;
 };
 
 struct ConstBufferPerFrame
@@ -44,6 +46,23 @@ struct ConstBufferBlurParams
 	DirectX::XMFLOAT2 pad;
 };
 
+// Kernel for SSAOBlurCS. weights[i / 4] holds SSAOBlur weights i to i + 3.
+struct ConstBufferSSAOBlur
+{
+	DirectX::XMFLOAT4 weights[5];
+	int radius;
+	DirectX::XMFLOAT3 pad;
+};
+
+// Resolution reduction factor and SSAODownsampleMode for the SSAO resample passes.
+// depthParams recover view depth from the depth buffer in compact normal/depth mode.
+struct ConstBufferSSAOResample
+{
+	UINT factor;
+	UINT mode;
+	DirectX::XMFLOAT2 depthParams;
+};
+
 struct ConstBufferPerObjectNormalDepth
 {
 	DirectX::XMMATRIX worldView;
@@ -55,7 +74,22 @@ struct ConstBufferPerFrameSSAO
 {
 	DirectX::XMMATRIX viewTex;
 	DirectX::XMFLOAT4 frustumFarCorners[4];
-	DirectX::XMFLOAT4 offsets[14];
+	DirectX::XMFLOAT4 offsets[32];
+
+	// Offsets used this frame, and the shift of the random vector tiling
+	UINT sampleCount;
+	DirectX::XMFLOAT2 noiseOffset;
+	float pad;
+};
+
+// Reprojection of the previous frame's SSAO into this one
+struct ConstBufferSSAOTemporal
+{
+	DirectX::XMMATRIX currentToPreviousView;
+	DirectX::XMMATRIX previousViewToTex;
+	DirectX::XMFLOAT2 tanHalfFov;
+	float historyWeight;
+	float pad;
 };
 
 struct ConstBufferPerFrameParticle
@@ -76,4 +110,13 @@ struct ConstBufferPerObjectShadow
 	DirectX::XMMATRIX worldViewProj;
 };
 
+// shadowTexelSize is the size of one shadow map texel in texture space, for the PCF taps.
+struct ConstBufferShadowCascades
+{
+	DirectX::XMMATRIX shadowTransforms[ShadowCascades::MaxCascades];
+	UINT cascadeCount;
+	float shadowTexelSize;
+	DirectX::XMUINT2 pad;
+};
+
 #endif // CONSTANTBUFFERS_H
\ No newline at end of file
@@ -0,0 +1,95 @@
+/*  ======================
+	Summary: Shared vertex and index buffers for static meshes
+	======================  */
+
+#include "GeometryBuffers.h"
+
+GeometryBuffers::GeometryBuffers(ID3D11Device* device, ID3D11DeviceContext* context, UINT verticesPerPage, UINT indicesPerPage)
+	: mVertexAllocator(verticesPerPage),
+	mIndexAllocator(indicesPerPage)
+{
+	mDevice = device;
+	mContext = context;
+}
+
+GeometryBuffers::~GeometryBuffers()
+{
+	// Meshes still using a page keep their own reference to it
+	for (auto it = mVertexPages.begin(); it != mVertexPages.end(); ++it)
+	{
+		ReleaseCOM(*it);
+	}
+
+	for (auto it = mIndexPages.begin(); it != mIndexPages.end(); ++it)
+	{
+		ReleaseCOM(*it);
+	}
+}
+
+void GeometryBuffers::Add(Mesh* mesh)
+{
+	if (mesh->VertexBuffer || mesh->VertexCount == 0)
+	{
+		return;
+	}
+
+	mesh->VertexRange = mVertexAllocator.Allocate(mesh->VertexCount);
+	mesh->VertexBuffer = GetPage(mVertexPages, mVertexAllocator, mesh->VertexRange.Page, sizeof(Vertex), D3D11_BIND_VERTEX_BUFFER);
+	mesh->VertexBuffer->AddRef();
+	mesh->BaseVertex = mesh->VertexRange.Offset;
+
+	Upload(mesh->VertexBuffer, &mesh->Vertices[0], mesh->VertexRange.Offset, mesh->VertexCount, sizeof(Vertex));
+
+	mesh->IndexRange = mIndexAllocator.Allocate(mesh->IndexCount);
+	if (mesh->IndexCount > 0)
+	{
+		mesh->IndexBuffer = GetPage(mIndexPages, mIndexAllocator, mesh->IndexRange.Page, sizeof(UINT), D3D11_BIND_INDEX_BUFFER);
+		mesh->IndexBuffer->AddRef();
+		mesh->StartIndex = mesh->IndexRange.Offset;
+
+		Upload(mesh->IndexBuffer, &mesh->Indices[0], mesh->IndexRange.Offset, mesh->IndexCount, sizeof(UINT));
+	}
+
+	mesh->Storage = this;
+}
+
+void GeometryBuffers::Free(Mesh* mesh)
+{
+	mVertexAllocator.Free(mesh->VertexRange);
+	mIndexAllocator.Free(mesh->IndexRange);
+	mesh->Storage = nullptr;
+}
+
+ID3D11Buffer* GeometryBuffers::GetPage(std::vector<ID3D11Buffer*>& pages, const BufferAllocator& allocator, UINT page, UINT stride, UINT bindFlags)
+{
+	while (pages.size() <= page)
+	{
+		D3D11_BUFFER_DESC desc;
+		desc.ByteWidth = allocator.GetPageSize(static_cast<UINT>(pages.size())) * stride;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.BindFlags = bindFlags;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = 0;
+		desc.StructureByteStride = 0;
+
+		ID3D11Buffer* buffer = nullptr;
+		HR(mDevice->CreateBuffer(&desc, nullptr, &buffer));
+		pages.push_back(buffer);
+	}
+
+	return pages[page];
+}
+
+void GeometryBuffers::Upload(ID3D11Buffer* buffer, const void* data, UINT offset, UINT count, UINT stride)
+{
+	// Pages are written once per mesh, outside the frame
+	D3D11_BOX box;
+	box.left = offset * stride;
+	box.right = (offset + count) * stride;
+	box.top = 0;
+	box.bottom = 1;
+	box.front = 0;
+	box.back = 1;
+
+	mContext->UpdateSubresource(buffer, 0, &box, data, 0, 0);
+}
@@ -0,0 +1,46 @@
+/*  ======================
+	Summary: Shared vertex and index buffers for static meshes
+	======================  */
+
+#ifndef GEOMETRY_BUFFERS_H
+#define GEOMETRY_BUFFERS_H
+
+#include "D3DUtil.h"
+#include "BufferAllocator.h"
+#include "MeshCache.h"
+
+// Packs static meshes into a few large vertex and index buffers. Each mesh gets a
+// range from a BufferAllocator and is drawn with its BaseVertex and StartIndex, so
+// consecutive draws of different meshes keep the same buffers bound. Pages are
+// created as the allocators open them; meshes hold a reference to their page.
+class GeometryBuffers : public MeshStorage
+{
+public:
+	GeometryBuffers(ID3D11Device* device, ID3D11DeviceContext* context, UINT verticesPerPage, UINT indicesPerPage);
+	~GeometryBuffers();
+
+	// Copies the mesh into the shared buffers and points it at its ranges. Meshes that
+	// already have buffers are left alone.
+	void Add(Mesh* mesh);
+
+	void Free(Mesh* mesh) override;
+
+	inline const BufferAllocator& GetVertexAllocator() const { return mVertexAllocator; }
+	inline const BufferAllocator& GetIndexAllocator() const { return mIndexAllocator; }
+
+private:
+	ID3D11Buffer* GetPage(std::vector<ID3D11Buffer*>& pages, const BufferAllocator& allocator, UINT page, UINT stride, UINT bindFlags);
+	void Upload(ID3D11Buffer* buffer, const void* data, UINT offset, UINT count, UINT stride);
+
+private:
+	ID3D11Device* mDevice;
+	ID3D11DeviceContext* mContext;
+
+	BufferAllocator mVertexAllocator;
+	BufferAllocator mIndexAllocator;
+
+	std::vector<ID3D11Buffer*> mVertexPages;
+	std::vector<ID3D11Buffer*> mIndexPages;
+};
+
+#endif // GEOMETRY_BUFFERS_H
\ No newline at end of file
@@ -0,0 +1,504 @@
+/*  =======================
+	Summary: Synthetic frame benchmark
+	=======================  */
+
+// Times a synthetic frame without a window or device. This is not MyApp::DrawScene:
+// the real passes create D3D resources as they are set up, so the recorders here stand
+// in for them. They build a render graph shaped like the one MyApp builds and issue the
+// same kind of commands against placeholder pipeline objects. Every pass records in
+// parallel, and the streams are filtered as the D3D11 backend does and replayed on a
+// NullRenderBackend. Prints what the frames submitted and returns non-zero if a frame
+// did not come out as expected.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "CommandBuffer.h"
+#include "RenderBackend.h"
+#include "RenderGraph.h"
+#include "RenderQueue.h"
+#include "StateFilter.h"
+#include "WorkerPool.h"
+
+namespace
+{
+	// DXGI and D3D11 values the frame uses; the stream only carries them.
+	const uint32_t FORMAT_R16G16B16A16_FLOAT = 10;
+	const uint32_t FORMAT_R24G8_TYPELESS = 44;
+	const uint32_t FORMAT_R16_FLOAT = 54;
+	const uint32_t FORMAT_R32_UINT = 42;
+	const uint32_t TOPOLOGY_TRIANGLELIST = 4;
+	const uint32_t TOPOLOGY_POINTLIST = 1;
+	const uint32_t CLEAR_DEPTH_STENCIL = 3;
+
+	const uint32_t Width = 1280;
+	const uint32_t Height = 720;
+	const int CascadeCount = 4;
+	const int BlurCount = 2;
+
+	const uint32_t VariantCount = 4;
+	const uint32_t ParamsCount = 8;
+	const uint32_t TextureSetCount = 32;
+	const uint32_t MaxInstances = 64;
+
+	// Stand-ins for pipeline objects. The null backend never dereferences them; distinct
+	// addresses let the state filter see the same state changes it would on the device.
+	char sPipelineObjects[1024];
+
+	enum PipelineObject
+	{
+		OBJ_SHADOW_VS = 0,
+		OBJ_NORMAL_DEPTH_VS,
+		OBJ_NORMAL_DEPTH_PS,
+		OBJ_QUAD_VS,
+		OBJ_DOWNSAMPLE_PS,
+		OBJ_SSAO_PS,
+		OBJ_BLUR_PS,
+		OBJ_UPSAMPLE_PS,
+		OBJ_DEBUG_PS,
+		OBJ_PARTICLE_VS,
+		OBJ_PARTICLE_GS,
+		OBJ_PARTICLE_PS,
+		OBJ_INPUT_LAYOUT,
+		OBJ_QUAD_VB,
+		OBJ_QUAD_IB,
+		OBJ_PARTICLE_VB,
+		OBJ_SAMPLER = OBJ_PARTICLE_VB + 2,
+		OBJ_SCENE_VS = 32,
+		OBJ_SCENE_PS = OBJ_SCENE_VS + VariantCount,
+		OBJ_MESH_VB = OBJ_SCENE_PS + VariantCount,
+		OBJ_TEXTURES = OBJ_MESH_VB + VariantCount,
+		OBJ_CONSTANTS = OBJ_TEXTURES + TextureSetCount,
+		OBJ_SHADOW_DSV = OBJ_CONSTANTS + 16,
+		OBJ_VIEWS = 256
+	};
+
+	template<class T>
+	T* GetPipelineObject(uint32_t id)
+	{
+		return reinterpret_cast<T*>(&sPipelineObjects[id]);
+	}
+
+	// Every resource of the graph gets its own views, like RenderGraphTextures hands out.
+	template<class T>
+	T* GetView(const RenderGraph& graph, RGHandle handle, uint32_t kind)
+	{
+		return GetPipelineObject<T>(OBJ_VIEWS + 4 * graph.GetResourceIndex(handle) + kind);
+	}
+
+	struct HeadlessObject
+	{
+		float X;
+		float Z;
+		uint32_t Variant;
+		uint32_t Params;
+		uint32_t TextureSet;
+		uint32_t IndexCount;
+	};
+
+	class HeadlessFrame
+	{
+	public:
+		HeadlessFrame(uint32_t objectCount)
+		{
+			srand(1);
+
+			for (uint32_t i = 0; i < objectCount; ++i)
+			{
+				HeadlessObject object;
+				object.X = static_cast<float>(rand() % 2000) * 0.1f - 100.0f;
+				object.Z = static_cast<float>(rand() % 2000) * 0.1f - 100.0f;
+				object.Variant = rand() % VariantCount;
+				object.Params = rand() % ParamsCount;
+				object.TextureSet = rand() % TextureSetCount;
+				object.IndexCount = 36 * (1 + rand() % 8);
+				mObjects.push_back(object);
+			}
+
+			mEyeZ = -120.0f;
+		}
+
+		void Setup(RenderGraph& graph)
+		{
+			graph.Reset();
+			mGraph = &graph;
+
+			RGTextureDesc normalDepthDesc = { Width, Height, FORMAT_R16G16B16A16_FLOAT, 8 };
+			RGTextureDesc depthDesc = { Width, Height, FORMAT_R24G8_TYPELESS, 4 };
+			RGTextureDesc reducedDesc = { Width / 2, Height / 2, FORMAT_R16G16B16A16_FLOAT, 8 };
+			RGTextureDesc ambientDesc = { Width / 2, Height / 2, FORMAT_R16_FLOAT, 2 };
+			RGTextureDesc upsampledDesc = { Width, Height, FORMAT_R16_FLOAT, 2 };
+
+			RGHandle sceneColor = graph.ImportTexture("BackBuffer");
+			RGHandle sceneDepth = graph.ImportTexture("BackBufferDepth");
+
+			uint32_t pass = graph.AddPass("Shadow", [this](CommandBuffer& commands) { RecordShadow(commands); });
+			mShadowMap = graph.Write(pass, graph.ImportTexture("ShadowMap"), RG_BIND_DEPTH_STENCIL);
+
+			pass = graph.AddPass("NormalDepth", [this](CommandBuffer& commands) { RecordNormalDepth(commands); });
+			mNormalDepthMap = graph.Write(pass, graph.CreateTexture("NormalDepthMap", normalDepthDesc), RG_BIND_RENDER_TARGET);
+			mNormalDepthZ = graph.Write(pass, graph.CreateTexture("NormalDepthZ", depthDesc), RG_BIND_DEPTH_STENCIL);
+
+			pass = graph.AddPass("SSAODownsample", [this](CommandBuffer& commands) { RecordFullScreen(commands, OBJ_DOWNSAMPLE_PS, mNormalDepthMap, mReducedNormalDepthMap); });
+			graph.Read(pass, mNormalDepthMap, STAGE_PS, 0);
+			mReducedNormalDepthMap = graph.Write(pass, graph.CreateTexture("ReducedNormalDepthMap", reducedDesc), RG_BIND_RENDER_TARGET);
+
+			pass = graph.AddPass("SSAO", [this](CommandBuffer& commands) { RecordFullScreen(commands, OBJ_SSAO_PS, mReducedNormalDepthMap, mAmbientMaps[0]); });
+			graph.Read(pass, mReducedNormalDepthMap, STAGE_PS, 0);
+			mAmbientMaps[0] = graph.Write(pass, graph.CreateTexture("AmbientMap", ambientDesc), RG_BIND_RENDER_TARGET);
+
+			for (int i = 0; i < 2 * BlurCount; ++i)
+			{
+				pass = graph.AddPass((i % 2) == 0 ? "BlurHorizontal" : "BlurVertical", [this, i](CommandBuffer& commands) { RecordFullScreen(commands, OBJ_BLUR_PS, mAmbientMaps[i], mAmbientMaps[i + 1]); });
+				graph.Read(pass, mReducedNormalDepthMap, STAGE_PS, 0);
+				graph.Read(pass, mAmbientMaps[i], STAGE_PS, 1);
+				mAmbientMaps[i + 1] = graph.Write(pass, graph.CreateTexture("AmbientMapBlurred", ambientDesc), RG_BIND_RENDER_TARGET);
+			}
+
+			pass = graph.AddPass("SSAOUpsample", [this](CommandBuffer& commands) { RecordFullScreen(commands, OBJ_UPSAMPLE_PS, mAmbientMaps[2 * BlurCount], mSSAOMap); });
+			graph.Read(pass, mNormalDepthMap, STAGE_PS, 0);
+			graph.Read(pass, mReducedNormalDepthMap, STAGE_PS, 1);
+			graph.Read(pass, mAmbientMaps[2 * BlurCount], STAGE_PS, 2);
+			mSSAOMap = graph.Write(pass, graph.CreateTexture("SSAOMap", upsampledDesc), RG_BIND_RENDER_TARGET);
+
+			pass = graph.AddPass("Scene", [this](CommandBuffer& commands) { RecordScene(commands); });
+			graph.Read(pass, mShadowMap, STAGE_PS, 2);
+			graph.Read(pass, mSSAOMap, STAGE_PS, 3);
+			mSceneColor = graph.Write(pass, sceneColor, RG_BIND_RENDER_TARGET);
+			mSceneDepth = graph.Write(pass, sceneDepth, RG_BIND_DEPTH_STENCIL);
+
+			pass = graph.AddPass("Particles", [this](CommandBuffer& commands) { RecordParticles(commands); });
+			mSceneColor = graph.Write(pass, mSceneColor, RG_BIND_RENDER_TARGET);
+			mSceneDepth = graph.Write(pass, mSceneDepth, RG_BIND_DEPTH_STENCIL);
+
+			// Nothing consumes this one, so the graph culls it
+			pass = graph.AddPass("Unused", [this](CommandBuffer& commands) { RecordFullScreen(commands, OBJ_DEBUG_PS, mSSAOMap, mUnused); });
+			graph.Read(pass, mSSAOMap, STAGE_PS, 0);
+			mUnused = graph.Write(pass, graph.CreateTexture("Unused", upsampledDesc), RG_BIND_RENDER_TARGET);
+
+			graph.MarkOutput(mSceneColor);
+		}
+
+		// Moves the camera along the scene like a walk through it.
+		void Update()
+		{
+			mEyeZ += 0.5f;
+			if (mEyeZ > 100.0f)
+			{
+				mEyeZ = -120.0f;
+			}
+		}
+
+	private:
+		void RecordShadow(CommandBuffer& commands)
+		{
+			commands.SetInputLayout(GetPipelineObject<ID3D11InputLayout>(OBJ_INPUT_LAYOUT));
+			commands.SetPrimitiveTopology(TOPOLOGY_TRIANGLELIST);
+			commands.SetVertexShader(GetPipelineObject<ID3D11VertexShader>(OBJ_SHADOW_VS));
+			commands.SetPixelShader(nullptr);
+
+			for (int cascade = 0; cascade < CascadeCount; ++cascade)
+			{
+				ID3D11DepthStencilView* dsv = GetPipelineObject<ID3D11DepthStencilView>(OBJ_SHADOW_DSV + cascade);
+				commands.SetRenderTargets(0, nullptr, dsv);
+				commands.SetViewport(0.0f, 0.0f, 1024.0f, 1024.0f, 0.0f, 1.0f);
+				commands.ClearDepthStencil(dsv, CLEAR_DEPTH_STENCIL, 1.0f, 0);
+
+				for (const HeadlessObject& object : mObjects)
+				{
+					DrawObject(commands, object, 64);
+				}
+			}
+		}
+
+		void RecordNormalDepth(CommandBuffer& commands)
+		{
+			ID3D11RenderTargetView* rtv = GetView<ID3D11RenderTargetView>(*mGraph, mNormalDepthMap, 1);
+			ID3D11DepthStencilView* dsv = GetView<ID3D11DepthStencilView>(*mGraph, mNormalDepthZ, 2);
+			const float clearColor[4] = { 0.0f, 0.0f, -1.0f, 1e5f };
+
+			commands.SetRenderTargets(1, &rtv, dsv);
+			commands.SetViewport(0.0f, 0.0f, static_cast<float>(Width), static_cast<float>(Height), 0.0f, 1.0f);
+			commands.ClearRenderTarget(rtv, clearColor);
+			commands.ClearDepthStencil(dsv, CLEAR_DEPTH_STENCIL, 1.0f, 0);
+
+			commands.SetInputLayout(GetPipelineObject<ID3D11InputLayout>(OBJ_INPUT_LAYOUT));
+			commands.SetPrimitiveTopology(TOPOLOGY_TRIANGLELIST);
+			commands.SetVertexShader(GetPipelineObject<ID3D11VertexShader>(OBJ_NORMAL_DEPTH_VS));
+			commands.SetPixelShader(GetPipelineObject<ID3D11PixelShader>(OBJ_NORMAL_DEPTH_PS));
+
+			for (const HeadlessObject& object : mObjects)
+			{
+				if (IsVisible(object))
+				{
+					DrawObject(commands, object, 192);
+				}
+			}
+		}
+
+		void RecordFullScreen(CommandBuffer& commands, uint32_t pixelShader, RGHandle input, RGHandle output)
+		{
+			ID3D11RenderTargetView* rtv = GetView<ID3D11RenderTargetView>(*mGraph, output, 1);
+			ID3D11ShaderResourceView* srv = GetView<ID3D11ShaderResourceView>(*mGraph, input, 0);
+			ID3D11Buffer* constants = GetPipelineObject<ID3D11Buffer>(OBJ_CONSTANTS + pixelShader);
+			ID3D11SamplerState* sampler = GetPipelineObject<ID3D11SamplerState>(OBJ_SAMPLER);
+
+			commands.SetRenderTargets(1, &rtv, nullptr);
+			commands.SetInputLayout(GetPipelineObject<ID3D11InputLayout>(OBJ_INPUT_LAYOUT));
+			commands.SetPrimitiveTopology(TOPOLOGY_TRIANGLELIST);
+			commands.SetVertexBuffer(0, GetPipelineObject<ID3D11Buffer>(OBJ_QUAD_VB), 32, 0);
+			commands.SetIndexBuffer(GetPipelineObject<ID3D11Buffer>(OBJ_QUAD_IB), FORMAT_R32_UINT, 0);
+			commands.SetVertexShader(GetPipelineObject<ID3D11VertexShader>(OBJ_QUAD_VS));
+			commands.SetPixelShader(GetPipelineObject<ID3D11PixelShader>(pixelShader));
+
+			float* cb = static_cast<float*>(commands.UpdateConstants(constants, 16));
+			cb[0] = 1.0f / static_cast<float>(Width);
+			cb[1] = 1.0f / static_cast<float>(Height);
+			cb[2] = 0.0f;
+			cb[3] = 0.0f;
+
+			commands.SetConstantBuffers(STAGE_PS, 0, 1, &constants);
+			commands.SetShaderResources(STAGE_PS, 1, 1, &srv);
+			commands.SetSamplers(STAGE_PS, 0, 1, &sampler);
+			commands.DrawIndexed(6, 0, 0);
+		}
+
+		// Queues the visible objects and draws them in sort key order, instancing runs
+		// that share a variant, parameters and texture set.
+		void RecordScene(CommandBuffer& commands)
+		{
+			ID3D11RenderTargetView* rtv = GetView<ID3D11RenderTargetView>(*mGraph, mSceneColor, 1);
+			ID3D11DepthStencilView* dsv = GetView<ID3D11DepthStencilView>(*mGraph, mSceneDepth, 2);
+			ID3D11ShaderResourceView* shadowMap = GetView<ID3D11ShaderResourceView>(*mGraph, mShadowMap, 0);
+			ID3D11ShaderResourceView* ssaoMap = GetView<ID3D11ShaderResourceView>(*mGraph, mSSAOMap, 0);
+			const float clearColor[4] = { 0.75f, 0.75f, 0.75f, 1.0f };
+
+			commands.SetRenderTargets(1, &rtv, dsv);
+			commands.SetViewport(0.0f, 0.0f, static_cast<float>(Width), static_cast<float>(Height), 0.0f, 1.0f);
+			commands.ClearRenderTarget(rtv, clearColor);
+			commands.ClearDepthStencil(dsv, CLEAR_DEPTH_STENCIL, 1.0f, 0);
+			commands.SetShaderResources(STAGE_PS, 2, 1, &shadowMap);
+			commands.SetShaderResources(STAGE_PS, 3, 1, &ssaoMap);
+
+			RenderQueue queue;
+			for (uint32_t i = 0; i < static_cast<uint32_t>(mObjects.size()); ++i)
+			{
+				const HeadlessObject& object = mObjects[i];
+				if (IsVisible(object))
+				{
+					uint32_t depth = RenderQueue::QuantizeDepth(object.Z - mEyeZ, 1.0f, 1000.0f);
+					queue.Add(RenderQueue::MakeKey(0, object.Variant, object.Params, object.TextureSet, depth), i);
+				}
+			}
+			queue.Sort();
+
+			std::vector<RenderQueueRun> runs;
+			uint64_t stateMask = RenderQueue::VariantMask | RenderQueue::ParamsMask | RenderQueue::TextureSetMask;
+			queue.BuildRuns(stateMask, MaxInstances, runs);
+
+			commands.SetInputLayout(GetPipelineObject<ID3D11InputLayout>(OBJ_INPUT_LAYOUT));
+			commands.SetPrimitiveTopology(TOPOLOGY_TRIANGLELIST);
+
+			for (const RenderQueueRun& run : runs)
+			{
+				const HeadlessObject& first = mObjects[queue.GetItem(run.First).Payload];
+				ID3D11Buffer* constants = GetPipelineObject<ID3D11Buffer>(OBJ_CONSTANTS);
+				ID3D11ShaderResourceView* texture = GetPipelineObject<ID3D11ShaderResourceView>(OBJ_TEXTURES + first.TextureSet);
+
+				commands.SetVertexShader(GetPipelineObject<ID3D11VertexShader>(OBJ_SCENE_VS + first.Variant));
+				commands.SetPixelShader(GetPipelineObject<ID3D11PixelShader>(OBJ_SCENE_PS + first.Variant));
+				commands.SetVertexBuffer(0, GetPipelineObject<ID3D11Buffer>(OBJ_MESH_VB + first.Variant), 32, 0);
+
+				uint32_t* params = static_cast<uint32_t*>(commands.UpdateConstants(constants, 32));
+				for (uint32_t i = 0; i < 8; ++i)
+				{
+					params[i] = (first.Params >> i) & 1;
+				}
+
+				commands.SetConstantBuffers(STAGE_PS, 2, 1, &constants);
+				commands.SetShaderResources(STAGE_PS, 0, 1, &texture);
+
+				// Per instance world matrices
+				float* instances = static_cast<float*>(commands.SetVertexData(1, 64, 64 * run.Count));
+				for (uint32_t i = 0; i < run.Count; ++i)
+				{
+					const HeadlessObject& object = mObjects[queue.GetItem(run.First + i).Payload];
+					float* world = instances + 16 * i;
+					for (int j = 0; j < 16; ++j)
+					{
+						world[j] = (j % 5) == 0 ? 1.0f : 0.0f;
+					}
+					world[12] = object.X;
+					world[14] = object.Z;
+				}
+
+				commands.DrawIndexedInstanced(first.IndexCount, run.Count, 0, 0, 0);
+			}
+
+			commands.ClearShaderResources(STAGE_PS, 2, 2);
+		}
+
+		void RecordParticles(CommandBuffer& commands)
+		{
+			ID3D11RenderTargetView* rtv = GetView<ID3D11RenderTargetView>(*mGraph, mSceneColor, 1);
+			ID3D11DepthStencilView* dsv = GetView<ID3D11DepthStencilView>(*mGraph, mSceneDepth, 2);
+
+			// Stream out the simulation step, then draw the particles it produced
+			commands.SetPrimitiveTopology(TOPOLOGY_POINTLIST);
+			commands.SetVertexShader(GetPipelineObject<ID3D11VertexShader>(OBJ_PARTICLE_VS));
+			commands.SetGeometryShader(GetPipelineObject<ID3D11GeometryShader>(OBJ_PARTICLE_GS));
+			commands.SetPixelShader(nullptr);
+			commands.SetVertexBuffer(0, GetPipelineObject<ID3D11Buffer>(OBJ_PARTICLE_VB), 44, 0);
+			commands.SetStreamOutTarget(GetPipelineObject<ID3D11Buffer>(OBJ_PARTICLE_VB + 1), 0);
+			commands.DrawAuto();
+			commands.SetStreamOutTarget(nullptr, 0);
+
+			commands.SetRenderTargets(1, &rtv, dsv);
+			commands.SetVertexBuffer(0, GetPipelineObject<ID3D11Buffer>(OBJ_PARTICLE_VB + 1), 44, 0);
+			commands.SetPixelShader(GetPipelineObject<ID3D11PixelShader>(OBJ_PARTICLE_PS));
+			commands.DrawAuto();
+			commands.SetGeometryShader(nullptr);
+		}
+
+		void DrawObject(CommandBuffer& commands, const HeadlessObject& object, uint32_t constantSize)
+		{
+			ID3D11Buffer* constants = GetPipelineObject<ID3D11Buffer>(OBJ_CONSTANTS);
+
+			float* cb = static_cast<float*>(commands.UpdateConstants(constants, constantSize));
+			cb[0] = object.X;
+			cb[1] = object.Z;
+
+			commands.SetConstantBuffers(STAGE_VS, 0, 1, &constants);
+			commands.SetVertexBuffer(0, GetPipelineObject<ID3D11Buffer>(OBJ_MESH_VB + object.Variant), 32, 0);
+			commands.DrawIndexed(object.IndexCount, 0, 0);
+		}
+
+		bool IsVisible(const HeadlessObject& object) const
+		{
+			float depth = object.Z - mEyeZ;
+			return depth > 1.0f && (object.X < depth && -object.X < depth);
+		}
+
+	private:
+		std::vector<HeadlessObject> mObjects;
+		float mEyeZ;
+
+		RenderGraph* mGraph;
+		RGHandle mShadowMap;
+		RGHandle mNormalDepthMap;
+		RGHandle mNormalDepthZ;
+		RGHandle mReducedNormalDepthMap;
+		RGHandle mAmbientMaps[2 * BlurCount + 1];
+		RGHandle mSSAOMap;
+		RGHandle mSceneColor;
+		RGHandle mSceneDepth;
+		RGHandle mUnused;
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t frameCount = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 60;
+	uint32_t objectCount = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 2000;
+
+	HeadlessFrame frame(objectCount);
+	RenderGraph graph;
+	frame.Setup(graph);
+
+	if (!graph.Compile())
+	{
+		printf("HeadlessFrame: the render graph has a cycle\n");
+		return 1;
+	}
+
+	uint32_t passCount = static_cast<uint32_t>(graph.GetExecutionOrder().size());
+	std::vector<CommandBuffer*> passCommands;
+	for (uint32_t i = 0; i < passCount; ++i)
+	{
+		passCommands.push_back(new CommandBuffer());
+	}
+
+	CommandBuffer filtered;
+	StateFilter filter;
+	NullRenderBackend backend;
+
+	double recordSeconds = 0.0;
+	double submitSeconds = 0.0;
+	uint32_t recordedCount = 0;
+	bool isValid = true;
+
+	for (uint32_t f = 0; f < frameCount; ++f)
+	{
+		frame.Update();
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+		WorkerPool::Shared().ParallelFor(passCount, [&](uint32_t i)
+		{
+			passCommands[i]->Reset();
+			graph.RecordPass(i, *passCommands[i]);
+		});
+
+		std::chrono::high_resolution_clock::time_point recorded = std::chrono::high_resolution_clock::now();
+
+		// Submit in graph order, filtered like the D3D11 backend filters before issuing
+		uint32_t drawsBefore = backend.GetDrawCount();
+		backend.BeginFrame();
+		for (uint32_t i = 0; i < passCount; ++i)
+		{
+			recordedCount += passCommands[i]->GetCommandCount();
+
+			filtered.Reset();
+			filter.Filter(*passCommands[i], filtered);
+			backend.Execute(filtered);
+		}
+
+		std::chrono::high_resolution_clock::time_point submitted = std::chrono::high_resolution_clock::now();
+		recordSeconds += std::chrono::duration<double>(recorded - start).count();
+		submitSeconds += std::chrono::duration<double>(submitted - recorded).count();
+
+		// Every frame has the shadow, normal/depth, SSAO and scene draws at least
+		if (backend.GetDrawCount() - drawsBefore < CascadeCount + 2 * BlurCount + 4)
+		{
+			isValid = false;
+		}
+	}
+
+	uint32_t culledCount = 0;
+	for (uint32_t i = 0; i < graph.GetPassCount(); ++i)
+	{
+		culledCount += graph.IsPassCulled(i) ? 1 : 0;
+	}
+
+	double frames = static_cast<double>(frameCount > 0 ? frameCount : 1);
+	printf("HeadlessFrame: %u frames, %u objects, %u passes (%u culled), %u worker threads\n",
+		frameCount, objectCount, passCount, culledCount, WorkerPool::Shared().GetWorkerCount());
+	printf("  commands: %u recorded, %u issued after filtering\n", recordedCount, backend.GetCommandCount());
+	printf("  draws: %u, instances: %u, constant bytes: %u, vertex bytes: %u\n",
+		backend.GetDrawCount(), backend.GetInstanceCount(), backend.GetConstantBytes(), backend.GetVertexBytes());
+	printf("  transient textures: %u, %llu bytes (%llu unaliased)\n", graph.GetPhysicalTextureCount(),
+		static_cast<unsigned long long>(graph.GetTransientBytes()), static_cast<unsigned long long>(graph.GetUnaliasedBytes()));
+	printf("  record %.3f ms/frame, filter and execute %.3f ms/frame\n", 1000.0 * recordSeconds / frames, 1000.0 * submitSeconds / frames);
+
+	for (uint32_t i = 0; i < passCount; ++i)
+	{
+		delete passCommands[i];
+	}
+
+	// The unconsumed pass must be culled and the filter must never add commands
+	if (culledCount != 1 || backend.GetCommandCount() > recordedCount)
+	{
+		isValid = false;
+	}
+
+	if (!isValid)
+	{
+		printf("HeadlessFrame: FAILED\n");
+		return 1;
+	}
+
+	return 0;
+}
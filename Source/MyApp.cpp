@@ -7,18 +7,57 @@
 #include "MathHelper.h"
 #include "D3DCompiler.h"
 
+#include <algorithm>
+
+namespace
+{
+	// Pixel shader parameter bits carried in the scene sort keys
+	enum ScenePSParams
+	{
+		PSP_USE_TEXTURE = 1,
+		PSP_ALPHA_CLIP = 2,
+		PSP_FOG = 4,
+		PSP_REFLECTION = 8,
+		PSP_USE_NORMAL = 16
+	};
+
+	// Reflection captures: far plane, and distance beyond which coarse meshes are drawn
+	const float CaptureFarZ = 100.0f;
+	const float CaptureLodDistance = 8.0f;
+
+	// Angle in radians the shadow light may turn before every probe is re-captured
+	const float CaptureLightTolerance = 0.05f;
+}
+
 /* D3DApp Functions*/
 
 MyApp::MyApp(HINSTANCE Instance) :
 	D3DApp(Instance)
 {
 	mWindowTitle = L"DX11 Sample";
+
+	mDeviceBackend = nullptr;
+	mBackend = nullptr;
+	mGraphTextures = nullptr;
+	mTargetPool = nullptr;
+	mGeometryBuffers = nullptr;
+	mReflectionProbes = nullptr;
 }
 
 MyApp::~MyApp()
 {
 	delete rp_SSAO;
 	delete rp_Particle;
+	delete mDeviceBackend;
+	delete mGraphTextures;
+	delete mTargetPool;
+	delete mGeometryBuffers;
+	delete mReflectionProbes;
+
+	for (auto it = mPassCommands.begin(); it != mPassCommands.end(); ++it)
+	{
+		delete *it;
+	}
 }
 
 bool MyApp::Init()
@@ -28,6 +67,16 @@ bool MyApp::Init()
 
 	mObjectStore = new GObjectStore();
 
+	// Replay recorded commands on the device by default
+	mDeviceBackend = new RenderBackendD3D11(mImmediateContext);
+	mBackend = mDeviceBackend;
+
+	mTargetPool = new RenderTargetPool(mDevice);
+	mGeometryBuffers = new GeometryBuffers(mDevice, mImmediateContext, 64 * 1024, 256 * 1024);
+	mGraphTextures = new RenderGraphTextures(mTargetPool);
+	isGraphDirty = true;
+	isSSAOMapVisible = true;
+
 	// Initialize Camera
 	mCamera.SetPosition(0.0f, 2.0f, -15.0f);
 
@@ -79,10 +128,31 @@ bool MyApp::Init()
 	// Initialize Object Placement and Properties
 	PositionObjects();
 
+	// Batching reads the placed world matrices, and the batches it discards release
+	// their transforms, so bring the store up to date on both sides
+	TransformStore::Shared().UpdateWorldMatrices();
+	BuildStaticBatches();
+	TransformStore::Shared().UpdateWorldMatrices();
+	BuildSceneEntries();
+
+	// Placement and flags changed after the objects were stored
+	mObjectStore->InvalidateStatic();
+
+	// The start-up capture draws before the first UpdateScene filters the scene
+	mObjectStore->UpdateVisibility();
+	UpdateVisibleEntries();
+
 	// Compile Shaders
 	CreateVertexShader(mDevice, &mVertexShader, &mVSByteCode, L"Assets/Shaders/MainVS.hlsl", "VS");
 	CreatePixelShader(mDevice, &mPixelShader, L"Assets/Shaders/MainPS.hlsl", "PS");
 
+	const D3D_SHADER_MACRO instancedDefines[] = { { "INSTANCED", "1" }, { nullptr, nullptr } };
+	CreateVertexShader(mDevice, &mInstancedVertexShader, &mVSByteCodeInstanced, L"Assets/Shaders/MainVS.hlsl", "VS", instancedDefines);
+	CreatePixelShader(mDevice, &mInstancedPixelShader, L"Assets/Shaders/MainPS.hlsl", "PS", instancedDefines);
+
+	const D3D_SHADER_MACRO captureDefines[] = { { "INSTANCED", "1" }, { "CAPTURE", "1" }, { nullptr, nullptr } };
+	CreatePixelShader(mDevice, &mCapturePixelShader, L"Assets/Shaders/MainPS.hlsl", "PS", captureDefines);
+
 	CreateVertexShader(mDevice, &mSkyVertexShader, &mVSByteCodeSky, L"Assets/Shaders/SkyVS.hlsl", "VS");
 	CreatePixelShader(mDevice, &mSkyPixelShader, L"Assets/Shaders/SkyPS.hlsl", "PS");
 
@@ -105,6 +175,36 @@ bool MyApp::Init()
 	// Create the input layout
 	HR(mDevice->CreateInputLayout(vertexDesc, numElements, mVSByteCode->GetBufferPointer(), mVSByteCode->GetBufferSize(), &mVertexLayout));
 
+	// Instanced layout: the same vertices, plus an InstanceData per instance in slot 1
+	D3D11_INPUT_ELEMENT_DESC vertexDescInstanced[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TANGENT",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 32, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "WORLD",             0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0,   D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD",             1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD",             2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD",             3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLDINVTRANSPOSE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLDINVTRANSPOSE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 80,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLDINVTRANSPOSE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 96,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLDINVTRANSPOSE", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 112, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "TEXTRANSFORM",      0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 128, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "TEXTRANSFORM",      1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 144, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "TEXTRANSFORM",      2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 160, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "TEXTRANSFORM",      3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 176, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "MATERIAL",          0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 192, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "MATERIAL",          1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 208, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "MATERIAL",          2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 224, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "MATERIAL",          3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 240, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "PROBEBLEND",        0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 256, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
+	};
+
+	numElements = sizeof(vertexDescInstanced) / sizeof(D3D11_INPUT_ELEMENT_DESC);
+
+	HR(mDevice->CreateInputLayout(vertexDescInstanced, numElements, mVSByteCodeInstanced->GetBufferPointer(), mVSByteCodeInstanced->GetBufferSize(), &mVertexLayoutInstanced));
+
 	// Create Constant Buffers
 	CreateConstantBuffer(mDevice, &mConstBufferPerFrame, sizeof(ConstBufferPerFrame));
 	CreateConstantBuffer(mDevice, &mConstBufferPerObject, sizeof(ConstBufferPerObject));
@@ -118,10 +218,22 @@ bool MyApp::Init()
 	rp_Particle->Init();
 	rp_Shadow->Init();
 
+	// The cube map capture reads the shadow map through the graph
+	BuildRenderGraph();
+
 	// Cube Maps
-	BuildDynamicCubeMapViews();
+	BuildReflectionProbes();
 
-	RenderCubeMaps();
+	// Capture every face once up front; afterwards only faces that changed are re-captured.
+	// The scene samples the shadow map, so fill it before the first capture.
+	CommandBuffer& commands = *mPassCommands[0];
+	commands.Reset();
+	rp_Shadow->Draw(commands);
+	RenderCubeMaps(commands, mReflectionProbes->GetProbeCount() * CubeFaceScheduler::FaceCount);
+
+	// Captures at start-up always go to the device
+	mDeviceBackend->BeginFrame();
+	mDeviceBackend->Execute(commands);
 
 	return true;
 }
@@ -157,6 +269,20 @@ void MyApp::UpdateScene(float dt)
 		mCamera.Strafe(10.0f*dt);
 	}
 
+	// Passes fit their per-frame state to the camera as it will be drawn
+	mCamera.UpdateViewMatrix();
+
+	// Keep the sky centred on the viewer
+	DirectX::XMFLOAT3 eyePos = mCamera.GetPosition();
+	mSkyObject->SetEyePos(eyePos.x, eyePos.y, eyePos.z);
+
+	// Rebuild every transform changed this frame in one pass before any pass reads them
+	TransformStore::Shared().UpdateWorldMatrices();
+
+	// Filter by visibility once; the passes only walk what is left
+	mObjectStore->UpdateVisibility();
+	UpdateVisibleEntries();
+
 	rp_SSAO->Update(dt);
 	rp_Particle->Update(dt);
 	rp_Shadow->Update(dt);
@@ -167,31 +293,115 @@ void MyApp::DrawScene()
 	// Update Camera
 	mCamera.UpdateViewMatrix();
 
-	// Shadow Pass - Render scene depth to the shadow map
-	rp_Shadow->Draw();
+	if (isGraphDirty)
+	{
+		BuildRenderGraph();
+	}
 
-	rp_SSAO->Draw();
+	// Captures move the sky and share the scene queue while they record, so they go
+	// first, on this thread. They read the shadow map left by the previous frame and
+	// upload the cascade transforms that go with it.
+	mCubeMapCommands.Reset();
+	RenderCubeMaps(mCubeMapCommands, CubeFacesPerFrame);
 
-	// Restore old viewport and render targets.
-	mImmediateContext->RSSetViewports(1, &mViewport);
-	ID3D11RenderTargetView* renderTargets[1];
-	renderTargets[0] = mRenderTargetView;
-	mImmediateContext->OMSetRenderTargets(1, renderTargets, mDepthStencilView);
+	// Build all lazily derived scene data up front, on this thread; while passes record
+	// they only read it. This also puts the sky back after the captures moved it.
+	TransformStore::Shared().UpdateWorldMatrices();
+	mObjectStore->PrepareConcurrentReads();
 
-	// Clear the render target and depth/stencil views
-	mImmediateContext->ClearRenderTargetView(mRenderTargetView, reinterpret_cast<const float*>(&Colors::Silver));
-	mImmediateContext->ClearDepthStencilView(mDepthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	// Record every pass into its own stream in parallel
+	UINT passCount = static_cast<UINT>(mRenderGraph.GetExecutionOrder().size());
+
+	WorkerPool::Shared().ParallelFor(passCount, [this](UINT i)
+	{
+		mPassCommands[i]->Reset();
+		mRenderGraph.RecordPass(i, *mPassCommands[i]);
+	});
+
+	// Submit in graph order on this thread
+	mBackend->BeginFrame();
+	mBackend->Execute(mCubeMapCommands);
+	for (UINT i = 0; i < passCount; ++i)
+	{
+		mBackend->Execute(*mPassCommands[i]);
+	}
+
+	// Textures released this frame may be reused next frame before they are evicted
+	mTargetPool->EndFrame();
+
+	HR(mSwapChain->Present(0, 0));
+}
+
+void MyApp::BuildRenderGraph()
+{
+	mRenderGraph.Reset();
+	mGraphTextures->Reset(&mRenderGraph);
+
+	// Back buffer and its depth come from the swap chain
+	RGHandle sceneColor = mRenderGraph.ImportTexture("BackBuffer");
+	RGHandle sceneDepth = mRenderGraph.ImportTexture("BackBufferDepth");
+	mGraphTextures->Import(sceneColor, nullptr, &mRenderTargetView, nullptr);
+	mGraphTextures->Import(sceneDepth, nullptr, nullptr, &mDepthStencilView);
+
+	rp_Shadow->Setup(mRenderGraph, *mGraphTextures);
+	rp_SSAO->Setup(mRenderGraph, *mGraphTextures);
+
+	mShadowMapHandle = mRenderGraph.Find("ShadowMap");
+	mSSAOMapHandle = mRenderGraph.Find("SSAOMap");
 
 	// Normal Lighting Pass - Render scene to the back buffer
-	RenderScene(mCamera);
+	UINT pass = mRenderGraph.AddPass("Scene", [this](CommandBuffer& commands) { RenderMainView(commands); });
+	mRenderGraph.Read(pass, mShadowMapHandle, STAGE_PS, 2);
+	mSceneColorHandle = mRenderGraph.Write(pass, sceneColor, RG_BIND_RENDER_TARGET);
+	mSceneDepthHandle = mRenderGraph.Write(pass, sceneDepth, RG_BIND_DEPTH_STENCIL);
 
-	// Particle System
-	rp_Particle->Draw();
+	mRenderGraph.Publish("SceneColor", mSceneColorHandle);
+	mRenderGraph.Publish("SceneDepth", mSceneDepthHandle);
 
-	// Draw SSAO Map in Bottom Corner
-	DrawSSAOMap();
+	rp_Particle->Setup(mRenderGraph, *mGraphTextures);
 
-	HR(mSwapChain->Present(0, 0));
+	// Draw SSAO Map in Bottom Corner. Without this view nothing consumes the SSAO map,
+	// so the graph culls the whole SSAO chain.
+	if (isSSAOMapVisible)
+	{
+		pass = mRenderGraph.AddPass("SSAODebug", [this](CommandBuffer& commands) { DrawSSAOMap(commands); });
+		mRenderGraph.Read(pass, mSSAOMapHandle, STAGE_PS, 0);
+		mSSAODebugColorHandle = mRenderGraph.Write(pass, mRenderGraph.Find("SceneColor"), RG_BIND_RENDER_TARGET);
+		mSSAODebugDepthHandle = mRenderGraph.Write(pass, mRenderGraph.Find("SceneDepth"), RG_BIND_DEPTH_STENCIL);
+
+		mRenderGraph.Publish("SceneColor", mSSAODebugColorHandle);
+		mRenderGraph.Publish("SceneDepth", mSSAODebugDepthHandle);
+	}
+
+	mRenderGraph.MarkOutput(mRenderGraph.Find("SceneColor"));
+
+	bool isCompiled = mRenderGraph.Compile();
+	assert(isCompiled);
+
+	mGraphTextures->Realize();
+
+	while (mPassCommands.size() < mRenderGraph.GetExecutionOrder().size())
+	{
+		mPassCommands.push_back(new CommandBuffer());
+	}
+
+	isGraphDirty = false;
+}
+
+void MyApp::RenderMainView(CommandBuffer& commands)
+{
+	// Restore old viewport and render targets.
+	commands.SetViewport(mViewport);
+	ID3D11RenderTargetView* renderTargets[1];
+	renderTargets[0] = mGraphTextures->GetRTV(mSceneColorHandle);
+	commands.SetRenderTargets(1, renderTargets, mGraphTextures->GetDSV(mSceneDepthHandle));
+
+	// Clear the render target and depth/stencil views
+	commands.ClearRenderTarget(renderTargets[0], reinterpret_cast<const float*>(&Colors::Silver));
+	commands.ClearDepthStencil(mGraphTextures->GetDSV(mSceneDepthHandle), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+
+	// Normal Lighting Pass - Render scene to the back buffer
+	RenderScene(commands, mCamera);
 }
 
 
@@ -240,12 +450,83 @@ void MyApp::OnKeyDown(WPARAM key, LPARAM info)
 	{
 		mNormalMapping = false;
 	}
+	else if (key == 0x35)
+	{
+		mBackend = mDeviceBackend;
+	}
+	else if (key == 0x36)
+	{
+		mBackend = &mNullBackend;
+	}
+	else if (key == 0x37)
+	{
+		isSSAOMapVisible = !isSSAOMapVisible;
+		isGraphDirty = true;
+	}
+	else if (key == 0x38)
+	{
+		// Cycle SSAO between full, half and quarter resolution
+		UINT factor = rp_SSAO->GetResolution();
+		rp_SSAO->SetResolution(factor >= 4 ? 1 : factor * 2);
+		isGraphDirty = true;
+	}
+	else if (key == 0x39)
+	{
+		rp_SSAO->SetTemporal(!rp_SSAO->IsTemporal());
+		isGraphDirty = true;
+	}
+	else if (key == 0x30)
+	{
+		rp_SSAO->SetComputeBlur(!rp_SSAO->IsComputeBlur());
+		isGraphDirty = true;
+	}
+	else if (key == 0x31)
+	{
+		rp_SSAO->SetCompactNormalDepth(!rp_SSAO->IsCompactNormalDepth());
+		isGraphDirty = true;
+	}
+	else if (key == 0x32)
+	{
+		// Cycle the SSAO kernel through 4, 8, 16 and 32 samples
+		SSAOQuality quality = rp_SSAO->GetQuality();
+		rp_SSAO->SetQuality(static_cast<SSAOQuality>((quality + 1) % SSAO_QUALITY_COUNT));
+	}
 }
 
 
 /* D3D11 Helper Functions */
 
 void MyApp::CreateGeometryBuffers(GObject* obj, bool bDynamic)
+{
+	// Static meshes are packed into the shared buffers, once per mesh
+	if (!bDynamic)
+	{
+		mGeometryBuffers->Add(obj->GetMesh());
+		if (obj->GetLodMesh()) { mGeometryBuffers->Add(obj->GetLodMesh()); }
+		return;
+	}
+
+	// Objects sharing a mesh share its buffers; only the first one creates them
+	if (*obj->GetVertexBuffer() == nullptr)
+	{
+		CreateVertexBuffer(obj, bDynamic);
+	}
+
+	if (obj->IsIndexed() && *obj->GetIndexBuffer() == nullptr)
+	{
+		D3D11_BUFFER_DESC ibd;
+		ibd.Usage = D3D11_USAGE_IMMUTABLE;
+		ibd.ByteWidth = sizeof(UINT) * obj->GetIndexCount();
+		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		ibd.CPUAccessFlags = 0;
+		ibd.MiscFlags = 0;
+		D3D11_SUBRESOURCE_DATA iinitData;
+		iinitData.pSysMem = obj->GetIndices();
+		HR(mDevice->CreateBuffer(&ibd, &iinitData, obj->GetIndexBuffer()));
+	}
+}
+
+void MyApp::CreateVertexBuffer(GObject* obj, bool bDynamic)
 {
 	D3D11_BUFFER_DESC vbd;
 	vbd.ByteWidth = sizeof(Vertex) * obj->GetVertexCount();
@@ -266,29 +547,15 @@ void MyApp::CreateGeometryBuffers(GObject* obj, bool bDynamic)
 	D3D11_SUBRESOURCE_DATA vinitData;
 	vinitData.pSysMem = obj->GetVertices();
 	HR(mDevice->CreateBuffer(&vbd, &vinitData, obj->GetVertexBuffer()));
-
-	if (obj->IsIndexed())
-	{
-		D3D11_BUFFER_DESC ibd;
-		ibd.Usage = D3D11_USAGE_IMMUTABLE;
-		ibd.ByteWidth = sizeof(UINT) * obj->GetIndexCount();
-		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-		ibd.CPUAccessFlags = 0;
-		ibd.MiscFlags = 0;
-		D3D11_SUBRESOURCE_DATA iinitData;
-		iinitData.pSysMem = obj->GetIndices();
-		HR(mDevice->CreateBuffer(&ibd, &iinitData, obj->GetIndexBuffer()));
-	}
 }
 
-void MyApp::DrawObject(GObject* object, const GFirstPersonCamera& camera)
+void MyApp::DrawObject(CommandBuffer& commands, GObject* object, const GFirstPersonCamera& camera)
 {
 	// Store convenient matrices
 	DirectX::XMMATRIX world = XMLoadFloat4x4(&object->GetWorldTransform());
-	DirectX::XMMATRIX worldInvTranspose = MathHelper::InverseTranspose(world);
+	DirectX::XMMATRIX worldInvTranspose = XMLoadFloat4x4(&object->GetNormalTransform());
 	DirectX::XMMATRIX worldViewProj = world*camera.ViewProj();
 	DirectX::XMMATRIX texTransform = XMLoadFloat4x4(&object->GetTexTransform());
-	DirectX::XMMATRIX shadowTransform = XMLoadFloat4x4(&rp_Shadow->GetShadowTransform());
 
 	static const DirectX::XMMATRIX T(
 		0.5f, 0.0f, 0.0f, 0.0f,
@@ -297,51 +564,37 @@ void MyApp::DrawObject(GObject* object, const GFirstPersonCamera& camera)
 		0.5f, 0.5f, 0.0f, 1.0f);
 
 	// Set per object constants
-	mImmediateContext->Map(mConstBufferPerObject, 0, D3D11_MAP_WRITE_DISCARD, 0, &cbPerObjectResource);
-	cbPerObject = (ConstBufferPerObject*)cbPerObjectResource.pData;
+	ConstBufferPerObject* cbPerObject = commands.UpdateConstants<ConstBufferPerObject>(mConstBufferPerObject);
 	cbPerObject->world = DirectX::XMMatrixTranspose(world);
 	cbPerObject->worldInvTranpose = DirectX::XMMatrixTranspose(worldInvTranspose);
 	cbPerObject->worldViewProj = DirectX::XMMatrixTranspose(worldViewProj);
 	cbPerObject->texTransform = DirectX::XMMatrixTranspose(texTransform);
 	cbPerObject->worldViewProjTex = DirectX::XMMatrixTranspose(worldViewProj * T);
-	cbPerObject->shadowTransform = DirectX::XMMatrixTranspose(world*shadowTransform);
 
 	cbPerObject->material = object->GetMaterial();
+	cbPerObject->probeBlend = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
 
-	mImmediateContext->Unmap(mConstBufferPerObject, 0);
 
 	// Set Vertex Buffer to Input Assembler Stage
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
 
-	mImmediateContext->IASetVertexBuffers(0, 1, object->GetVertexBuffer(), &stride, &offset);
+	commands.SetVertexBuffer(0, *object->GetVertexBuffer(), stride, offset);
 
 	// Set Index Buffer to Input Assembler Stage if indexing is enabled for this draw
 	if (object->IsIndexed())
 	{
-		mImmediateContext->IASetIndexBuffer(*object->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
-	}
-
-	// Add an SRV to the shader for the object's diffuse texture if one exists
-	if (object->GetDiffuseMapSRV() != nullptr)
-	{
-		mImmediateContext->PSSetShaderResources(0, 1, object->GetDiffuseMapSRV());
-	}
-
-	// Add an SRV to the shader for the object's diffuse texture if one exists
-	if (object->GetNormalMapSRV() != nullptr)
-	{
-		mImmediateContext->PSSetShaderResources(1, 1, object->GetNormalMapSRV());
+		commands.SetIndexBuffer(*object->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
 	}
 
 	// Draw Object, with indexing if enabled
 	if (object->IsIndexed())
 	{
-		mImmediateContext->DrawIndexed(object->GetIndexCount(), 0, 0);
+		commands.DrawIndexed(object->GetIndexCount(), object->GetStartIndex(), object->GetBaseVertex());
 	}
 	else
 	{
-		mImmediateContext->Draw(object->GetVertexCount(), 0);
+		commands.Draw(object->GetVertexCount(), object->GetBaseVertex());
 	}
 }
 
@@ -362,8 +615,12 @@ void MyApp::PositionObjects()
 		mColumnObjects[i * 2 + 0]->Translate(-5.0f, 1.5f, -10.0f + i*5.0f);
 		mColumnObjects[i * 2 + 1]->Translate(+5.0f, 1.5f, -10.0f + i*5.0f);
 
-		mSphereObjects[i * 2 + 0]->Translate(-5.0f, 3.5f, -10.0f + i*5.0f);
-		mSphereObjects[i * 2 + 1]->Translate(+5.0f, 3.5f, -10.0f + i*5.0f);
+		// Spheres rest on top of their column
+		for (int j = 0; j < 2; ++j)
+		{
+			mSphereObjects[i * 2 + j]->SetParent(mColumnObjects[i * 2 + j]);
+			mSphereObjects[i * 2 + j]->Translate(0.0f, 2.0f, 0.0f);
+		}
 	}
 
 	for (int i = 0; i < 10; ++i)
@@ -401,13 +658,54 @@ void MyApp::PositionObjects()
 	LoadTextureToSRV(mDevice, mBoxObject->GetDiffuseMapSRV(), L"Assets/Textures/grass.dds");
 	LoadTextureToSRV(mDevice, mBoxObject->GetNormalMapSRV(), L"Assets/Textures/bricks_nmap.dds");
 
-	for (int i = 0; i < 10; ++i)
+	// Columns share one texture, so they can share batches too
+	LoadTextureToSRV(mDevice, mColumnObjects[0]->GetDiffuseMapSRV(), L"Assets/Textures/stone.dds");
+	for (int i = 1; i < 10; ++i)
 	{
 		//		LoadTextureToSRV(mSphereObjects[i]->GetDiffuseMapSRV(), L"Assets/Textures/ice.dds");
-		LoadTextureToSRV(mDevice, mColumnObjects[i]->GetDiffuseMapSRV(), L"Assets/Textures/stone.dds");
+		*mColumnObjects[i]->GetDiffuseMapSRV() = *mColumnObjects[0]->GetDiffuseMapSRV();
+		(*mColumnObjects[i]->GetDiffuseMapSRV())->AddRef();
 	}
 
 	LoadTextureToSRV(mDevice, mSkyObject->GetDiffuseMapSRV(), L"Assets/Textures/grasscube1024.dds");
+
+	// Nothing in the scene moves after this point, so all of it can live in the cached shadow map
+	mFloorObject->SetStatic(true);
+	mBoxObject->SetStatic(true);
+	mSkullObject->SetStatic(true);
+
+	for (int i = 0; i < 10; ++i)
+	{
+		mColumnObjects[i]->SetStatic(true);
+		mSphereObjects[i]->SetStatic(true);
+		mSphereObjects[i]->SetReflective(true);
+	}
+}
+
+void MyApp::BuildStaticBatches()
+{
+	// Copy first; adding the batches invalidates spans of the store
+	GObjectSpan stored = mObjectStore->GetObjects();
+	std::vector<GObject*> sources;
+
+	for (UINT i = 0; i < stored.size(); ++i)
+	{
+		GObject* obj = stored[i];
+		if (obj->IsStatic() && obj->IsOpaque() && obj->IsVisible() && !obj->IsReflective() && obj != mSkyObject)
+		{
+			sources.push_back(obj);
+		}
+	}
+
+	GStaticBatch::Build(sources, 20.0f, 64 * 1024, mStaticBatches);
+
+	for (UINT i = 0; i < mStaticBatches.size(); ++i)
+	{
+		CreateGeometryBuffers(mStaticBatches[i], false);
+		mObjectStore->AddObject(mStaticBatches[i]);
+	}
+
+	mObjectStore->InvalidateCategories();
 }
 
 void MyApp::SetupStaticLights()
@@ -437,198 +735,487 @@ void MyApp::InitUserInput()
 
 /* Render Passes */
 
-void MyApp::RenderCubeMaps()
+void MyApp::RenderCubeMaps(CommandBuffer& commands, UINT maxFaces)
 {
 	ID3D11RenderTargetView* renderTargets[1];
 
-	// Generate the cube map.
-	mImmediateContext->RSSetViewports(1, &mCubeMapViewport);
-	for (int j = 0; j < 10; j++)
+	InvalidateCubeMaps();
+
+	DirectX::XMFLOAT3 eyePos = mCamera.GetPosition();
+	mCubeFaceScheduler.Schedule(eyePos, maxFaces, mCubeFaceUpdates);
+
+	if (mCubeFaceUpdates.empty())
 	{
-		mSphereObjects[j]->SetVisibility(false);
-		DirectX::XMFLOAT3 cameraPosition = mSphereObjects[j]->GetPosition();
-		BuildCubeFaceCamera(cameraPosition.x, cameraPosition.y, cameraPosition.z);
-		for (int i = 0; i < 6; ++i)
-		{
-			// Clear cube map face and depth buffer.
-			mImmediateContext->ClearRenderTargetView(mDynamicCubeMapRTV[j][i], reinterpret_cast<const float*>(&Colors::Silver));
-			mImmediateContext->ClearDepthStencilView(mDynamicCubeMapDSV, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+		return;
+	}
 
-			// Bind cube map face as render target.
-			renderTargets[0] = mDynamicCubeMapRTV[j][i];
-			mImmediateContext->OMSetRenderTargets(1, renderTargets, mDynamicCubeMapDSV);
+	// This stream is submitted before the shadow pass uploads this frame's cascades, so
+	// give it the transforms of the shadow map it samples
+	rp_Shadow->UploadCascadeConstants(commands);
 
-			// Draw the scene with the exception of the center sphere to this cube map face.
-			RenderScene(mCubeMapCamera[i]);
-		}
-		mSphereObjects[j]->SetVisibility(true);
+	// Group the faces by probe so each probe's cameras are built once
+	std::sort(mCubeFaceUpdates.begin(), mCubeFaceUpdates.end(), [](const CubeFaceUpdate& a, const CubeFaceUpdate& b)
+	{
+		return a.Probe != b.Probe ? a.Probe < b.Probe : a.Face < b.Face;
+	});
+
+	// We need a depth texture for rendering the scene into the cubemap
+	// that has the same resolution as the cubemap faces.
+	PoolTextureDesc depthDesc;
+	depthDesc.Width = CubeMapSize;
+	depthDesc.Height = CubeMapSize;
+	depthDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	depthDesc.BytesPerTexel = 4;
+	depthDesc.MipLevels = 1;
+	depthDesc.BindFlags = RG_BIND_DEPTH_STENCIL;
+	depthDesc.isCube = false;
+
+	UINT depthEntry = mTargetPool->Acquire(depthDesc);
+	ID3D11DepthStencilView* depthView = mTargetPool->GetDSV(depthEntry);
+
+	// Bounds are shared by every probe
+	mCubeFaceCuller.Reset();
+	for (UINT i = 0; i < mVisibleEntries.size(); ++i)
+	{
+		mCubeFaceCuller.AddBox(mSceneEntries[mVisibleEntries[i]].Object->GetWorldBoundingBox());
 	}
 
-	// Have hardware generate lower mipmap levels of cube map.
-	for (int j = 0; j < 10; ++j)
+	// Generate the cube map faces.
+	commands.SetViewport(mCubeMapViewport);
+	for (UINT k = 0; k < mCubeFaceUpdates.size(); ++k)
 	{
-		mImmediateContext->GenerateMips(mDynamicCubeMapSRV[j]);
+		UINT j = mCubeFaceUpdates[k].Probe;
+		UINT i = mCubeFaceUpdates[k].Face;
+
+		if (k == 0 || mCubeFaceUpdates[k - 1].Probe != j)
+		{
+			DirectX::XMFLOAT3 cameraPosition = mCubeFaceScheduler.GetProbePosition(j);
+			BuildCubeFaceCamera(cameraPosition.x, cameraPosition.y, cameraPosition.z);
+			mSkyObject->SetEyePos(cameraPosition.x, cameraPosition.y, cameraPosition.z);
+			TransformStore::Shared().UpdateWorldMatrices();
+
+			// One sweep finds what each face sees
+			mCubeFaceCuller.Cull(cameraPosition, mCubeMapCamera[0].GetFarZ(), mCubeFaceMasks);
+
+			// Lights and the eye are the same for every face of the probe
+			BeginScenePass(commands, cameraPosition);
+		}
+
+		// Clear cube map face and depth buffer.
+		renderTargets[0] = mReflectionProbes->GetRTV(j, i);
+		commands.ClearRenderTarget(renderTargets[0], reinterpret_cast<const float*>(&Colors::Silver));
+		commands.ClearDepthStencil(depthView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+
+		// Bind cube map face as render target.
+		commands.SetRenderTargets(1, renderTargets, depthView);
+
+		// Draw what this cube map face sees, through the reduced capture variant.
+		QueueScene(mCubeMapCamera[i], true, static_cast<UINT8>(1 << i));
+		SubmitScene(commands, mCubeMapCamera[i]);
+
+		// Have hardware generate lower mipmap levels once the probe's last face is in.
+		if (k + 1 == mCubeFaceUpdates.size() || mCubeFaceUpdates[k + 1].Probe != j)
+		{
+			commands.GenerateMips(mReflectionProbes->GetProbeSRV(j));
+		}
 	}
+
+	EndScenePass(commands);
+	mSkyObject->SetEyePos(eyePos.x, eyePos.y, eyePos.z);
+
+	// Released every frame but reacquired the next, so the pool keeps it while probes update
+	mTargetPool->Release(depthEntry);
 }
 
-void MyApp::RenderScene(const GFirstPersonCamera& camera)
+void MyApp::InvalidateCubeMaps()
 {
-	// Restore the back and depth buffer
-	//	ID3D11RenderTargetView* renderTargets[] = { mRenderTargetView };
-	//	mImmediateContext->OMSetRenderTargets(1, renderTargets, mDepthStencilView);
+	// The shadow light turning and static objects changing can alter what every face
+	// sees. Captures sample the shadow map, so the light is the shadow pass's animated
+	// one; small turns are let through, like the shadow cache does.
+	DirectX::XMFLOAT3 lightDir = rp_Shadow->GetLightDirection();
+	if (!ShadowCache::LightMatches(mCubeMapLightDir, lightDir, CaptureLightTolerance) ||
+		mCubeMapStaticVersion != mObjectStore->GetStaticVersion())
+	{
+		mCubeMapLightDir = lightDir;
+		mCubeMapStaticVersion = mObjectStore->GetStaticVersion();
+		mCubeFaceScheduler.InvalidateAll();
+	}
 
-	// Clear the render target and depth/stencil views
-	//	mImmediateContext->ClearRenderTargetView(mRenderTargetView, reinterpret_cast<const float*>(&Colors::Silver));
-	//	mImmediateContext->ClearDepthStencilView(mDepthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	// Moving objects dirty the faces that saw their old bounds or see their new ones. The
+	// sky is centred on each probe while it captures, so it never changes for them.
+	GObjectSpan objects = mObjectStore->GetObjects();
+	for (UINT i = 0; i < objects.size(); ++i)
+	{
+		GObject* obj = objects[i];
+		if (obj->IsStatic() || obj == mSkyObject)
+		{
+			continue;
+		}
 
-	// Set Viewport
-	//	mImmediateContext->RSSetViewports(1, &mViewport);
+		DirectX::BoundingBox box = obj->GetWorldBoundingBox();
+		auto it = mCubeMapObjectBounds.find(obj);
 
-	// Set Vertex Layout
-	mImmediateContext->IASetInputLayout(mVertexLayout);
-	mImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		if (it == mCubeMapObjectBounds.end())
+		{
+			mCubeFaceScheduler.InvalidateBounds(box);
+			mCubeMapObjectBounds[obj] = box;
+		}
+		else if (memcmp(&it->second, &box, sizeof(box)) != 0)
+		{
+			mCubeFaceScheduler.InvalidateBounds(it->second);
+			mCubeFaceScheduler.InvalidateBounds(box);
+			it->second = box;
+		}
+	}
+}
 
-	// Set Render States
-	float blendFactor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+void MyApp::RenderScene(CommandBuffer& commands, const GFirstPersonCamera& camera)
+{
+	BeginScenePass(commands, camera.GetPosition());
+	QueueScene(camera, false, 0);
+	SubmitScene(commands, camera);
+	EndScenePass(commands);
+}
 
-	mImmediateContext->RSSetState(RenderStates::DefaultRS);
-	mImmediateContext->OMSetBlendState(RenderStates::DefaultBS, blendFactor, 0xffffffff);
-	mImmediateContext->OMSetDepthStencilState(RenderStates::DefaultDSS, 0);
+void MyApp::BeginScenePass(CommandBuffer& commands, const DirectX::XMFLOAT3& eyePos)
+{
+	// The vertex layout depends on the variant
+	commands.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	// Set Shaders
-	mImmediateContext->VSSetShader(mVertexShader, NULL, 0);
-	mImmediateContext->PSSetShader(mPixelShader, NULL, 0);
+	// Set Render States
+	float blendFactor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	commands.SetBlendState(RenderStates::DefaultBS, blendFactor, 0xffffffff);
 
 	ID3D11SamplerState* samplers[2] = { RenderStates::DefaultSS, RenderStates::ShadowMapCompSS };
-	mImmediateContext->PSSetSamplers(0, 2, samplers);
+	commands.SetSamplers(STAGE_PS, 0, 2, samplers);
 
 	// Set per frame constants
-	mImmediateContext->Map(mConstBufferPerFrame, 0, D3D11_MAP_WRITE_DISCARD, 0, &cbPerFrameResource);
-	cbPerFrame = (ConstBufferPerFrame*)cbPerFrameResource.pData;
+	ConstBufferPerFrame* cbPerFrame = commands.UpdateConstants<ConstBufferPerFrame>(mConstBufferPerFrame);
 	cbPerFrame->dirLight0 = mDirLights[0];
 	cbPerFrame->dirLight1 = mDirLights[1];
 	cbPerFrame->dirLight2 = mDirLights[2];
-	cbPerFrame->eyePosW = camera.GetPosition();
-	mImmediateContext->Unmap(mConstBufferPerFrame, 0);
+	cbPerFrame->eyePosW = eyePos;
 
 	// Bind Constant Buffers to the Pipeline
-	mImmediateContext->VSSetConstantBuffers(0, 1, &mConstBufferPerFrame);
-	mImmediateContext->VSSetConstantBuffers(1, 1, &mConstBufferPerObject);
+	commands.SetConstantBuffers(STAGE_VS, 0, 1, &mConstBufferPerFrame);
+	commands.SetConstantBuffers(STAGE_VS, 1, 1, &mConstBufferPerObject);
 
-	mImmediateContext->PSSetConstantBuffers(0, 1, &mConstBufferPerFrame);
-	mImmediateContext->PSSetConstantBuffers(1, 1, &mConstBufferPerObject);
-	mImmediateContext->PSSetConstantBuffers(2, 1, &mConstBufferPSParams);
-	
-	ID3D11ShaderResourceView* sceneShadowMap = rp_Shadow->GetDepthMapSRV();
-	mImmediateContext->PSSetShaderResources(2, 1, &sceneShadowMap);
+	commands.SetConstantBuffers(STAGE_PS, 0, 1, &mConstBufferPerFrame);
+	commands.SetConstantBuffers(STAGE_PS, 1, 1, &mConstBufferPerObject);
+	commands.SetConstantBuffers(STAGE_PS, 2, 1, &mConstBufferPSParams);
 
-//	mImmediateContext->PSSetShaderResources(3, 1, &mSsaoSRV1);
+	ID3D11Buffer* cascadeConstants = rp_Shadow->GetCascadeConstantBuffer();
+	commands.SetConstantBuffers(STAGE_PS, 3, 1, &cascadeConstants);
+	
+	ID3D11ShaderResourceView* sceneShadowMap = mGraphTextures->GetSRV(mShadowMapHandle);
+	commands.SetShaderResources(STAGE_PS, 2, 1, &sceneShadowMap);
+}
 
-	// Set PS Parameters
-	mImmediateContext->Map(mConstBufferPSParams, 0, D3D11_MAP_WRITE_DISCARD, 0, &cbPSParamsResource);
-	cbPSParams = (ConstBufferPSParams*)cbPSParamsResource.pData;
-	cbPSParams->bUseTexure = true;
-	cbPSParams->bAlphaClip = false;
-	cbPSParams->bFogEnabled = false;
-	cbPSParams->bReflection = false;
-	cbPSParams->bUseNormal = mNormalMapping;
-//	cbPSParams->bUseAO = mAOSetting;
-	mImmediateContext->Unmap(mConstBufferPSParams, 0);
+void MyApp::QueueScene(const GFirstPersonCamera& camera, bool bCapture, UINT8 faceBit)
+{
+	// Queue every visible object with the state it needs
+	mSceneQueue.Reset();
+	mSceneDraws.clear();
+	mDrawGroupIds.clear();
 
-	if (mFloorObject->IsVisible())
+	for (UINT i = 0; i < mVisibleEntries.size(); ++i)
 	{
-		DrawObject(mFloorObject, camera);
-	}
+		const SceneEntry& entry = mSceneEntries[mVisibleEntries[i]];
 
-	if (mBoxObject->IsVisible())
-	{
-		DrawObject(mBoxObject, camera);
+		// Skip what the cube face being captured cannot see. The sky surrounds every probe.
+		if (faceBit && entry.Variant != SV_SKY && !(mCubeFaceMasks[i] & faceBit))
+		{
+			continue;
+		}
+
+		UINT params = mNormalMapping ? entry.Params : entry.Params & ~PSP_USE_NORMAL;
+
+		// Captures use the cheap shaders and coarse meshes, and sample no probes, since
+		// one of them is the render target
+		if (bCapture)
+		{
+			UINT variant = entry.Variant == SV_MAIN ? SV_CAPTURE : entry.Variant;
+			QueueSceneObject(entry.Object, variant, params & ~PSP_USE_NORMAL, nullptr, camera, CaptureLodDistance);
+		}
+		else if (entry.isReflective)
+		{
+			QueueSceneObject(entry.Object, entry.Variant, params | PSP_REFLECTION, mReflectionProbes->GetSRV(), camera);
+		}
+		else
+		{
+			QueueSceneObject(entry.Object, entry.Variant, params, nullptr, camera);
+		}
 	}
+}
 
-	// Set PS Parameters
-	mImmediateContext->Map(mConstBufferPSParams, 0, D3D11_MAP_WRITE_DISCARD, 0, &cbPSParamsResource);
-	cbPSParams = (ConstBufferPSParams*)cbPSParamsResource.pData;
-	cbPSParams->bUseTexure = true;
-	cbPSParams->bAlphaClip = false;
-	cbPSParams->bFogEnabled = false;
-	cbPSParams->bReflection = false;
-	cbPSParams->bUseNormal = false;
-//	cbPSParams->bUseAO = mAOSetting;
-	mImmediateContext->Unmap(mConstBufferPSParams, 0);
+void MyApp::SubmitScene(CommandBuffer& commands, const GFirstPersonCamera& camera)
+{
+	mSceneQueue.Sort();
 
-	for (int i = 0; i < 10; ++i)
+	// Draws that agree on everything but depth form runs; each run is one instanced
+	// draw, so front to back order only holds between runs
+	mSceneQueue.BuildRuns(~RenderQueue::DepthMask, MaxInstancesPerDraw, mSceneRuns);
+
+	// Submit, changing only the state whose key bits differ from the previous run
+	UINT64 previousKey = 0;
+
+	for (UINT r = 0; r < mSceneRuns.size(); ++r)
 	{
-		if (mColumnObjects[i]->IsVisible())
+		const RenderQueueRun& run = mSceneRuns[r];
+		const RenderQueueItem& item = mSceneQueue.GetItem(run.First);
+		const SceneDraw& draw = mSceneDraws[item.Payload];
+		UINT64 changed = r == 0 ? ~0ull : item.SortKey ^ previousKey;
+		previousKey = item.SortKey;
+
+		UINT variant = static_cast<UINT>((item.SortKey & RenderQueue::VariantMask) >> RenderQueue::VariantShift);
+
+		if (changed & (RenderQueue::LayerMask | RenderQueue::VariantMask))
+		{
+			BindSceneVariant(commands, variant, camera);
+		}
+
+		if (changed & RenderQueue::ParamsMask)
 		{
-			DrawObject(mColumnObjects[i], camera);
+			// Set PS Parameters
+			ConstBufferPSParams* cbPSParams = commands.UpdateConstants<ConstBufferPSParams>(mConstBufferPSParams);
+			cbPSParams->bUseTexure = (draw.Params & PSP_USE_TEXTURE) != 0;
+			cbPSParams->bAlphaClip = (draw.Params & PSP_ALPHA_CLIP) != 0;
+			cbPSParams->bFogEnabled = (draw.Params & PSP_FOG) != 0;
+			cbPSParams->bReflection = (draw.Params & PSP_REFLECTION) != 0;
+			cbPSParams->bUseNormal = (draw.Params & PSP_USE_NORMAL) != 0;
+//			cbPSParams->bUseAO = mAOSetting;
 		}
+
+		if (changed & RenderQueue::TextureSetMask)
+		{
+			commands.SetShaderResources(STAGE_PS, 0, 2, draw.Textures);
+			commands.SetShaderResources(STAGE_PS, 4, 1, &draw.Textures[2]);
+		}
+
+		if (variant == SV_SKY)
+		{
+			// The sky shaders take their transform from the per object constants
+			for (UINT i = 0; i < run.Count; ++i)
+			{
+				DrawObject(commands, mSceneDraws[mSceneQueue.GetItem(run.First + i).Payload].Object, camera);
+			}
+			continue;
+		}
+
+		DrawSceneRun(commands, run);
 	}
+}
+
+void MyApp::EndScenePass(CommandBuffer& commands)
+{
+	// Unbind Shadow Map, SSAO and cube map SRVs
+	ID3D11ShaderResourceView* nullSRVs[3] = { NULL, NULL, NULL };
+	commands.SetShaderResources(STAGE_PS, 2, 3, nullSRVs);
+}
+
+void MyApp::BuildSceneEntries()
+{
+	mSceneEntries.clear();
+
+	SceneEntry entry;
+	entry.isReflective = false;
+	entry.Variant = SV_MAIN;
 
-	// Set PS Parameters
-	mImmediateContext->Map(mConstBufferPSParams, 0, D3D11_MAP_WRITE_DISCARD, 0, &cbPSParamsResource);
-	cbPSParams = (ConstBufferPSParams*)cbPSParamsResource.pData;
-	cbPSParams->bUseTexure = true;
-	cbPSParams->bAlphaClip = false;
-	cbPSParams->bFogEnabled = false;
-	cbPSParams->bReflection = true;
-	cbPSParams->bUseNormal = false;
-//	cbPSParams->bUseAO = mAOSetting;
-	mImmediateContext->Unmap(mConstBufferPSParams, 0);
+	entry.Params = PSP_USE_TEXTURE | PSP_USE_NORMAL;
+	entry.Object = mFloorObject;
+	mSceneEntries.push_back(entry);
+	entry.Object = mBoxObject;
+	mSceneEntries.push_back(entry);
 
+	entry.Params = PSP_USE_TEXTURE;
 	for (int i = 0; i < 10; ++i)
 	{
-		if (mSphereObjects[i]->IsVisible())
+		entry.Object = mColumnObjects[i];
+		mSceneEntries.push_back(entry);
+	}
+
+	entry.isReflective = true;
+	for (int i = 0; i < 10; ++i)
+	{
+		entry.Object = mSphereObjects[i];
+		mSceneEntries.push_back(entry);
+	}
+
+	entry.isReflective = false;
+	entry.Params = 0;
+	entry.Object = mSkullObject;
+	mSceneEntries.push_back(entry);
+
+	for (UINT i = 0; i < mStaticBatches.size(); ++i)
+	{
+		GStaticBatch* batch = mStaticBatches[i];
+		entry.Object = batch;
+		entry.Params = (*batch->GetDiffuseMapSRV() ? PSP_USE_TEXTURE : 0) | (*batch->GetNormalMapSRV() ? PSP_USE_NORMAL : 0);
+		mSceneEntries.push_back(entry);
+	}
+
+	entry.Variant = SV_SKY;
+	entry.Params = 0;
+	entry.Object = mSkyObject;
+	mSceneEntries.push_back(entry);
+}
+
+void MyApp::UpdateVisibleEntries()
+{
+	mVisibleEntries.clear();
+
+	// Batched objects are drawn by their batch
+	for (UINT i = 0; i < mSceneEntries.size(); ++i)
+	{
+		GObject* object = mSceneEntries[i].Object;
+		if (object->IsVisible() && !object->IsBatched())
 		{
-			mImmediateContext->PSSetShaderResources(4, 1, &mDynamicCubeMapSRV[i]);
-			DrawObject(mSphereObjects[i], camera);
-			ID3D11ShaderResourceView* nullSRVs[1] = { NULL };
-			mImmediateContext->PSSetShaderResources(4, 1, nullSRVs);
+			mVisibleEntries.push_back(i);
 		}
 	}
+}
+
+void MyApp::QueueSceneObject(GObject* object, UINT variant, UINT params, ID3D11ShaderResourceView* cubeMap, const GFirstPersonCamera& camera, float lodDistance)
+{
+	SceneDraw draw;
+	draw.Object = object;
+	draw.Params = params;
+	draw.Textures[0] = *object->GetDiffuseMapSRV();
+	draw.Textures[1] = *object->GetNormalMapSRV();
+	draw.Textures[2] = cubeMap;
+	draw.ProbeBlend = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	draw.DrawMesh = object->GetMesh();
+
+	DirectX::XMFLOAT3 position = object->GetWorldPosition();
+	DirectX::XMVECTOR toObject = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&position), camera.GetPositionXM());
+
+	// Past lodDistance, objects with a coarser mesh draw that instead
+	if (lodDistance > 0.0f && object->GetLodMesh() && DirectX::XMVectorGetX(DirectX::XMVector3Length(toObject)) > lodDistance)
+	{
+		draw.DrawMesh = object->GetLodMesh();
+	}
+
+	if (cubeMap)
+	{
+		ProbeBlend blend = mProbeVolume.Lookup(object->GetWorldPosition());
+		draw.ProbeBlend = DirectX::XMFLOAT4(static_cast<float>(blend.Probe[0]), static_cast<float>(blend.Probe[1]), blend.Weight, 0.0f);
+	}
+
+	// Ids only need to be unique within this queue
+	UINT64 meshKey = draw.DrawMesh == object->GetMesh() ? object->GetMeshKey() : reinterpret_cast<UINT64>(draw.DrawMesh);
+	DrawGroup group(draw.Textures[0], draw.Textures[1], draw.Textures[2], meshKey);
+	auto it = mDrawGroupIds.find(group);
+	if (it == mDrawGroupIds.end())
+	{
+		it = mDrawGroupIds.insert(std::make_pair(group, static_cast<UINT>(mDrawGroupIds.size()))).first;
+	}
 
-	// Set PS Parameters
-	mImmediateContext->Map(mConstBufferPSParams, 0, D3D11_MAP_WRITE_DISCARD, 0, &cbPSParamsResource);
-	cbPSParams = (ConstBufferPSParams*)cbPSParamsResource.pData;
-	cbPSParams->bUseTexure = false;
-	cbPSParams->bAlphaClip = false;
-	cbPSParams->bFogEnabled = false;
-	cbPSParams->bReflection = false;
-	cbPSParams->bUseNormal = false;
-//	cbPSParams->bUseAO = mAOSetting;
-	mImmediateContext->Unmap(mConstBufferPSParams, 0);
+	// Opaque draws go front to back for early depth rejection. The sky is drawn last
+	// at the far plane, so its depth does not matter.
+	UINT layer = variant == SV_SKY ? 1 : 0;
+	UINT depth = 0;
 
-	if (mSkullObject->IsVisible())
+	if (variant != SV_SKY)
 	{
-		DrawObject(mSkullObject, camera);
+		float viewDepth = DirectX::XMVectorGetX(DirectX::XMVector3Dot(toObject, camera.GetLookXM()));
+		depth = RenderQueue::QuantizeDepth(viewDepth, camera.GetNearZ(), camera.GetFarZ());
 	}
 
-	// Draw Sky
-	mImmediateContext->VSSetShader(mSkyVertexShader, NULL, 0);
-	mImmediateContext->PSSetShader(mSkyPixelShader, NULL, 0);
+	mSceneQueue.Add(RenderQueue::MakeKey(layer, variant, params, it->second, depth), static_cast<UINT>(mSceneDraws.size()));
+	mSceneDraws.push_back(draw);
+}
+
+void MyApp::BindSceneVariant(CommandBuffer& commands, UINT variant, const GFirstPersonCamera& camera)
+{
+	if (variant == SV_SKY)
+	{
+		// Draw Sky
+		commands.SetInputLayout(mVertexLayout);
+		commands.SetVertexShader(mSkyVertexShader);
+		commands.SetPixelShader(mSkyPixelShader);
+
+		commands.SetRasterizerState(RenderStates::NoCullRS);
+		commands.SetDepthStencilState(RenderStates::LessEqualDSS, 0);
+		return;
+	}
+
+	static const DirectX::XMMATRIX T(
+		0.5f, 0.0f, 0.0f, 0.0f,
+		0.0f, -0.5f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.5f, 0.5f, 0.0f, 1.0f);
+
+	// Instanced draws take world transforms and materials from the instance data, so
+	// the per object constants only hold the view
+	DirectX::XMMATRIX viewProj = camera.ViewProj();
 
-	mImmediateContext->RSSetState(RenderStates::NoCullRS);
-	mImmediateContext->OMSetDepthStencilState(RenderStates::LessEqualDSS, 0);
+	ConstBufferPerObject* cbPerObject = commands.UpdateConstants<ConstBufferPerObject>(mConstBufferPerObject);
+	cbPerObject->world = DirectX::XMMatrixIdentity();
+	cbPerObject->worldInvTranpose = DirectX::XMMatrixIdentity();
+	cbPerObject->worldViewProj = DirectX::XMMatrixTranspose(viewProj);
+	cbPerObject->texTransform = DirectX::XMMatrixIdentity();
+	cbPerObject->worldViewProjTex = DirectX::XMMatrixTranspose(viewProj * T);
+	cbPerObject->probeBlend = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
 
-	mSkyObject->SetEyePos(camera.GetPosition().x, camera.GetPosition().y, camera.GetPosition().z);
-	if (mSkyObject->IsVisible())
+	// Set Shaders
+	commands.SetInputLayout(mVertexLayoutInstanced);
+	commands.SetVertexShader(mInstancedVertexShader);
+	commands.SetPixelShader(variant == SV_CAPTURE ? mCapturePixelShader : mInstancedPixelShader);
+
+	commands.SetRasterizerState(RenderStates::DefaultRS);
+	commands.SetDepthStencilState(RenderStates::DefaultDSS, 0);
+}
+
+void MyApp::DrawSceneRun(CommandBuffer& commands, const RenderQueueRun& run)
+{
+	InstanceData* instances = commands.SetVertexData<InstanceData>(1, run.Count);
+	for (UINT i = 0; i < run.Count; ++i)
 	{
-		DrawObject(mSkyObject, camera);
+		const SceneDraw& draw = mSceneDraws[mSceneQueue.GetItem(run.First + i).Payload];
+		GObject* obj = draw.Object;
+		Material material = obj->GetMaterial();
+
+		instances[i].World = obj->GetWorldTransform();
+		instances[i].WorldInvTranspose = obj->GetNormalTransform();
+		instances[i].TexTransform = obj->GetTexTransform();
+		instances[i].Ambient = material.Ambient;
+		instances[i].Diffuse = material.Diffuse;
+		instances[i].Specular = material.Specular;
+		instances[i].Reflect = material.Reflect;
+		instances[i].ProbeBlend = draw.ProbeBlend;
 	}
 
-	// Unbind Shadow Map SRV
-	ID3D11ShaderResourceView* nullSRVs[2] = { NULL, NULL };
-	mImmediateContext->PSSetShaderResources(2, 2, nullSRVs);
+	// Every draw in the run has the same mesh, full or coarse; draw it once per instance
+	const SceneDraw& first = mSceneDraws[mSceneQueue.GetItem(run.First).Payload];
+	const Mesh* mesh = first.DrawMesh;
+
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	commands.SetVertexBuffer(0, mesh->VertexBuffer, stride, offset);
+
+	if (first.Object->IsIndexed())
+	{
+		commands.SetIndexBuffer(mesh->IndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+		commands.DrawIndexedInstanced(mesh->IndexCount, run.Count, mesh->StartIndex, mesh->BaseVertex, 0);
+	}
+	else
+	{
+		commands.DrawInstanced(mesh->VertexCount, run.Count, mesh->BaseVertex, 0);
+	}
 }
 
-void MyApp::DrawSSAOMap()
+void MyApp::DrawSSAOMap(CommandBuffer& commands)
 {
+	ID3D11RenderTargetView* renderTargets[] = { mGraphTextures->GetRTV(mSSAODebugColorHandle) };
+	commands.SetRenderTargets(1, renderTargets, mGraphTextures->GetDSV(mSSAODebugDepthHandle));
+
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
 
-	mImmediateContext->IASetInputLayout(mVertexLayout);
-	mImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	mImmediateContext->IASetVertexBuffers(0, 1, &mScreenQuadVB, &stride, &offset);
-	mImmediateContext->IASetIndexBuffer(mScreenQuadIB, DXGI_FORMAT_R16_UINT, 0);
+	commands.SetInputLayout(mVertexLayout);
+	commands.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	commands.SetVertexBuffer(0, mScreenQuadVB, stride, offset);
+	commands.SetIndexBuffer(mScreenQuadIB, DXGI_FORMAT_R16_UINT, 0);
 
 	// Scale and shift quad to lower-right corner.
 	DirectX::XMMATRIX world(
@@ -637,26 +1224,24 @@ void MyApp::DrawSSAOMap()
 		0.0f, 0.0f, 1.0f, 0.0f,
 		0.75f, -0.75f, 0.0f, 1.0f);
 
-	mImmediateContext->Map(mConstBufferPerObjectDebug, 0, D3D11_MAP_WRITE_DISCARD, 0, &cbPerObjectDebugResource);
-	cbPerObjectDebug = (ConstBufferPerObjectDebug*)cbPerObjectDebugResource.pData;
+	ConstBufferPerObjectDebug* cbPerObjectDebug = commands.UpdateConstants<ConstBufferPerObjectDebug>(mConstBufferPerObjectDebug);
 	cbPerObjectDebug->world = DirectX::XMMatrixTranspose(world);
-	mImmediateContext->Unmap(mConstBufferPerObjectDebug, 0);
 
-	mImmediateContext->VSSetShader(mDebugTextureVS, NULL, 0);
-	mImmediateContext->PSSetShader(mDebugTexturePS, NULL, 0);
+	commands.SetVertexShader(mDebugTextureVS);
+	commands.SetPixelShader(mDebugTexturePS);
 
-	mImmediateContext->VSSetConstantBuffers(0, 1, &mConstBufferPerObjectDebug);
+	commands.SetConstantBuffers(STAGE_VS, 0, 1, &mConstBufferPerObjectDebug);
 
-	ID3D11ShaderResourceView* tmp = rp_SSAO->GetSSAOMap();
-	mImmediateContext->PSSetShaderResources(0, 1, &tmp);
-	mImmediateContext->PSSetSamplers(0, 1, &RenderStates::DefaultSS);
+	ID3D11ShaderResourceView* ssaoMap = mGraphTextures->GetSRV(mSSAOMapHandle);
+	commands.SetShaderResources(STAGE_PS, 0, 1, &ssaoMap);
+	commands.SetSamplers(STAGE_PS, 0, 1, &RenderStates::DefaultSS);
 
-	mImmediateContext->OMSetDepthStencilState(RenderStates::DefaultDSS, 0);
+	commands.SetDepthStencilState(RenderStates::DefaultDSS, 0);
 
 	float blendFactor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
-	mImmediateContext->OMSetBlendState(RenderStates::DefaultBS, blendFactor, 0xffffffff);
+	commands.SetBlendState(RenderStates::DefaultBS, blendFactor, 0xffffffff);
 
-	mImmediateContext->DrawIndexed(6, 0, 0);
+	commands.DrawIndexed(6, 0, 0);
 }
 
 
@@ -748,106 +1333,31 @@ void MyApp::BuildCubeFaceCamera(float x, float y, float z)
 	for (int i = 0; i < 6; ++i)
 	{
 		mCubeMapCamera[i].LookAt(center, targets[i], ups[i]);
-		mCubeMapCamera[i].SetLens(0.5f*DirectX::XM_PI, 1.0f, 0.1f, 1000.0f);
+		mCubeMapCamera[i].SetLens(0.5f*DirectX::XM_PI, 1.0f, 0.1f, CaptureFarZ);
 		mCubeMapCamera[i].UpdateViewMatrix();
 	}
 }
 
-void MyApp::BuildDynamicCubeMapViews()
+void MyApp::BuildReflectionProbes()
 {
 	//
-	// Cubemap is a special texture array with 6 elements.
-	//
-
-	D3D11_TEXTURE2D_DESC texDesc;
-	texDesc.Width = CubeMapSize;
-	texDesc.Height = CubeMapSize;
-	texDesc.MipLevels = 0;
-	texDesc.ArraySize = 6;
-	texDesc.SampleDesc.Count = 1;
-	texDesc.SampleDesc.Quality = 0;
-	texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	texDesc.Usage = D3D11_USAGE_DEFAULT;
-	texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	texDesc.CPUAccessFlags = 0;
-	texDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS | D3D11_RESOURCE_MISC_TEXTURECUBE;
-
-	ID3D11Texture2D* cubeTex[10] = { 0 };
-	for (int j = 0; j < 10; ++j)
-	{
-		HR(mDevice->CreateTexture2D(&texDesc, 0, &cubeTex[j]));
-	}
-
-	//
-	// Create a render target view to each cube map face 
-	// (i.e., each element in the texture array).
-	// 
-
-	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc;
-	rtvDesc.Format = texDesc.Format;
-	rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
-	rtvDesc.Texture2DArray.ArraySize = 1;
-	rtvDesc.Texture2DArray.MipSlice = 0;
-
-	for (int j = 0; j < 10; ++j)
-	{
-		for (int i = 0; i < 6; ++i)
-		{
-			rtvDesc.Texture2DArray.FirstArraySlice = i;
-			HR(mDevice->CreateRenderTargetView(cubeTex[j], &rtvDesc, &mDynamicCubeMapRTV[j][i]));
-		}
-	}
-
-	//
-	// Create a shader resource view to the cube map.
+	// One probe per sphere pair, at sphere height in the middle of the aisle. The pairs
+	// see nearly the same surroundings, so cost follows the probes, not the spheres.
 	//
 
-	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
-	srvDesc.Format = texDesc.Format;
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
-	srvDesc.TextureCube.MostDetailedMip = 0;
-	srvDesc.TextureCube.MipLevels = -1;
-
-	for (int j = 0; j < 10; ++j)
+	for (int i = 0; i < 5; ++i)
 	{
-		HR(mDevice->CreateShaderResourceView(cubeTex[j], &srvDesc, &mDynamicCubeMapSRV[j]));
-	}
+		DirectX::XMFLOAT3 position(0.0f, 3.5f, -10.0f + i*5.0f);
+		mProbeVolume.AddProbe(position, 8.0f);
 
-	for (int j = 0; j < 10; ++j)
-	{
-		ReleaseCOM(cubeTex[j]);
+		// Captures see as far as the cube face cameras' far plane
+		mCubeFaceScheduler.AddProbe(position, CaptureFarZ);
 	}
 
-	//
-	// We need a depth texture for rendering the scene into the cubemap
-	// that has the same resolution as the cubemap faces.  
-	//
+	mReflectionProbes = new ReflectionProbes(mDevice, mProbeVolume.GetProbeCount(), CubeMapSize);
 
-	D3D11_TEXTURE2D_DESC depthTexDesc;
-	depthTexDesc.Width = CubeMapSize;
-	depthTexDesc.Height = CubeMapSize;
-	depthTexDesc.MipLevels = 1;
-	depthTexDesc.ArraySize = 1;
-	depthTexDesc.SampleDesc.Count = 1;
-	depthTexDesc.SampleDesc.Quality = 0;
-	depthTexDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	depthTexDesc.Usage = D3D11_USAGE_DEFAULT;
-	depthTexDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-	depthTexDesc.CPUAccessFlags = 0;
-	depthTexDesc.MiscFlags = 0;
-
-	ID3D11Texture2D* depthTex = 0;
-	HR(mDevice->CreateTexture2D(&depthTexDesc, 0, &depthTex));
-
-	// Create the depth stencil view for the entire cube
-	D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
-	dsvDesc.Format = depthTexDesc.Format;
-	dsvDesc.Flags = 0;
-	dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	dsvDesc.Texture2D.MipSlice = 0;
-	HR(mDevice->CreateDepthStencilView(depthTex, &dsvDesc, &mDynamicCubeMapDSV));
-
-	ReleaseCOM(depthTex);
+	mCubeMapLightDir = rp_Shadow->GetLightDirection();
+	mCubeMapStaticVersion = mObjectStore->GetStaticVersion();
 
 	//
 	// Viewport for drawing into cubemap.
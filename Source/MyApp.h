@@ -9,6 +9,23 @@
 #include "Vertex.h"
 #include "RenderStates.h"
 #include "ConstantBuffers.h"
+#include "CommandBuffer.h"
+#include "RenderBackend.h"
+#include "RenderBackendD3D11.h"
+#include "WorkerPool.h"
+#include "RenderGraph.h"
+#include "RenderGraphTextures.h"
+#include "RenderTargetPool.h"
+#include "RenderQueue.h"
+#include "GeometryBuffers.h"
+#include "CubeFaceScheduler.h"
+#include "CubeFaceCuller.h"
+#include "ReflectionProbeVolume.h"
+#include "ReflectionProbes.h"
+
+#include <map>
+#include <tuple>
+#include <unordered_map>
 
 #include "GFirstPersonCamera.h"
 #include "GObject.h"
@@ -18,6 +35,7 @@
 #include "GCylinder.h"
 #include "GPlaneXZ.h"
 #include "GSky.h"
+#include "GStaticBatch.h"
 
 #include "RenderPassSSAO.h"
 #include "RenderPassParticleSystem.h"
@@ -42,19 +60,34 @@ public:
 
 private:
 	void CreateGeometryBuffers(GObject* obj, bool dynamic = false);
-	void DrawObject(GObject* object, const GFirstPersonCamera& camera);
+	void CreateVertexBuffer(GObject* obj, bool dynamic);
+	void DrawObject(CommandBuffer& commands, GObject* object, const GFirstPersonCamera& camera);
 
 	void InitUserInput();
 
 	void PositionObjects();
+	void BuildStaticBatches();
 	void SetupStaticLights();
 
-	void RenderCubeMaps();
-	void RenderScene(const GFirstPersonCamera& camera);
-	void DrawSSAOMap();
+	void BuildRenderGraph();
+	void RenderMainView(CommandBuffer& commands);
+
+	void RenderCubeMaps(CommandBuffer& commands, UINT maxFaces);
+	void InvalidateCubeMaps();
+	void RenderScene(CommandBuffer& commands, const GFirstPersonCamera& camera);
+	void BeginScenePass(CommandBuffer& commands, const DirectX::XMFLOAT3& eyePos);
+	void QueueScene(const GFirstPersonCamera& camera, bool bCapture, UINT8 faceBit);
+	void SubmitScene(CommandBuffer& commands, const GFirstPersonCamera& camera);
+	void EndScenePass(CommandBuffer& commands);
+	void BuildSceneEntries();
+	void UpdateVisibleEntries();
+	void QueueSceneObject(GObject* object, UINT variant, UINT params, ID3D11ShaderResourceView* cubeMap, const GFirstPersonCamera& camera, float lodDistance = 0.0f);
+	void BindSceneVariant(CommandBuffer& commands, UINT variant, const GFirstPersonCamera& camera);
+	void DrawSceneRun(CommandBuffer& commands, const RenderQueueRun& run);
+	void DrawSSAOMap(CommandBuffer& commands);
 
 	void BuildCubeFaceCamera(float x, float y, float z);
-	void BuildDynamicCubeMapViews();
+	void BuildReflectionProbes();
 
 	void BuildFullScreenQuad();
 
@@ -64,6 +97,33 @@ private:
 	RenderPassParticleSystem* rp_Particle;
 	RenderPassShadow* rp_Shadow;
 
+	// Every render target below comes from this pool, so its stats cover them all
+	RenderTargetPool* mTargetPool;
+
+	// Vertex and index pages shared by every static mesh
+	GeometryBuffers* mGeometryBuffers;
+
+	// Frame graph of all passes, rebuilt only when its shape changes
+	RenderGraph mRenderGraph;
+	RenderGraphTextures* mGraphTextures;
+	bool isGraphDirty;
+	bool isSSAOMapVisible;
+
+	RGHandle mShadowMapHandle;
+	RGHandle mSSAOMapHandle;
+	RGHandle mSceneColorHandle;
+	RGHandle mSceneDepthHandle;
+	RGHandle mSSAODebugColorHandle;
+	RGHandle mSSAODebugDepthHandle;
+
+	// One command stream per compiled pass, recorded in parallel and submitted in
+	// graph order. The null backend skips the device entirely so the CPU cost of a
+	// frame can be measured alone.
+	std::vector<CommandBuffer*> mPassCommands;
+	RenderBackendD3D11* mDeviceBackend;
+	NullRenderBackend mNullBackend;
+	RenderBackend* mBackend;
+
 	// Object Store
 	GObjectStore* mObjectStore;
 
@@ -73,21 +133,19 @@ private:
 	ID3D11Buffer* mConstBufferPSParams;
 	ID3D11Buffer* mConstBufferPerObjectDebug;
 
-	D3D11_MAPPED_SUBRESOURCE cbPerFrameResource;
-	D3D11_MAPPED_SUBRESOURCE cbPerObjectResource;
-	D3D11_MAPPED_SUBRESOURCE cbPSParamsResource;
-	D3D11_MAPPED_SUBRESOURCE cbPerObjectDebugResource;
-
-	ConstBufferPerFrame* cbPerFrame;
-	ConstBufferPerObject* cbPerObject;
-	ConstBufferPSParams* cbPSParams;
-	ConstBufferPerObjectDebug* cbPerObjectDebug;
-
 	// Shaders
 	ID3D11VertexShader* mVertexShader;
 	ID3D11PixelShader* mPixelShader;
 	ID3DBlob* mVSByteCode;
 
+	// Main shaders compiled with INSTANCED, reading transforms and material per instance
+	ID3D11VertexShader* mInstancedVertexShader;
+	ID3D11PixelShader* mInstancedPixelShader;
+	ID3DBlob* mVSByteCodeInstanced;
+
+	// Instanced pixel shader compiled with CAPTURE as well, for the reflection probes
+	ID3D11PixelShader* mCapturePixelShader;
+
 	ID3D11VertexShader* mSkyVertexShader;
 	ID3D11PixelShader* mSkyPixelShader;
 	ID3DBlob* mVSByteCodeSky;
@@ -98,12 +156,58 @@ private:
 
 	// Vertex Layout
 	ID3D11InputLayout* mVertexLayout;
+	ID3D11InputLayout* mVertexLayoutInstanced;
+
+	// Scene draws, sorted by state and depth before they are submitted. Only the scene
+	// pass and the start-up cube capture fill it, never at the same time.
+	enum SceneVariant
+	{
+		SV_MAIN,
+		SV_SKY,
+		SV_CAPTURE
+	};
+
+	// Everything the scene pass draws, with the state it needs. PSP_USE_NORMAL in Params
+	// only applies while normal mapping is on.
+	struct SceneEntry
+	{
+		GObject* Object;
+		UINT Variant;
+		UINT Params;
+		bool isReflective;
+	};
+
+	std::vector<SceneEntry> mSceneEntries;
+
+	// Indices of the entries drawn this frame, rebuilt once in UpdateScene
+	std::vector<UINT> mVisibleEntries;
+
+	struct SceneDraw
+	{
+		GObject* Object;
+		UINT Params;
+		ID3D11ShaderResourceView* Textures[3];
+		DirectX::XMFLOAT4 ProbeBlend;
+		Mesh* DrawMesh;
+	};
+
+	// Draws with the same textures and mesh share a group, which takes the texture set
+	// bits of the sort key. Runs of a group with equal state become one instanced draw.
+	typedef std::tuple<ID3D11ShaderResourceView*, ID3D11ShaderResourceView*, ID3D11ShaderResourceView*, UINT64> DrawGroup;
+
+	RenderQueue mSceneQueue;
+	std::vector<SceneDraw> mSceneDraws;
+	std::map<DrawGroup, UINT> mDrawGroupIds;
+	std::vector<RenderQueueRun> mSceneRuns;
 
 	// Objects
 	GObject* mSkullObject;
 	GPlaneXZ* mFloorObject;
 	GCube* mBoxObject;
 	GSphere* mSphereObjects[10];
+
+	// Static objects merged after placement; they draw in place of their sources
+	std::vector<GStaticBatch*> mStaticBatches;
 	GCylinder* mColumnObjects[10];
 	GSky* mSkyObject;
 
@@ -116,15 +220,34 @@ private:
 	// User Input
 	POINT mLastMousePos;
 
-	// Cube Map 
-	ID3D11DepthStencilView* mDynamicCubeMapDSV;
-	ID3D11RenderTargetView* mDynamicCubeMapRTV[10][6];
-	ID3D11ShaderResourceView* mDynamicCubeMapSRV[10];
+	// Reflection probes, placed along the aisle between the sphere pairs. Reflective
+	// objects blend the two nearest; the capture depth buffer is a pool entry.
+	ReflectionProbeVolume mProbeVolume;
+	ReflectionProbes* mReflectionProbes;
 	D3D11_VIEWPORT mCubeMapViewport;
 
 	GFirstPersonCamera mCubeMapCamera[6];
 
-	static const int CubeMapSize = 256;
+	// Reflections are blurry and seen on curved surfaces, so probes capture at low
+	// resolution with a short far plane; the sky is drawn at the far plane regardless
+	static const int CubeMapSize = 128;
+
+	// Probe faces are re-captured when something they see changes, a
+	// few per frame, into their own stream submitted ahead of the graph passes.
+	CubeFaceScheduler mCubeFaceScheduler;
+	std::vector<CubeFaceUpdate> mCubeFaceUpdates;
+	CommandBuffer mCubeMapCommands;
+
+	// Visible scene entry bounds, culled once per probe against all six faces. A face
+	// only queues the entries whose mask has its bit.
+	CubeFaceCuller mCubeFaceCuller;
+	std::vector<UINT8> mCubeFaceMasks;
+	static const UINT CubeFacesPerFrame = 6;
+
+	// What the cube maps were last invalidated against
+	DirectX::XMFLOAT3 mCubeMapLightDir;
+	UINT mCubeMapStaticVersion;
+	std::unordered_map<GObject*, DirectX::BoundingBox> mCubeMapObjectBounds;
 
 	bool mNormalMapping;
 
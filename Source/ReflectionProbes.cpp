@@ -0,0 +1,75 @@
+/*  ======================
+	Summary: Reflection probe cube maps in one TextureCubeArray
+	======================  */
+
+#include "ReflectionProbes.h"
+
+ReflectionProbes::ReflectionProbes(ID3D11Device* device, UINT probeCount, UINT size)
+{
+	mProbeCount = probeCount;
+	mSize = size;
+
+	D3D11_TEXTURE2D_DESC texDesc;
+	texDesc.Width = size;
+	texDesc.Height = size;
+	texDesc.MipLevels = 0;
+	texDesc.ArraySize = probeCount * 6;
+	texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.SampleDesc.Quality = 0;
+	texDesc.Usage = D3D11_USAGE_DEFAULT;
+	texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	texDesc.CPUAccessFlags = 0;
+	texDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE | D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+	HR(device->CreateTexture2D(&texDesc, 0, &mTexture));
+
+	// The whole array, for sampling
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	srvDesc.Format = texDesc.Format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+	srvDesc.TextureCubeArray.MostDetailedMip = 0;
+	srvDesc.TextureCubeArray.MipLevels = -1;
+	srvDesc.TextureCubeArray.First2DArrayFace = 0;
+	srvDesc.TextureCubeArray.NumCubes = probeCount;
+	HR(device->CreateShaderResourceView(mTexture, &srvDesc, &mArraySRV));
+
+	// One cube per view, so GenerateMips only touches the probe that changed
+	mProbeSRVs.resize(probeCount, nullptr);
+	srvDesc.TextureCubeArray.NumCubes = 1;
+	for (UINT j = 0; j < probeCount; ++j)
+	{
+		srvDesc.TextureCubeArray.First2DArrayFace = j * 6;
+		HR(device->CreateShaderResourceView(mTexture, &srvDesc, &mProbeSRVs[j]));
+	}
+
+	// One view per face (i.e., each element in the texture array)
+	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc;
+	rtvDesc.Format = texDesc.Format;
+	rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+	rtvDesc.Texture2DArray.ArraySize = 1;
+	rtvDesc.Texture2DArray.MipSlice = 0;
+
+	mFaceRTVs.resize(probeCount * 6, nullptr);
+	for (UINT i = 0; i < probeCount * 6; ++i)
+	{
+		rtvDesc.Texture2DArray.FirstArraySlice = i;
+		HR(device->CreateRenderTargetView(mTexture, &rtvDesc, &mFaceRTVs[i]));
+	}
+}
+
+ReflectionProbes::~ReflectionProbes()
+{
+	for (auto it = mFaceRTVs.begin(); it != mFaceRTVs.end(); ++it)
+	{
+		ReleaseCOM(*it);
+	}
+
+	for (auto it = mProbeSRVs.begin(); it != mProbeSRVs.end(); ++it)
+	{
+		ReleaseCOM(*it);
+	}
+
+	ReleaseCOM(mArraySRV);
+	ReleaseCOM(mTexture);
+}
@@ -0,0 +1,36 @@
+/*  ======================
+	Summary: Reflection probe cube maps in one TextureCubeArray
+	======================  */
+
+#ifndef REFLECTION_PROBES_H
+#define REFLECTION_PROBES_H
+
+#include "D3DUtil.h"
+
+// Cube maps of every reflection probe, as slices of one mip-chained TextureCubeArray.
+// Shaders sample the whole array and pick probes by index; each face has its own
+// render target view and each probe its own view for mip generation.
+class ReflectionProbes
+{
+public:
+	ReflectionProbes(ID3D11Device* device, UINT probeCount, UINT size);
+	~ReflectionProbes();
+
+	inline UINT GetProbeCount() const { return mProbeCount; }
+	inline UINT GetSize() const { return mSize; }
+
+	inline ID3D11ShaderResourceView* GetSRV() const { return mArraySRV; }
+	inline ID3D11ShaderResourceView* GetProbeSRV(UINT probe) const { return mProbeSRVs[probe]; }
+	inline ID3D11RenderTargetView* GetRTV(UINT probe, UINT face) const { return mFaceRTVs[probe * 6 + face]; }
+
+private:
+	UINT mProbeCount;
+	UINT mSize;
+
+	ID3D11Texture2D* mTexture;
+	ID3D11ShaderResourceView* mArraySRV;
+	std::vector<ID3D11ShaderResourceView*> mProbeSRVs;
+	std::vector<ID3D11RenderTargetView*> mFaceRTVs;
+};
+
+#endif // REFLECTION_PROBES_H
\ No newline at end of file
@@ -0,0 +1,125 @@
+/*  ======================
+	Summary: D3D11 textures behind a compiled render graph
+	======================  */
+
+#include "RenderGraphTextures.h"
+
+RenderGraphTextures::RenderGraphTextures(RenderTargetPool* pool)
+{
+	mPool = pool;
+	mGraph = nullptr;
+}
+
+RenderGraphTextures::~RenderGraphTextures()
+{
+	ReleaseTextures();
+}
+
+void RenderGraphTextures::Reset(const RenderGraph* graph)
+{
+	mGraph = graph;
+	mImports.clear();
+}
+
+void RenderGraphTextures::Import(RGHandle handle, ID3D11ShaderResourceView* const* srv, ID3D11RenderTargetView* const* rtv, ID3D11DepthStencilView* const* dsv)
+{
+	UINT resource = mGraph->GetResourceIndex(handle);
+	if (resource >= mImports.size())
+	{
+		ImportedViews none = { nullptr, nullptr, nullptr };
+		mImports.resize(resource + 1, none);
+	}
+
+	ImportedViews views = { srv, rtv, dsv };
+	mImports[resource] = views;
+}
+
+void RenderGraphTextures::Realize()
+{
+	// Released textures are the first candidates for the new slots
+	ReleaseTextures();
+
+	UINT count = mGraph->GetPhysicalTextureCount();
+	mEntries.resize(count);
+
+	for (UINT i = 0; i < count; ++i)
+	{
+		const RGTextureDesc& desc = mGraph->GetPhysicalTextureDesc(i);
+
+		PoolTextureDesc poolDesc;
+		poolDesc.Width = desc.Width;
+		poolDesc.Height = desc.Height;
+		poolDesc.Format = desc.Format;
+		poolDesc.BytesPerTexel = desc.BytesPerTexel;
+		poolDesc.MipLevels = 1;
+		poolDesc.BindFlags = mGraph->GetPhysicalBindFlags(i);
+		poolDesc.isCube = false;
+
+		mEntries[i] = mPool->Acquire(poolDesc);
+	}
+}
+
+void RenderGraphTextures::ReleaseTextures()
+{
+	for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		mPool->Release(*it);
+	}
+
+	mEntries.clear();
+}
+
+UINT RenderGraphTextures::FindEntry(RGHandle handle) const
+{
+	UINT slot = mGraph->GetPhysicalTexture(handle);
+	return slot < mEntries.size() ? mEntries[slot] : TexturePool::InvalidEntry;
+}
+
+const RenderGraphTextures::ImportedViews* RenderGraphTextures::FindImport(RGHandle handle) const
+{
+	UINT resource = mGraph->GetResourceIndex(handle);
+	return resource < mImports.size() ? &mImports[resource] : nullptr;
+}
+
+ID3D11ShaderResourceView* RenderGraphTextures::GetSRV(RGHandle handle) const
+{
+	if (mGraph->IsImported(handle))
+	{
+		const ImportedViews* views = FindImport(handle);
+		return views && views->SRV ? *views->SRV : nullptr;
+	}
+
+	return mPool->GetSRV(FindEntry(handle));
+}
+
+ID3D11RenderTargetView* RenderGraphTextures::GetRTV(RGHandle handle) const
+{
+	if (mGraph->IsImported(handle))
+	{
+		const ImportedViews* views = FindImport(handle);
+		return views && views->RTV ? *views->RTV : nullptr;
+	}
+
+	return mPool->GetRTV(FindEntry(handle));
+}
+
+ID3D11DepthStencilView* RenderGraphTextures::GetDSV(RGHandle handle) const
+{
+	if (mGraph->IsImported(handle))
+	{
+		const ImportedViews* views = FindImport(handle);
+		return views && views->DSV ? *views->DSV : nullptr;
+	}
+
+	return mPool->GetDSV(FindEntry(handle));
+}
+
+ID3D11UnorderedAccessView* RenderGraphTextures::GetUAV(RGHandle handle) const
+{
+	if (mGraph->IsImported(handle))
+	{
+		return nullptr;
+	}
+
+	return mPool->GetUAV(FindEntry(handle));
+}
@@ -0,0 +1,59 @@
+/*  ======================
+	Summary: D3D11 textures behind a compiled render graph
+	======================  */
+
+#ifndef RENDERGRAPH_TEXTURES_H
+#define RENDERGRAPH_TEXTURES_H
+
+#include "D3DUtil.h"
+#include "RenderGraph.h"
+#include "RenderTargetPool.h"
+
+// Takes a pooled texture for every physical slot of a compiled graph and resolves
+// graph handles to views. Imported textures are read through their owner's pointers,
+// so an owner may swap the view it exposes between frames.
+class RenderGraphTextures
+{
+public:
+	RenderGraphTextures(RenderTargetPool* pool);
+	~RenderGraphTextures();
+
+	// Forget imports and the graph; textures stay acquired until the next Realize.
+	void Reset(const RenderGraph* graph);
+
+	void Import(RGHandle handle, ID3D11ShaderResourceView* const* srv, ID3D11RenderTargetView* const* rtv, ID3D11DepthStencilView* const* dsv);
+
+	// Hands the previous textures back to the pool and acquires one per physical slot.
+	// Slots whose description did not change get the same texture back. Call after the
+	// graph compiled.
+	void Realize();
+
+	ID3D11ShaderResourceView* GetSRV(RGHandle handle) const;
+	ID3D11RenderTargetView* GetRTV(RGHandle handle) const;
+	ID3D11DepthStencilView* GetDSV(RGHandle handle) const;
+
+	// Transient textures only; imports carry no unordered access view.
+	ID3D11UnorderedAccessView* GetUAV(RGHandle handle) const;
+
+private:
+	struct ImportedViews
+	{
+		ID3D11ShaderResourceView* const* SRV;
+		ID3D11RenderTargetView* const* RTV;
+		ID3D11DepthStencilView* const* DSV;
+	};
+
+	void ReleaseTextures();
+
+	UINT FindEntry(RGHandle handle) const;
+	const ImportedViews* FindImport(RGHandle handle) const;
+
+private:
+	RenderTargetPool* mPool;
+	const RenderGraph* mGraph;
+
+	std::vector<UINT> mEntries;
+	std::vector<ImportedViews> mImports;
+};
+
+#endif // RENDERGRAPH_TEXTURES_H
\ No newline at end of file
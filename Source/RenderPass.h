@@ -5,6 +5,11 @@
 #ifndef RENDERPASS_H
 #define RENDERPASS_H
 
+#include "CommandBuffer.h"
+#include "RenderGraph.h"
+
+class RenderGraphTextures;
+
 class RenderPass
 {
 public:
@@ -13,7 +18,9 @@ public:
 
 	virtual void Init() = 0;
 	virtual void Update(float dt) = 0;
-	virtual void Draw() = 0;
+	// Adds the pass to the frame graph with the textures it reads and writes. Its
+	// callbacks record commands once the graph is compiled and its textures exist.
+	virtual void Setup(RenderGraph& graph, RenderGraphTextures& textures) = 0;
 
 private:
 
@@ -3,7 +3,6 @@
 RenderPassParticleSystem::RenderPassParticleSystem(ID3D11Device* device, GFirstPersonCamera* camera, GameTimer* timer)
 {
 	mDevice = device;
-	mDevice->GetImmediateContext(&mImmediateContext);
 
 	mCamera = camera;
 	mTimer = timer;
@@ -65,9 +64,21 @@ void RenderPassParticleSystem::Update(float dt)
 	mAge += dt;
 }
 
-void RenderPassParticleSystem::Draw()
+void RenderPassParticleSystem::Setup(RenderGraph& graph, RenderGraphTextures& textures)
 {
-	RenderParticleSystem();
+	mTextures = &textures;
+
+	UINT pass = graph.AddPass("Particles", [this](CommandBuffer& commands) { Draw(commands); });
+	mTarget = graph.Write(pass, graph.Find("SceneColor"), RG_BIND_RENDER_TARGET);
+	mDepth = graph.Write(pass, graph.Find("SceneDepth"), RG_BIND_DEPTH_STENCIL);
+
+	graph.Publish("SceneColor", mTarget);
+	graph.Publish("SceneDepth", mDepth);
+}
+
+void RenderPassParticleSystem::Draw(CommandBuffer& commands)
+{
+	RenderParticleSystem(commands);
 }
 
 
@@ -145,10 +156,13 @@ void RenderPassParticleSystem::BuildParticleVB()
 	HR(mDevice->CreateBuffer(&vbd, 0, &mStreamOutVB));
 }
 
-void RenderPassParticleSystem::RenderParticleSystem()
+void RenderPassParticleSystem::RenderParticleSystem(CommandBuffer& commands)
 {
-	mImmediateContext->IASetInputLayout(mVertexLayoutParticle);
-	mImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
+	ID3D11RenderTargetView* renderTargets[] = { mTextures->GetRTV(mTarget) };
+	commands.SetRenderTargets(1, renderTargets, mTextures->GetDSV(mDepth));
+
+	commands.SetInputLayout(mVertexLayoutParticle);
+	commands.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
 
 	UINT stride = sizeof(Particle);
 	UINT offset = 0;
@@ -156,74 +170,71 @@ void RenderPassParticleSystem::RenderParticleSystem()
 	DirectX::XMFLOAT3 eyePosW = mCamera->GetPosition();
 
 	// Set per frame constants
-	mImmediateContext->Map(mConstBufferPerFrameParticle, 0, D3D11_MAP_WRITE_DISCARD, 0, &cbPerFrameParticleResource);
-	cbPerFrameParticle = (ConstBufferPerFrameParticle*)cbPerFrameParticleResource.pData;
+	ConstBufferPerFrameParticle* cbPerFrameParticle = commands.UpdateConstants<ConstBufferPerFrameParticle>(mConstBufferPerFrameParticle);
 	cbPerFrameParticle->eyePosW = DirectX::XMFLOAT4(eyePosW.x, eyePosW.y, eyePosW.z, 0.0f);
 	cbPerFrameParticle->emitPosW = DirectX::XMFLOAT4(mEmitPosW.x, mEmitPosW.y, mEmitPosW.z, 0.0f);
 	cbPerFrameParticle->emitDirW = DirectX::XMFLOAT4(mEmitDirW.x, mEmitDirW.y, mEmitDirW.z, 0.0f);
 	cbPerFrameParticle->gameTime = mGameTime;
 	cbPerFrameParticle->timeStep = mTimeStep;
 	cbPerFrameParticle->viewProj = DirectX::XMMatrixTranspose(mCamera->ViewProj());
-	mImmediateContext->Unmap(mConstBufferPerFrameParticle, 0);
 
 	// Stream-Out Particles
 
 	if (mFirstRun)
 	{
-		mImmediateContext->IASetVertexBuffers(0, 1, &mInitVB, &stride, &offset);
+		commands.SetVertexBuffer(0, mInitVB, stride, offset);
 	}
 	else
 	{
-		mImmediateContext->IASetVertexBuffers(0, 1, &mDrawVB, &stride, &offset);
+		commands.SetVertexBuffer(0, mDrawVB, stride, offset);
 	}
 
-	mImmediateContext->SOSetTargets(1, &mStreamOutVB, &offset);
+	commands.SetStreamOutTarget(mStreamOutVB, offset);
 
-	mImmediateContext->VSSetShader(mParticleStreamOutVS, NULL, 0);
-	mImmediateContext->GSSetShader(mParticleStreamOutGS, NULL, 0);
-	mImmediateContext->PSSetShader(0, NULL, 0);
+	commands.SetVertexShader(mParticleStreamOutVS);
+	commands.SetGeometryShader(mParticleStreamOutGS);
+	commands.SetPixelShader(nullptr);
 
-	mImmediateContext->GSSetShaderResources(0, 1, &mRandomSRV);
-	mImmediateContext->GSSetConstantBuffers(0, 1, &mConstBufferPerFrameParticle);
+	commands.SetShaderResources(STAGE_GS, 0, 1, &mRandomSRV);
+	commands.SetConstantBuffers(STAGE_GS, 0, 1, &mConstBufferPerFrameParticle);
 
-	mImmediateContext->GSSetSamplers(0, 1, &RenderStates::DefaultSS);
-	mImmediateContext->OMSetDepthStencilState(RenderStates::DisableDepthDSS, 0);
+	commands.SetSamplers(STAGE_GS, 0, 1, &RenderStates::DefaultSS);
+	commands.SetDepthStencilState(RenderStates::DisableDepthDSS, 0);
 
 	if (mFirstRun)
 	{
-		mImmediateContext->Draw(1, 0);
+		commands.Draw(1, 0);
 		mFirstRun = false;
 	}
 	else
 	{
-		mImmediateContext->DrawAuto();
+		commands.DrawAuto();
 	}
 
-	ID3D11Buffer* nullBuffers[1] = { 0 };
-	mImmediateContext->SOSetTargets(1, nullBuffers, &offset);
+	commands.SetStreamOutTarget(nullptr, offset);
 
 	// Draw Particles
 	std::swap(mDrawVB, mStreamOutVB);
 
-	mImmediateContext->IASetVertexBuffers(0, 1, &mDrawVB, &stride, &offset);
+	commands.SetVertexBuffer(0, mDrawVB, stride, offset);
 
-	mImmediateContext->VSSetShader(mParticleDrawVS, NULL, 0);
-	mImmediateContext->GSSetShader(mParticleDrawGS, NULL, 0);
-	mImmediateContext->PSSetShader(mParticleDrawPS, NULL, 0);
+	commands.SetVertexShader(mParticleDrawVS);
+	commands.SetGeometryShader(mParticleDrawGS);
+	commands.SetPixelShader(mParticleDrawPS);
 
-	mImmediateContext->GSSetConstantBuffers(0, 1, &mConstBufferPerFrameParticle);
+	commands.SetConstantBuffers(STAGE_GS, 0, 1, &mConstBufferPerFrameParticle);
 
-	mImmediateContext->PSSetShaderResources(0, 1, &mTexArraySRV);
-	mImmediateContext->PSSetSamplers(0, 1, &RenderStates::DefaultSS);
+	commands.SetShaderResources(STAGE_PS, 0, 1, &mTexArraySRV);
+	commands.SetSamplers(STAGE_PS, 0, 1, &RenderStates::DefaultSS);
 
 	float blendFactor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
 
-	mImmediateContext->OMSetDepthStencilState(RenderStates::NoDepthWritesDSS, 0);
-	mImmediateContext->OMSetBlendState(RenderStates::AdditiveBS, blendFactor, 0xffffffff);
+	commands.SetDepthStencilState(RenderStates::NoDepthWritesDSS, 0);
+	commands.SetBlendState(RenderStates::AdditiveBS, blendFactor, 0xffffffff);
 
-	mImmediateContext->DrawAuto();
+	commands.DrawAuto();
 
-	mImmediateContext->VSSetShader(0, NULL, 0);
-	mImmediateContext->GSSetShader(0, NULL, 0);
-	mImmediateContext->PSSetShader(0, NULL, 0);
+	commands.SetVertexShader(nullptr);
+	commands.SetGeometryShader(nullptr);
+	commands.SetPixelShader(nullptr);
 }
\ No newline at end of file
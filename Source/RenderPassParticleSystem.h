@@ -19,6 +19,7 @@
 #include "GFirstPersonCamera.h"
 #include "GObject.h"
 #include "GObjectStore.h"
+#include "RenderGraphTextures.h"
 
 // Particle System
 #define PT_EMITTER 0
@@ -32,19 +33,24 @@ public:
 
 	void Init() override;
 	void Update(float dt) override;
-	void Draw() override;
+	void Setup(RenderGraph& graph, RenderGraphTextures& textures) override;
+	void Draw(CommandBuffer& commands);
 
-	void RenderParticleSystem();
+	void RenderParticleSystem(CommandBuffer& commands);
 	void CreateRandomSRV();
 	void BuildParticleVB();
 
 private:
 	ID3D11Device* mDevice;
-	ID3D11DeviceContext* mImmediateContext;
 	GFirstPersonCamera* mCamera;
 
 	GameTimer* mTimer;
 
+	// Scene color and depth the particles are blended into
+	RenderGraphTextures* mTextures;
+	RGHandle mTarget;
+	RGHandle mDepth;
+
 	ID3D11VertexShader* mParticleStreamOutVS;
 	ID3D11GeometryShader* mParticleStreamOutGS;
 	ID3DBlob* mVSByteCodeParticleSO;
@@ -75,8 +81,6 @@ private:
 	DirectX::XMFLOAT3 mEmitDirW;
 
 	ID3D11Buffer* mConstBufferPerFrameParticle;
-	D3D11_MAPPED_SUBRESOURCE cbPerFrameParticleResource;
-	ConstBufferPerFrameParticle* cbPerFrameParticle;
 };
 
 #endif // RENDERPASS_PARTICLESYSTEM_H
\ No newline at end of file
@@ -3,12 +3,36 @@
 RenderPassSSAO::RenderPassSSAO(ID3D11Device* device, float width, float height, GFirstPersonCamera* camera, GObjectStore* objectStore)
 {
 	mDevice = device;
-	mDevice->GetImmediateContext(&mImmediateContext);
 
 	mWidth = width;
 	mHeight = height;
 	mCamera = camera;
 	mObjectStore = objectStore;
+
+	mResolution = 2;
+	mDownsampleMode = SSAO_DOWNSAMPLE_CHECKERBOARD;
+
+	SetQuality(SSAO_QUALITY_MEDIUM);
+
+	isCompactNormalDepth = true;
+	isUsingCompactNormalDepth = false;
+
+	isTemporal = true;
+
+	isComputeBlur = true;
+	SetBlurRadius(SSAOBlur::DefaultRadius);
+
+	mHistoryIndex = 0;
+	mHistoryWidth = 0;
+	mHistoryHeight = 0;
+	for (int i = 0; i < 2; ++i)
+	{
+		mAmbientHistorySRV[i] = nullptr;
+		mAmbientHistoryRTV[i] = nullptr;
+		mNormalDepthHistorySRV[i] = nullptr;
+		mNormalDepthHistoryRTV[i] = nullptr;
+	}
+	SelectHistory();
 }
 
 RenderPassSSAO::~RenderPassSSAO()
@@ -18,31 +42,6 @@ RenderPassSSAO::~RenderPassSSAO()
 
 void RenderPassSSAO::Init()
 {
-	D3D11_TEXTURE2D_DESC DepthStencilDesc;
-
-	DepthStencilDesc.Width = mWidth;
-	DepthStencilDesc.Height = mHeight;
-	DepthStencilDesc.MipLevels = 1;
-	DepthStencilDesc.ArraySize = 1;
-	DepthStencilDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-
-//	if (mEnableMultisample) {
-//		DepthStencilDesc.SampleDesc.Count = 4;
-//		DepthStencilDesc.SampleDesc.Quality = mMultisampleQuality - 1;
-//	}
-//	else {
-	DepthStencilDesc.SampleDesc.Count = 1;
-	DepthStencilDesc.SampleDesc.Quality = 0;
-//	}
-
-	DepthStencilDesc.Usage = D3D11_USAGE_DEFAULT;
-	DepthStencilDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-	DepthStencilDesc.CPUAccessFlags = 0;
-	DepthStencilDesc.MiscFlags = 0;
-
-	mDevice->CreateTexture2D(&DepthStencilDesc, nullptr, &mDepthStencilBuffer);
-	mDevice->CreateDepthStencilView(mDepthStencilBuffer, nullptr, &mDepthStencilView);
-
 	mViewport.TopLeftX = 0.0f;
 	mViewport.TopLeftY = 0.0f;
 	mViewport.Width = mWidth;
@@ -53,19 +52,41 @@ void RenderPassSSAO::Init()
 	CreateVertexShader(mDevice, &mNormalDepthVS, &mVSByteCodeND, L"Assets/Shaders/NormalDepthVS.hlsl", "VS");
 	CreatePixelShader(mDevice, &mNormalDepthPS, L"Assets/Shaders/NormalDepthPS.hlsl", "PS");
 
+	const D3D_SHADER_MACRO compactDefines[] = { { "COMPACT_NORMAL_DEPTH", "1" }, { nullptr, nullptr } };
+	CreatePixelShader(mDevice, &mCompactNormalDepthPS, L"Assets/Shaders/NormalDepthPS.hlsl", "PS", compactDefines);
+
 	CreateVertexShader(mDevice, &mSsaoVS, &mVSByteCodeSSAO, L"Assets/Shaders/SSAOVS.hlsl", "VS");
 	CreatePixelShader(mDevice, &mSsaoPS, L"Assets/Shaders/SSAOPS.hlsl", "PS");
 
 	CreateVertexShader(mDevice, &mBlurVS, &mVSByteCodeBlur, L"Assets/Shaders/BlurVS.hlsl", "VS");
 	CreatePixelShader(mDevice, &mBlurPS, L"Assets/Shaders/BlurPS.hlsl", "PS");
 
+	CreatePixelShader(mDevice, &mDownsamplePS, L"Assets/Shaders/SSAODownsamplePS.hlsl", "PS");
+	CreatePixelShader(mDevice, &mUpsamplePS, L"Assets/Shaders/SSAOUpsamplePS.hlsl", "PS");
+	CreatePixelShader(mDevice, &mCompactDownsamplePS, L"Assets/Shaders/SSAODownsamplePS.hlsl", "PS", compactDefines);
+	CreatePixelShader(mDevice, &mCompactUpsamplePS, L"Assets/Shaders/SSAOUpsamplePS.hlsl", "PS", compactDefines);
+	CreatePixelShader(mDevice, &mTemporalPS, L"Assets/Shaders/SSAOTemporalPS.hlsl", "PS");
+
+	const D3D_SHADER_MACRO verticalDefines[] = { { "VERTICAL", "1" }, { nullptr, nullptr } };
+	CreateComputeShader(mDevice, &mBlurHorizontalCS, L"Assets/Shaders/SSAOBlurCS.hlsl", "CS");
+	CreateComputeShader(mDevice, &mBlurVerticalCS, L"Assets/Shaders/SSAOBlurCS.hlsl", "CS", verticalDefines);
+
 	UINT numElements;
 
-	// Create the vertex input layout.
+	// Create the vertex input layout. Objects are drawn instanced, with their
+	// transforms in slot 1.
 	D3D11_INPUT_ELEMENT_DESC vertexDescND[] =
 	{
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		{ "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "WORLD",             0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0,   D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD",             1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD",             2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD",             3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLDINVTRANSPOSE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLDINVTRANSPOSE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 80,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLDINVTRANSPOSE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 96,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLDINVTRANSPOSE", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 112, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
 	};
 
 	numElements = sizeof(vertexDescND) / sizeof(D3D11_INPUT_ELEMENT_DESC);
@@ -91,9 +112,10 @@ void RenderPassSSAO::Init()
 	CreateConstantBuffer(mDevice, &mConstBufferPerObjectND, sizeof(ConstBufferPerObjectNormalDepth));
 	CreateConstantBuffer(mDevice, &mConstBufferPerFrameSSAO, sizeof(ConstBufferPerFrameSSAO));
 	CreateConstantBuffer(mDevice, &mConstBufferBlurParams, sizeof(ConstBufferBlurParams));
+	CreateConstantBuffer(mDevice, &mConstBufferResample, sizeof(ConstBufferSSAOResample));
+	CreateConstantBuffer(mDevice, &mConstBufferTemporal, sizeof(ConstBufferSSAOTemporal));
+	CreateConstantBuffer(mDevice, &mConstBufferBlurCS, sizeof(ConstBufferSSAOBlur));
 
-	SetupNormalDepth();
-	SetupSSAO();
 	BuildFrustumCorners();
 	BuildOffsetVectors();
 	BuildFullScreenQuad();
@@ -102,106 +124,180 @@ void RenderPassSSAO::Init()
 
 void RenderPassSSAO::Update(float dt)
 {
+	// Track the camera even while temporal mode is off, so switching it on can reproject
+	// from the first frame
+	mTemporal.BeginFrame(mCamera->View(), mCamera->Proj());
 
+	// Last frame's history is this frame's input
+	mHistoryIndex = 1 - mHistoryIndex;
+	SelectHistory();
 }
 
-void RenderPassSSAO::Draw()
+void RenderPassSSAO::Setup(RenderGraph& graph, RenderGraphTextures& textures)
 {
+	mTextures = &textures;
+
+	UINT width = static_cast<UINT>(mWidth);
+	UINT height = static_cast<UINT>(mHeight);
+	UINT aoWidth = SSAOResample::GetReducedSize(width, mResolution);
+	UINT aoHeight = SSAOResample::GetReducedSize(height, mResolution);
+
+	mAOViewport = mViewport;
+	mAOViewport.Width = static_cast<float>(aoWidth);
+	mAOViewport.Height = static_cast<float>(aoHeight);
+
+	// The compact target holds only the normal; its depth buffer is typeless so the
+	// resample passes can read it
+	isUsingCompactNormalDepth = isCompactNormalDepth && mResolution > 1;
+
+	RGTextureDesc normalDepthDesc = { width, height, DXGI_FORMAT_R16G16B16A16_FLOAT, 8 };
+	RGTextureDesc depthDesc = { width, height, DXGI_FORMAT_D24_UNORM_S8_UINT, 4 };
+	if (isUsingCompactNormalDepth)
+	{
+		normalDepthDesc = { width, height, DXGI_FORMAT_R16G16_SNORM, 4 };
+		depthDesc.Format = DXGI_FORMAT_R24G8_TYPELESS;
+	}
+	RGTextureDesc reducedNormalDepthDesc = { aoWidth, aoHeight, DXGI_FORMAT_R16G16B16A16_FLOAT, 8 };
+	RGTextureDesc ambientDesc = { aoWidth, aoHeight, DXGI_FORMAT_R16_FLOAT, 2 };
+	RGTextureDesc upsampledDesc = { width, height, DXGI_FORMAT_R16_FLOAT, 2 };
+
 	// Render Scene Normals and Depth
-	RenderNormalDepthMap();
+	UINT pass = graph.AddPass("NormalDepth", [this](CommandBuffer& commands) { RenderNormalDepthMap(commands); });
+	mNormalDepthMap = graph.Write(pass, graph.CreateTexture("NormalDepthMap", normalDepthDesc), RG_BIND_RENDER_TARGET);
+	mNormalDepthZ = graph.Write(pass, graph.CreateTexture("NormalDepthZ", depthDesc), RG_BIND_DEPTH_STENCIL);
+
+	mAONormalDepthMap = mNormalDepthMap;
+
+	// Downsample Normals and Depth
+	if (mResolution > 1)
+	{
+		pass = graph.AddPass("SSAODownsample", [this](CommandBuffer& commands) { DownsampleNormalDepthMap(commands); });
+		graph.Read(pass, mNormalDepthMap, STAGE_PS, 0);
+		if (isUsingCompactNormalDepth)
+		{
+			graph.Read(pass, mNormalDepthZ, STAGE_PS, 1);
+		}
+		mReducedNormalDepthMap = graph.Write(pass, graph.CreateTexture("ReducedNormalDepthMap", reducedNormalDepthDesc), RG_BIND_RENDER_TARGET);
+
+		mAONormalDepthMap = mReducedNormalDepthMap;
+	}
 
 	// Render SSAO Map
-	RenderSSAOMap();
+	pass = graph.AddPass("SSAO", [this](CommandBuffer& commands) { RenderSSAOMap(commands); });
+	graph.Read(pass, mAONormalDepthMap, STAGE_PS, 0);
+	mFrameAmbientMap = graph.Write(pass, graph.CreateTexture("AmbientMap", ambientDesc), RG_BIND_RENDER_TARGET);
+
+	mAmbientMaps[0] = mFrameAmbientMap;
+
+	// Accumulate SSAO Map. The history is imported; only the blur reads this frame's.
+	if (isTemporal)
+	{
+		BuildHistoryTargets(aoWidth, aoHeight);
+
+		mPreviousAmbientMap = graph.ImportTexture("AmbientHistoryPrevious");
+		mPreviousNormalDepthMap = graph.ImportTexture("NormalDepthHistoryPrevious");
+		RGHandle ambientHistory = graph.ImportTexture("AmbientHistory");
+		RGHandle normalDepthHistory = graph.ImportTexture("NormalDepthHistory");
+
+		textures.Import(mPreviousAmbientMap, &mPreviousAmbientSRV, nullptr, nullptr);
+		textures.Import(mPreviousNormalDepthMap, &mPreviousNormalDepthSRV, nullptr, nullptr);
+		textures.Import(ambientHistory, &mCurrentAmbientSRV, &mCurrentAmbientRTV, nullptr);
+		textures.Import(normalDepthHistory, nullptr, &mCurrentNormalDepthRTV, nullptr);
+
+		pass = graph.AddPass("SSAOTemporal", [this](CommandBuffer& commands) { AccumulateSSAOMap(commands); });
+		graph.Read(pass, mAONormalDepthMap, STAGE_PS, 0);
+		graph.Read(pass, mFrameAmbientMap, STAGE_PS, 1);
+		graph.Read(pass, mPreviousAmbientMap, STAGE_PS, 2);
+		graph.Read(pass, mPreviousNormalDepthMap, STAGE_PS, 3);
+		mAmbientMaps[0] = graph.Write(pass, ambientHistory, RG_BIND_RENDER_TARGET);
+		mNormalDepthHistory = graph.Write(pass, normalDepthHistory, RG_BIND_RENDER_TARGET);
+	}
 
 	// Blur SSAO Map
-	BlurSSAOMap(4);
+	if (isComputeBlur)
+	{
+		for (int i = 0; i < 2; ++i)
+		{
+			bool isHorizontal = i == 0;
+			pass = graph.AddPass(isHorizontal ? "BlurHorizontal" : "BlurVertical", [this, isHorizontal](CommandBuffer& commands) { BlurSSAOMapCompute(commands, isHorizontal); });
+			graph.Read(pass, mAONormalDepthMap, STAGE_CS, 0);
+			graph.Read(pass, mAmbientMaps[i], STAGE_CS, 1);
+			mAmbientMaps[i + 1] = graph.Write(pass, graph.CreateTexture("AmbientMapBlurred", ambientDesc), RG_BIND_UNORDERED_ACCESS, 0);
+		}
+
+		mBlurredAmbientMap = mAmbientMaps[2];
+	}
+	else
+	{
+		for (int i = 0; i < 2 * BlurCount; ++i)
+		{
+			pass = graph.AddPass((i % 2) == 0 ? "BlurHorizontal" : "BlurVertical", [this, i](CommandBuffer& commands) { BlurSSAOMap(commands, i); });
+			graph.Read(pass, mAONormalDepthMap, STAGE_PS, 0);
+			graph.Read(pass, mAmbientMaps[i], STAGE_PS, 1);
+			mAmbientMaps[i + 1] = graph.Write(pass, graph.CreateTexture("AmbientMapBlurred", ambientDesc), RG_BIND_RENDER_TARGET);
+		}
+
+		mBlurredAmbientMap = mAmbientMaps[2 * BlurCount];
+	}
+
+	if (mResolution == 1)
+	{
+		graph.Publish("SSAOMap", mBlurredAmbientMap);
+		return;
+	}
+
+	// Upsample the blurred SSAO Map, guided by the full resolution normals and depth
+	pass = graph.AddPass("SSAOUpsample", [this](CommandBuffer& commands) { UpsampleSSAOMap(commands); });
+	graph.Read(pass, mNormalDepthMap, STAGE_PS, 0);
+	graph.Read(pass, mReducedNormalDepthMap, STAGE_PS, 1);
+	graph.Read(pass, mBlurredAmbientMap, STAGE_PS, 2);
+	if (isUsingCompactNormalDepth)
+	{
+		graph.Read(pass, mNormalDepthZ, STAGE_PS, 3);
+	}
+	mUpsampledAmbientMap = graph.Write(pass, graph.CreateTexture("AmbientMapUpsampled", upsampledDesc), RG_BIND_RENDER_TARGET);
+
+	graph.Publish("SSAOMap", mUpsampledAmbientMap);
+}
+
+void RenderPassSSAO::SetResolution(UINT factor)
+{
+	mResolution = factor > 0 ? factor : 1;
 }
 
+void RenderPassSSAO::SetTemporal(bool temporal)
+{
+	isTemporal = temporal;
+}
 
-// AO Set-Up
+void RenderPassSSAO::SetQuality(SSAOQuality quality)
+{
+	mQuality = quality;
+	mSampleCount = SSAOKernel::GetSampleCount(quality);
+	mTemporal.SetKernelSize(mSampleCount);
 
-void RenderPassSSAO::SetupNormalDepth()
+	BuildOffsetVectors();
+}
+
+void RenderPassSSAO::SetCompactNormalDepth(bool compact)
+{
+	isCompactNormalDepth = compact;
+}
+
+void RenderPassSSAO::SetComputeBlur(bool computeBlur)
 {
-	// Are the texture formats correct?
-
-	D3D11_TEXTURE2D_DESC normalDepthTexDesc;
-	normalDepthTexDesc.Width = mWidth;
-	normalDepthTexDesc.Height = mHeight;
-	normalDepthTexDesc.MipLevels = 1;
-	normalDepthTexDesc.ArraySize = 1;
-	normalDepthTexDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-	normalDepthTexDesc.SampleDesc.Count = 1;
-	normalDepthTexDesc.SampleDesc.Quality = 0;
-	normalDepthTexDesc.Usage = D3D11_USAGE_DEFAULT;
-	normalDepthTexDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	normalDepthTexDesc.CPUAccessFlags = 0;
-	normalDepthTexDesc.MiscFlags = 0;
-
-	ID3D11Texture2D* normalDepthTex;
-	HR(mDevice->CreateTexture2D(&normalDepthTexDesc, 0, &normalDepthTex));
-
-	D3D11_RENDER_TARGET_VIEW_DESC normalDepthRTVDesc;
-	normalDepthRTVDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-	normalDepthRTVDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	normalDepthRTVDesc.Texture2D.MipSlice = 0;
-
-	HR(mDevice->CreateRenderTargetView(normalDepthTex, &normalDepthRTVDesc, &mNormalDepthRTV));
-
-	D3D11_SHADER_RESOURCE_VIEW_DESC normalDepthSRVDesc;
-	normalDepthSRVDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-	normalDepthSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	normalDepthSRVDesc.Texture2D.MipLevels = normalDepthTexDesc.MipLevels;
-	normalDepthSRVDesc.Texture2D.MostDetailedMip = 0;
-
-	HR(mDevice->CreateShaderResourceView(normalDepthTex, &normalDepthSRVDesc, &mNormalDepthSRV));
-
-	ReleaseCOM(normalDepthTex);
+	isComputeBlur = computeBlur;
 }
 
-void RenderPassSSAO::SetupSSAO()
+void RenderPassSSAO::SetBlurRadius(int radius)
 {
-	// Are the texture formats correct?
-
-	D3D11_TEXTURE2D_DESC ssaoTexDesc;
-	ssaoTexDesc.Width = mWidth;
-	ssaoTexDesc.Height = mHeight;
-	ssaoTexDesc.MipLevels = 1;
-	ssaoTexDesc.ArraySize = 1;
-	ssaoTexDesc.Format = DXGI_FORMAT_R16_FLOAT;
-	ssaoTexDesc.SampleDesc.Count = 1;
-	ssaoTexDesc.SampleDesc.Quality = 0;
-	ssaoTexDesc.Usage = D3D11_USAGE_DEFAULT;
-	ssaoTexDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	ssaoTexDesc.CPUAccessFlags = 0;
-	ssaoTexDesc.MiscFlags = 0;
-
-	ID3D11Texture2D* ssaoTex0;
-	HR(mDevice->CreateTexture2D(&ssaoTexDesc, 0, &ssaoTex0));
-
-	ID3D11Texture2D* ssaoTex1;
-	HR(mDevice->CreateTexture2D(&ssaoTexDesc, 0, &ssaoTex1));
-
-	D3D11_RENDER_TARGET_VIEW_DESC ssaoRTVDesc;
-	ssaoRTVDesc.Format = DXGI_FORMAT_R16_FLOAT;
-	ssaoRTVDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	ssaoRTVDesc.Texture2D.MipSlice = 0;
-
-	HR(mDevice->CreateRenderTargetView(ssaoTex0, &ssaoRTVDesc, &mSsaoRTV0));
-	HR(mDevice->CreateRenderTargetView(ssaoTex1, &ssaoRTVDesc, &mSsaoRTV1));
-
-	D3D11_SHADER_RESOURCE_VIEW_DESC ssaoSRVDesc;
-	ssaoSRVDesc.Format = DXGI_FORMAT_R16_FLOAT;
-	ssaoSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	ssaoSRVDesc.Texture2D.MipLevels = ssaoTexDesc.MipLevels;
-	ssaoSRVDesc.Texture2D.MostDetailedMip = 0;
-
-	HR(mDevice->CreateShaderResourceView(ssaoTex0, &ssaoSRVDesc, &mSsaoSRV0));
-	HR(mDevice->CreateShaderResourceView(ssaoTex1, &ssaoSRVDesc, &mSsaoSRV1));
-
-	ReleaseCOM(ssaoTex0);
-	ReleaseCOM(ssaoTex1);
+	mBlurRadius = radius < 1 ? 1 : (radius > SSAOBlur::MaxRadius ? SSAOBlur::MaxRadius : radius);
+	SSAOBlur::BuildWeights(mBlurRadius, mBlurWeights);
 }
 
+
+// AO Set-Up
+
 void RenderPassSSAO::BuildFrustumCorners()
 {
 	float farZ = mCamera->GetFarZ();
@@ -217,41 +313,14 @@ void RenderPassSSAO::BuildFrustumCorners()
 
 void RenderPassSSAO::BuildOffsetVectors()
 {
-	mOffsets[0] = DirectX::XMFLOAT4(+1.0f, +1.0f, +1.0f, 0.0f);
-	mOffsets[1] = DirectX::XMFLOAT4(-1.0f, -1.0f, -1.0f, 0.0f);
-
-	mOffsets[2] = DirectX::XMFLOAT4(+1.0f, +1.0f, -1.0f, 0.0f);
-	mOffsets[3] = DirectX::XMFLOAT4(-1.0f, -1.0f, +1.0f, 0.0f);
-
-	mOffsets[4] = DirectX::XMFLOAT4(+1.0f, -1.0f, +1.0f, 0.0f);
-	mOffsets[5] = DirectX::XMFLOAT4(-1.0f, +1.0f, -1.0f, 0.0f);
-
-	mOffsets[6] = DirectX::XMFLOAT4(-1.0f, +1.0f, +1.0f, 0.0f);
-	mOffsets[7] = DirectX::XMFLOAT4(+1.0f, -1.0f, -1.0f, 0.0f);
-
-	mOffsets[8] = DirectX::XMFLOAT4(-1.0f, 0.0f, 0.0f, 0.0f);
-	mOffsets[9] = DirectX::XMFLOAT4(+1.0f, 0.0f, 0.0f, 0.0f);
-
-	mOffsets[10] = DirectX::XMFLOAT4(0.0f, +1.0f, 0.0f, 0.0f);
-	mOffsets[11] = DirectX::XMFLOAT4(0.0f, -1.0f, 0.0f, 0.0f);
-
-	mOffsets[12] = DirectX::XMFLOAT4(0.0f, 0.0f, +1.0f, 0.0f);
-	mOffsets[13] = DirectX::XMFLOAT4(0.0f, 0.0f, -1.0f, 0.0f);
-
-	for (int i = 0; i < 14; ++i)
-	{
-		DirectX::XMVECTOR v = DirectX::XMVector2Normalize(DirectX::XMLoadFloat4(&mOffsets[i]));
-		float s = MathHelper::RandF(0.25, 1.0f);
-		v = DirectX::XMVectorScale(v, s);
-		DirectX::XMStoreFloat4(&mOffsets[i], v);
-	}
+	SSAOKernel::BuildKernel(mSampleCount, mOffsets);
 }
 
 void RenderPassSSAO::BuildRandomVectorTexture()
 {
 	D3D11_TEXTURE2D_DESC texDesc;
-	texDesc.Width = 256;
-	texDesc.Height = 256;
+	texDesc.Width = SSAOKernel::NoiseSize;
+	texDesc.Height = SSAOKernel::NoiseSize;
 	texDesc.MipLevels = 1;
 	texDesc.ArraySize = 1;
 	texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
@@ -262,28 +331,81 @@ void RenderPassSSAO::BuildRandomVectorTexture()
 	texDesc.CPUAccessFlags = 0;
 	texDesc.MiscFlags = 0;
 
+	std::vector<UINT> texels;
+	SSAOKernel::BuildNoiseTexture(SSAOKernel::NoiseSize, texels);
+
 	D3D11_SUBRESOURCE_DATA initData = { 0 };
-	initData.SysMemPitch = 256 * sizeof(DirectX::PackedVector::XMCOLOR);
+	initData.SysMemPitch = SSAOKernel::NoiseSize * sizeof(UINT);
+	initData.pSysMem = texels.data();
 
-	DirectX::PackedVector::XMCOLOR color[256 * 256];
-	for (int i = 0; i < 256; ++i)
+	ID3D11Texture2D* randomVectorTex = 0;
+	HR(mDevice->CreateTexture2D(&texDesc, &initData, &randomVectorTex));
+
+	HR(mDevice->CreateShaderResourceView(randomVectorTex, 0, &mRandomVectorSRV));
+
+	ReleaseCOM(randomVectorTex);
+}
+
+void RenderPassSSAO::BuildHistoryTargets(UINT width, UINT height)
+{
+	// Whatever the targets held belongs to a different graph set-up
+	mTemporal.Reset();
+
+	if (width == mHistoryWidth && height == mHistoryHeight)
 	{
-		for (int j = 0; j < 256; ++j)
-		{
-			DirectX::XMFLOAT3 v(MathHelper::RandF(), MathHelper::RandF(), MathHelper::RandF());
+		return;
+	}
 
-			color[i * 256 + j] = DirectX::PackedVector::XMCOLOR(v.x, v.y, v.z, 0.0f);
-		}
+	for (int i = 0; i < 2; ++i)
+	{
+		ReleaseCOM(mAmbientHistorySRV[i]);
+		ReleaseCOM(mAmbientHistoryRTV[i]);
+		ReleaseCOM(mNormalDepthHistorySRV[i]);
+		ReleaseCOM(mNormalDepthHistoryRTV[i]);
+
+		CreateHistoryTarget(width, height, DXGI_FORMAT_R16_FLOAT, &mAmbientHistorySRV[i], &mAmbientHistoryRTV[i]);
+		CreateHistoryTarget(width, height, DXGI_FORMAT_R16G16B16A16_FLOAT, &mNormalDepthHistorySRV[i], &mNormalDepthHistoryRTV[i]);
 	}
 
-	initData.pSysMem = color;
+	mHistoryWidth = width;
+	mHistoryHeight = height;
 
-	ID3D11Texture2D* randomVectorTex = 0;
-	HR(mDevice->CreateTexture2D(&texDesc, &initData, &randomVectorTex));
+	SelectHistory();
+}
 
-	HR(mDevice->CreateShaderResourceView(randomVectorTex, 0, &mRandomVectorSRV));
+void RenderPassSSAO::CreateHistoryTarget(UINT width, UINT height, DXGI_FORMAT format, ID3D11ShaderResourceView** srv, ID3D11RenderTargetView** rtv)
+{
+	D3D11_TEXTURE2D_DESC texDesc;
+	texDesc.Width = width;
+	texDesc.Height = height;
+	texDesc.MipLevels = 1;
+	texDesc.ArraySize = 1;
+	texDesc.Format = format;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.SampleDesc.Quality = 0;
+	texDesc.Usage = D3D11_USAGE_DEFAULT;
+	texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	texDesc.CPUAccessFlags = 0;
+	texDesc.MiscFlags = 0;
 
-	ReleaseCOM(randomVectorTex);
+	ID3D11Texture2D* texture = 0;
+	HR(mDevice->CreateTexture2D(&texDesc, 0, &texture));
+
+	HR(mDevice->CreateShaderResourceView(texture, 0, srv));
+	HR(mDevice->CreateRenderTargetView(texture, 0, rtv));
+
+	ReleaseCOM(texture);
+}
+
+void RenderPassSSAO::SelectHistory()
+{
+	UINT previous = 1 - mHistoryIndex;
+
+	mPreviousAmbientSRV = mAmbientHistorySRV[previous];
+	mPreviousNormalDepthSRV = mNormalDepthHistorySRV[previous];
+	mCurrentAmbientSRV = mAmbientHistorySRV[mHistoryIndex];
+	mCurrentAmbientRTV = mAmbientHistoryRTV[mHistoryIndex];
+	mCurrentNormalDepthRTV = mNormalDepthHistoryRTV[mHistoryIndex];
 }
 
 void RenderPassSSAO::BuildFullScreenQuad()
@@ -339,70 +461,86 @@ void RenderPassSSAO::BuildFullScreenQuad()
 	HR(mDevice->CreateBuffer(&ibd, &iinitData, &mScreenQuadIB));
 }
 
-void RenderPassSSAO::RenderNormalDepthMap()
+void RenderPassSSAO::RenderNormalDepthMap(CommandBuffer& commands)
 {
-	ID3D11RenderTargetView* renderTargets[] = { mNormalDepthRTV };
-	mImmediateContext->OMSetRenderTargets(1, renderTargets, mDepthStencilView);
+	ID3D11RenderTargetView* normalDepthRTV = mTextures->GetRTV(mNormalDepthMap);
+	ID3D11DepthStencilView* depthStencilView = mTextures->GetDSV(mNormalDepthZ);
+
+	ID3D11RenderTargetView* renderTargets[] = { normalDepthRTV };
+	commands.SetRenderTargets(1, renderTargets, depthStencilView);
 
 	// Clear the render target and depth/stencil views
 	float clearColor[] = { 0.0f, 0.0f, -1.0f, 1e5f };
-	mImmediateContext->ClearRenderTargetView(mNormalDepthRTV, clearColor);
-	mImmediateContext->ClearDepthStencilView(mDepthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+
+	// The compact clear is (0, 0, -1) octahedral encoded; the cleared depth buffer reads
+	// back as the far plane
+	float compactClearColor[] = { 1.0f, 1.0f, 0.0f, 0.0f };
+	commands.ClearRenderTarget(normalDepthRTV, isUsingCompactNormalDepth ? compactClearColor : clearColor);
+	commands.ClearDepthStencil(depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 
 
 	// Set Viewport
-	mImmediateContext->RSSetViewports(1, &mViewport);
+	commands.SetViewport(mViewport);
 
 	// Set Vertex Layout
-	mImmediateContext->IASetInputLayout(mVertexLayoutNormalDepth);
-	mImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	commands.SetInputLayout(mVertexLayoutNormalDepth);
+	commands.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	// Set Render States
 	float blendFactor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
 
-	mImmediateContext->RSSetState(RenderStates::DefaultRS);
-	mImmediateContext->OMSetBlendState(RenderStates::DefaultBS, blendFactor, 0xffffffff);
-	mImmediateContext->OMSetDepthStencilState(RenderStates::DefaultDSS, 0);
+	commands.SetRasterizerState(RenderStates::DefaultRS);
+	commands.SetBlendState(RenderStates::DefaultBS, blendFactor, 0xffffffff);
+	commands.SetDepthStencilState(RenderStates::DefaultDSS, 0);
 
 	// Set Shaders
-	mImmediateContext->VSSetShader(mNormalDepthVS, NULL, 0);
-	mImmediateContext->PSSetShader(mNormalDepthPS, NULL, 0);
+	commands.SetVertexShader(mNormalDepthVS);
+	commands.SetPixelShader(isUsingCompactNormalDepth ? mCompactNormalDepthPS : mNormalDepthPS);
 
 	// Bind Constant Buffers to the Pipeline
-	mImmediateContext->VSSetConstantBuffers(0, 1, &mConstBufferPerObjectND);
+	commands.SetConstantBuffers(STAGE_VS, 0, 1, &mConstBufferPerObjectND);
 
 	// Compute ViewProj matrix of the light source
 	DirectX::XMMATRIX view = mCamera->View();
 	DirectX::XMMATRIX viewProj = mCamera->ViewProj();
 
-	DirectX::XMMATRIX world;
-	DirectX::XMMATRIX worldView;
-	DirectX::XMMATRIX worldViewProj;
+	// World and normal transforms come from the instance data, so the constants only
+	// carry the view. The view is rigid, so it also transforms the world normals.
+	ConstBufferPerObjectNormalDepth* cbPerObjectND = commands.UpdateConstants<ConstBufferPerObjectNormalDepth>(mConstBufferPerObjectND);
+	cbPerObjectND->worldView = DirectX::XMMatrixTranspose(view);
+	cbPerObjectND->worldViewProj = DirectX::XMMatrixTranspose(viewProj);
+	cbPerObjectND->worldInvTranposeView = DirectX::XMMatrixTranspose(view);
 
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
 
-	std::vector<GObject*> objects = mObjectStore->GetObjects();
+	GObjectSpan objects = mObjectStore->GetVisibleOpaque();
 
-	for (auto it = objects.begin(); it != objects.end(); ++it)
+	mObjectQueue.Reset();
+	for (UINT i = 0; i < objects.size(); ++i)
 	{
-		GObject* obj = *it;
+		mObjectQueue.Add(objects[i]->GetMeshKey(), i);
+	}
 
-		world = DirectX::XMLoadFloat4x4(&obj->GetWorldTransform());
-		worldView = world*view;
-		worldViewProj = world*viewProj;
+	mObjectQueue.Sort();
+	mObjectQueue.BuildRuns(~0ull, MaxInstancesPerDraw, mObjectRuns);
 
-		mImmediateContext->Map(mConstBufferPerObjectND, 0, D3D11_MAP_WRITE_DISCARD, 0, &cbPerObjectNDResource);
-		cbPerObjectND = (ConstBufferPerObjectNormalDepth*)cbPerObjectNDResource.pData;
-		cbPerObjectND->worldView = DirectX::XMMatrixTranspose(worldView);
-		cbPerObjectND->worldViewProj = DirectX::XMMatrixTranspose(worldViewProj);
-		cbPerObjectND->worldInvTranposeView = MathHelper::InverseTranspose(world)*view;
-		mImmediateContext->Unmap(mConstBufferPerObjectND, 0);
+	for (auto run = mObjectRuns.begin(); run != mObjectRuns.end(); ++run)
+	{
+		InstanceTransform* instances = commands.SetVertexData<InstanceTransform>(1, run->Count);
+		for (UINT i = 0; i < run->Count; ++i)
+		{
+			GObject* obj = objects[mObjectQueue.GetItem(run->First + i).Payload];
+			instances[i].World = obj->GetWorldTransform();
+			instances[i].WorldInvTranspose = obj->GetNormalTransform();
+		}
 
-		mImmediateContext->IASetVertexBuffers(0, 1, obj->GetVertexBuffer(), &stride, &offset);
-		mImmediateContext->IASetIndexBuffer(*obj->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
+		// Every object in the run has the same mesh; draw it with the first one's buffers
+		GObject* obj = objects[mObjectQueue.GetItem(run->First).Payload];
+		commands.SetVertexBuffer(0, *obj->GetVertexBuffer(), stride, offset);
+		commands.SetIndexBuffer(*obj->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
 
-		mImmediateContext->DrawIndexed(obj->GetIndexCount(), 0, 0);
+		commands.DrawIndexedInstanced(obj->GetIndexCount(), run->Count, obj->GetStartIndex(), obj->GetBaseVertex(), 0);
 	}
 /*
 	// Draw the grid
@@ -482,23 +620,23 @@ void RenderPassSSAO::RenderNormalDepthMap()
 	*/
 }
 
-void RenderPassSSAO::RenderSSAOMap()
+void RenderPassSSAO::RenderSSAOMap(CommandBuffer& commands)
 {
-	// TODO: Use half-resolution render target and viewport
-
 	// Restore the back and depth buffer
-	ID3D11RenderTargetView* renderTargets[] = { mSsaoRTV0 };
-	mImmediateContext->OMSetRenderTargets(1, renderTargets, 0);
+	ID3D11RenderTargetView* ambientRTV = mTextures->GetRTV(mFrameAmbientMap);
+
+	ID3D11RenderTargetView* renderTargets[] = { ambientRTV };
+	commands.SetRenderTargets(1, renderTargets, 0);
 
 	// Clear the render target and depth/stencil views
-	mImmediateContext->ClearRenderTargetView(mSsaoRTV0, reinterpret_cast<const float*>(&Colors::Black));
+	commands.ClearRenderTarget(ambientRTV, reinterpret_cast<const float*>(&Colors::Black));
 
 	// Set Viewport
-	mImmediateContext->RSSetViewports(1, &mViewport);
+	commands.SetViewport(mAOViewport);
 
 	// Set Vertex Layout
-	mImmediateContext->IASetInputLayout(mVertexLayoutSSAO);
-	mImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	commands.SetInputLayout(mVertexLayoutSSAO);
+	commands.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	static const DirectX::XMMATRIX T(
 		0.5f, 0.0f, 0.0f, 0.0f,
@@ -508,138 +646,254 @@ void RenderPassSSAO::RenderSSAOMap()
 
 	DirectX::XMMATRIX viewTexTransform = XMMatrixMultiply(mCamera->Proj(), T);
 
-	mImmediateContext->Map(mConstBufferPerFrameSSAO, 0, D3D11_MAP_WRITE_DISCARD, 0, &cbPerFrameSSAOResource);
-	cbPerFrameSSAO = (ConstBufferPerFrameSSAO*)cbPerFrameSSAOResource.pData;
+	ConstBufferPerFrameSSAO* cbPerFrameSSAO = commands.UpdateConstants<ConstBufferPerFrameSSAO>(mConstBufferPerFrameSSAO);
 	cbPerFrameSSAO->viewTex = DirectX::XMMatrixTranspose(viewTexTransform);
 	cbPerFrameSSAO->frustumFarCorners[0] = mFrustumFarCorners[0];
 	cbPerFrameSSAO->frustumFarCorners[1] = mFrustumFarCorners[1];
 	cbPerFrameSSAO->frustumFarCorners[2] = mFrustumFarCorners[2];
 	cbPerFrameSSAO->frustumFarCorners[3] = mFrustumFarCorners[3];
-	cbPerFrameSSAO->offsets[0] = mOffsets[0];
-	cbPerFrameSSAO->offsets[1] = mOffsets[1];
-	cbPerFrameSSAO->offsets[2] = mOffsets[2];
-	cbPerFrameSSAO->offsets[3] = mOffsets[3];
-	cbPerFrameSSAO->offsets[4] = mOffsets[4];
-	cbPerFrameSSAO->offsets[5] = mOffsets[5];
-	cbPerFrameSSAO->offsets[6] = mOffsets[6];
-	cbPerFrameSSAO->offsets[7] = mOffsets[7];
-	cbPerFrameSSAO->offsets[8] = mOffsets[8];
-	cbPerFrameSSAO->offsets[9] = mOffsets[9];
-	cbPerFrameSSAO->offsets[10] = mOffsets[10];
-	cbPerFrameSSAO->offsets[11] = mOffsets[11];
-	cbPerFrameSSAO->offsets[12] = mOffsets[12];
-	cbPerFrameSSAO->offsets[13] = mOffsets[13];
-	mImmediateContext->Unmap(mConstBufferPerFrameSSAO, 0);
-
-	mImmediateContext->VSSetShader(mSsaoVS, NULL, 0);
-	mImmediateContext->PSSetShader(mSsaoPS, NULL, 0);
-
-	mImmediateContext->VSSetConstantBuffers(0, 1, &mConstBufferPerFrameSSAO);
-	mImmediateContext->PSSetConstantBuffers(0, 1, &mConstBufferPerFrameSSAO);
-
-	mImmediateContext->PSSetShaderResources(0, 1, &mNormalDepthSRV);
-	mImmediateContext->PSSetShaderResources(1, 1, &mRandomVectorSRV);
-
-	ID3D11SamplerState* samplers[] = { RenderStates::SsaoSS, RenderStates::DefaultSS };
-	mImmediateContext->PSSetSamplers(0, 2, samplers);
+
+	// Temporal mode samples a rotated slice of the kernel, over a shifted noise tiling
+	if (isTemporal)
+	{
+		cbPerFrameSSAO->sampleCount = mTemporal.GetFrameOffsets(mOffsets, cbPerFrameSSAO->offsets);
+		cbPerFrameSSAO->noiseOffset = mTemporal.GetNoiseOffset();
+	}
+	else
+	{
+		for (UINT i = 0; i < mSampleCount; ++i)
+		{
+			cbPerFrameSSAO->offsets[i] = mOffsets[i];
+		}
+		cbPerFrameSSAO->sampleCount = mSampleCount;
+		cbPerFrameSSAO->noiseOffset = DirectX::XMFLOAT2(0.0f, 0.0f);
+	}
+
+	commands.SetVertexShader(mSsaoVS);
+	commands.SetPixelShader(mSsaoPS);
+
+	commands.SetConstantBuffers(STAGE_VS, 0, 1, &mConstBufferPerFrameSSAO);
+	commands.SetConstantBuffers(STAGE_PS, 0, 1, &mConstBufferPerFrameSSAO);
+
+	ID3D11ShaderResourceView* normalDepthSRV = mTextures->GetSRV(mAONormalDepthMap);
+	commands.SetShaderResources(STAGE_PS, 0, 1, &normalDepthSRV);
+	commands.SetShaderResources(STAGE_PS, 1, 1, &mRandomVectorSRV);
+
+	// The random vectors are loaded, not sampled
+	ID3D11SamplerState* samplers[] = { RenderStates::SsaoSS };
+	commands.SetSamplers(STAGE_PS, 0, 1, samplers);
 
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
 
-	mImmediateContext->IASetVertexBuffers(0, 1, &mScreenQuadVB, &stride, &offset);
-	mImmediateContext->IASetIndexBuffer(mScreenQuadIB, DXGI_FORMAT_R16_UINT, 0);
-	mImmediateContext->DrawIndexed(6, 0, 0);
-
-	ID3D11ShaderResourceView* nullSRVs[2] = { nullptr, nullptr };
-	mImmediateContext->PSSetShaderResources(0, 1, nullSRVs);
+	commands.SetVertexBuffer(0, mScreenQuadVB, stride, offset);
+	commands.SetIndexBuffer(mScreenQuadIB, DXGI_FORMAT_R16_UINT, 0);
+	commands.DrawIndexed(6, 0, 0);
 }
 
-void RenderPassSSAO::BlurSSAOMap(int numBlurs)
+void RenderPassSSAO::AccumulateSSAOMap(CommandBuffer& commands)
 {
-	for (int i = 0; i < numBlurs; ++i)
+	ID3D11RenderTargetView* renderTargets[] = { mTextures->GetRTV(mAmbientMaps[0]), mTextures->GetRTV(mNormalDepthHistory) };
+	commands.SetRenderTargets(2, renderTargets, 0);
+
+	// Set Viewport
+	commands.SetViewport(mAOViewport);
+
+	float tanHalfFovY = tanf(0.5f * mCamera->GetFovY());
+
+	ConstBufferSSAOTemporal* cbTemporal = commands.UpdateConstants<ConstBufferSSAOTemporal>(mConstBufferTemporal);
+	cbTemporal->currentToPreviousView = DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&mTemporal.GetCurrentToPreviousView()));
+	cbTemporal->previousViewToTex = DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&mTemporal.GetPreviousViewToTex()));
+	cbTemporal->tanHalfFov = DirectX::XMFLOAT2(mCamera->GetAspect() * tanHalfFovY, tanHalfFovY);
+	cbTemporal->historyWeight = mTemporal.GetHistoryWeight();
+
+	// Set Vertex Layout
+	commands.SetInputLayout(mVertexLayoutSSAO);
+	commands.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	commands.SetVertexShader(mBlurVS);
+	commands.SetPixelShader(mTemporalPS);
+
+	commands.SetConstantBuffers(STAGE_PS, 0, 1, &mConstBufferTemporal);
+
+	ID3D11ShaderResourceView* inputSRVs[] =
 	{
-		// Horizontal Blur
-		ID3D11RenderTargetView* renderTargets[] = { mSsaoRTV1 };
-		mImmediateContext->OMSetRenderTargets(1, renderTargets, 0);
+		mTextures->GetSRV(mAONormalDepthMap),
+		mTextures->GetSRV(mFrameAmbientMap),
+		mTextures->GetSRV(mPreviousAmbientMap),
+		mTextures->GetSRV(mPreviousNormalDepthMap)
+	};
+	commands.SetShaderResources(STAGE_PS, 0, 4, inputSRVs);
 
-		// Clear the render target and depth/stencil views
-		mImmediateContext->ClearRenderTargetView(mSsaoRTV1, reinterpret_cast<const float*>(&Colors::Black));
+	ID3D11SamplerState* samplers[] = { RenderStates::BlurSS };
+	commands.SetSamplers(STAGE_PS, 0, 1, samplers);
 
-		// Set Viewport
-		mImmediateContext->RSSetViewports(1, &mViewport);
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+
+	commands.SetVertexBuffer(0, mScreenQuadVB, stride, offset);
+	commands.SetIndexBuffer(mScreenQuadIB, DXGI_FORMAT_R16_UINT, 0);
+	commands.DrawIndexed(6, 0, 0);
 
-		mImmediateContext->Map(mConstBufferBlurParams, 0, D3D11_MAP_WRITE_DISCARD, 0, &cbBlurParamsResource);
-		cbBlurParams = (ConstBufferBlurParams*)cbBlurParamsResource.pData;
-		cbBlurParams->texelWidth = 1.0f / mViewport.Width;
-		cbBlurParams->texelHeight = 0.0f;
-		mImmediateContext->Unmap(mConstBufferBlurParams, 0);
+	// The graph never sees the previous history written, so it does not unbind it. It is
+	// rendered to next frame.
+	commands.ClearShaderResources(STAGE_PS, 2, 2);
+}
 
-		// Set Vertex Layout
-		mImmediateContext->IASetInputLayout(mVertexLayoutSSAO);
-		mImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+void RenderPassSSAO::BlurSSAOMap(CommandBuffer& commands, int step)
+{
+	// Even steps blur horizontally, odd steps vertically
+	bool isHorizontal = (step % 2) == 0;
 
-		mImmediateContext->VSSetShader(mBlurVS, NULL, 0);
-		mImmediateContext->PSSetShader(mBlurPS, NULL, 0);
+	ID3D11RenderTargetView* blurredRTV = mTextures->GetRTV(mAmbientMaps[step + 1]);
 
-		mImmediateContext->PSSetConstantBuffers(0, 1, &mConstBufferBlurParams);
+	ID3D11RenderTargetView* renderTargets[] = { blurredRTV };
+	commands.SetRenderTargets(1, renderTargets, 0);
 
-		mImmediateContext->PSSetShaderResources(0, 1, &mNormalDepthSRV);
-		mImmediateContext->PSSetShaderResources(1, 1, &mSsaoSRV0);
+	// Clear the render target and depth/stencil views
+	commands.ClearRenderTarget(blurredRTV, reinterpret_cast<const float*>(&Colors::Black));
 
-		ID3D11SamplerState* samplers[] = { RenderStates::BlurSS };
-		mImmediateContext->PSSetSamplers(0, 1, samplers);
+	// Set Viewport
+	commands.SetViewport(mAOViewport);
 
-		UINT stride = sizeof(Vertex);
-		UINT offset = 0;
+	ConstBufferBlurParams* cbBlurParams = commands.UpdateConstants<ConstBufferBlurParams>(mConstBufferBlurParams);
+	cbBlurParams->texelWidth = isHorizontal ? 1.0f / mAOViewport.Width : 0.0f;
+	cbBlurParams->texelHeight = isHorizontal ? 0.0f : 1.0f / mAOViewport.Height;
 
-		mImmediateContext->IASetVertexBuffers(0, 1, &mScreenQuadVB, &stride, &offset);
-		mImmediateContext->IASetIndexBuffer(mScreenQuadIB, DXGI_FORMAT_R16_UINT, 0);
-		mImmediateContext->DrawIndexed(6, 0, 0);
+	// Set Vertex Layout
+	commands.SetInputLayout(mVertexLayoutSSAO);
+	commands.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-		ID3D11ShaderResourceView* nullSRVs[2] = { nullptr, nullptr };
-		mImmediateContext->PSSetShaderResources(0, 2, nullSRVs);
+	commands.SetVertexShader(mBlurVS);
+	commands.SetPixelShader(mBlurPS);
 
+	commands.SetConstantBuffers(STAGE_PS, 0, 1, &mConstBufferBlurParams);
 
+	ID3D11ShaderResourceView* inputSRVs[] = { mTextures->GetSRV(mAONormalDepthMap), mTextures->GetSRV(mAmbientMaps[step]) };
+	commands.SetShaderResources(STAGE_PS, 0, 2, inputSRVs);
 
-		// Vertical Blur
-		renderTargets[0] = mSsaoRTV0;
-		mImmediateContext->OMSetRenderTargets(1, renderTargets, 0);
+	ID3D11SamplerState* samplers[] = { RenderStates::BlurSS };
+	commands.SetSamplers(STAGE_PS, 0, 1, samplers);
 
-		// Clear the render target and depth/stencil views
-		mImmediateContext->ClearRenderTargetView(mSsaoRTV0, reinterpret_cast<const float*>(&Colors::Black));
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
 
-		// Set Viewport
-		mImmediateContext->RSSetViewports(1, &mViewport);
+	commands.SetVertexBuffer(0, mScreenQuadVB, stride, offset);
+	commands.SetIndexBuffer(mScreenQuadIB, DXGI_FORMAT_R16_UINT, 0);
+	commands.DrawIndexed(6, 0, 0);
+}
 
-		mImmediateContext->Map(mConstBufferBlurParams, 0, D3D11_MAP_WRITE_DISCARD, 0, &cbBlurParamsResource);
-		cbBlurParams = (ConstBufferBlurParams*)cbBlurParamsResource.pData;
-		cbBlurParams->texelWidth = 0.0f;
-		cbBlurParams->texelHeight = 1.0f / mViewport.Height;
-		mImmediateContext->Unmap(mConstBufferBlurParams, 0);
+void RenderPassSSAO::BlurSSAOMapCompute(CommandBuffer& commands, bool isHorizontal)
+{
+	// The horizontal pass reads mAmbientMaps[0] and writes [1]; the vertical pass reads
+	// [1] and writes [2]
+	int step = isHorizontal ? 0 : 1;
 
-		// Set Vertex Layout
-		mImmediateContext->IASetInputLayout(mVertexLayoutSSAO);
-		mImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	ConstBufferSSAOBlur* cbBlurCS = commands.UpdateConstants<ConstBufferSSAOBlur>(mConstBufferBlurCS);
+	float* weights = reinterpret_cast<float*>(cbBlurCS->weights);
+	for (int i = 0; i < static_cast<int>(sizeof(cbBlurCS->weights) / sizeof(float)); ++i)
+	{
+		weights[i] = i < SSAOBlur::WeightCount ? mBlurWeights[i] : 0.0f;
+	}
+	cbBlurCS->radius = mBlurRadius;
 
-		mImmediateContext->VSSetShader(mBlurVS, NULL, 0);
-		mImmediateContext->PSSetShader(mBlurPS, NULL, 0);
+	commands.SetComputeShader(isHorizontal ? mBlurHorizontalCS : mBlurVerticalCS);
 
-		mImmediateContext->PSSetConstantBuffers(0, 1, &mConstBufferBlurParams);
+	commands.SetConstantBuffers(STAGE_CS, 0, 1, &mConstBufferBlurCS);
 
-		mImmediateContext->PSSetShaderResources(0, 1, &mNormalDepthSRV);
-		mImmediateContext->PSSetShaderResources(1, 1, &mSsaoSRV1);
+	ID3D11ShaderResourceView* inputSRVs[] = { mTextures->GetSRV(mAONormalDepthMap), mTextures->GetSRV(mAmbientMaps[step]) };
+	commands.SetShaderResources(STAGE_CS, 0, 2, inputSRVs);
 
-		mImmediateContext->PSSetSamplers(0, 1, samplers);
+	ID3D11UnorderedAccessView* outputUAV = mTextures->GetUAV(mAmbientMaps[step + 1]);
+	commands.SetUnorderedAccessViews(0, 1, &outputUAV);
 
-		mImmediateContext->IASetVertexBuffers(0, 1, &mScreenQuadVB, &stride, &offset);
-		mImmediateContext->IASetIndexBuffer(mScreenQuadIB, DXGI_FORMAT_R16_UINT, 0);
-		mImmediateContext->DrawIndexed(6, 0, 0);
+	// One thread group per 256 texel run of a row or column, as in SSAOBlurCS
+	UINT width = static_cast<UINT>(mAOViewport.Width);
+	UINT height = static_cast<UINT>(mAOViewport.Height);
+	const UINT groupSize = 256;
 
-		mImmediateContext->PSSetShaderResources(0, 2, nullSRVs);
+	if (isHorizontal)
+	{
+		commands.Dispatch((width + groupSize - 1) / groupSize, height, 1);
+	}
+	else
+	{
+		commands.Dispatch(width, (height + groupSize - 1) / groupSize, 1);
 	}
 }
 
-ID3D11ShaderResourceView* RenderPassSSAO::GetSSAOMap()
+void RenderPassSSAO::DownsampleNormalDepthMap(CommandBuffer& commands)
+{
+	ID3D11RenderTargetView* reducedRTV = mTextures->GetRTV(mReducedNormalDepthMap);
+
+	ID3D11RenderTargetView* renderTargets[] = { reducedRTV };
+	commands.SetRenderTargets(1, renderTargets, 0);
+
+	// Set Viewport
+	commands.SetViewport(mAOViewport);
+
+	ConstBufferSSAOResample* cbResample = commands.UpdateConstants<ConstBufferSSAOResample>(mConstBufferResample);
+	cbResample->factor = mResolution;
+	cbResample->mode = mDownsampleMode;
+	cbResample->depthParams = NormalDepthEncoding::GetDepthParams(mCamera->GetNearZ(), mCamera->GetFarZ());
+
+	// Set Vertex Layout
+	commands.SetInputLayout(mVertexLayoutSSAO);
+	commands.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	commands.SetVertexShader(mBlurVS);
+	commands.SetPixelShader(isUsingCompactNormalDepth ? mCompactDownsamplePS : mDownsamplePS);
+
+	commands.SetConstantBuffers(STAGE_PS, 0, 1, &mConstBufferResample);
+
+	ID3D11ShaderResourceView* inputSRVs[] = { mTextures->GetSRV(mNormalDepthMap), mTextures->GetSRV(mNormalDepthZ) };
+	commands.SetShaderResources(STAGE_PS, 0, isUsingCompactNormalDepth ? 2 : 1, inputSRVs);
+
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+
+	commands.SetVertexBuffer(0, mScreenQuadVB, stride, offset);
+	commands.SetIndexBuffer(mScreenQuadIB, DXGI_FORMAT_R16_UINT, 0);
+	commands.DrawIndexed(6, 0, 0);
+}
+
+void RenderPassSSAO::UpsampleSSAOMap(CommandBuffer& commands)
 {
-	return mSsaoSRV1;
-}
\ No newline at end of file
+	ID3D11RenderTargetView* upsampledRTV = mTextures->GetRTV(mUpsampledAmbientMap);
+
+	ID3D11RenderTargetView* renderTargets[] = { upsampledRTV };
+	commands.SetRenderTargets(1, renderTargets, 0);
+
+	// Set Viewport
+	commands.SetViewport(mViewport);
+
+	ConstBufferSSAOResample* cbResample = commands.UpdateConstants<ConstBufferSSAOResample>(mConstBufferResample);
+	cbResample->factor = mResolution;
+	cbResample->mode = mDownsampleMode;
+	cbResample->depthParams = NormalDepthEncoding::GetDepthParams(mCamera->GetNearZ(), mCamera->GetFarZ());
+
+	// Set Vertex Layout
+	commands.SetInputLayout(mVertexLayoutSSAO);
+	commands.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	commands.SetVertexShader(mBlurVS);
+	commands.SetPixelShader(isUsingCompactNormalDepth ? mCompactUpsamplePS : mUpsamplePS);
+
+	commands.SetConstantBuffers(STAGE_PS, 0, 1, &mConstBufferResample);
+
+	ID3D11ShaderResourceView* inputSRVs[] =
+	{
+		mTextures->GetSRV(mNormalDepthMap),
+		mTextures->GetSRV(mReducedNormalDepthMap),
+		mTextures->GetSRV(mBlurredAmbientMap),
+		mTextures->GetSRV(mNormalDepthZ)
+	};
+	commands.SetShaderResources(STAGE_PS, 0, isUsingCompactNormalDepth ? 4 : 3, inputSRVs);
+
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+
+	commands.SetVertexBuffer(0, mScreenQuadVB, stride, offset);
+	commands.SetIndexBuffer(mScreenQuadIB, DXGI_FORMAT_R16_UINT, 0);
+	commands.DrawIndexed(6, 0, 0);
+}
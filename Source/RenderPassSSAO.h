@@ -18,6 +18,13 @@
 #include "GFirstPersonCamera.h"
 #include "GObject.h"
 #include "GObjectStore.h"
+#include "RenderGraphTextures.h"
+#include "RenderQueue.h"
+#include "NormalDepthEncoding.h"
+#include "SSAOBlur.h"
+#include "SSAOKernel.h"
+#include "SSAOResample.h"
+#include "SSAOTemporal.h"
 
 class RenderPassSSAO : public RenderPass
 {
@@ -27,50 +34,88 @@ public:
 
 	void Init() override;
 	void Update(float dt) override;
-	void Draw() override;
+	void Setup(RenderGraph& graph, RenderGraphTextures& textures) override;
+
+	// AO is computed at 1/factor of the screen size in each direction and upsampled to
+	// full resolution. Takes effect the next time the graph is set up.
+	void SetResolution(UINT factor);
+	inline UINT GetResolution() const { return mResolution; }
+
+	// Temporal mode takes a few rotated kernel samples per frame and accumulates them
+	// with the reprojected AO of earlier frames. Takes effect the next time the graph is
+	// set up.
+	void SetTemporal(bool temporal);
+	inline bool IsTemporal() const { return isTemporal; }
+
+	// Compute blur replaces the four pixel shader blur iterations with one dispatch per
+	// direction, over radius texels either side. Takes effect the next time the graph is
+	// set up.
+	void SetComputeBlur(bool computeBlur);
+	void SetBlurRadius(int radius);
+	inline bool IsComputeBlur() const { return isComputeBlur; }
+	inline int GetBlurRadius() const { return mBlurRadius; }
+
+	// Compact mode writes octahedral view normals to a two channel target and reads view
+	// depth back from the pass's depth buffer. Only the resample passes read the full
+	// resolution map, so it applies while AO runs at reduced resolution. Takes effect the
+	// next time the graph is set up.
+	void SetCompactNormalDepth(bool compact);
+	inline bool IsCompactNormalDepth() const { return isCompactNormalDepth; }
+
+	// Number of kernel samples. Takes effect from the next frame.
+	void SetQuality(SSAOQuality quality);
+	inline SSAOQuality GetQuality() const { return mQuality; }
 
-	void SetupNormalDepth();
-	void SetupSSAO();
 	void BuildFrustumCorners();
 	void BuildOffsetVectors();
 	void BuildFullScreenQuad();
 	void BuildRandomVectorTexture();
+	void BuildHistoryTargets(UINT width, UINT height);
 
-	void RenderNormalDepthMap();
-	void RenderSSAOMap();
-	void BlurSSAOMap(int numBlurs);
+	void RenderNormalDepthMap(CommandBuffer& commands);
+	void DownsampleNormalDepthMap(CommandBuffer& commands);
+	void RenderSSAOMap(CommandBuffer& commands);
+	void AccumulateSSAOMap(CommandBuffer& commands);
+	void BlurSSAOMap(CommandBuffer& commands, int step);
+	void BlurSSAOMapCompute(CommandBuffer& commands, bool isHorizontal);
+	void UpsampleSSAOMap(CommandBuffer& commands);
 
-	ID3D11ShaderResourceView* GetSSAOMap();
+private:
+	void CreateHistoryTarget(UINT width, UINT height, DXGI_FORMAT format, ID3D11ShaderResourceView** srv, ID3D11RenderTargetView** rtv);
+	void SelectHistory();
+
+	// Each blur iteration is a horizontal and a vertical step
+	static const int BlurCount = 4;
 
 private:
 	ID3D11Device* mDevice;
-	ID3D11DeviceContext* mImmediateContext;
 	float mWidth;
 	float mHeight;
 	GFirstPersonCamera* mCamera;
 
 	GObjectStore* mObjectStore;
 
-	ID3D11DepthStencilView* mDepthStencilView;
+	D3D11_VIEWPORT mViewport;
 
-	ID3D11Texture2D* mDepthStencilBuffer;
+	// AO and its blur run at the reduced resolution
+	UINT mResolution;
+	SSAODownsampleMode mDownsampleMode;
+	D3D11_VIEWPORT mAOViewport;
 
-	D3D11_VIEWPORT mViewport;
+	// Compact normal/depth as requested, and whether the current graph uses it
+	bool isCompactNormalDepth;
+	bool isUsingCompactNormalDepth;
 
 	ID3D11Buffer* mConstBufferPerObjectND;
 	ID3D11Buffer* mConstBufferPerFrameSSAO;
 	ID3D11Buffer* mConstBufferBlurParams;
-
-	D3D11_MAPPED_SUBRESOURCE cbPerObjectNDResource;
-	D3D11_MAPPED_SUBRESOURCE cbPerFrameSSAOResource;
-	D3D11_MAPPED_SUBRESOURCE cbBlurParamsResource;
-
-	ConstBufferPerObjectNormalDepth* cbPerObjectND;
-	ConstBufferPerFrameSSAO* cbPerFrameSSAO;
-	ConstBufferBlurParams* cbBlurParams;
+	ID3D11Buffer* mConstBufferResample;
+	ID3D11Buffer* mConstBufferTemporal;
+	ID3D11Buffer* mConstBufferBlurCS;
 
 	ID3D11VertexShader* mNormalDepthVS;
 	ID3D11PixelShader* mNormalDepthPS;
+	ID3D11PixelShader* mCompactNormalDepthPS;
 	ID3DBlob* mVSByteCodeND;
 
 	ID3D11VertexShader* mSsaoVS;
@@ -81,21 +126,69 @@ private:
 	ID3D11PixelShader* mBlurPS;
 	ID3DBlob* mVSByteCodeBlur;
 
-	ID3D11InputLayout* mVertexLayoutNormalDepth;
-	ID3D11InputLayout* mVertexLayoutSSAO;
+	// Share the blur vertex shader
+	ID3D11PixelShader* mDownsamplePS;
+	ID3D11PixelShader* mUpsamplePS;
+	ID3D11PixelShader* mCompactDownsamplePS;
+	ID3D11PixelShader* mCompactUpsamplePS;
+	ID3D11PixelShader* mTemporalPS;
 
-	// SSAO
-	ID3D11RenderTargetView* mNormalDepthRTV;
-	ID3D11ShaderResourceView* mNormalDepthSRV;
+	bool isComputeBlur;
+	int mBlurRadius;
+	float mBlurWeights[SSAOBlur::WeightCount];
+	ID3D11ComputeShader* mBlurHorizontalCS;
+	ID3D11ComputeShader* mBlurVerticalCS;
 
-	ID3D11RenderTargetView* mSsaoRTV0;
-	ID3D11ShaderResourceView* mSsaoSRV0;
+	ID3D11InputLayout* mVertexLayoutNormalDepth;
+	ID3D11InputLayout* mVertexLayoutSSAO;
 
-	ID3D11RenderTargetView* mSsaoRTV1;
-	ID3D11ShaderResourceView* mSsaoSRV1;
+	// Opaque objects keyed by mesh, so that objects sharing a mesh are drawn as one
+	// instanced draw
+	RenderQueue mObjectQueue;
+	std::vector<RenderQueueRun> mObjectRuns;
+
+	// SSAO targets are transient graph textures. Every blur step writes a new one,
+	// so the graph can fold them onto two physical textures. At reduced resolution
+	// the AO and blur passes read the reduced normal/depth map instead of the full one.
+	// mBlurredAmbientMap is the last blur step's output, whichever blur ran.
+	RenderGraphTextures* mTextures;
+	RGHandle mNormalDepthMap;
+	RGHandle mNormalDepthZ;
+	RGHandle mReducedNormalDepthMap;
+	RGHandle mAONormalDepthMap;
+	RGHandle mFrameAmbientMap;
+	RGHandle mAmbientMaps[2 * BlurCount + 1];
+	RGHandle mBlurredAmbientMap;
+	RGHandle mUpsampledAmbientMap;
+
+	// Temporal mode keeps the accumulated AO, and the normals and depths it belongs to,
+	// in two sets of targets that swap roles every frame. They outlive the frame, so the
+	// graph imports them through the views below.
+	SSAOTemporal mTemporal;
+	bool isTemporal;
+
+	UINT mHistoryIndex;
+	UINT mHistoryWidth;
+	UINT mHistoryHeight;
+	ID3D11ShaderResourceView* mAmbientHistorySRV[2];
+	ID3D11RenderTargetView* mAmbientHistoryRTV[2];
+	ID3D11ShaderResourceView* mNormalDepthHistorySRV[2];
+	ID3D11RenderTargetView* mNormalDepthHistoryRTV[2];
+
+	ID3D11ShaderResourceView* mPreviousAmbientSRV;
+	ID3D11ShaderResourceView* mPreviousNormalDepthSRV;
+	ID3D11ShaderResourceView* mCurrentAmbientSRV;
+	ID3D11RenderTargetView* mCurrentAmbientRTV;
+	ID3D11RenderTargetView* mCurrentNormalDepthRTV;
+
+	RGHandle mPreviousAmbientMap;
+	RGHandle mPreviousNormalDepthMap;
+	RGHandle mNormalDepthHistory;
 
 	DirectX::XMFLOAT4 mFrustumFarCorners[4];
-	DirectX::XMFLOAT4 mOffsets[14];
+	SSAOQuality mQuality;
+	UINT mSampleCount;
+	DirectX::XMFLOAT4 mOffsets[SSAOKernel::MaxSampleCount];
 
 	ID3D11ShaderResourceView* mRandomVectorSRV;
 
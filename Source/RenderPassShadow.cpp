@@ -3,7 +3,6 @@
 RenderPassShadow::RenderPassShadow(ID3D11Device* device, GFirstPersonCamera* camera, DirectionalLight light, GObjectStore* objectStore)
 {
 	mDevice = device;
-	mDevice->GetImmediateContext(&mImmediateContext);
 
 	mCamera = camera;
 	mLight = light;
@@ -17,55 +16,36 @@ RenderPassShadow::~RenderPassShadow()
 
 void RenderPassShadow::Init()
 {
+	UINT shadowMapSize = mCascades.GetShadowMapSize();
+
+	// Leave room for the camera to move before a cached cascade stops covering its slice
+	mCascades.SetGuardBand(0.1f);
+
 	// Setup Viewport
 	mViewport.TopLeftX = 0.0f;
 	mViewport.TopLeftY = 0.0f;
-	mViewport.Width = static_cast<float>(2048);
-	mViewport.Height = static_cast<float>(2048);
+	mViewport.Width = static_cast<float>(shadowMapSize);
+	mViewport.Height = static_cast<float>(shadowMapSize);
 	mViewport.MinDepth = 0.0f;
 	mViewport.MaxDepth = 1.0f;
 
-	// Create depth map texture
-	D3D11_TEXTURE2D_DESC texDesc;
-	texDesc.Width = 2048;
-	texDesc.Height = 2048;
-	texDesc.MipLevels = 1;
-	texDesc.ArraySize = 1;
-	texDesc.Format = DXGI_FORMAT_R24G8_TYPELESS;
-	texDesc.SampleDesc.Count = 1;
-	texDesc.SampleDesc.Quality = 0;
-	texDesc.Usage = D3D11_USAGE_DEFAULT;
-	texDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
-	texDesc.CPUAccessFlags = 0;
-	texDesc.MiscFlags = 0;
-
-	ID3D11Texture2D* depthMap = 0;
-	HR(mDevice->CreateTexture2D(&texDesc, 0, &depthMap));
+	CreateDepthMapArray(&mDepthMap, mDepthMapDSV, &mDepthMapSRV);
+	CreateDepthMapArray(&mStaticDepthMap, mStaticDepthMapDSV, &mStaticDepthMapSRV);
 
-	// Create Depth/Stencil View
-	D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
-	dsvDesc.Flags = 0;
-	dsvDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-	dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	dsvDesc.Texture2D.MipSlice = 0;
-	HR(mDevice->CreateDepthStencilView(depthMap, &dsvDesc, &mDepthMapDSV));
-
-	// Create Shader Resource View
-	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
-	srvDesc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MipLevels = texDesc.MipLevels;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	HR(mDevice->CreateShaderResourceView(depthMap, &srvDesc, &mDepthMapSRV));
-
-	ReleaseCOM(depthMap);
+	mPendingRefreshMask = 0;
+	mDrawnCascadeCount = 0;
 
 	CreateVertexShader(mDevice, &mShadowVertexShader, &mVSByteCodeShadow, L"Assets/Shaders/ShadowVS.hlsl", "VS");
 
-	// Create the vertex input layout.
+	// Create the vertex input layout. Casters are drawn instanced, with their world
+	// transforms in slot 1.
 	D3D11_INPUT_ELEMENT_DESC vertexDescShadow[] =
 	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D11_INPUT_PER_VERTEX_DATA, 0 }
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
 	};
 
 	UINT numElements = sizeof(vertexDescShadow) / sizeof(D3D11_INPUT_ELEMENT_DESC);
@@ -74,11 +54,61 @@ void RenderPassShadow::Init()
 	HR(mDevice->CreateInputLayout(vertexDescShadow, numElements, mVSByteCodeShadow->GetBufferPointer(), mVSByteCodeShadow->GetBufferSize(), &mVertexLayoutShadow));
 
 	CreateConstantBuffer(mDevice, &mConstBufferPerObjectShadow, sizeof(ConstBufferPerObjectShadow));
+	CreateConstantBuffer(mDevice, &mConstBufferCascades, sizeof(ConstBufferShadowCascades));
 
 	// Shadow Maps
 	mLightRotationAngle = 0.0f;
 
 	mOriginalLightDir = mLight.Direction;
+
+	BuildShadowTransform();
+	SelectDepthMap();
+}
+
+void RenderPassShadow::CreateDepthMapArray(ID3D11Texture2D** texture, ID3D11DepthStencilView** dsvs, ID3D11ShaderResourceView** srv)
+{
+	UINT cascadeCount = mCascades.GetCascadeCount();
+	UINT shadowMapSize = mCascades.GetShadowMapSize();
+
+	// Create depth map texture array, one slice per cascade
+	D3D11_TEXTURE2D_DESC texDesc;
+	texDesc.Width = shadowMapSize;
+	texDesc.Height = shadowMapSize;
+	texDesc.MipLevels = 1;
+	texDesc.ArraySize = cascadeCount;
+	texDesc.Format = DXGI_FORMAT_R24G8_TYPELESS;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.SampleDesc.Quality = 0;
+	texDesc.Usage = D3D11_USAGE_DEFAULT;
+	texDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+	texDesc.CPUAccessFlags = 0;
+	texDesc.MiscFlags = 0;
+
+	HR(mDevice->CreateTexture2D(&texDesc, 0, texture));
+
+	// Create a Depth/Stencil View for each cascade
+	D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
+	dsvDesc.Flags = 0;
+	dsvDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+	dsvDesc.Texture2DArray.MipSlice = 0;
+	dsvDesc.Texture2DArray.ArraySize = 1;
+
+	for (UINT i = 0; i < cascadeCount; ++i)
+	{
+		dsvDesc.Texture2DArray.FirstArraySlice = i;
+		HR(mDevice->CreateDepthStencilView(*texture, &dsvDesc, &dsvs[i]));
+	}
+
+	// Create Shader Resource View over all cascades
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	srvDesc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MipLevels = texDesc.MipLevels;
+	srvDesc.Texture2DArray.MostDetailedMip = 0;
+	srvDesc.Texture2DArray.FirstArraySlice = 0;
+	srvDesc.Texture2DArray.ArraySize = cascadeCount;
+	HR(mDevice->CreateShaderResourceView(*texture, &srvDesc, srv));
 }
 
 void RenderPassShadow::Update(float dt)
@@ -93,120 +123,199 @@ void RenderPassShadow::Update(float dt)
 	DirectX::XMStoreFloat3(&mLight.Direction, lightDir);
 
 	BuildShadowTransform();
+	SelectDepthMap();
 }
 
-void RenderPassShadow::Draw()
+void RenderPassShadow::Setup(RenderGraph& graph, RenderGraphTextures& textures)
 {
-	RenderShadowMap();
+	// The depth maps outlive the frame to keep the static cache, so they are imported.
+	// Readers get whichever map is active this frame.
+	RGHandle shadowMap = graph.ImportTexture("ShadowMap");
+	textures.Import(shadowMap, &mActiveDepthMapSRV, nullptr, nullptr);
+
+	UINT pass = graph.AddPass("Shadow", [this](CommandBuffer& commands) { Draw(commands); });
+	shadowMap = graph.Write(pass, shadowMap, RG_BIND_DEPTH_STENCIL);
+
+	graph.Publish("ShadowMap", shadowMap);
 }
 
-void RenderPassShadow::RenderShadowMap()
+void RenderPassShadow::Draw(CommandBuffer& commands)
 {
-	// Set Null Render Target and Shadow Map DSV
-	ID3D11RenderTargetView* renderTargets[] = { nullptr };
-	ID3D11DepthStencilView* shadowMapDSV = mDepthMapDSV;
-	mImmediateContext->OMSetRenderTargets(1, renderTargets, shadowMapDSV);
+	mDrawnCascadeCount = mShadowCache.GetCascadeCount();
+	for (int i = 0; i < mDrawnCascadeCount; ++i)
+	{
+		mDrawnTransforms[i] = mShadowCache.GetCascade(i).ShadowTransform;
+	}
+
+	UploadCascadeConstants(commands);
 
-	// Clear Shadow Map DSV
-	mImmediateContext->ClearDepthStencilView(shadowMapDSV, D3D11_CLEAR_DEPTH, 1.0f, 0);
+	RenderShadowMap(commands);
+}
 
+void RenderPassShadow::RenderShadowMap(CommandBuffer& commands)
+{
 	// Set Viewport
 	D3D11_VIEWPORT shadowMapViewport = mViewport;
-	mImmediateContext->RSSetViewports(1, &shadowMapViewport);
+	commands.SetViewport(shadowMapViewport);
 
 	// Set Vertex Layout for shadow map
-	mImmediateContext->IASetInputLayout(mVertexLayoutShadow);
-	mImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	commands.SetInputLayout(mVertexLayoutShadow);
+	commands.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	// Set Render States
-	mImmediateContext->RSSetState(RenderStates::ShadowMapRS);
-	mImmediateContext->OMSetDepthStencilState(RenderStates::DefaultDSS, 0);
+	commands.SetRasterizerState(RenderStates::ShadowMapRS);
+	commands.SetDepthStencilState(RenderStates::DefaultDSS, 0);
 
 	// Set shadow map VS and null PS
-	mImmediateContext->VSSetShader(mShadowVertexShader, NULL, 0);
-	mImmediateContext->PSSetShader(NULL, NULL, 0);
+	commands.SetVertexShader(mShadowVertexShader);
+	commands.SetPixelShader(nullptr);
 
 	// Set VS constant buffer 
-	mImmediateContext->VSSetConstantBuffers(0, 1, &mConstBufferPerObjectShadow);
+	commands.SetConstantBuffers(STAGE_VS, 0, 1, &mConstBufferPerObjectShadow);
+
+	// Re-render the static layer of every cascade whose cached depth is stale
+	for (int i = 0; i < mShadowCache.GetCascadeCount(); ++i)
+	{
+		if (mPendingRefreshMask & (1u << i))
+		{
+			RenderCascade(commands, i, mStaticDepthMapDSV[i], true);
+		}
+	}
+	mPendingRefreshMask = 0;
+
+	// Without dynamic casters the cached depth is already complete
+	if (!mIsDynamicLayerActive)
+	{
+		return;
+	}
+
+	// Copy the cached depth and draw only the dynamic casters on top
+	commands.CopyResource(mDepthMap, mStaticDepthMap);
 
-	// Compute ViewProj matrix of the light source
-	DirectX::XMMATRIX view = XMLoadFloat4x4(&mLightView);
-	DirectX::XMMATRIX proj = XMLoadFloat4x4(&mLightProj);
+	for (int i = 0; i < mShadowCache.GetCascadeCount(); ++i)
+	{
+		RenderCascade(commands, i, mDepthMapDSV[i], false);
+	}
+}
+
+void RenderPassShadow::RenderCascade(CommandBuffer& commands, int cascade, ID3D11DepthStencilView* dsv, bool staticLayer)
+{
+	// Set Null Render Target and this cascade's DSV
+	ID3D11RenderTargetView* renderTargets[] = { nullptr };
+	commands.SetRenderTargets(1, renderTargets, dsv);
+
+	// The static layer starts from scratch, the dynamic layer draws over the cached copy
+	if (staticLayer)
+	{
+		commands.ClearDepthStencil(dsv, D3D11_CLEAR_DEPTH, 1.0f, 0);
+	}
+
+	// Compute ViewProj matrix of the cached cascade
+	const ShadowCascade& c = mShadowCache.GetCascade(cascade);
+	DirectX::XMMATRIX view = XMLoadFloat4x4(&c.View);
+	DirectX::XMMATRIX proj = XMLoadFloat4x4(&c.Proj);
 	DirectX::XMMATRIX viewProj = XMMatrixMultiply(view, proj);
 
-	DirectX::XMMATRIX world;
-	DirectX::XMMATRIX worldViewProj;
+	// The world transform of each caster comes from the instance data
+	ConstBufferPerObjectShadow* cbPerObjectShadow = commands.UpdateConstants<ConstBufferPerObjectShadow>(mConstBufferPerObjectShadow);
+	cbPerObjectShadow->worldViewProj = DirectX::XMMatrixTranspose(viewProj);
 
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
 
-	std::vector<GObject*> objects = mObjectStore->GetObjects();
+	GObjectSpan casters = staticLayer ? mObjectStore->GetVisibleStaticCasters() : mObjectStore->GetVisibleDynamicCasters();
+
+	mCasterQueue.Reset();
+	mCasterDraws.clear();
 
-	for (auto it = objects.begin(); it != objects.end(); ++it)
+	for (auto it = casters.begin(); it != casters.end(); ++it)
 	{
 		GObject* obj = *it;
 
-		world = DirectX::XMLoadFloat4x4(&obj->GetWorldTransform());
-		worldViewProj = world*viewProj;
+		// Skip casters that cannot throw a shadow into this cascade
+		if (!c.CasterVolume.Intersects(obj->GetWorldBoundingBox()))
+		{
+			continue;
+		}
 
-		mImmediateContext->Map(mConstBufferPerObjectShadow, 0, D3D11_MAP_WRITE_DISCARD, 0, &cbPerObjectShadowResource);
-		cbPerObjectShadow = (ConstBufferPerObjectShadow*)cbPerObjectShadowResource.pData;
-		cbPerObjectShadow->worldViewProj = DirectX::XMMatrixTranspose(worldViewProj);
-		mImmediateContext->Unmap(mConstBufferPerObjectShadow, 0);
+		mCasterQueue.Add(obj->GetMeshKey(), static_cast<UINT>(mCasterDraws.size()));
+		mCasterDraws.push_back(obj);
+	}
 
-		mImmediateContext->IASetVertexBuffers(0, 1, obj->GetVertexBuffer(), &stride, &offset);
-		mImmediateContext->IASetIndexBuffer(*obj->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
+	mCasterQueue.Sort();
+	mCasterQueue.BuildRuns(~0ull, MaxInstancesPerDraw, mCasterRuns);
 
-		mImmediateContext->DrawIndexed(obj->GetIndexCount(), 0, 0);
+	for (auto run = mCasterRuns.begin(); run != mCasterRuns.end(); ++run)
+	{
+		InstanceTransform* instances = commands.SetVertexData<InstanceTransform>(1, run->Count);
+		for (UINT i = 0; i < run->Count; ++i)
+		{
+			GObject* obj = mCasterDraws[mCasterQueue.GetItem(run->First + i).Payload];
+			instances[i].World = obj->GetWorldTransform();
+			instances[i].WorldInvTranspose = obj->GetNormalTransform();
+		}
+
+		// Every caster in the run has the same mesh; draw it with the first one's buffers
+		GObject* obj = mCasterDraws[mCasterQueue.GetItem(run->First).Payload];
+		commands.SetVertexBuffer(0, *obj->GetVertexBuffer(), stride, offset);
+		commands.SetIndexBuffer(*obj->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
+
+		commands.DrawIndexedInstanced(obj->GetIndexCount(), run->Count, obj->GetStartIndex(), obj->GetBaseVertex(), 0);
 	}
 }
 
-void RenderPassShadow::BuildShadowTransform()
+void RenderPassShadow::SelectDepthMap()
 {
-	// Build Directional Light View Matrix
-	float radius = 18.0f;
-
-	DirectX::XMVECTOR lightDir = DirectX::XMLoadFloat3(&mLight.Direction);
-	DirectX::XMVECTOR lightPos = DirectX::XMVectorScale(lightDir, -2.0f*radius);
-	DirectX::XMVECTOR targetPos = DirectX::XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f);
-	DirectX::XMVECTOR up = DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
-
-	DirectX::XMMATRIX V = DirectX::XMMatrixLookAtLH(lightPos, targetPos, up);
+	mIsDynamicLayerActive = HasDynamicCasters();
+	mActiveDepthMapSRV = mIsDynamicLayerActive ? mDepthMapSRV : mStaticDepthMapSRV;
+}
 
-	// Build Directional Light Ortho Projection Volume Matrix
-	DirectX::XMFLOAT3 center(0.0f, 0.0f, 0.0f);
-	DirectX::XMStoreFloat3(&center, DirectX::XMVector3TransformCoord(targetPos, V));
+bool RenderPassShadow::HasDynamicCasters()
+{
+	return !mObjectStore->GetVisibleDynamicCasters().empty();
+}
 
-	DirectX::XMMATRIX P = DirectX::XMMatrixOrthographicOffCenterLH(
-		center.x - radius, center.x + radius,
-		center.y - radius, center.y + radius,
-		center.z - radius, center.z + radius);
+void RenderPassShadow::BuildShadowTransform()
+{
+	// Refit the cascades to the camera frustum for the current light direction
+	mCascades.Update(*mCamera, mLight.Direction);
 
-	// Build Directional Light Texture Matrix to transform from NDC space to Texture Space
-	DirectX::XMMATRIX T(
-		0.5f, 0.0f, 0.0f, 0.0f,
-		0.0f, -0.5f, 0.0f, 0.0f,
-		0.0f, 0.0f, 1.0f, 0.0f,
-		0.5f, 0.5f, 0.0f, 1.0f);
+	// Let the cache decide which cascades adopt the new fit and need their static layer
+	// re-rendered. Keep pending refreshes until the next Draw consumes them.
+	mPendingRefreshMask |= mShadowCache.Update(mCascades, mObjectStore->GetStaticVersion());
+}
 
-	// Multiply View, Projection, and Texture matrices to get Shadow Transformation Matrix
-	// Transforms vertices from world space to the view space of the light, to the projection
-	// plane, to texture coordinates.
-	DirectX::XMMATRIX S = V*P*T;
+void RenderPassShadow::InvalidateStaticBounds(const DirectX::BoundingBox& worldBox)
+{
+	mShadowCache.InvalidateBounds(worldBox);
+}
 
-	DirectX::XMStoreFloat4x4(&mLightView, V);
-	DirectX::XMStoreFloat4x4(&mLightProj, P);
-	DirectX::XMStoreFloat4x4(&mShadowTransform, S);
+void RenderPassShadow::UploadCascadeConstants(CommandBuffer& commands)
+{
+	// Upload the world to shadow texture space transform of every drawn cascade
+	ConstBufferShadowCascades* cbCascades = commands.UpdateConstants<ConstBufferShadowCascades>(mConstBufferCascades);
+	for (int i = 0; i < mDrawnCascadeCount; ++i)
+	{
+		DirectX::XMMATRIX S = DirectX::XMLoadFloat4x4(&mDrawnTransforms[i]);
+		cbCascades->shadowTransforms[i] = DirectX::XMMatrixTranspose(S);
+	}
+	cbCascades->cascadeCount = mDrawnCascadeCount;
+	cbCascades->shadowTexelSize = 1.0f / static_cast<float>(mCascades.GetShadowMapSize());
 }
 
 ID3D11ShaderResourceView* RenderPassShadow::GetDepthMapSRV()
 {
-	return mDepthMapSRV;
+	return mActiveDepthMapSRV;
+}
+
+ID3D11DepthStencilView* RenderPassShadow::GetDepthMapDSV(int cascade)
+{
+	return mDepthMapDSV[cascade];
 }
 
-ID3D11DepthStencilView* RenderPassShadow::GetDepthMapDSV()
+ID3D11Buffer* RenderPassShadow::GetCascadeConstantBuffer()
 {
-	return mDepthMapDSV;
+	return mConstBufferCascades;
 }
 
 D3D11_VIEWPORT RenderPassShadow::GetViewport()
@@ -214,7 +323,17 @@ D3D11_VIEWPORT RenderPassShadow::GetViewport()
 	return mViewport;
 }
 
-DirectX::XMFLOAT4X4 RenderPassShadow::GetShadowTransform()
+const ShadowCascades& RenderPassShadow::GetCascades()
+{
+	return mCascades;
+}
+
+const ShadowCache& RenderPassShadow::GetShadowCache()
+{
+	return mShadowCache;
+}
+
+DirectX::XMFLOAT3 RenderPassShadow::GetLightDirection()
 {
-	return mShadowTransform;
+	return mLight.Direction;
 }
\ No newline at end of file
@@ -19,6 +19,10 @@
 #include "GFirstPersonCamera.h"
 #include "GObject.h"
 #include "GObjectStore.h"
+#include "ShadowCascades.h"
+#include "ShadowCache.h"
+#include "RenderGraphTextures.h"
+#include "RenderQueue.h"
 
 class RenderPassShadow : public RenderPass
 {
@@ -28,43 +32,84 @@ public:
 
 	void Init() override;
 	void Update(float dt) override;
-	void Draw() override;
+	void Setup(RenderGraph& graph, RenderGraphTextures& textures) override;
+	void Draw(CommandBuffer& commands);
 
-	void RenderShadowMap();
+	void RenderShadowMap(CommandBuffer& commands);
+	void RenderCascade(CommandBuffer& commands, int cascade, ID3D11DepthStencilView* dsv, bool staticLayer);
 	void BuildShadowTransform();
+	// Re-renders only the cascades a moved static caster overlaps. Pass both its old
+	// and new bounds.
+	void InvalidateStaticBounds(const DirectX::BoundingBox& worldBox);
+	// Uploads the transforms of the depth maps as last drawn, so streams submitted ahead
+	// of this frame's shadow pass sample the maps consistently
+	void UploadCascadeConstants(CommandBuffer& commands);
+	void SelectDepthMap();
+	bool HasDynamicCasters();
 
 	ID3D11ShaderResourceView* GetDepthMapSRV();
-	ID3D11DepthStencilView* GetDepthMapDSV();
+	ID3D11DepthStencilView* GetDepthMapDSV(int cascade);
+	ID3D11Buffer* GetCascadeConstantBuffer();
 	D3D11_VIEWPORT GetViewport();
-	DirectX::XMFLOAT4X4 GetShadowTransform();
+	const ShadowCascades& GetCascades();
+	const ShadowCache& GetShadowCache();
+	// Direction of the animated shadow light, as of the last Update
+	DirectX::XMFLOAT3 GetLightDirection();
+
+private:
+	void CreateDepthMapArray(ID3D11Texture2D** texture, ID3D11DepthStencilView** dsvs, ID3D11ShaderResourceView** srv);
 
 private:
 	ID3D11Device* mDevice;
-	ID3D11DeviceContext* mImmediateContext;
 	GFirstPersonCamera* mCamera;
 	DirectionalLight mLight;
 	GObjectStore* mObjectStore;
 
+	// One slice of the depth map array per cascade. The static map caches static
+	// casters; the live map is a copy of it with dynamic casters drawn on top.
+	ID3D11Texture2D* mDepthMap;
 	ID3D11ShaderResourceView* mDepthMapSRV;
-	ID3D11DepthStencilView* mDepthMapDSV;
+	ID3D11DepthStencilView* mDepthMapDSV[ShadowCascades::MaxCascades];
+
+	ID3D11Texture2D* mStaticDepthMap;
+	ID3D11ShaderResourceView* mStaticDepthMapSRV;
+	ID3D11DepthStencilView* mStaticDepthMapDSV[ShadowCascades::MaxCascades];
+
+	// Whichever of the two maps holds this frame's complete shadow depth. Chosen in
+	// Update so passes recorded alongside this one already see the final view.
+	ID3D11ShaderResourceView* mActiveDepthMapSRV;
+	bool mIsDynamicLayerActive;
 
 	D3D11_VIEWPORT mViewport;
 
 	ID3D11Buffer* mConstBufferPerObjectShadow;
-	D3D11_MAPPED_SUBRESOURCE cbPerObjectShadowResource;
-	ConstBufferPerObjectShadow* cbPerObjectShadow;
+
+	ID3D11Buffer* mConstBufferCascades;
+
+	// Transforms the depth maps were last drawn with. They stay valid until the next
+	// Draw, while Update may already have refitted the cache.
+	DirectX::XMFLOAT4X4 mDrawnTransforms[ShadowCascades::MaxCascades];
+	int mDrawnCascadeCount;
 
 	ID3D11VertexShader* mShadowVertexShader;
 	ID3DBlob* mVSByteCodeShadow;
 
 	ID3D11InputLayout* mVertexLayoutShadow;	
+
+	// Casters of the cascade being recorded, keyed by mesh so that casters sharing a
+	// mesh are drawn as one instanced draw
+	RenderQueue mCasterQueue;
+	std::vector<GObject*> mCasterDraws;
+	std::vector<RenderQueueRun> mCasterRuns;
 	
 	float mLightRotationAngle;
 	DirectX::XMFLOAT3 mOriginalLightDir;
 
-	DirectX::XMFLOAT4X4 mLightView;
-	DirectX::XMFLOAT4X4 mLightProj;
-	DirectX::XMFLOAT4X4 mShadowTransform;
+	ShadowCascades mCascades;
+	ShadowCache mShadowCache;
+
+	// Cascades whose static layer must be re-rendered on the next Draw
+	UINT mPendingRefreshMask;
 };
 
 #endif // RENDERPASS_SHADOW_H
\ No newline at end of file
@@ -62,7 +62,8 @@ void RenderStates::InitAll(ID3D11Device* device)
 	ShadowMapRSDesc.DepthBias = 100000;
 	ShadowMapRSDesc.DepthBiasClamp = 0.0f;
 	ShadowMapRSDesc.SlopeScaledDepthBias = 0.0f;
-	ShadowMapRSDesc.DepthClipEnable = true;
+	// Clamp casters in front of the cascade's near plane onto it instead of clipping them
+	ShadowMapRSDesc.DepthClipEnable = false;
 	ShadowMapRSDesc.ScissorEnable = false;
 	ShadowMapRSDesc.MultisampleEnable = false;
 	ShadowMapRSDesc.AntialiasedLineEnable = false;
@@ -0,0 +1,203 @@
+/*  ======================
+	Summary: D3D11 textures handed out by a TexturePool
+	======================  */
+
+#include "RenderTargetPool.h"
+
+RenderTargetPool::RenderTargetPool(ID3D11Device* device)
+{
+	mDevice = device;
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+	for (auto it = mTextures.begin(); it != mTextures.end(); ++it)
+	{
+		ReleaseTexture(*it);
+	}
+}
+
+UINT RenderTargetPool::Acquire(const PoolTextureDesc& desc)
+{
+	UINT entry = mPool.Acquire(desc);
+
+	if (entry >= mTextures.size())
+	{
+		PooledTexture empty = {};
+		mTextures.resize(entry + 1, empty);
+	}
+
+	if (!mTextures[entry].Texture)
+	{
+		CreateTexture(mTextures[entry], desc);
+	}
+
+	return entry;
+}
+
+void RenderTargetPool::Release(UINT entry)
+{
+	mPool.Release(entry);
+}
+
+void RenderTargetPool::EndFrame()
+{
+	mPool.EndFrame();
+	ReleaseEvicted();
+}
+
+void RenderTargetPool::Trim()
+{
+	mPool.Trim();
+	ReleaseEvicted();
+}
+
+void RenderTargetPool::ReleaseEvicted()
+{
+	for (UINT i = 0; i < mTextures.size(); ++i)
+	{
+		if (mTextures[i].Texture && !mPool.IsResident(i))
+		{
+			ReleaseTexture(mTextures[i]);
+		}
+	}
+}
+
+void RenderTargetPool::CreateTexture(PooledTexture& texture, const PoolTextureDesc& desc)
+{
+	UINT arraySize = desc.isCube ? 6 : 1;
+
+	D3D11_TEXTURE2D_DESC texDesc;
+	texDesc.Width = desc.Width;
+	texDesc.Height = desc.Height;
+	texDesc.MipLevels = desc.MipLevels;
+	texDesc.ArraySize = arraySize;
+	texDesc.Format = static_cast<DXGI_FORMAT>(desc.Format);
+	texDesc.SampleDesc.Count = 1;
+	texDesc.SampleDesc.Quality = 0;
+	texDesc.Usage = D3D11_USAGE_DEFAULT;
+	texDesc.BindFlags = 0;
+	texDesc.CPUAccessFlags = 0;
+	texDesc.MiscFlags = 0;
+
+	if (desc.BindFlags & RG_BIND_SHADER_RESOURCE) { texDesc.BindFlags |= D3D11_BIND_SHADER_RESOURCE; }
+	if (desc.BindFlags & RG_BIND_RENDER_TARGET) { texDesc.BindFlags |= D3D11_BIND_RENDER_TARGET; }
+	if (desc.BindFlags & RG_BIND_DEPTH_STENCIL) { texDesc.BindFlags |= D3D11_BIND_DEPTH_STENCIL; }
+	if (desc.BindFlags & RG_BIND_UNORDERED_ACCESS) { texDesc.BindFlags |= D3D11_BIND_UNORDERED_ACCESS; }
+
+	if (desc.isCube) { texDesc.MiscFlags |= D3D11_RESOURCE_MISC_TEXTURECUBE; }
+
+	// A mip chain on a render target is filled by GenerateMips
+	bool isMipped = TexturePool::GetMipCount(desc) > 1;
+	if (isMipped && (desc.BindFlags & RG_BIND_RENDER_TARGET) && (desc.BindFlags & RG_BIND_SHADER_RESOURCE))
+	{
+		texDesc.MiscFlags |= D3D11_RESOURCE_MISC_GENERATE_MIPS;
+	}
+
+	HR(mDevice->CreateTexture2D(&texDesc, 0, &texture.Texture));
+
+	if (desc.BindFlags & RG_BIND_SHADER_RESOURCE)
+	{
+		if (desc.isCube)
+		{
+			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+			srvDesc.Format = texDesc.Format;
+			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+			srvDesc.TextureCube.MostDetailedMip = 0;
+			srvDesc.TextureCube.MipLevels = -1;
+			HR(mDevice->CreateShaderResourceView(texture.Texture, &srvDesc, &texture.SRV));
+		}
+		else if (texDesc.Format == DXGI_FORMAT_R24G8_TYPELESS)
+		{
+			// A depth buffer that is also sampled reads back its depth bits
+			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+			srvDesc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+			srvDesc.Texture2D.MostDetailedMip = 0;
+			srvDesc.Texture2D.MipLevels = texDesc.MipLevels;
+			HR(mDevice->CreateShaderResourceView(texture.Texture, &srvDesc, &texture.SRV));
+		}
+		else
+		{
+			HR(mDevice->CreateShaderResourceView(texture.Texture, nullptr, &texture.SRV));
+		}
+	}
+
+	if (desc.BindFlags & RG_BIND_RENDER_TARGET)
+	{
+		if (desc.isCube)
+		{
+			// One view per face (i.e., each element in the texture array)
+			D3D11_RENDER_TARGET_VIEW_DESC rtvDesc;
+			rtvDesc.Format = texDesc.Format;
+			rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+			rtvDesc.Texture2DArray.ArraySize = 1;
+			rtvDesc.Texture2DArray.MipSlice = 0;
+
+			for (UINT i = 0; i < 6; ++i)
+			{
+				rtvDesc.Texture2DArray.FirstArraySlice = i;
+				HR(mDevice->CreateRenderTargetView(texture.Texture, &rtvDesc, &texture.RTV[i]));
+			}
+		}
+		else
+		{
+			HR(mDevice->CreateRenderTargetView(texture.Texture, nullptr, &texture.RTV[0]));
+		}
+	}
+
+	if (desc.BindFlags & RG_BIND_DEPTH_STENCIL)
+	{
+		if (texDesc.Format == DXGI_FORMAT_R24G8_TYPELESS)
+		{
+			D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
+			dsvDesc.Flags = 0;
+			dsvDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+			dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+			dsvDesc.Texture2D.MipSlice = 0;
+			HR(mDevice->CreateDepthStencilView(texture.Texture, &dsvDesc, &texture.DSV));
+		}
+		else
+		{
+			HR(mDevice->CreateDepthStencilView(texture.Texture, nullptr, &texture.DSV));
+		}
+	}
+
+	if (desc.BindFlags & RG_BIND_UNORDERED_ACCESS)
+	{
+		HR(mDevice->CreateUnorderedAccessView(texture.Texture, nullptr, &texture.UAV));
+	}
+}
+
+void RenderTargetPool::ReleaseTexture(PooledTexture& texture)
+{
+	ReleaseCOM(texture.SRV);
+	ReleaseCOM(texture.DSV);
+	ReleaseCOM(texture.UAV);
+	ReleaseCOM(texture.Texture);
+
+	for (UINT i = 0; i < 6; ++i)
+	{
+		ReleaseCOM(texture.RTV[i]);
+	}
+}
+
+ID3D11ShaderResourceView* RenderTargetPool::GetSRV(UINT entry) const
+{
+	return entry < mTextures.size() ? mTextures[entry].SRV : nullptr;
+}
+
+ID3D11RenderTargetView* RenderTargetPool::GetRTV(UINT entry, UINT face) const
+{
+	return entry < mTextures.size() ? mTextures[entry].RTV[face] : nullptr;
+}
+
+ID3D11DepthStencilView* RenderTargetPool::GetDSV(UINT entry) const
+{
+	return entry < mTextures.size() ? mTextures[entry].DSV : nullptr;
+}
+
+ID3D11UnorderedAccessView* RenderTargetPool::GetUAV(UINT entry) const
+{
+	return entry < mTextures.size() ? mTextures[entry].UAV : nullptr;
+}
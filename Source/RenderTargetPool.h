@@ -0,0 +1,55 @@
+/*  ======================
+	Summary: D3D11 textures handed out by a TexturePool
+	======================  */
+
+#ifndef RENDERTARGET_POOL_H
+#define RENDERTARGET_POOL_H
+
+#include "D3DUtil.h"
+#include "TexturePool.h"
+#include "RenderGraph.h"
+
+// Owns the device textures behind a TexturePool. A texture is created with its views
+// when the pool makes an entry resident and released when the pool evicts it. Cube
+// textures get a render target view per face and a cube shader resource view.
+class RenderTargetPool
+{
+public:
+	RenderTargetPool(ID3D11Device* device);
+	~RenderTargetPool();
+
+	UINT Acquire(const PoolTextureDesc& desc);
+	void Release(UINT entry);
+
+	// Call once the frame was submitted; evicted textures are released here.
+	void EndFrame();
+	void Trim();
+
+	ID3D11ShaderResourceView* GetSRV(UINT entry) const;
+	ID3D11RenderTargetView* GetRTV(UINT entry, UINT face = 0) const;
+	ID3D11DepthStencilView* GetDSV(UINT entry) const;
+	ID3D11UnorderedAccessView* GetUAV(UINT entry) const;
+
+	inline const TexturePool& GetStats() const { return mPool; }
+
+private:
+	struct PooledTexture
+	{
+		ID3D11Texture2D* Texture;
+		ID3D11ShaderResourceView* SRV;
+		ID3D11RenderTargetView* RTV[6];
+		ID3D11DepthStencilView* DSV;
+		ID3D11UnorderedAccessView* UAV;
+	};
+
+	void CreateTexture(PooledTexture& texture, const PoolTextureDesc& desc);
+	void ReleaseTexture(PooledTexture& texture);
+	void ReleaseEvicted();
+
+private:
+	ID3D11Device* mDevice;
+	TexturePool mPool;
+	std::vector<PooledTexture> mTextures;
+};
+
+#endif // RENDERTARGET_POOL_H
\ No newline at end of file
@@ -0,0 +1,135 @@
+/*  =======================
+	Summary: Range allocator for shared buffers
+	=======================  */
+
+#include "BufferAllocator.h"
+
+BufferAllocator::BufferAllocator(uint32_t pageSize)
+{
+	mPageSize = pageSize > 0 ? pageSize : 1;
+	mUsedCount = 0;
+}
+
+BufferAllocator::~BufferAllocator()
+{
+}
+
+BufferAllocation BufferAllocator::Allocate(uint32_t count)
+{
+	BufferAllocation allocation = { InvalidPage, 0, 0 };
+
+	if (count == 0)
+	{
+		return allocation;
+	}
+
+	for (uint32_t page = 0; page < mPages.size(); ++page)
+	{
+		if (AllocateFromPage(page, count, allocation))
+		{
+			return allocation;
+		}
+	}
+
+	// Nothing fits; open a page, sized up for oversized requests
+	Page page;
+	page.Size = count > mPageSize ? count : mPageSize;
+
+	Range range = { 0, page.Size };
+	page.FreeRanges.push_back(range);
+	mPages.push_back(page);
+
+	AllocateFromPage(static_cast<uint32_t>(mPages.size()) - 1, count, allocation);
+	return allocation;
+}
+
+bool BufferAllocator::AllocateFromPage(uint32_t page, uint32_t count, BufferAllocation& allocation)
+{
+	std::vector<Range>& ranges = mPages[page].FreeRanges;
+
+	for (auto it = ranges.begin(); it != ranges.end(); ++it)
+	{
+		if (it->Count < count)
+		{
+			continue;
+		}
+
+		allocation.Page = page;
+		allocation.Offset = it->Offset;
+		allocation.Count = count;
+
+		it->Offset += count;
+		it->Count -= count;
+		if (it->Count == 0)
+		{
+			ranges.erase(it);
+		}
+
+		mUsedCount += count;
+		return true;
+	}
+
+	return false;
+}
+
+void BufferAllocator::Free(const BufferAllocation& allocation)
+{
+	if (allocation.Page >= mPages.size() || allocation.Count == 0)
+	{
+		return;
+	}
+
+	std::vector<Range>& ranges = mPages[allocation.Page].FreeRanges;
+
+	// Keep the list sorted and merge with the ranges on either side
+	auto next = ranges.begin();
+	while (next != ranges.end() && next->Offset < allocation.Offset)
+	{
+		++next;
+	}
+
+	Range range = { allocation.Offset, allocation.Count };
+
+	if (next != ranges.end() && range.Offset + range.Count == next->Offset)
+	{
+		range.Count += next->Count;
+		next = ranges.erase(next);
+	}
+
+	if (next != ranges.begin())
+	{
+		auto previous = next - 1;
+		if (previous->Offset + previous->Count == range.Offset)
+		{
+			previous->Count += range.Count;
+			mUsedCount -= allocation.Count;
+			return;
+		}
+	}
+
+	ranges.insert(next, range);
+	mUsedCount -= allocation.Count;
+}
+
+uint32_t BufferAllocator::GetCapacity() const
+{
+	uint32_t capacity = 0;
+	for (auto it = mPages.begin(); it != mPages.end(); ++it)
+	{
+		capacity += it->Size;
+	}
+	return capacity;
+}
+
+uint32_t BufferAllocator::GetLargestFreeRange() const
+{
+	uint32_t largest = 0;
+	for (auto page = mPages.begin(); page != mPages.end(); ++page)
+	{
+		for (auto it = page->FreeRanges.begin(); it != page->FreeRanges.end(); ++it)
+		{
+			if (it->Count > largest) { largest = it->Count; }
+		}
+	}
+	return largest;
+}
@@ -0,0 +1,68 @@
+/*  =======================
+	Summary: Range allocator for shared buffers
+	=======================  */
+
+#ifndef BUFFERALLOCATOR_H
+#define BUFFERALLOCATOR_H
+
+#include <cstdint>
+#include <vector>
+
+// A range of elements inside one page.
+struct BufferAllocation
+{
+	uint32_t Page;
+	uint32_t Offset;
+	uint32_t Count;
+};
+
+// Hands out element ranges from a growing set of fixed size pages, so many small
+// meshes can live in a few large vertex and index buffers. Each page keeps its free
+// ranges sorted by offset; allocation is first fit and freeing merges neighbours.
+// Requests larger than a page get a page of their own. Touches no device, so the
+// packing can be checked on the CPU.
+class BufferAllocator
+{
+public:
+	static const uint32_t InvalidPage = 0xffffffff;
+
+	BufferAllocator(uint32_t pageSize);
+	~BufferAllocator();
+
+	// Returns a range of count elements, opening a new page if no page has room.
+	// Zero elements give a range on InvalidPage.
+	BufferAllocation Allocate(uint32_t count);
+
+	void Free(const BufferAllocation& allocation);
+
+	inline uint32_t GetPageCount() const { return static_cast<uint32_t>(mPages.size()); }
+	inline uint32_t GetPageSize(uint32_t page) const { return mPages[page].Size; }
+	inline uint32_t GetUsedCount() const { return mUsedCount; }
+
+	// Elements in all pages, used or not
+	uint32_t GetCapacity() const;
+
+	uint32_t GetLargestFreeRange() const;
+
+private:
+	struct Range
+	{
+		uint32_t Offset;
+		uint32_t Count;
+	};
+
+	struct Page
+	{
+		uint32_t Size;
+		std::vector<Range> FreeRanges;
+	};
+
+	bool AllocateFromPage(uint32_t page, uint32_t count, BufferAllocation& allocation);
+
+private:
+	std::vector<Page> mPages;
+	uint32_t mPageSize;
+	uint32_t mUsedCount;
+};
+
+#endif // BUFFERALLOCATOR_H
\ No newline at end of file
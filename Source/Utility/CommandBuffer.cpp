@@ -0,0 +1,353 @@
+/*  =======================
+	Summary: Backend agnostic render command stream
+	=======================  */
+
+#include "CommandBuffer.h"
+
+#include <cstring>
+#include <xmmintrin.h>
+
+namespace
+{
+	inline uint32_t AlignUp(uint32_t value, uint32_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+CommandBuffer::CommandBuffer()
+{
+	mData = nullptr;
+	mSize = 0;
+	mCapacity = 0;
+	mCommandCount = 0;
+}
+
+CommandBuffer::~CommandBuffer()
+{
+	_mm_free(mData);
+}
+
+void CommandBuffer::Reset()
+{
+	mSize = 0;
+	mCommandCount = 0;
+}
+
+void CommandBuffer::SetRenderTargets(uint32_t count, ID3D11RenderTargetView* const* rtvs, ID3D11DepthStencilView* dsv)
+{
+	CmdSetRenderTargets* cmd = Allocate<CmdSetRenderTargets>(CMD_SET_RENDER_TARGETS);
+	cmd->Count = count < MaxCommandRenderTargets ? count : MaxCommandRenderTargets;
+	for (uint32_t i = 0; i < cmd->Count; ++i)
+	{
+		cmd->RTVs[i] = rtvs ? rtvs[i] : nullptr;
+	}
+	cmd->DSV = dsv;
+}
+
+void CommandBuffer::ClearRenderTarget(ID3D11RenderTargetView* rtv, const float color[4])
+{
+	CmdClearRenderTarget* cmd = Allocate<CmdClearRenderTarget>(CMD_CLEAR_RENDER_TARGET);
+	cmd->RTV = rtv;
+	memcpy(cmd->Color, color, sizeof(cmd->Color));
+}
+
+void CommandBuffer::ClearDepthStencil(ID3D11DepthStencilView* dsv, uint32_t flags, float depth, uint8_t stencil)
+{
+	CmdClearDepthStencil* cmd = Allocate<CmdClearDepthStencil>(CMD_CLEAR_DEPTH_STENCIL);
+	cmd->DSV = dsv;
+	cmd->Flags = flags;
+	cmd->Depth = depth;
+	cmd->Stencil = stencil;
+}
+
+void CommandBuffer::SetViewport(float topLeftX, float topLeftY, float width, float height, float minDepth, float maxDepth)
+{
+	CmdSetViewport* cmd = Allocate<CmdSetViewport>(CMD_SET_VIEWPORT);
+	cmd->TopLeftX = topLeftX;
+	cmd->TopLeftY = topLeftY;
+	cmd->Width = width;
+	cmd->Height = height;
+	cmd->MinDepth = minDepth;
+	cmd->MaxDepth = maxDepth;
+}
+
+void CommandBuffer::SetInputLayout(ID3D11InputLayout* layout)
+{
+	Allocate<CmdSetInputLayout>(CMD_SET_INPUT_LAYOUT)->Layout = layout;
+}
+
+void CommandBuffer::SetPrimitiveTopology(uint32_t topology)
+{
+	Allocate<CmdSetPrimitiveTopology>(CMD_SET_PRIMITIVE_TOPOLOGY)->Topology = topology;
+}
+
+void CommandBuffer::SetVertexBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t stride, uint32_t offset)
+{
+	CmdSetVertexBuffer* cmd = Allocate<CmdSetVertexBuffer>(CMD_SET_VERTEX_BUFFER);
+	cmd->Slot = slot;
+	cmd->Buffer = buffer;
+	cmd->Stride = stride;
+	cmd->Offset = offset;
+}
+
+void CommandBuffer::SetIndexBuffer(ID3D11Buffer* buffer, uint32_t format, uint32_t offset)
+{
+	CmdSetIndexBuffer* cmd = Allocate<CmdSetIndexBuffer>(CMD_SET_INDEX_BUFFER);
+	cmd->Buffer = buffer;
+	cmd->Format = format;
+	cmd->Offset = offset;
+}
+
+void CommandBuffer::SetVertexShader(ID3D11VertexShader* shader)
+{
+	Allocate<CmdSetVertexShader>(CMD_SET_VERTEX_SHADER)->Shader = shader;
+}
+
+void CommandBuffer::SetGeometryShader(ID3D11GeometryShader* shader)
+{
+	Allocate<CmdSetGeometryShader>(CMD_SET_GEOMETRY_SHADER)->Shader = shader;
+}
+
+void CommandBuffer::SetPixelShader(ID3D11PixelShader* shader)
+{
+	Allocate<CmdSetPixelShader>(CMD_SET_PIXEL_SHADER)->Shader = shader;
+}
+
+void CommandBuffer::SetComputeShader(ID3D11ComputeShader* shader)
+{
+	Allocate<CmdSetComputeShader>(CMD_SET_COMPUTE_SHADER)->Shader = shader;
+}
+
+void CommandBuffer::SetConstantBuffers(ShaderStage stage, uint32_t startSlot, uint32_t count, ID3D11Buffer* const* buffers)
+{
+	CmdSetConstantBuffers* cmd = Allocate<CmdSetConstantBuffers>(CMD_SET_CONSTANT_BUFFERS);
+	cmd->Stage = stage;
+	cmd->StartSlot = startSlot;
+	cmd->Count = count < MaxCommandSlots ? count : MaxCommandSlots;
+	for (uint32_t i = 0; i < cmd->Count; ++i)
+	{
+		cmd->Buffers[i] = buffers ? buffers[i] : nullptr;
+	}
+}
+
+void CommandBuffer::SetShaderResources(ShaderStage stage, uint32_t startSlot, uint32_t count, ID3D11ShaderResourceView* const* views)
+{
+	CmdSetShaderResources* cmd = Allocate<CmdSetShaderResources>(CMD_SET_SHADER_RESOURCES);
+	cmd->Stage = stage;
+	cmd->StartSlot = startSlot;
+	cmd->Count = count < MaxCommandSlots ? count : MaxCommandSlots;
+	for (uint32_t i = 0; i < cmd->Count; ++i)
+	{
+		cmd->Views[i] = views ? views[i] : nullptr;
+	}
+}
+
+void CommandBuffer::SetSamplers(ShaderStage stage, uint32_t startSlot, uint32_t count, ID3D11SamplerState* const* samplers)
+{
+	CmdSetSamplers* cmd = Allocate<CmdSetSamplers>(CMD_SET_SAMPLERS);
+	cmd->Stage = stage;
+	cmd->StartSlot = startSlot;
+	cmd->Count = count < MaxCommandSlots ? count : MaxCommandSlots;
+	for (uint32_t i = 0; i < cmd->Count; ++i)
+	{
+		cmd->Samplers[i] = samplers ? samplers[i] : nullptr;
+	}
+}
+
+void CommandBuffer::ClearShaderResources(ShaderStage stage, uint32_t startSlot, uint32_t count)
+{
+	SetShaderResources(stage, startSlot, count, nullptr);
+}
+
+void CommandBuffer::SetUnorderedAccessViews(uint32_t startSlot, uint32_t count, ID3D11UnorderedAccessView* const* views)
+{
+	CmdSetUnorderedAccessViews* cmd = Allocate<CmdSetUnorderedAccessViews>(CMD_SET_UNORDERED_ACCESS_VIEWS);
+	cmd->StartSlot = startSlot;
+	cmd->Count = count < MaxCommandSlots ? count : MaxCommandSlots;
+	for (uint32_t i = 0; i < cmd->Count; ++i)
+	{
+		cmd->Views[i] = views ? views[i] : nullptr;
+	}
+}
+
+void CommandBuffer::ClearUnorderedAccessViews(uint32_t startSlot, uint32_t count)
+{
+	SetUnorderedAccessViews(startSlot, count, nullptr);
+}
+
+void CommandBuffer::SetRasterizerState(ID3D11RasterizerState* state)
+{
+	Allocate<CmdSetRasterizerState>(CMD_SET_RASTERIZER_STATE)->State = state;
+}
+
+void CommandBuffer::SetBlendState(ID3D11BlendState* state, const float blendFactor[4], uint32_t sampleMask)
+{
+	CmdSetBlendState* cmd = Allocate<CmdSetBlendState>(CMD_SET_BLEND_STATE);
+	cmd->State = state;
+	memcpy(cmd->BlendFactor, blendFactor, sizeof(cmd->BlendFactor));
+	cmd->SampleMask = sampleMask;
+}
+
+void CommandBuffer::SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencilRef)
+{
+	CmdSetDepthStencilState* cmd = Allocate<CmdSetDepthStencilState>(CMD_SET_DEPTH_STENCIL_STATE);
+	cmd->State = state;
+	cmd->StencilRef = stencilRef;
+}
+
+void CommandBuffer::SetStreamOutTarget(ID3D11Buffer* buffer, uint32_t offset)
+{
+	CmdSetStreamOutTarget* cmd = Allocate<CmdSetStreamOutTarget>(CMD_SET_STREAM_OUT_TARGET);
+	cmd->Buffer = buffer;
+	cmd->Offset = offset;
+}
+
+void* CommandBuffer::UpdateConstants(ID3D11Buffer* buffer, uint32_t size)
+{
+	uint32_t dataOffset = AlignUp(sizeof(CmdUpdateConstants), 16);
+
+	CmdUpdateConstants* cmd = static_cast<CmdUpdateConstants*>(Allocate(CMD_UPDATE_CONSTANTS, dataOffset + size));
+	cmd->Buffer = buffer;
+	cmd->DataSize = size;
+	cmd->DataOffset = dataOffset;
+
+	return reinterpret_cast<uint8_t*>(cmd) + dataOffset;
+}
+
+void* CommandBuffer::SetVertexData(uint32_t slot, uint32_t stride, uint32_t size)
+{
+	uint32_t dataOffset = AlignUp(sizeof(CmdSetVertexData), 16);
+
+	CmdSetVertexData* cmd = static_cast<CmdSetVertexData*>(Allocate(CMD_SET_VERTEX_DATA, dataOffset + size));
+	cmd->Slot = slot;
+	cmd->Stride = stride;
+	cmd->DataSize = size;
+	cmd->DataOffset = dataOffset;
+
+	return reinterpret_cast<uint8_t*>(cmd) + dataOffset;
+}
+
+void CommandBuffer::Draw(uint32_t vertexCount, uint32_t startVertex)
+{
+	CmdDraw* cmd = Allocate<CmdDraw>(CMD_DRAW);
+	cmd->VertexCount = vertexCount;
+	cmd->StartVertex = startVertex;
+}
+
+void CommandBuffer::DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+{
+	CmdDrawIndexed* cmd = Allocate<CmdDrawIndexed>(CMD_DRAW_INDEXED);
+	cmd->IndexCount = indexCount;
+	cmd->StartIndex = startIndex;
+	cmd->BaseVertex = baseVertex;
+}
+
+void CommandBuffer::DrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance)
+{
+	CmdDrawInstanced* cmd = Allocate<CmdDrawInstanced>(CMD_DRAW_INSTANCED);
+	cmd->VertexCount = vertexCount;
+	cmd->InstanceCount = instanceCount;
+	cmd->StartVertex = startVertex;
+	cmd->StartInstance = startInstance;
+}
+
+void CommandBuffer::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
+{
+	CmdDrawIndexedInstanced* cmd = Allocate<CmdDrawIndexedInstanced>(CMD_DRAW_INDEXED_INSTANCED);
+	cmd->IndexCount = indexCount;
+	cmd->InstanceCount = instanceCount;
+	cmd->StartIndex = startIndex;
+	cmd->BaseVertex = baseVertex;
+	cmd->StartInstance = startInstance;
+}
+
+void CommandBuffer::DrawAuto()
+{
+	Allocate<CmdDrawAuto>(CMD_DRAW_AUTO);
+}
+
+void CommandBuffer::Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+	CmdDispatch* cmd = Allocate<CmdDispatch>(CMD_DISPATCH);
+	cmd->GroupCountX = groupCountX;
+	cmd->GroupCountY = groupCountY;
+	cmd->GroupCountZ = groupCountZ;
+}
+
+void CommandBuffer::CopyResource(ID3D11Resource* dest, ID3D11Resource* source)
+{
+	CmdCopyResource* cmd = Allocate<CmdCopyResource>(CMD_COPY_RESOURCE);
+	cmd->Dest = dest;
+	cmd->Source = source;
+}
+
+void CommandBuffer::GenerateMips(ID3D11ShaderResourceView* view)
+{
+	Allocate<CmdGenerateMips>(CMD_GENERATE_MIPS)->View = view;
+}
+
+void CommandBuffer::Append(const CommandBuffer& other)
+{
+	if (other.mSize == 0) { return; }
+
+	if (mSize + other.mSize > mCapacity)
+	{
+		Reserve(mSize + other.mSize);
+	}
+
+	// Packets are relocatable: offsets inside them are relative to the packet
+	memcpy(mData + mSize, other.mData, other.mSize);
+	mSize += other.mSize;
+	mCommandCount += other.mCommandCount;
+}
+
+void CommandBuffer::AppendCommand(const CmdHeader* cmd)
+{
+	if (mSize + cmd->Size > mCapacity)
+	{
+		Reserve(mSize + cmd->Size);
+	}
+
+	memcpy(mData + mSize, cmd, cmd->Size);
+	mSize += cmd->Size;
+	++mCommandCount;
+}
+
+void* CommandBuffer::Allocate(uint32_t type, uint32_t size)
+{
+	size = AlignUp(size, 16);
+
+	if (mSize + size > mCapacity)
+	{
+		Reserve(mSize + size);
+	}
+
+	CmdHeader* header = reinterpret_cast<CmdHeader*>(mData + mSize);
+	header->Type = type;
+	header->Size = size;
+
+	mSize += size;
+	++mCommandCount;
+
+	return header;
+}
+
+void CommandBuffer::Reserve(uint32_t capacity)
+{
+	uint32_t newCapacity = mCapacity == 0 ? 16 * 1024 : mCapacity;
+	while (newCapacity < capacity)
+	{
+		newCapacity *= 2;
+	}
+
+	uint8_t* data = static_cast<uint8_t*>(_mm_malloc(newCapacity, 16));
+	if (mData)
+	{
+		memcpy(data, mData, mSize);
+		_mm_free(mData);
+	}
+
+	mData = data;
+	mCapacity = newCapacity;
+}
@@ -0,0 +1,223 @@
+/*  =======================
+	Summary: Backend agnostic render command stream
+	=======================  */
+
+#ifndef COMMANDBUFFER_H
+#define COMMANDBUFFER_H
+
+#include <cstdint>
+
+// Pipeline objects are only carried by pointer, so the stream can be recorded and
+// inspected without the D3D11 headers or a device.
+struct ID3D11Buffer;
+struct ID3D11Resource;
+struct ID3D11InputLayout;
+struct ID3D11VertexShader;
+struct ID3D11GeometryShader;
+struct ID3D11PixelShader;
+struct ID3D11ComputeShader;
+struct ID3D11ShaderResourceView;
+struct ID3D11RenderTargetView;
+struct ID3D11DepthStencilView;
+struct ID3D11UnorderedAccessView;
+struct ID3D11SamplerState;
+struct ID3D11RasterizerState;
+struct ID3D11BlendState;
+struct ID3D11DepthStencilState;
+
+enum CommandType
+{
+	CMD_SET_RENDER_TARGETS,
+	CMD_CLEAR_RENDER_TARGET,
+	CMD_CLEAR_DEPTH_STENCIL,
+	CMD_SET_VIEWPORT,
+	CMD_SET_INPUT_LAYOUT,
+	CMD_SET_PRIMITIVE_TOPOLOGY,
+	CMD_SET_VERTEX_BUFFER,
+	CMD_SET_INDEX_BUFFER,
+	CMD_SET_VERTEX_DATA,
+	CMD_SET_VERTEX_SHADER,
+	CMD_SET_GEOMETRY_SHADER,
+	CMD_SET_PIXEL_SHADER,
+	CMD_SET_COMPUTE_SHADER,
+	CMD_SET_CONSTANT_BUFFERS,
+	CMD_SET_SHADER_RESOURCES,
+	CMD_SET_SAMPLERS,
+	CMD_SET_UNORDERED_ACCESS_VIEWS,
+	CMD_SET_RASTERIZER_STATE,
+	CMD_SET_BLEND_STATE,
+	CMD_SET_DEPTH_STENCIL_STATE,
+	CMD_SET_STREAM_OUT_TARGET,
+	CMD_UPDATE_CONSTANTS,
+	CMD_DRAW,
+	CMD_DRAW_INDEXED,
+	CMD_DRAW_INSTANCED,
+	CMD_DRAW_INDEXED_INSTANCED,
+	CMD_DRAW_AUTO,
+	CMD_DISPATCH,
+	CMD_COPY_RESOURCE,
+	CMD_GENERATE_MIPS,
+	CMD_COUNT
+};
+
+enum ShaderStage
+{
+	STAGE_VS,
+	STAGE_GS,
+	STAGE_PS,
+	STAGE_CS,
+	STAGE_COUNT
+};
+
+// Every packet starts with a header and is 16-byte aligned within the stream.
+struct CmdHeader
+{
+	uint32_t Type;
+	uint32_t Size;
+};
+
+static const uint32_t MaxCommandRenderTargets = 8;
+static const uint32_t MaxCommandSlots = 8;
+
+struct CmdSetRenderTargets { CmdHeader Header; uint32_t Count; ID3D11RenderTargetView* RTVs[MaxCommandRenderTargets]; ID3D11DepthStencilView* DSV; };
+struct CmdClearRenderTarget { CmdHeader Header; ID3D11RenderTargetView* RTV; float Color[4]; };
+struct CmdClearDepthStencil { CmdHeader Header; ID3D11DepthStencilView* DSV; uint32_t Flags; float Depth; uint8_t Stencil; };
+struct CmdSetViewport { CmdHeader Header; float TopLeftX; float TopLeftY; float Width; float Height; float MinDepth; float MaxDepth; };
+struct CmdSetInputLayout { CmdHeader Header; ID3D11InputLayout* Layout; };
+struct CmdSetPrimitiveTopology { CmdHeader Header; uint32_t Topology; };
+struct CmdSetVertexBuffer { CmdHeader Header; uint32_t Slot; ID3D11Buffer* Buffer; uint32_t Stride; uint32_t Offset; };
+struct CmdSetIndexBuffer { CmdHeader Header; ID3D11Buffer* Buffer; uint32_t Format; uint32_t Offset; };
+struct CmdSetVertexShader { CmdHeader Header; ID3D11VertexShader* Shader; };
+struct CmdSetGeometryShader { CmdHeader Header; ID3D11GeometryShader* Shader; };
+struct CmdSetPixelShader { CmdHeader Header; ID3D11PixelShader* Shader; };
+struct CmdSetComputeShader { CmdHeader Header; ID3D11ComputeShader* Shader; };
+struct CmdSetConstantBuffers { CmdHeader Header; uint32_t Stage; uint32_t StartSlot; uint32_t Count; ID3D11Buffer* Buffers[MaxCommandSlots]; };
+struct CmdSetShaderResources { CmdHeader Header; uint32_t Stage; uint32_t StartSlot; uint32_t Count; ID3D11ShaderResourceView* Views[MaxCommandSlots]; };
+struct CmdSetSamplers { CmdHeader Header; uint32_t Stage; uint32_t StartSlot; uint32_t Count; ID3D11SamplerState* Samplers[MaxCommandSlots]; };
+struct CmdSetUnorderedAccessViews { CmdHeader Header; uint32_t StartSlot; uint32_t Count; ID3D11UnorderedAccessView* Views[MaxCommandSlots]; };
+struct CmdSetRasterizerState { CmdHeader Header; ID3D11RasterizerState* State; };
+struct CmdSetBlendState { CmdHeader Header; ID3D11BlendState* State; float BlendFactor[4]; uint32_t SampleMask; };
+struct CmdSetDepthStencilState { CmdHeader Header; ID3D11DepthStencilState* State; uint32_t StencilRef; };
+struct CmdSetStreamOutTarget { CmdHeader Header; ID3D11Buffer* Buffer; uint32_t Offset; };
+struct CmdDraw { CmdHeader Header; uint32_t VertexCount; uint32_t StartVertex; };
+struct CmdDrawIndexed { CmdHeader Header; uint32_t IndexCount; uint32_t StartIndex; int32_t BaseVertex; };
+struct CmdDrawInstanced { CmdHeader Header; uint32_t VertexCount; uint32_t InstanceCount; uint32_t StartVertex; uint32_t StartInstance; };
+struct CmdDrawIndexedInstanced { CmdHeader Header; uint32_t IndexCount; uint32_t InstanceCount; uint32_t StartIndex; int32_t BaseVertex; uint32_t StartInstance; };
+struct CmdDrawAuto { CmdHeader Header; };
+struct CmdDispatch { CmdHeader Header; uint32_t GroupCountX; uint32_t GroupCountY; uint32_t GroupCountZ; };
+struct CmdCopyResource { CmdHeader Header; ID3D11Resource* Dest; ID3D11Resource* Source; };
+struct CmdGenerateMips { CmdHeader Header; ID3D11ShaderResourceView* View; };
+
+// Constant and vertex data follow the packet at DataOffset bytes from its start.
+struct CmdUpdateConstants { CmdHeader Header; ID3D11Buffer* Buffer; uint32_t DataSize; uint32_t DataOffset; };
+struct CmdSetVertexData { CmdHeader Header; uint32_t Slot; uint32_t Stride; uint32_t DataSize; uint32_t DataOffset; };
+
+// A linear buffer of render commands. Passes record into it with calls that mirror the
+// device context; a RenderBackend replays it later. Enum arguments such as topology and
+// formats are the D3D11 values carried as uint32_t.
+class CommandBuffer
+{
+public:
+	CommandBuffer();
+	~CommandBuffer();
+
+	// Drops all recorded commands but keeps the memory for the next frame.
+	void Reset();
+
+	void SetRenderTargets(uint32_t count, ID3D11RenderTargetView* const* rtvs, ID3D11DepthStencilView* dsv);
+	void ClearRenderTarget(ID3D11RenderTargetView* rtv, const float color[4]);
+	void ClearDepthStencil(ID3D11DepthStencilView* dsv, uint32_t flags, float depth, uint8_t stencil);
+	void SetViewport(float topLeftX, float topLeftY, float width, float height, float minDepth, float maxDepth);
+
+	// Accepts any viewport struct with the D3D11_VIEWPORT members.
+	template<class Viewport>
+	void SetViewport(const Viewport& vp) { SetViewport(vp.TopLeftX, vp.TopLeftY, vp.Width, vp.Height, vp.MinDepth, vp.MaxDepth); }
+
+	void SetInputLayout(ID3D11InputLayout* layout);
+	void SetPrimitiveTopology(uint32_t topology);
+	void SetVertexBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t stride, uint32_t offset);
+	void SetIndexBuffer(ID3D11Buffer* buffer, uint32_t format, uint32_t offset);
+
+	void SetVertexShader(ID3D11VertexShader* shader);
+	void SetGeometryShader(ID3D11GeometryShader* shader);
+	void SetPixelShader(ID3D11PixelShader* shader);
+	void SetComputeShader(ID3D11ComputeShader* shader);
+
+	void SetConstantBuffers(ShaderStage stage, uint32_t startSlot, uint32_t count, ID3D11Buffer* const* buffers);
+	void SetShaderResources(ShaderStage stage, uint32_t startSlot, uint32_t count, ID3D11ShaderResourceView* const* views);
+	void SetSamplers(ShaderStage stage, uint32_t startSlot, uint32_t count, ID3D11SamplerState* const* samplers);
+
+	// Unbinds count shader resource slots.
+	void ClearShaderResources(ShaderStage stage, uint32_t startSlot, uint32_t count);
+
+	// Compute stage only.
+	void SetUnorderedAccessViews(uint32_t startSlot, uint32_t count, ID3D11UnorderedAccessView* const* views);
+	void ClearUnorderedAccessViews(uint32_t startSlot, uint32_t count);
+
+	void SetRasterizerState(ID3D11RasterizerState* state);
+	void SetBlendState(ID3D11BlendState* state, const float blendFactor[4], uint32_t sampleMask);
+	void SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencilRef);
+	void SetStreamOutTarget(ID3D11Buffer* buffer, uint32_t offset);
+
+	// Reserves size bytes of constant data that replace the contents of buffer when the
+	// stream is replayed. The returned pointer is 16-byte aligned and stays valid until
+	// the next command is recorded.
+	void* UpdateConstants(ID3D11Buffer* buffer, uint32_t size);
+
+	template<class T>
+	T* UpdateConstants(ID3D11Buffer* buffer) { return static_cast<T*>(UpdateConstants(buffer, sizeof(T))); }
+
+	// Reserves size bytes of vertex data, such as per instance data, that the backend
+	// uploads to memory it owns and binds to slot when the stream is replayed. The
+	// returned pointer is 16-byte aligned and stays valid until the next command is recorded.
+	void* SetVertexData(uint32_t slot, uint32_t stride, uint32_t size);
+
+	template<class T>
+	T* SetVertexData(uint32_t slot, uint32_t count) { return static_cast<T*>(SetVertexData(slot, sizeof(T), sizeof(T) * count)); }
+
+	void Draw(uint32_t vertexCount, uint32_t startVertex);
+	void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex);
+	void DrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance);
+	void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance);
+	void DrawAuto();
+	void Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
+	void CopyResource(ID3D11Resource* dest, ID3D11Resource* source);
+	void GenerateMips(ID3D11ShaderResourceView* view);
+
+	// Appends all commands of another buffer.
+	void Append(const CommandBuffer& other);
+
+	// Appends a copy of one packet taken from another buffer.
+	void AppendCommand(const CmdHeader* cmd);
+
+	// Iteration: for (const CmdHeader* cmd = buffer.Begin(); cmd != buffer.End(); cmd = CommandBuffer::Next(cmd))
+	inline const CmdHeader* Begin() const { return reinterpret_cast<const CmdHeader*>(mData); }
+	inline const CmdHeader* End() const { return reinterpret_cast<const CmdHeader*>(mData + mSize); }
+	static inline const CmdHeader* Next(const CmdHeader* cmd) { return reinterpret_cast<const CmdHeader*>(reinterpret_cast<const uint8_t*>(cmd) + cmd->Size); }
+
+	static inline const void* GetConstantData(const CmdUpdateConstants* cmd) { return reinterpret_cast<const uint8_t*>(cmd) + cmd->DataOffset; }
+	static inline const void* GetVertexData(const CmdSetVertexData* cmd) { return reinterpret_cast<const uint8_t*>(cmd) + cmd->DataOffset; }
+
+	inline uint32_t GetCommandCount() const { return mCommandCount; }
+	inline uint32_t GetSize() const { return mSize; }
+
+private:
+	void* Allocate(uint32_t type, uint32_t size);
+
+	template<class T>
+	T* Allocate(uint32_t type) { return static_cast<T*>(Allocate(type, sizeof(T))); }
+
+	void Reserve(uint32_t capacity);
+
+	// Copying would double free the storage
+	CommandBuffer(const CommandBuffer&);
+	CommandBuffer& operator=(const CommandBuffer&);
+
+private:
+	uint8_t* mData;
+	uint32_t mSize;
+	uint32_t mCapacity;
+	uint32_t mCommandCount;
+};
+
+#endif // COMMANDBUFFER_H
\ No newline at end of file
@@ -0,0 +1,54 @@
+/*  =======================
+	Summary: Per-frame constant upload ring
+	=======================  */
+
+#include "ConstantRing.h"
+
+ConstantRing::ConstantRing(uint32_t capacity)
+{
+	mCapacity = AlignSize(capacity > 0 ? capacity : Alignment);
+	mHead = 0;
+	mRequestedBytes = 0;
+
+	mPeakBytes = 0;
+	mAllocationCount = 0;
+	mOverflowCount = 0;
+}
+
+ConstantRing::~ConstantRing()
+{
+}
+
+void ConstantRing::BeginFrame()
+{
+	while (mCapacity < mRequestedBytes)
+	{
+		mCapacity *= 2;
+	}
+
+	mHead = 0;
+	mRequestedBytes = 0;
+}
+
+uint32_t ConstantRing::Allocate(uint32_t size)
+{
+	uint32_t alignedSize = AlignSize(size);
+	mRequestedBytes += alignedSize;
+
+	if (alignedSize > mCapacity - mHead)
+	{
+		++mOverflowCount;
+		return InvalidOffset;
+	}
+
+	uint32_t offset = mHead;
+	mHead += alignedSize;
+	++mAllocationCount;
+
+	if (mHead > mPeakBytes)
+	{
+		mPeakBytes = mHead;
+	}
+
+	return offset;
+}
@@ -0,0 +1,57 @@
+/*  =======================
+	Summary: Per-frame constant upload ring
+	=======================  */
+
+#ifndef CONSTANTRING_H
+#define CONSTANTRING_H
+
+#include <cstdint>
+
+// Hands out 256 byte aligned blocks of one large dynamic constant buffer. Each frame
+// starts again at the front with a discard, so the driver renames the buffer once per
+// frame instead of once per draw; every block after the first is mapped without
+// overwrite. A frame that does not fit is reported as an overflow and the capacity is
+// doubled at the start of the next frame. Touches no device, so it can be driven and
+// checked on the CPU.
+class ConstantRing
+{
+public:
+	// Constant buffer offsets are given in 16 byte constants and must be a multiple of 16.
+	static const uint32_t Alignment = 256;
+	static const uint32_t InvalidOffset = 0xffffffff;
+
+	ConstantRing(uint32_t capacity);
+	~ConstantRing();
+
+	// Restarts at the front, growing first if the previous frame overflowed.
+	void BeginFrame();
+
+	// Returns the byte offset of a block of at least size bytes, or InvalidOffset if
+	// the rest of the frame does not fit.
+	uint32_t Allocate(uint32_t size);
+
+	// True until the first block of the frame was handed out; that block must be mapped
+	// with a discard.
+	inline bool IsFrameStart() const { return mHead == 0; }
+
+	inline uint32_t GetCapacity() const { return mCapacity; }
+	inline uint32_t GetUsedBytes() const { return mHead; }
+	inline uint32_t GetPeakBytes() const { return mPeakBytes; }
+	inline uint32_t GetAllocationCount() const { return mAllocationCount; }
+	inline uint32_t GetOverflowCount() const { return mOverflowCount; }
+
+	static inline uint32_t AlignSize(uint32_t size) { return (size + Alignment - 1) & ~(Alignment - 1); }
+
+private:
+	uint32_t mCapacity;
+	uint32_t mHead;
+
+	// Bytes the current frame asked for, including what did not fit
+	uint32_t mRequestedBytes;
+
+	uint32_t mPeakBytes;
+	uint32_t mAllocationCount;
+	uint32_t mOverflowCount;
+};
+
+#endif // CONSTANTRING_H
\ No newline at end of file
@@ -0,0 +1,137 @@
+/*  =======================
+	Summary: Six-face culling for cube map captures
+	=======================  */
+
+#include "CubeFaceCuller.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <xmmintrin.h>
+
+CubeFaceCuller::CubeFaceCuller()
+{
+	mCount = 0;
+}
+
+CubeFaceCuller::~CubeFaceCuller()
+{
+}
+
+void CubeFaceCuller::Reset()
+{
+	mCount = 0;
+
+	for (uint32_t a = 0; a < 3; ++a)
+	{
+		mCenters[a].clear();
+		mExtents[a].clear();
+	}
+}
+
+uint32_t CubeFaceCuller::AddBox(const DirectX::BoundingBox& box)
+{
+	// Open a new group of four, filled with boxes no face can see
+	if (mCount % 4 == 0)
+	{
+		for (uint32_t a = 0; a < 3; ++a)
+		{
+			mCenters[a].resize(mCount + 4, FLT_MAX);
+			mExtents[a].resize(mCount + 4, 0.0f);
+		}
+	}
+
+	const float* center = &box.Center.x;
+	const float* extents = &box.Extents.x;
+
+	for (uint32_t a = 0; a < 3; ++a)
+	{
+		mCenters[a][mCount] = center[a];
+		mExtents[a][mCount] = extents[a];
+	}
+
+	return mCount++;
+}
+
+void CubeFaceCuller::Cull(const DirectX::XMFLOAT3& position, float farZ, std::vector<uint8_t>& masks) const
+{
+	masks.resize(mCount);
+
+	const float* origin = &position.x;
+	__m128 zero = _mm_setzero_ps();
+	__m128 farV = _mm_set1_ps(farZ);
+
+	for (uint32_t i = 0; i < mCount; i += 4)
+	{
+		// Box bounds relative to the capture point, and the smallest magnitude each
+		// axis reaches inside the box: lo if the box is above zero, -hi if below, else 0
+		__m128 lo[3], hi[3], minAbs[3];
+		for (uint32_t a = 0; a < 3; ++a)
+		{
+			__m128 c = _mm_sub_ps(_mm_loadu_ps(&mCenters[a][i]), _mm_set1_ps(origin[a]));
+			__m128 e = _mm_loadu_ps(&mExtents[a][i]);
+			lo[a] = _mm_sub_ps(c, e);
+			hi[a] = _mm_add_ps(c, e);
+			minAbs[a] = _mm_max_ps(_mm_max_ps(lo[a], _mm_sub_ps(zero, hi[a])), zero);
+		}
+
+		int bits[4] = { 0, 0, 0, 0 };
+		for (uint32_t face = 0; face < 6; ++face)
+		{
+			uint32_t axis = face / 2;
+			uint32_t u = (axis + 1) % 3;
+			uint32_t v = (axis + 2) % 3;
+
+			// A face sees points at least as far along its axis as across it. The box is
+			// axis aligned, so the best point is furthest along the axis and nearest to it
+			// across; the nearest point along the axis must be inside the far plane.
+			__m128 along = (face & 1) ? _mm_sub_ps(zero, lo[axis]) : hi[axis];
+			__m128 nearest = (face & 1) ? _mm_sub_ps(zero, hi[axis]) : lo[axis];
+
+			__m128 visible = _mm_and_ps(_mm_cmpge_ps(along, _mm_max_ps(minAbs[u], minAbs[v])), _mm_cmple_ps(nearest, farV));
+			int lanes = _mm_movemask_ps(visible);
+
+			for (uint32_t k = 0; k < 4; ++k)
+			{
+				bits[k] |= ((lanes >> k) & 1) << face;
+			}
+		}
+
+		uint32_t lanesUsed = std::min(4u, mCount - i);
+		for (uint32_t k = 0; k < lanesUsed; ++k)
+		{
+			masks[i + k] = static_cast<uint8_t>(bits[k]);
+		}
+	}
+}
+
+uint8_t CubeFaceCuller::CullBox(const DirectX::XMFLOAT3& position, float farZ, const DirectX::BoundingBox& box)
+{
+	const float* origin = &position.x;
+	const float* center = &box.Center.x;
+	const float* extents = &box.Extents.x;
+
+	// Same operations in the same order as Cull, so boxes on a face boundary agree
+	float lo[3], hi[3], minAbs[3];
+	for (uint32_t a = 0; a < 3; ++a)
+	{
+		float c = center[a] - origin[a];
+		lo[a] = c - extents[a];
+		hi[a] = c + extents[a];
+		minAbs[a] = std::max(std::max(lo[a], -hi[a]), 0.0f);
+	}
+
+	uint8_t mask = 0;
+	for (uint32_t face = 0; face < 6; ++face)
+	{
+		uint32_t axis = face / 2;
+		float along = (face & 1) ? -lo[axis] : hi[axis];
+		float nearest = (face & 1) ? -hi[axis] : lo[axis];
+
+		if (along >= std::max(minAbs[(axis + 1) % 3], minAbs[(axis + 2) % 3]) && nearest <= farZ)
+		{
+			mask |= 1 << face;
+		}
+	}
+
+	return mask;
+}
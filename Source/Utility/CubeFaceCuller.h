@@ -0,0 +1,44 @@
+/*  =======================
+	Summary: Six-face culling for cube map captures
+	=======================  */
+
+#ifndef CUBEFACECULLER_H
+#define CUBEFACECULLER_H
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+#include "DirectXCollision.h"
+
+// Culls world space boxes against all six 90 degree face frustums of a cube capture in
+// one pass. Boxes are kept in structure-of-arrays form, four to an SSE register, and
+// each gets a mask with bit i set if face i (+X, -X, +Y, -Y, +Z, -Z) may see it. Has no
+// D3D dependencies so it can be checked without a device.
+class CubeFaceCuller
+{
+public:
+	static const uint8_t AllFaces = 0x3f;
+
+	CubeFaceCuller();
+	~CubeFaceCuller();
+
+	void Reset();
+	uint32_t AddBox(const DirectX::BoundingBox& box);
+	inline uint32_t GetBoxCount() const { return mCount; }
+
+	// Writes one mask per box, in the order they were added. Boxes entirely beyond farZ
+	// along a face's axis are culled from that face.
+	void Cull(const DirectX::XMFLOAT3& position, float farZ, std::vector<uint8_t>& masks) const;
+
+	// The same test for a single box, one face at a time.
+	static uint8_t CullBox(const DirectX::XMFLOAT3& position, float farZ, const DirectX::BoundingBox& box);
+
+private:
+	uint32_t mCount;
+
+	// Box centres and extents per axis, padded to a multiple of four with empty boxes
+	std::vector<float> mCenters[3];
+	std::vector<float> mExtents[3];
+};
+
+#endif // CUBEFACECULLER_H
\ No newline at end of file
@@ -0,0 +1,179 @@
+/*  =======================
+	Summary: Dynamic cube map update scheduling
+	=======================  */
+
+#include "CubeFaceScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Smallest absolute value in [lo, hi]
+	float MinAbs(float lo, float hi)
+	{
+		if (lo <= 0.0f && hi >= 0.0f) { return 0.0f; }
+		return std::min(fabsf(lo), fabsf(hi));
+	}
+}
+
+CubeFaceScheduler::CubeFaceScheduler()
+{
+	mFrame = 0;
+	mStalenessWeight = 1.0f;
+}
+
+CubeFaceScheduler::~CubeFaceScheduler()
+{
+}
+
+uint32_t CubeFaceScheduler::AddProbe(const DirectX::XMFLOAT3& position, float range)
+{
+	Probe probe;
+	probe.Position = position;
+	probe.Range = range;
+
+	for (uint32_t i = 0; i < FaceCount; ++i)
+	{
+		probe.isDirty[i] = true;
+		probe.DirtyFrame[i] = mFrame;
+	}
+
+	mProbes.push_back(probe);
+	return static_cast<uint32_t>(mProbes.size()) - 1;
+}
+
+void CubeFaceScheduler::SetProbePosition(uint32_t probe, const DirectX::XMFLOAT3& position)
+{
+	Probe& p = mProbes[probe];
+	if (p.Position.x == position.x && p.Position.y == position.y && p.Position.z == position.z)
+	{
+		return;
+	}
+
+	p.Position = position;
+	InvalidateProbe(probe);
+}
+
+void CubeFaceScheduler::InvalidateAll()
+{
+	for (uint32_t i = 0; i < mProbes.size(); ++i)
+	{
+		InvalidateProbe(i);
+	}
+}
+
+void CubeFaceScheduler::InvalidateProbe(uint32_t probe)
+{
+	for (uint32_t i = 0; i < FaceCount; ++i)
+	{
+		MarkDirty(mProbes[probe], i);
+	}
+}
+
+void CubeFaceScheduler::InvalidateBounds(const DirectX::BoundingBox& box)
+{
+	for (uint32_t p = 0; p < mProbes.size(); ++p)
+	{
+		Probe& probe = mProbes[p];
+
+		// Distance from the probe to the nearest point of the box
+		float dx = std::max(fabsf(box.Center.x - probe.Position.x) - box.Extents.x, 0.0f);
+		float dy = std::max(fabsf(box.Center.y - probe.Position.y) - box.Extents.y, 0.0f);
+		float dz = std::max(fabsf(box.Center.z - probe.Position.z) - box.Extents.z, 0.0f);
+
+		if (dx * dx + dy * dy + dz * dz > probe.Range * probe.Range)
+		{
+			continue;
+		}
+
+		for (uint32_t i = 0; i < FaceCount; ++i)
+		{
+			if (FaceSeesBox(probe.Position, i, box)) { MarkDirty(probe, i); }
+		}
+	}
+}
+
+void CubeFaceScheduler::Schedule(const DirectX::XMFLOAT3& cameraPos, uint32_t maxFaces, std::vector<CubeFaceUpdate>& faces)
+{
+	faces.clear();
+	mCandidates.clear();
+
+	for (uint32_t p = 0; p < mProbes.size(); ++p)
+	{
+		const Probe& probe = mProbes[p];
+
+		float dx = probe.Position.x - cameraPos.x;
+		float dy = probe.Position.y - cameraPos.y;
+		float dz = probe.Position.z - cameraPos.z;
+		float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+		for (uint32_t i = 0; i < FaceCount; ++i)
+		{
+			if (!probe.isDirty[i]) { continue; }
+
+			Candidate candidate;
+			candidate.Face.Probe = p;
+			candidate.Face.Face = i;
+			candidate.Priority = static_cast<float>(mFrame - probe.DirtyFrame[i]) * mStalenessWeight - distance;
+			mCandidates.push_back(candidate);
+		}
+	}
+
+	// Stable, so equal priorities keep probe and face order
+	std::stable_sort(mCandidates.begin(), mCandidates.end(), [](const Candidate& a, const Candidate& b)
+	{
+		return a.Priority > b.Priority;
+	});
+
+	uint32_t count = std::min(maxFaces, static_cast<uint32_t>(mCandidates.size()));
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const CubeFaceUpdate& face = mCandidates[i].Face;
+		mProbes[face.Probe].isDirty[face.Face] = false;
+		faces.push_back(face);
+	}
+
+	++mFrame;
+}
+
+uint32_t CubeFaceScheduler::GetDirtyFaceCount() const
+{
+	uint32_t count = 0;
+	for (uint32_t p = 0; p < mProbes.size(); ++p)
+	{
+		for (uint32_t i = 0; i < FaceCount; ++i)
+		{
+			if (mProbes[p].isDirty[i]) { ++count; }
+		}
+	}
+	return count;
+}
+
+bool CubeFaceScheduler::FaceSeesBox(const DirectX::XMFLOAT3& position, uint32_t face, const DirectX::BoundingBox& box)
+{
+	// Box relative to the probe
+	float lo[3] = { box.Center.x - box.Extents.x - position.x, box.Center.y - box.Extents.y - position.y, box.Center.z - box.Extents.z - position.z };
+	float hi[3] = { box.Center.x + box.Extents.x - position.x, box.Center.y + box.Extents.y - position.y, box.Center.z + box.Extents.z - position.z };
+
+	uint32_t axis = face / 2;
+	uint32_t u = (axis + 1) % 3;
+	uint32_t v = (axis + 2) % 3;
+
+	// The face sees points whose coordinate along its axis is at least as large as the
+	// other two in magnitude. The box is axis aligned, so the best point takes the
+	// furthest coordinate along the axis and the smallest magnitudes across it.
+	float along = (face & 1) ? -lo[axis] : hi[axis];
+
+	return along >= 0.0f && along >= MinAbs(lo[u], hi[u]) && along >= MinAbs(lo[v], hi[v]);
+}
+
+void CubeFaceScheduler::MarkDirty(Probe& probe, uint32_t face)
+{
+	// Staleness counts from the first change since the last capture
+	if (!probe.isDirty[face])
+	{
+		probe.isDirty[face] = true;
+		probe.DirtyFrame[face] = mFrame;
+	}
+}
@@ -0,0 +1,87 @@
+/*  =======================
+	Summary: Dynamic cube map update scheduling
+	=======================  */
+
+#ifndef CUBEFACESCHEDULER_H
+#define CUBEFACESCHEDULER_H
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+#include "DirectXCollision.h"
+
+// One cube map face to capture, in D3D face order: +X, -X, +Y, -Y, +Z, -Z.
+struct CubeFaceUpdate
+{
+	uint32_t Probe;
+	uint32_t Face;
+};
+
+// Decides which faces of the dynamic cube maps to re-capture each frame. Every face is
+// clean or dirty; changes dirty only the faces that can see them, and each frame at most
+// a budget of dirty faces is handed out, most urgent first. Urgency grows with the time
+// a face has been dirty and falls with its probe's distance to the camera. Has no D3D
+// dependencies so the policy can be driven without a device.
+class CubeFaceScheduler
+{
+public:
+	static const uint32_t FaceCount = 6;
+
+	CubeFaceScheduler();
+	~CubeFaceScheduler();
+
+	// New probes start with every face dirty. Changes further away than range, the far
+	// plane of the capture, are not visible to the probe.
+	uint32_t AddProbe(const DirectX::XMFLOAT3& position, float range);
+	inline uint32_t GetProbeCount() const { return static_cast<uint32_t>(mProbes.size()); }
+	inline const DirectX::XMFLOAT3& GetProbePosition(uint32_t probe) const { return mProbes[probe].Position; }
+
+	// Moving a probe dirties all its faces. Setting the current position does nothing.
+	void SetProbePosition(uint32_t probe, const DirectX::XMFLOAT3& position);
+
+	// For changes seen everywhere, such as lighting.
+	void InvalidateAll();
+	void InvalidateProbe(uint32_t probe);
+
+	// Dirties the faces that can see any part of a world space box. A moved object
+	// should pass both its old and its new bounds.
+	void InvalidateBounds(const DirectX::BoundingBox& box);
+
+	// Distance, in world units, that one frame of staleness is worth when ranking faces.
+	inline void SetStalenessWeight(float weight) { mStalenessWeight = weight; }
+
+	// Hands out up to maxFaces dirty faces, most urgent first, and marks them clean.
+	// Each call is one frame for the staleness count.
+	void Schedule(const DirectX::XMFLOAT3& cameraPos, uint32_t maxFaces, std::vector<CubeFaceUpdate>& faces);
+
+	inline bool IsFaceDirty(uint32_t probe, uint32_t face) const { return mProbes[probe].isDirty[face]; }
+	uint32_t GetDirtyFaceCount() const;
+
+	// True if the 90 degree frustum of face, looking out from position, overlaps box.
+	static bool FaceSeesBox(const DirectX::XMFLOAT3& position, uint32_t face, const DirectX::BoundingBox& box);
+
+private:
+	struct Probe
+	{
+		DirectX::XMFLOAT3 Position;
+		float Range;
+		bool isDirty[FaceCount];
+		uint32_t DirtyFrame[FaceCount];
+	};
+
+	struct Candidate
+	{
+		CubeFaceUpdate Face;
+		float Priority;
+	};
+
+	void MarkDirty(Probe& probe, uint32_t face);
+
+private:
+	std::vector<Probe> mProbes;
+	std::vector<Candidate> mCandidates;
+	uint32_t mFrame;
+	float mStalenessWeight;
+};
+
+#endif // CUBEFACESCHEDULER_H
\ No newline at end of file
@@ -1,21 +1,31 @@
 #include "D3DUtil.h"
 
-void CreateVertexShader(ID3D11Device* device, ID3D11VertexShader** shader, ID3DBlob** bytecode, LPCWSTR filename, LPCSTR entryPoint)
+void CreateVertexShader(ID3D11Device* device, ID3D11VertexShader** shader, ID3DBlob** bytecode, LPCWSTR filename, LPCSTR entryPoint, const D3D_SHADER_MACRO* defines)
 {
-	HR(D3DCompileFromFile(filename, 0, D3D_COMPILE_STANDARD_FILE_INCLUDE, entryPoint, "vs_5_0", D3DCOMPILE_DEBUG, 0, bytecode, 0));
+	HR(D3DCompileFromFile(filename, defines, D3D_COMPILE_STANDARD_FILE_INCLUDE, entryPoint, "vs_5_0", D3DCOMPILE_DEBUG, 0, bytecode, 0));
 	HR(device->CreateVertexShader((*bytecode)->GetBufferPointer(), (*bytecode)->GetBufferSize(), NULL, shader));
 }
 
-void CreatePixelShader(ID3D11Device* device, ID3D11PixelShader** shader, LPCWSTR filename, LPCSTR entryPoint)
+void CreatePixelShader(ID3D11Device* device, ID3D11PixelShader** shader, LPCWSTR filename, LPCSTR entryPoint, const D3D_SHADER_MACRO* defines)
 {
 	ID3DBlob* PSByteCode = 0;
-	HR(D3DCompileFromFile(filename, 0, D3D_COMPILE_STANDARD_FILE_INCLUDE, entryPoint, "ps_5_0", D3DCOMPILE_DEBUG, 0, &PSByteCode, 0));
+	HR(D3DCompileFromFile(filename, defines, D3D_COMPILE_STANDARD_FILE_INCLUDE, entryPoint, "ps_5_0", D3DCOMPILE_DEBUG, 0, &PSByteCode, 0));
 
 	HR(device->CreatePixelShader(PSByteCode->GetBufferPointer(), PSByteCode->GetBufferSize(), NULL, shader));
 
 	PSByteCode->Release();
 }
 
+void CreateComputeShader(ID3D11Device* device, ID3D11ComputeShader** shader, LPCWSTR filename, LPCSTR entryPoint, const D3D_SHADER_MACRO* defines)
+{
+	ID3DBlob* CSByteCode = 0;
+	HR(D3DCompileFromFile(filename, defines, D3D_COMPILE_STANDARD_FILE_INCLUDE, entryPoint, "cs_5_0", D3DCOMPILE_DEBUG, 0, &CSByteCode, 0));
+
+	HR(device->CreateComputeShader(CSByteCode->GetBufferPointer(), CSByteCode->GetBufferSize(), NULL, shader));
+
+	CSByteCode->Release();
+}
+
 void LoadTextureToSRV(ID3D11Device* device, ID3D11ShaderResourceView** SRV, LPCWSTR filename)
 {
 	ID3D11Resource* texResource = nullptr;
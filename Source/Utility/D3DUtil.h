@@ -54,10 +54,11 @@ namespace Colors
 }
 
 void CreateConstantBuffer(ID3D11Device* device, ID3D11Buffer** buffer, UINT size);
-void CreateVertexShader(ID3D11Device* device, ID3D11VertexShader** shader, ID3DBlob** bytecode, LPCWSTR filename, LPCSTR entryPoint);
+void CreateVertexShader(ID3D11Device* device, ID3D11VertexShader** shader, ID3DBlob** bytecode, LPCWSTR filename, LPCSTR entryPoint, const D3D_SHADER_MACRO* defines = nullptr);
 void CreateGeometryShader(ID3D11Device* device, ID3D11GeometryShader** shader, LPCWSTR filename, LPCSTR entryPoint);
 void CreateGeometryShaderStreamOut(ID3D11Device* device, ID3D11GeometryShader** shader, LPCWSTR filename, LPCSTR entryPoint);
-void CreatePixelShader(ID3D11Device* device, ID3D11PixelShader** shader, LPCWSTR filename, LPCSTR entryPoint);
+void CreatePixelShader(ID3D11Device* device, ID3D11PixelShader** shader, LPCWSTR filename, LPCSTR entryPoint, const D3D_SHADER_MACRO* defines = nullptr);
+void CreateComputeShader(ID3D11Device* device, ID3D11ComputeShader** shader, LPCWSTR filename, LPCSTR entryPoint, const D3D_SHADER_MACRO* defines = nullptr);
 void LoadTextureToSRV(ID3D11Device* device, ID3D11ShaderResourceView** srv, LPCWSTR filename);
 
 
@@ -6,24 +6,29 @@
 
 GCube::GCube() : GObject()
 { 
+	// Shared by every cube
+	if (!AcquireMesh(MeshCache::MakeKey("Box", { 1.0f, 1.0f, 1.0f })))
+	{
+		return;
+	}
+
 	GeometryGenerator geoGen;
 	GeometryGenerator::MeshData cube;
 	geoGen.CreateBox(1.0f, 1.0f, 1.0f, cube);
 
-	mVertexCount = cube.Vertices.size();
-	mIndexCount = cube.Indices.size();
+	mMesh->VertexCount = cube.Vertices.size();
+	mMesh->IndexCount = cube.Indices.size();
 
-	mVertices.resize(mVertexCount);
-	for (size_t i = 0; i < mVertexCount; ++i)
+	mMesh->Vertices.resize(mMesh->VertexCount);
+	for (size_t i = 0; i < mMesh->VertexCount; ++i)
 	{
-		mVertices[i].Pos = cube.Vertices[i].Position;
-		mVertices[i].Normal = cube.Vertices[i].Normal;
-		mVertices[i].Tex = cube.Vertices[i].TexC;
-		mVertices[i].TangentU = cube.Vertices[i].TangentU;
+		mMesh->Vertices[i].Pos = cube.Vertices[i].Position;
+		mMesh->Vertices[i].Normal = cube.Vertices[i].Normal;
+		mMesh->Vertices[i].Tex = cube.Vertices[i].TexC;
+		mMesh->Vertices[i].TangentU = cube.Vertices[i].TangentU;
 	}
 
-	mIndices.resize(mIndexCount);
-	mIndices.insert(mIndices.begin(), cube.Indices.begin(), cube.Indices.end());
+	mMesh->Indices.assign(cube.Indices.begin(), cube.Indices.end());
 }
 
 GCube::~GCube()
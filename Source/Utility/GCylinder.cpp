@@ -6,23 +6,49 @@
 
 GCylinder::GCylinder() : GObject()
 { 
+	// Reflection captures see columns from afar, where a six-sided prism does
+	if (AcquireLodMesh(MeshCache::MakeKey("Cylinder", { 0.5f, 0.5f, 3.0f, 6, 1 })))
+	{
+		GeometryGenerator geoGen;
+		GeometryGenerator::MeshData lod;
+		geoGen.CreateCylinder(0.5f, 0.5f, 3.0f, 6, 1, lod);
+
+		mLodMesh->VertexCount = lod.Vertices.size();
+		mLodMesh->IndexCount = lod.Indices.size();
+
+		mLodMesh->Vertices.resize(mLodMesh->VertexCount);
+		for (size_t i = 0; i < mLodMesh->VertexCount; ++i)
+		{
+			mLodMesh->Vertices[i].Pos = lod.Vertices[i].Position;
+			mLodMesh->Vertices[i].Normal = lod.Vertices[i].Normal;
+			mLodMesh->Vertices[i].Tex = lod.Vertices[i].TexC;
+		}
+
+		mLodMesh->Indices.assign(lod.Indices.begin(), lod.Indices.end());
+	}
+
+	// Shared by every cylinder
+	if (!AcquireMesh(MeshCache::MakeKey("Cylinder", { 0.5f, 0.5f, 3.0f, 15, 15 })))
+	{
+		return;
+	}
+
 	GeometryGenerator geoGen;
 	GeometryGenerator::MeshData cylinder;
 	geoGen.CreateCylinder(0.5f, 0.5f, 3.0f, 15, 15, cylinder);
 
-	mVertexCount = cylinder.Vertices.size();
-	mIndexCount = cylinder.Indices.size();
+	mMesh->VertexCount = cylinder.Vertices.size();
+	mMesh->IndexCount = cylinder.Indices.size();
 
-	mVertices.resize(mVertexCount);
-	for (size_t i = 0; i < mVertexCount; ++i)
+	mMesh->Vertices.resize(mMesh->VertexCount);
+	for (size_t i = 0; i < mMesh->VertexCount; ++i)
 	{
-		mVertices[i].Pos = cylinder.Vertices[i].Position;
-		mVertices[i].Normal = cylinder.Vertices[i].Normal;
-		mVertices[i].Tex = cylinder.Vertices[i].TexC;
+		mMesh->Vertices[i].Pos = cylinder.Vertices[i].Position;
+		mMesh->Vertices[i].Normal = cylinder.Vertices[i].Normal;
+		mMesh->Vertices[i].Tex = cylinder.Vertices[i].TexC;
 	}
 
-	mIndices.resize(mIndexCount);
-	mIndices.insert(mIndices.begin(), cylinder.Indices.begin(), cylinder.Indices.end());
+	mMesh->Indices.assign(cylinder.Indices.begin(), cylinder.Indices.end());
 }
 
 GCylinder::~GCylinder()
@@ -7,8 +7,7 @@
 
 #include "MathHelper.h"
 
-__declspec(align(16))
-class GFirstPersonCamera
+class alignas(16) GFirstPersonCamera
 {
 public:
 	GFirstPersonCamera();
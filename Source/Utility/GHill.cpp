@@ -6,29 +6,34 @@
 
 GHill::GHill() : GObject()
 { 
+	// Shared by every hill
+	if (!AcquireMesh(MeshCache::MakeKey("Hill", { 160.0f, 160.0f, 50, 50 })))
+	{
+		return;
+	}
+
 	GeometryGenerator::MeshData grid;
 
 	GeometryGenerator geoGen;
 
 	geoGen.CreateGrid(160.0f, 160.0f, 50, 50, grid);
 
-	mVertexCount = grid.Vertices.size();
-	mIndexCount = grid.Indices.size();
+	mMesh->VertexCount = grid.Vertices.size();
+	mMesh->IndexCount = grid.Indices.size();
 
-	mVertices.resize(mVertexCount);
-	for (size_t i = 0; i < mVertexCount; ++i)
+	mMesh->Vertices.resize(mMesh->VertexCount);
+	for (size_t i = 0; i < mMesh->VertexCount; ++i)
 	{
 		DirectX::XMFLOAT3 p = grid.Vertices[i].Position;
 
 		p.y = GetHillHeight(p.x, p.z);
 
-		mVertices[i].Pos = p;
-		mVertices[i].Normal = GetHillNormal(p.x, p.z);
-		mVertices[i].Tex = grid.Vertices[i].TexC;
+		mMesh->Vertices[i].Pos = p;
+		mMesh->Vertices[i].Normal = GetHillNormal(p.x, p.z);
+		mMesh->Vertices[i].Tex = grid.Vertices[i].TexC;
 	}
 
-	mIndices.resize(mIndexCount);
-	mIndices.insert(mIndices.begin(), grid.Indices.begin(), grid.Indices.end());
+	mMesh->Indices.assign(grid.Indices.begin(), grid.Indices.end());
 }
 
 GHill::~GHill()
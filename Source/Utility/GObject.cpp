@@ -13,36 +13,68 @@ GObject::GObject()
 
 GObject::GObject(std::string filename, bool bIndexed)
 { 
+	Init();
 	mFilename = filename;
 	isIndexed = bIndexed;
-	isVisible = true;
-	ReadObjFile();
-	Init();
+
+	// Every object loading the same file shares one mesh
+	if (AcquireMesh("File(" + filename + ")"))
+	{
+		ReadObjFile();
+	}
 }
 
 GObject::~GObject()
 {
-	ReleaseCOM(mVertexBuffer);
-	ReleaseCOM(mIndexBuffer);
+	MeshCache::Shared().Release(mMesh);
+	if (mLodMesh) { MeshCache::Shared().Release(mLodMesh); }
 	ReleaseCOM(mDiffuseMapSRV);
 	ReleaseCOM(mNormalMapSRV);
+	TransformStore::Shared().Release(mTransformHandle);
 }
 
 bool GObject::Init()
 {
-	mVertexBuffer = nullptr; 
-	mIndexBuffer = nullptr;
+	mMesh = MeshCache::Shared().Acquire(std::string());
+	mLodMesh = nullptr;
 	mDiffuseMapSRV = nullptr;
 	mNormalMapSRV = nullptr;
-	mTranslation = DirectX::XMMatrixIdentity();
-	mRotation = DirectX::XMMatrixIdentity();
-	mScale = DirectX::XMMatrixIdentity();
-	mPosition = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
-	DirectX::XMStoreFloat4x4(&mWorldTransform, DirectX::XMMatrixIdentity());
+	mTransformHandle = TransformStore::Shared().Create();
+	isIndexed = true;
+	isVisible = true;
+	isReflective = false;
+	isShadowCaster = true;
+	isStatic = false;
+	isOpaque = true;
+	isBatched = false;
+	hasBoundingBox = false;
 	DirectX::XMStoreFloat4x4(&mTexTransform, DirectX::XMMatrixIdentity());
 	return true;
 }
 
+bool GObject::AcquireMesh(const std::string& key)
+{
+	bool isNew = false;
+	Mesh* mesh = MeshCache::Shared().Acquire(key, &isNew);
+
+	MeshCache::Shared().Release(mMesh);
+	mMesh = mesh;
+	hasBoundingBox = false;
+
+	return isNew;
+}
+
+bool GObject::AcquireLodMesh(const std::string& key)
+{
+	bool isNew = false;
+	Mesh* mesh = MeshCache::Shared().Acquire(key, &isNew);
+
+	if (mLodMesh) { MeshCache::Shared().Release(mLodMesh); }
+	mLodMesh = mesh;
+
+	return isNew;
+}
+
 bool GObject::ReadObjFile()
 {
 	DirectX::XMFLOAT3 vMinf3(+MathHelper::Infinity, +MathHelper::Infinity, +MathHelper::Infinity);
@@ -57,17 +89,17 @@ bool GObject::ReadObjFile()
 
 	std::string ignore;
 
-	fin >> ignore >> mVertexCount;
-	fin >> ignore >> mIndexCount;
+	fin >> ignore >> mMesh->VertexCount;
+	fin >> ignore >> mMesh->IndexCount;
 	fin >> ignore >> ignore >> ignore >> ignore;
 
-	mVertices.resize(mVertexCount);
-	for (UINT i = 0; i < mVertexCount; ++i)
+	mMesh->Vertices.resize(mMesh->VertexCount);
+	for (UINT i = 0; i < mMesh->VertexCount; ++i)
 	{
-		fin >> mVertices[i].Pos.x >> mVertices[i].Pos.y >> mVertices[i].Pos.z;
-		fin >> mVertices[i].Normal.x >> mVertices[i].Normal.y >> mVertices[i].Normal.z;
+		fin >> mMesh->Vertices[i].Pos.x >> mMesh->Vertices[i].Pos.y >> mMesh->Vertices[i].Pos.z;
+		fin >> mMesh->Vertices[i].Normal.x >> mMesh->Vertices[i].Normal.y >> mMesh->Vertices[i].Normal.z;
 
-		DirectX::XMVECTOR P = DirectX::XMLoadFloat3(&mVertices[i].Pos);
+		DirectX::XMVECTOR P = DirectX::XMLoadFloat3(&mMesh->Vertices[i].Pos);
 
 		vMin = DirectX::XMVectorMin(vMin, P);
 		vMax = DirectX::XMVectorMax(vMax, P);
@@ -80,12 +112,12 @@ bool GObject::ReadObjFile()
 	fin >> ignore;
 	fin >> ignore;
 
-	mIndices.resize(mIndexCount * 3);
-	for (UINT i = 0; i < mIndexCount; ++i)
+	mMesh->Indices.resize(mMesh->IndexCount * 3);
+	for (UINT i = 0; i < mMesh->IndexCount; ++i)
 	{
-		fin >> mIndices[i * 3 + 0] >> mIndices[i * 3 + 1] >> mIndices[i * 3 + 2];
+		fin >> mMesh->Indices[i * 3 + 0] >> mMesh->Indices[i * 3 + 1] >> mMesh->Indices[i * 3 + 2];
 	}
-	mIndexCount = mIndexCount * 3;
+	mMesh->IndexCount = mMesh->IndexCount * 3;
 
 	fin.close();
 	return true;
@@ -149,35 +181,75 @@ void GObject::SetReflectShadow(DirectX::XMFLOAT4 reflect)
 
 void GObject::Translate(float x, float y, float z)
 {
-	mTranslation = DirectX::XMMatrixTranslation(x, y, z);
-	mPosition = DirectX::XMFLOAT3(x, y, z);
-	UpdateWorldTransform();
+	TransformStore::Shared().SetPosition(mTransformHandle, DirectX::XMFLOAT3(x, y, z));
 }
 
 void GObject::Rotate(float x, float y, float z)
 {
-	mRotation = DirectX::XMMatrixRotationRollPitchYaw(
+	DirectX::XMFLOAT4 rotation;
+	DirectX::XMStoreFloat4(&rotation, DirectX::XMQuaternionRotationRollPitchYaw(
 		DirectX::XMConvertToRadians(x),
-		DirectX::XMConvertToRadians(y), 
-		DirectX::XMConvertToRadians(z));
-	UpdateWorldTransform();
+		DirectX::XMConvertToRadians(y),
+		DirectX::XMConvertToRadians(z)));
+	TransformStore::Shared().SetRotation(mTransformHandle, rotation);
 }
 
 void GObject::Scale(float x, float y, float z)
 {
-	mScale = DirectX::XMMatrixScaling(x, y, z);
-	UpdateWorldTransform();
+	TransformStore::Shared().SetScale(mTransformHandle, DirectX::XMFLOAT3(x, y, z));
+}
+
+const DirectX::XMFLOAT4X4& GObject::GetWorldTransform()
+{
+	return TransformStore::Shared().GetWorld(mTransformHandle);
+}
+
+DirectX::XMFLOAT4X4 GObject::GetInverseWorldTransform()
+{
+	DirectX::XMFLOAT4X4 invWorld;
+	DirectX::XMStoreFloat4x4(&invWorld, TransformStore::Shared().ComputeInverseWorld(mTransformHandle));
+	return invWorld;
+}
+
+bool GObject::SetParent(GObject* parent)
+{
+	TransformHandle parentHandle = parent ? parent->GetTransformHandle() : TransformStore::InvalidHandle;
+	return TransformStore::Shared().SetParent(mTransformHandle, parentHandle);
+}
+
+DirectX::XMFLOAT3 GObject::GetWorldPosition()
+{
+	const DirectX::XMFLOAT4X4& world = GetWorldTransform();
+	return DirectX::XMFLOAT3(world._41, world._42, world._43);
+}
+
+const DirectX::XMFLOAT4X4& GObject::GetNormalTransform()
+{
+	return TransformStore::Shared().GetNormal(mTransformHandle);
+}
+
+DirectX::BoundingBox GObject::GetBoundingBox()
+{
+	// Generated meshes fill their vertices after GObject::Init, so build the box on first use.
+	if (!hasBoundingBox && mMesh->VertexCount > 0)
+	{
+		DirectX::BoundingBox::CreateFromPoints(mAABB, mMesh->VertexCount, &mMesh->Vertices[0].Pos, sizeof(Vertex));
+		hasBoundingBox = true;
+	}
+	return mAABB;
 }
 
-DirectX::XMFLOAT4X4 GObject::GetWorldTransform() 
+UINT64 GObject::GetMeshKey()
 {
-	return mWorldTransform;
+	// Meshes are at least pointer aligned, which leaves the low bit for the draw mode
+	return reinterpret_cast<UINT64>(mMesh) | (isIndexed ? 0 : 1);
 }
 
-void GObject::UpdateWorldTransform()
+DirectX::BoundingBox GObject::GetWorldBoundingBox()
 {
-	DirectX::XMMATRIX SR = XMMatrixMultiply(mScale, mRotation);
-	XMStoreFloat4x4(&mWorldTransform, XMMatrixMultiply(SR, mTranslation));
+	DirectX::BoundingBox worldBox;
+	GetBoundingBox().Transform(worldBox, DirectX::XMLoadFloat4x4(&GetWorldTransform()));
+	return worldBox;
 }
 
 DirectX::XMFLOAT4X4 GObject::GetTexTransform()
@@ -193,8 +265,7 @@ void GObject::SetTextureScaling(float x, float y)
 
 bool GObject::Pick(const DirectX::XMVECTOR& rayOriginV, const DirectX::XMVECTOR& rayDirectionV, const DirectX::XMMATRIX& invView, GTriangle* pickedTri)
 {
-	DirectX::XMMATRIX W = DirectX::XMLoadFloat4x4(&mWorldTransform);
-	DirectX::XMMATRIX invWorld = XMMatrixInverse(&XMMatrixDeterminant(W), W);
+	DirectX::XMMATRIX invWorld = TransformStore::Shared().ComputeInverseWorld(mTransformHandle);
 
 	DirectX::XMMATRIX toLocal = XMMatrixMultiply(invView, invWorld);
 
@@ -213,21 +284,21 @@ bool GObject::Pick(const DirectX::XMVECTOR& rayOriginV, const DirectX::XMVECTOR&
 	// Assume we have not picked anything yet, so init to -1.
 	int mPickedTriangle = -1;
 	float tmin = 0.0f;
-	if (mAABB.Intersects(rayOriginL, rayDirectionL, tmin))
+	if (GetBoundingBox().Intersects(rayOriginL, rayDirectionL, tmin))
 	{
 		// Find the nearest ray/triangle intersection.
 		tmin = MathHelper::Infinity;
-		for (UINT i = 0; i < mIndexCount / 3; ++i)
+		for (UINT i = 0; i < mMesh->IndexCount / 3; ++i)
 		{
 			// Indices for this triangle.
-			UINT i0 = mIndices[i * 3 + 0];
-			UINT i1 = mIndices[i * 3 + 1];
-			UINT i2 = mIndices[i * 3 + 2];
+			UINT i0 = mMesh->Indices[i * 3 + 0];
+			UINT i1 = mMesh->Indices[i * 3 + 1];
+			UINT i2 = mMesh->Indices[i * 3 + 2];
 
 			// Vertices for this triangle.
-			DirectX::XMVECTOR v0 = DirectX::XMLoadFloat3(&mVertices[i0].Pos);
-			DirectX::XMVECTOR v1 = DirectX::XMLoadFloat3(&mVertices[i1].Pos);
-			DirectX::XMVECTOR v2 = DirectX::XMLoadFloat3(&mVertices[i2].Pos);
+			DirectX::XMVECTOR v0 = DirectX::XMLoadFloat3(&mMesh->Vertices[i0].Pos);
+			DirectX::XMVECTOR v1 = DirectX::XMLoadFloat3(&mMesh->Vertices[i1].Pos);
+			DirectX::XMVECTOR v2 = DirectX::XMLoadFloat3(&mMesh->Vertices[i2].Pos);
 
 			// We have to iterate over all the triangles in order to find the nearest intersection.
 			float t = 0.0f;
@@ -244,11 +315,11 @@ bool GObject::Pick(const DirectX::XMVECTOR& rayOriginV, const DirectX::XMVECTOR&
 
 		if (mPickedTriangle != -1)
 		{
-			UINT i0 = mIndices[mPickedTriangle * 3 + 0];
-			UINT i1 = mIndices[mPickedTriangle * 3 + 1];
-			UINT i2 = mIndices[mPickedTriangle * 3 + 2];
+			UINT i0 = mMesh->Indices[mPickedTriangle * 3 + 0];
+			UINT i1 = mMesh->Indices[mPickedTriangle * 3 + 1];
+			UINT i2 = mMesh->Indices[mPickedTriangle * 3 + 2];
 
-			pickedTri->SetVertices(mVertices[i0], mVertices[i1], mVertices[i2]);
+			pickedTri->SetVertices(mMesh->Vertices[i0], mMesh->Vertices[i1], mMesh->Vertices[i2]);
 			return true;
 		}
 	}
@@ -9,6 +9,8 @@
 #include "LightHelper.h"
 #include "Vertex.h"
 #include "DirectXCollision.h"
+#include "TransformStore.h"
+#include "MeshCache.h"
 #include <string>
 #include <vector>
 
@@ -48,18 +50,36 @@ public:
 	void Rotate(float x, float y, float z);
 	void Scale(float x, float y, float z);
 
-	inline UINT GetIndexCount() { return mIndexCount; }
-	inline UINT GetVertexCount() { return mVertexCount; }
+	// Geometry lives in a Mesh from MeshCache::Shared() and may be shared with other
+	// objects, buffers included.
+	inline Mesh* GetMesh() { return mMesh; }
+	inline UINT GetIndexCount() { return mMesh->IndexCount; }
+	inline UINT GetVertexCount() { return mMesh->VertexCount; }
 
-	inline void* GetIndices() { return &mIndices[0]; }
-	inline void* GetVertices() { return &mVertices[0]; }
+	inline void* GetIndices() { return &mMesh->Indices[0]; }
+	inline void* GetVertices() { return &mMesh->Vertices[0]; }
 
-	inline ID3D11Buffer** GetIndexBuffer() { return &mIndexBuffer; }
-	inline ID3D11Buffer** GetVertexBuffer() { return &mVertexBuffer; }
+	inline ID3D11Buffer** GetIndexBuffer() { return &mMesh->IndexBuffer; }
+	inline ID3D11Buffer** GetVertexBuffer() { return &mMesh->VertexBuffer; }
+	inline UINT GetBaseVertex() { return mMesh->BaseVertex; }
+	inline UINT GetStartIndex() { return mMesh->StartIndex; }
+
+	// Coarser, shared stand-in for the mesh, drawn by reflection captures far from the
+	// probe. Null if the object has none.
+	inline Mesh* GetLodMesh() { return mLodMesh; }
 	inline ID3D11ShaderResourceView** GetDiffuseMapSRV() { return &mDiffuseMapSRV; }
 	inline ID3D11ShaderResourceView** GetNormalMapSRV() { return &mNormalMapSRV; }
 
-	DirectX::XMFLOAT4X4 GetWorldTransform();
+	// The transform lives in TransformStore::Shared(). World and normal (inverse-transpose,
+	// no translation) matrices are rebuilt there from position/rotation/scale by
+	// UpdateWorldMatrices, which must run after a change before they are read.
+	const DirectX::XMFLOAT4X4& GetWorldTransform();
+	DirectX::XMFLOAT4X4 GetInverseWorldTransform();
+	const DirectX::XMFLOAT4X4& GetNormalTransform();
+	inline TransformHandle GetTransformHandle() { return mTransformHandle; }
+
+	// Translate/Rotate/Scale become relative to the parent. Pass nullptr to detach.
+	bool SetParent(GObject* parent);
 	DirectX::XMFLOAT4X4 GetTexTransform();
 
 	bool Pick(const DirectX::XMVECTOR& rayOriginV, 
@@ -70,20 +90,58 @@ public:
 	inline bool IsIndexed() { return isIndexed; }
 	inline void SetIndexed(bool bIndexed) { isIndexed = bIndexed; }
 
+	// Takes effect at the next GObjectStore::UpdateVisibility, once per frame.
 	inline void SetVisibility(bool bVisible) { isVisible = bVisible; }
 	inline bool IsVisible() { return isVisible; }
 
-	inline DirectX::XMFLOAT3 GetPosition() { return mPosition; }
+	inline void SetShadowCaster(bool bCaster) { isShadowCaster = bCaster; }
+	inline bool IsShadowCaster() { return isShadowCaster; }
+
+	// Static objects are baked into cached data such as the static shadow map. Moving
+	// one requires GObjectStore::InvalidateStatic, or for the shadow map alone
+	// RenderPassShadow::InvalidateStaticBounds.
+	inline void SetStatic(bool bStatic) { isStatic = bStatic; }
+	inline bool IsStatic() { return isStatic; }
+
+	inline void SetReflective(bool bReflective) { isReflective = bReflective; }
+	inline bool IsReflective() { return isReflective; }
+
+	// Opaque objects are drawn by the regular scene passes (normal/depth, main).
+	inline void SetOpaque(bool bOpaque) { isOpaque = bOpaque; }
+	inline bool IsOpaque() { return isOpaque; }
+
+	// Batched objects have been merged into a GStaticBatch, which draws them instead.
+	// They stay in the store for picking and bounds.
+	inline void SetBatched(bool bBatched) { isBatched = bBatched; }
+	inline bool IsBatched() { return isBatched; }
+
+	// Flags above feed GObjectStore's category lists. Changing them on a stored object
+	// requires GObjectStore::InvalidateCategories.
 
-	inline DirectX::BoundingBox GetBoundingBox() { return mAABB; }
+	inline DirectX::XMFLOAT3 GetPosition() { return TransformStore::Shared().GetPosition(mTransformHandle); }
+	inline DirectX::XMFLOAT4 GetRotation() { return TransformStore::Shared().GetRotation(mTransformHandle); }
+	inline DirectX::XMFLOAT3 GetScale() { return TransformStore::Shared().GetScale(mTransformHandle); }
+	DirectX::XMFLOAT3 GetWorldPosition();
+
+	DirectX::BoundingBox GetBoundingBox();
+	DirectX::BoundingBox GetWorldBoundingBox();
+
+	// Objects with the same key draw the same mesh the same way, so one object's
+	// buffers can draw all of them instanced.
+	UINT64 GetMeshKey();
 
 private:
 	bool ReadObjFile();
-	void UpdateWorldTransform();
 
 protected:
-	ID3D11Buffer* mVertexBuffer;
-	ID3D11Buffer* mIndexBuffer;
+	// Replaces this object's mesh with the one shared under key. Returns true if that
+	// mesh was just created and the caller must fill it.
+	bool AcquireMesh(const std::string& key);
+	bool AcquireLodMesh(const std::string& key);
+
+protected:
+	Mesh* mMesh;
+	Mesh* mLodMesh;
 
 	ID3D11ShaderResourceView* mDiffuseMapSRV;
 	ID3D11ShaderResourceView* mNormalMapSRV;
@@ -91,29 +149,23 @@ protected:
 
 	DirectX::BoundingBox mAABB;
 
-	std::vector<Vertex> mVertices;
-	std::vector<UINT> mIndices;
-
 	std::string mFilename;
 
 	Material mMaterial;
 	Material mShadowMaterial;
 
-	DirectX::XMFLOAT4X4 mWorldTransform;
 	DirectX::XMFLOAT4X4 mTexTransform;
 
-	DirectX::XMMATRIX mTranslation;
-	DirectX::XMMATRIX mRotation;
-	DirectX::XMMATRIX mScale;
-
-	DirectX::XMFLOAT3 mPosition;
-
-	UINT mIndexCount;
-	UINT mVertexCount;
+	TransformHandle mTransformHandle;
 
 	bool isIndexed;
 	bool isVisible;
 	bool isReflective;
+	bool isShadowCaster;
+	bool isStatic;
+	bool isOpaque;
+	bool isBatched;
+	bool hasBoundingBox;
 };
 
 #endif // GOBJECT_H
\ No newline at end of file
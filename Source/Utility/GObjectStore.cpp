@@ -2,6 +2,8 @@
 
 GObjectStore::GObjectStore()
 {
+	mStaticVersion = 1;
+	isCategoryDirty = true;
 }
 
 GObjectStore::~GObjectStore()
@@ -9,12 +11,208 @@ GObjectStore::~GObjectStore()
 
 }
 
-void GObjectStore::AddObject(GObject* obj)
+GObjectHandle GObjectStore::AddObject(GObject* obj)
 {
+	GObjectHandle handle;
+	if (!mFreeHandles.empty())
+	{
+		handle = mFreeHandles.back();
+		mFreeHandles.pop_back();
+	}
+	else
+	{
+		handle = static_cast<GObjectHandle>(mSlots.size());
+		mSlots.push_back(0);
+	}
+
+	mSlots[handle] = static_cast<UINT>(mObjects.size());
 	mObjects.push_back(obj);
+	mHandles.push_back(handle);
+
+	InvalidateStatic();
+	return handle;
+}
+
+void GObjectStore::RemoveObject(GObjectHandle handle)
+{
+	UINT slot = mSlots[handle];
+	UINT last = static_cast<UINT>(mObjects.size()) - 1;
+
+	if (mObjects[slot]->IsStatic())
+	{
+		InvalidateStatic();
+	}
+
+	// Swap the last object into the hole
+	mObjects[slot] = mObjects[last];
+	mHandles[slot] = mHandles[last];
+	mSlots[mHandles[slot]] = slot;
+
+	mObjects.pop_back();
+	mHandles.pop_back();
+
+	mSlots[handle] = InvalidHandle;
+	mFreeHandles.push_back(handle);
+
+	InvalidateCategories();
+}
+
+GObject* GObjectStore::GetObjectByHandle(GObjectHandle handle)
+{
+	if (handle >= mSlots.size() || mSlots[handle] == InvalidHandle) { return nullptr; }
+	return mObjects[mSlots[handle]];
+}
+
+GObjectSpan GObjectStore::GetObjects()
+{
+	return MakeSpan(mObjects);
+}
+
+GObjectSpan GObjectStore::GetOpaque()
+{
+	if (isCategoryDirty) { RebuildCategories(); }
+	return MakeSpan(mOpaque);
+}
+
+GObjectSpan GObjectStore::GetReflective()
+{
+	if (isCategoryDirty) { RebuildCategories(); }
+	return MakeSpan(mReflective);
+}
+
+GObjectSpan GObjectStore::GetCasters()
+{
+	if (isCategoryDirty) { RebuildCategories(); }
+	return MakeSpan(mCasters);
+}
+
+GObjectSpan GObjectStore::GetStaticCasters()
+{
+	if (isCategoryDirty) { RebuildCategories(); }
+	return MakeSpan(mStaticCasters);
+}
+
+GObjectSpan GObjectStore::GetDynamicCasters()
+{
+	if (isCategoryDirty) { RebuildCategories(); }
+	return MakeSpan(mDynamicCasters);
+}
+
+GObjectSpan GObjectStore::GetVisibleOpaque()
+{
+	if (isCategoryDirty) { RebuildCategories(); }
+	return MakeSpan(mVisibleOpaque);
+}
+
+GObjectSpan GObjectStore::GetVisibleReflective()
+{
+	if (isCategoryDirty) { RebuildCategories(); }
+	return MakeSpan(mVisibleReflective);
+}
+
+GObjectSpan GObjectStore::GetVisibleStaticCasters()
+{
+	if (isCategoryDirty) { RebuildCategories(); }
+	return MakeSpan(mVisibleStaticCasters);
+}
+
+GObjectSpan GObjectStore::GetVisibleDynamicCasters()
+{
+	if (isCategoryDirty) { RebuildCategories(); }
+	return MakeSpan(mVisibleDynamicCasters);
+}
+
+void GObjectStore::InvalidateCategories()
+{
+	isCategoryDirty = true;
+}
+
+void GObjectStore::InvalidateStatic()
+{
+	++mStaticVersion;
+
+	// The static flag splits the caster lists
+	InvalidateCategories();
+}
+
+void GObjectStore::UpdateVisibility()
+{
+	// Keep the last visible static casters to compare against
+	mPreviousStaticCasters.swap(mVisibleStaticCasters);
+
+	if (isCategoryDirty) { RebuildCategories(); }
+	else { FilterCategories(); }
+
+	// Showing or hiding a static caster changes the cached static shadow depth
+	if (mVisibleStaticCasters != mPreviousStaticCasters)
+	{
+		++mStaticVersion;
+	}
+}
+
+void GObjectStore::PrepareConcurrentReads()
+{
+	if (isCategoryDirty) { RebuildCategories(); }
+
+	for (auto it = mObjects.begin(); it != mObjects.end(); ++it)
+	{
+		(*it)->GetBoundingBox();
+	}
+}
+
+void GObjectStore::RebuildCategories()
+{
+	mOpaque.clear();
+	mReflective.clear();
+	mCasters.clear();
+	mStaticCasters.clear();
+	mDynamicCasters.clear();
+
+	for (auto it = mObjects.begin(); it != mObjects.end(); ++it)
+	{
+		GObject* obj = *it;
+
+		// Merged objects are drawn by their batch
+		if (obj->IsBatched()) { continue; }
+
+		if (obj->IsOpaque()) { mOpaque.push_back(obj); }
+		if (obj->IsReflective()) { mReflective.push_back(obj); }
+
+		if (obj->IsShadowCaster())
+		{
+			mCasters.push_back(obj);
+			if (obj->IsStatic()) { mStaticCasters.push_back(obj); }
+			else { mDynamicCasters.push_back(obj); }
+		}
+	}
+
+	isCategoryDirty = false;
+
+	// The visible lists would still point at removed objects
+	FilterCategories();
+}
+
+void GObjectStore::FilterCategories()
+{
+	FilterVisible(mOpaque, mVisibleOpaque);
+	FilterVisible(mReflective, mVisibleReflective);
+	FilterVisible(mStaticCasters, mVisibleStaticCasters);
+	FilterVisible(mDynamicCasters, mVisibleDynamicCasters);
+}
+
+void GObjectStore::FilterVisible(const std::vector<GObject*>& objects, std::vector<GObject*>& visible)
+{
+	visible.clear();
+	for (auto it = objects.begin(); it != objects.end(); ++it)
+	{
+		if ((*it)->IsVisible()) { visible.push_back(*it); }
+	}
 }
 
-std::vector<GObject*> GObjectStore::GetObjects()
+GObjectSpan GObjectStore::MakeSpan(const std::vector<GObject*>& objects)
 {
-	return mObjects;
+	GObjectSpan span;
+	span.First = objects.empty() ? nullptr : &objects[0];
+	span.Last = span.First + objects.size();
+	return span;
 }
\ No newline at end of file
@@ -8,17 +8,95 @@
 #include <vector>
 #include "GObject.h"
 
+typedef UINT GObjectHandle;
+
+// Non-owning view over a contiguous run of objects. Invalidated when objects are added
+// or removed, or the categories are rebuilt.
+struct GObjectSpan
+{
+	GObject* const* First;
+	GObject* const* Last;
+
+	inline GObject* const* begin() const { return First; }
+	inline GObject* const* end() const { return Last; }
+	inline UINT size() const { return static_cast<UINT>(Last - First); }
+	inline bool empty() const { return First == Last; }
+	inline GObject* operator[](UINT i) const { return First[i]; }
+};
+
 class GObjectStore
 {
 public:
+	static const GObjectHandle InvalidHandle = 0xffffffff;
+
 	GObjectStore();
 	~GObjectStore();
 
-	void AddObject(GObject* obj);
-	std::vector<GObject*> GetObjects();
+	// Handles stay valid until the object is removed, even as other objects move.
+	GObjectHandle AddObject(GObject* obj);
+	void RemoveObject(GObjectHandle handle);
+	GObject* GetObjectByHandle(GObjectHandle handle);
+
+	GObjectSpan GetObjects();
+
+	// Category lists, rebuilt from the object flags only when they may have changed.
+	GObjectSpan GetOpaque();
+	GObjectSpan GetReflective();
+	GObjectSpan GetCasters();
+	GObjectSpan GetStaticCasters();
+	GObjectSpan GetDynamicCasters();
+
+	// Visible members of the category lists as of the last UpdateVisibility, so passes
+	// iterate them without testing each object.
+	GObjectSpan GetVisibleOpaque();
+	GObjectSpan GetVisibleReflective();
+	GObjectSpan GetVisibleStaticCasters();
+	GObjectSpan GetVisibleDynamicCasters();
+
+	// Call after changing category flags (visibility excluded) of a stored object.
+	void InvalidateCategories();
+
+	// Filters the category lists by visibility. Call once per frame before the passes
+	// read them. A change in the visible static casters bumps the static version.
+	void UpdateVisibility();
+
+	// Bumped whenever static objects may have changed. Caches built from static
+	// objects compare against it to know when to rebuild.
+	void InvalidateStatic();
+	inline UINT GetStaticVersion() { return mStaticVersion; }
+
+	// Builds everything the getters would otherwise build lazily: the category lists
+	// and each object's local bounds. Afterwards the store and its objects can be read
+	// from several threads at once, until the next change.
+	void PrepareConcurrentReads();
+
+private:
+	void RebuildCategories();
+	void FilterCategories();
+	static void FilterVisible(const std::vector<GObject*>& objects, std::vector<GObject*>& visible);
+	static GObjectSpan MakeSpan(const std::vector<GObject*>& objects);
 
 private:
 	std::vector<GObject*> mObjects;
+	UINT mStaticVersion;
+
+	// Handle to slot indirection
+	std::vector<GObjectHandle> mHandles;
+	std::vector<UINT> mSlots;
+	std::vector<GObjectHandle> mFreeHandles;
+
+	std::vector<GObject*> mOpaque;
+	std::vector<GObject*> mReflective;
+	std::vector<GObject*> mCasters;
+	std::vector<GObject*> mStaticCasters;
+	std::vector<GObject*> mDynamicCasters;
+	bool isCategoryDirty;
+
+	std::vector<GObject*> mVisibleOpaque;
+	std::vector<GObject*> mVisibleReflective;
+	std::vector<GObject*> mVisibleStaticCasters;
+	std::vector<GObject*> mVisibleDynamicCasters;
+	std::vector<GObject*> mPreviousStaticCasters;
 };
 
 #endif // G_OBJECTSTORE_H
\ No newline at end of file
@@ -6,23 +6,28 @@ Summary: DX11 Chapter 4
 
 GPlane::GPlane() : GObject()
 {
+	// Shared by every plane
+	if (!AcquireMesh(MeshCache::MakeKey("Grid", { 20.0f, 30.0f, 60, 40 })))
+	{
+		return;
+	}
+
 	GeometryGenerator geoGen;
 	GeometryGenerator::MeshData plane;
 	geoGen.CreateGrid(20.0f, 30.0f, 60, 40, plane);
 
-	mVertexCount = plane.Vertices.size();
-	mIndexCount = plane.Indices.size();
+	mMesh->VertexCount = plane.Vertices.size();
+	mMesh->IndexCount = plane.Indices.size();
 
-	mVertices.resize(mVertexCount);
-	for (size_t i = 0; i < mVertexCount; ++i)
+	mMesh->Vertices.resize(mMesh->VertexCount);
+	for (size_t i = 0; i < mMesh->VertexCount; ++i)
 	{
-		mVertices[i].Pos = plane.Vertices[i].Position;
-		mVertices[i].Normal = plane.Vertices[i].Normal;
-		mVertices[i].Tex = plane.Vertices[i].TexC;
+		mMesh->Vertices[i].Pos = plane.Vertices[i].Position;
+		mMesh->Vertices[i].Normal = plane.Vertices[i].Normal;
+		mMesh->Vertices[i].Tex = plane.Vertices[i].TexC;
 	}
 
-	mIndices.resize(mIndexCount);
-	mIndices.insert(mIndices.begin(), plane.Indices.begin(), plane.Indices.end());
+	mMesh->Indices.assign(plane.Indices.begin(), plane.Indices.end());
 }
 
 GPlane::~GPlane()
@@ -16,9 +16,15 @@ GPlaneXZ::GPlaneXZ(float width, float depth, UINT m, UINT n) : GObject()
 
 void GPlaneXZ::CreatePlane(float width, float depth, UINT m, UINT n)
 {
+	// Shared by every plane with these dimensions
+	if (!AcquireMesh(MeshCache::MakeKey("PlaneXZ", { width, depth, static_cast<float>(m), static_cast<float>(n) })))
+	{
+		return;
+	}
+
 	UINT faceCount = (m - 1) * (n - 1) * 2;
-	mIndexCount = faceCount * 3;
-	mVertexCount = m * n;
+	mMesh->IndexCount = faceCount * 3;
+	mMesh->VertexCount = m * n;
 
 	// Create the vertices.
 	float halfWidth = 0.5f * width;
@@ -30,7 +36,7 @@ void GPlaneXZ::CreatePlane(float width, float depth, UINT m, UINT n)
 	float du = 1.0f / (n - 1);
 	float dv = 1.0f / (m - 1);
 
-	mVertices.resize(mVertexCount);
+	mMesh->Vertices.resize(mMesh->VertexCount);
 	for (UINT i = 0; i < m; ++i)
 	{
 		float z = halfDepth - (i * dz);
@@ -38,31 +44,31 @@ void GPlaneXZ::CreatePlane(float width, float depth, UINT m, UINT n)
 		{
 			float x = (j * dx) - halfWidth;
 
-			mVertices[(i * n) + j].Pos = DirectX::XMFLOAT3(x, 0.0f, z);
-			mVertices[(i * n) + j].Normal = DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
-			mVertices[(i * n) + j].TangentU = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
+			mMesh->Vertices[(i * n) + j].Pos = DirectX::XMFLOAT3(x, 0.0f, z);
+			mMesh->Vertices[(i * n) + j].Normal = DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
+			mMesh->Vertices[(i * n) + j].TangentU = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
 
 			// Stretch texture over grid.
-			mVertices[(i * n) + j].Tex.x = j * du;
-			mVertices[(i * n) + j].Tex.y = i * dv;
+			mMesh->Vertices[(i * n) + j].Tex.x = j * du;
+			mMesh->Vertices[(i * n) + j].Tex.y = i * dv;
 		}
 	}
 
 	// Create the indices.
-	mIndices.resize(mIndexCount); // 3 indices per face
+	mMesh->Indices.resize(mMesh->IndexCount); // 3 indices per face
 
 	UINT k = 0;
 	for (UINT i = 0; i < m - 1; ++i)
 	{
 		for (UINT j = 0; j < n - 1; ++j)
 		{
-			mIndices[k] = i*n + j;
-			mIndices[k + 1] = i*n + j + 1;
-			mIndices[k + 2] = (i + 1)*n + j;
+			mMesh->Indices[k] = i*n + j;
+			mMesh->Indices[k + 1] = i*n + j + 1;
+			mMesh->Indices[k + 2] = (i + 1)*n + j;
 
-			mIndices[k + 3] = (i + 1)*n + j;
-			mIndices[k + 4] = i*n + j + 1;
-			mIndices[k + 5] = (i + 1)*n + j + 1;
+			mMesh->Indices[k + 3] = (i + 1)*n + j;
+			mMesh->Indices[k + 4] = i*n + j + 1;
+			mMesh->Indices[k + 5] = (i + 1)*n + j + 1;
 
 			k += 6; // next quad
 		}
@@ -11,9 +11,15 @@ GPlaneYZ::GPlaneYZ() : GObject()
 
 GPlaneYZ::GPlaneYZ(float height, float depth, UINT m, UINT n) : GObject()
 {
+	// Shared by every plane with these dimensions
+	if (!AcquireMesh(MeshCache::MakeKey("PlaneYZ", { height, depth, static_cast<float>(m), static_cast<float>(n) })))
+	{
+		return;
+	}
+
 	UINT faceCount = (m - 1) * (n - 1) * 2;
-	mIndexCount = faceCount * 3;
-	mVertexCount = m * n;
+	mMesh->IndexCount = faceCount * 3;
+	mMesh->VertexCount = m * n;
 
 	// Create the vertices.
 	float halfHeight = 0.5f * height;
@@ -25,7 +31,7 @@ GPlaneYZ::GPlaneYZ(float height, float depth, UINT m, UINT n) : GObject()
 	float du = 1.0f / (n - 1);
 	float dv = 1.0f / (m - 1);
 
-	mVertices.resize(mVertexCount);
+	mMesh->Vertices.resize(mMesh->VertexCount);
 	for (UINT i = 0; i < m; ++i)
 	{
 		float z = halfDepth - (i * dz);
@@ -33,31 +39,31 @@ GPlaneYZ::GPlaneYZ(float height, float depth, UINT m, UINT n) : GObject()
 		{
 			float y = (j * dx) - halfHeight;
 
-			mVertices[(i * n) + j].Pos = DirectX::XMFLOAT3(0.0f, y, z);
-			mVertices[(i * n) + j].Normal = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
-			//			mVertices[(i * n) + j].TangentU = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
+			mMesh->Vertices[(i * n) + j].Pos = DirectX::XMFLOAT3(0.0f, y, z);
+			mMesh->Vertices[(i * n) + j].Normal = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
+			//			mMesh->Vertices[(i * n) + j].TangentU = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
 
 			// Stretch texture over grid.
-			mVertices[(i * n) + j].Tex.x = j * du;
-			mVertices[(i * n) + j].Tex.y = i * dv;
+			mMesh->Vertices[(i * n) + j].Tex.x = j * du;
+			mMesh->Vertices[(i * n) + j].Tex.y = i * dv;
 		}
 	}
 
 	// Create the indices.
-	mIndices.resize(mIndexCount); // 3 indices per face
+	mMesh->Indices.resize(mMesh->IndexCount); // 3 indices per face
 
 	UINT k = 0;
 	for (UINT i = 0; i < m - 1; ++i)
 	{
 		for (UINT j = 0; j < n - 1; ++j)
 		{
-			mIndices[k] = i*n + j;
-			mIndices[k + 1] = i*n + j + 1;
-			mIndices[k + 2] = (i + 1)*n + j;
+			mMesh->Indices[k] = i*n + j;
+			mMesh->Indices[k + 1] = i*n + j + 1;
+			mMesh->Indices[k + 2] = (i + 1)*n + j;
 
-			mIndices[k + 3] = (i + 1)*n + j;
-			mIndices[k + 4] = i*n + j + 1;
-			mIndices[k + 5] = (i + 1)*n + j + 1;
+			mMesh->Indices[k + 3] = (i + 1)*n + j;
+			mMesh->Indices[k + 4] = i*n + j + 1;
+			mMesh->Indices[k + 5] = (i + 1)*n + j + 1;
 
 			k += 6; // next quad
 		}
@@ -6,27 +6,35 @@
 
 GSky::GSky(float skySphereRadius) : GObject()
 { 
-	GeometryGenerator::MeshData sphere;
-	GeometryGenerator geoGen;
-	geoGen.CreateSphere(skySphereRadius, 30, 30, sphere);
+	// Positions only, so it does not share the regular sphere's mesh
+	if (AcquireMesh(MeshCache::MakeKey("Sky", { skySphereRadius, 30, 30 })))
+	{
+		GeometryGenerator::MeshData sphere;
+		GeometryGenerator geoGen;
+		geoGen.CreateSphere(skySphereRadius, 30, 30, sphere);
 
-	mVertexCount = sphere.Vertices.size();
-	mIndexCount = sphere.Indices.size();
+		mMesh->VertexCount = sphere.Vertices.size();
+		mMesh->IndexCount = sphere.Indices.size();
 
-	mVertices.resize(mVertexCount);
+		mMesh->Vertices.resize(mMesh->VertexCount);
 
-	for (size_t i = 0; i < mVertexCount; ++i)
-	{
-		mVertices[i].Pos = sphere.Vertices[i].Position;
+		for (size_t i = 0; i < mMesh->VertexCount; ++i)
+		{
+			mMesh->Vertices[i].Pos = sphere.Vertices[i].Position;
+		}
+
+		mMesh->Indices.assign(sphere.Indices.begin(), sphere.Indices.end());
 	}
 
-	mIndices.resize(mIndexCount);
-	mIndices.insert(mIndices.begin(), sphere.Indices.begin(), sphere.Indices.end());
+	// The sky surrounds the whole scene and must never occlude the light. It is drawn
+	// last with its own states rather than by the opaque scene passes.
+	isShadowCaster = false;
+	isOpaque = false;
 }
 
 void GSky::SetEyePos(float x, float y, float z)
 {
-	DirectX::XMStoreFloat4x4(&mWorldTransform, DirectX::XMMatrixTranslation(x, y, z));
+	Translate(x, y, z);
 }
 
 // TODO: OVERRIDE TRANSFORMATION FUNCTIONS TO HAVE NO MEANING FOR GSKY
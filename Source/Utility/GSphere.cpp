@@ -6,23 +6,49 @@
 
 GSphere::GSphere() : GObject()
 { 
+	// Reflection captures see spheres from afar, where a few facets do
+	if (AcquireLodMesh(MeshCache::MakeKey("Sphere", { 0.5f, 8, 6 })))
+	{
+		GeometryGenerator geoGen;
+		GeometryGenerator::MeshData lod;
+		geoGen.CreateSphere(0.5f, 8, 6, lod);
+
+		mLodMesh->VertexCount = lod.Vertices.size();
+		mLodMesh->IndexCount = lod.Indices.size();
+
+		mLodMesh->Vertices.resize(mLodMesh->VertexCount);
+		for (size_t i = 0; i < mLodMesh->VertexCount; ++i)
+		{
+			mLodMesh->Vertices[i].Pos = lod.Vertices[i].Position;
+			mLodMesh->Vertices[i].Normal = lod.Vertices[i].Normal;
+			mLodMesh->Vertices[i].Tex = lod.Vertices[i].TexC;
+		}
+
+		mLodMesh->Indices.assign(lod.Indices.begin(), lod.Indices.end());
+	}
+
+	// Shared by every sphere
+	if (!AcquireMesh(MeshCache::MakeKey("Sphere", { 0.5f, 20, 20 })))
+	{
+		return;
+	}
+
 	GeometryGenerator geoGen;
 	GeometryGenerator::MeshData sphere;
 	geoGen.CreateSphere(0.5f, 20, 20, sphere);
 
-	mVertexCount = sphere.Vertices.size();
-	mIndexCount = sphere.Indices.size();
+	mMesh->VertexCount = sphere.Vertices.size();
+	mMesh->IndexCount = sphere.Indices.size();
 
-	mVertices.resize(mVertexCount);
-	for (size_t i = 0; i < mVertexCount; ++i)
+	mMesh->Vertices.resize(mMesh->VertexCount);
+	for (size_t i = 0; i < mMesh->VertexCount; ++i)
 	{
-		mVertices[i].Pos = sphere.Vertices[i].Position;
-		mVertices[i].Normal = sphere.Vertices[i].Normal;
-		mVertices[i].Tex = sphere.Vertices[i].TexC;
+		mMesh->Vertices[i].Pos = sphere.Vertices[i].Position;
+		mMesh->Vertices[i].Normal = sphere.Vertices[i].Normal;
+		mMesh->Vertices[i].Tex = sphere.Vertices[i].TexC;
 	}
 
-	mIndices.resize(mIndexCount);
-	mIndices.insert(mIndices.begin(), sphere.Indices.begin(), sphere.Indices.end());
+	mMesh->Indices.assign(sphere.Indices.begin(), sphere.Indices.end());
 }
 
 GSphere::~GSphere()
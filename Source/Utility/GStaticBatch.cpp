@@ -0,0 +1,163 @@
+/*  =======================
+	Summary: Merged static geometry
+	=======================  */
+
+#include "GStaticBatch.h"
+#include "D3DUtil.h"
+
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+GStaticBatch::GStaticBatch() : GObject()
+{
+	mMesh->VertexCount = 0;
+	mMesh->IndexCount = 0;
+
+	SetStatic(true);
+}
+
+GStaticBatch::~GStaticBatch()
+{
+}
+
+bool GStaticBatch::CanAppend(GObject* source, UINT maxVertices)
+{
+	if (mMesh->VertexCount + source->GetVertexCount() > maxVertices)
+	{
+		return false;
+	}
+
+	if (mSources.empty())
+	{
+		return true;
+	}
+
+	GObject* first = mSources[0];
+	Material material = first->GetMaterial();
+	Material sourceMaterial = source->GetMaterial();
+
+	return *first->GetDiffuseMapSRV() == *source->GetDiffuseMapSRV() &&
+		*first->GetNormalMapSRV() == *source->GetNormalMapSRV() &&
+		first->IsShadowCaster() == source->IsShadowCaster() &&
+		memcmp(&material, &sourceMaterial, sizeof(Material)) == 0;
+}
+
+void GStaticBatch::Append(GObject* source)
+{
+	if (mSources.empty())
+	{
+		// The base class releases these, so hold references of our own
+		mDiffuseMapSRV = *source->GetDiffuseMapSRV();
+		mNormalMapSRV = *source->GetNormalMapSRV();
+		if (mDiffuseMapSRV) { mDiffuseMapSRV->AddRef(); }
+		if (mNormalMapSRV) { mNormalMapSRV->AddRef(); }
+
+		SetMaterial(source->GetMaterial());
+		SetShadowMaterial(source->GetShadowMaterial());
+		SetShadowCaster(source->IsShadowCaster());
+	}
+
+	DirectX::XMMATRIX world = DirectX::XMLoadFloat4x4(&source->GetWorldTransform());
+	DirectX::XMMATRIX normal = DirectX::XMLoadFloat4x4(&source->GetNormalTransform());
+	DirectX::XMFLOAT4X4 texTransformF = source->GetTexTransform();
+	DirectX::XMMATRIX texTransform = DirectX::XMLoadFloat4x4(&texTransformF);
+
+	Mesh* sourceMesh = source->GetMesh();
+	UINT baseVertex = mMesh->VertexCount;
+
+	mMesh->Vertices.resize(baseVertex + sourceMesh->VertexCount);
+	for (UINT i = 0; i < sourceMesh->VertexCount; ++i)
+	{
+		const Vertex& in = sourceMesh->Vertices[i];
+		Vertex& out = mMesh->Vertices[baseVertex + i];
+
+		DirectX::XMStoreFloat3(&out.Pos, DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&in.Pos), world));
+		DirectX::XMStoreFloat3(&out.Normal, DirectX::XMVector3Normalize(DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&in.Normal), normal)));
+		DirectX::XMStoreFloat3(&out.TangentU, DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&in.TangentU), world));
+
+		DirectX::XMVECTOR tex = DirectX::XMVectorSet(in.Tex.x, in.Tex.y, 0.0f, 1.0f);
+		DirectX::XMStoreFloat2(&out.Tex, DirectX::XMVector4Transform(tex, texTransform));
+	}
+
+	// The batch is always indexed; non-indexed sources get a trivial index list
+	if (source->IsIndexed())
+	{
+		for (UINT i = 0; i < sourceMesh->IndexCount; ++i)
+		{
+			mMesh->Indices.push_back(baseVertex + sourceMesh->Indices[i]);
+		}
+	}
+	else
+	{
+		for (UINT i = 0; i < sourceMesh->VertexCount; ++i)
+		{
+			mMesh->Indices.push_back(baseVertex + i);
+		}
+	}
+
+	mMesh->VertexCount = static_cast<UINT>(mMesh->Vertices.size());
+	mMesh->IndexCount = static_cast<UINT>(mMesh->Indices.size());
+	hasBoundingBox = false;
+
+	mSources.push_back(source);
+}
+
+void GStaticBatch::Build(const std::vector<GObject*>& sources, float cellSize, UINT maxVertices, std::vector<GStaticBatch*>& batches)
+{
+	// Candidate batches per cell; a source joins the first one it fits
+	typedef std::tuple<int, int> Cell;
+	std::map<Cell, std::vector<GStaticBatch*> > cells;
+
+	for (UINT i = 0; i < sources.size(); ++i)
+	{
+		GObject* source = sources[i];
+		if (source->GetVertexCount() == 0 || source->GetVertexCount() > maxVertices)
+		{
+			continue;
+		}
+
+		DirectX::XMFLOAT3 position = source->GetWorldPosition();
+		Cell cell(static_cast<int>(floorf(position.x / cellSize)), static_cast<int>(floorf(position.z / cellSize)));
+		std::vector<GStaticBatch*>& candidates = cells[cell];
+
+		GStaticBatch* target = nullptr;
+		for (UINT j = 0; j < candidates.size() && !target; ++j)
+		{
+			if (candidates[j]->CanAppend(source, maxVertices)) { target = candidates[j]; }
+		}
+
+		if (!target)
+		{
+			target = new GStaticBatch();
+			candidates.push_back(target);
+
+			// Its own transform just joined the store, which has to be brought up to date
+			// before the next source's world matrix can be read
+			TransformStore::Shared().UpdateWorldMatrices();
+		}
+
+		target->Append(source);
+	}
+
+	// A batch of one saves nothing, so leave those sources drawing themselves
+	for (auto it = cells.begin(); it != cells.end(); ++it)
+	{
+		for (UINT j = 0; j < it->second.size(); ++j)
+		{
+			GStaticBatch* batch = it->second[j];
+			if (batch->GetSourceCount() < 2)
+			{
+				delete batch;
+				continue;
+			}
+
+			for (UINT k = 0; k < batch->mSources.size(); ++k)
+			{
+				batch->mSources[k]->SetBatched(true);
+			}
+			batches.push_back(batch);
+		}
+	}
+}
@@ -0,0 +1,40 @@
+/*  =======================
+	Summary: Merged static geometry
+	=======================  */
+
+#ifndef GSTATICBATCH_H
+#define GSTATICBATCH_H
+
+#include "GObject.h"
+
+// Static objects sharing textures and material, baked into one mesh in world space so
+// they draw with a single call. The batch has an identity transform and takes the
+// textures and material of its first source. Sources are marked batched and stay in
+// the store for picking, but no longer draw themselves.
+__declspec(align(16))
+class GStaticBatch : public GObject
+{
+public:
+	GStaticBatch();
+	~GStaticBatch();
+
+	void* operator new(size_t i) { return _mm_malloc(i,16);	}
+	void operator delete(void* p) { _mm_free(p); }
+
+	// True if source draws the same way as this batch and leaves room under maxVertices.
+	bool CanAppend(GObject* source, UINT maxVertices);
+
+	// Bakes source's mesh into the batch with its world and texture transforms applied.
+	void Append(GObject* source);
+
+	inline UINT GetSourceCount() { return static_cast<UINT>(mSources.size()); }
+
+	// Groups compatible sources by grid cell on the XZ plane, so batches stay small enough
+	// to cull, and merges every group of two or more. Merged sources are marked batched.
+	static void Build(const std::vector<GObject*>& sources, float cellSize, UINT maxVertices, std::vector<GStaticBatch*>& batches);
+
+private:
+	std::vector<GObject*> mSources;
+};
+
+#endif // GSTATICBATCH_H
\ No newline at end of file
@@ -6,8 +6,8 @@
 
 GTriangle::GTriangle() : GObject()
 {
-	mIndexCount = 0;
-	mIndices.resize(0);
+	mMesh->IndexCount = 0;
+	mMesh->Indices.resize(0);
 
 	Vertex v0, v1, v2;
 	v0.Pos = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
@@ -22,25 +22,25 @@ GTriangle::GTriangle() : GObject()
 	v2.Normal = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
 	v2.Tex = DirectX::XMFLOAT2(0.0f, 0.0f);
 
-	mVertexCount = 3;
-	mVertices.resize(3);
+	mMesh->VertexCount = 3;
+	mMesh->Vertices.resize(3);
 
-	mVertices[0] = v0;
-	mVertices[1] = v1;
-	mVertices[2] = v2;
+	mMesh->Vertices[0] = v0;
+	mMesh->Vertices[1] = v1;
+	mMesh->Vertices[2] = v2;
 }
 
 GTriangle::GTriangle(Vertex v0, Vertex v1, Vertex v2) : GObject()
 {
-	mIndexCount = 0;
-	mVertexCount = 3;
+	mMesh->IndexCount = 0;
+	mMesh->VertexCount = 3;
 
-	mIndices.resize(0);
-	mVertices.resize(3);
+	mMesh->Indices.resize(0);
+	mMesh->Vertices.resize(3);
 
-	mVertices[0] = v0;
-	mVertices[1] = v1;
-	mVertices[2] = v2;
+	mMesh->Vertices[0] = v0;
+	mMesh->Vertices[1] = v1;
+	mMesh->Vertices[2] = v2;
 }
 
 GTriangle::~GTriangle()
@@ -49,10 +49,10 @@ GTriangle::~GTriangle()
 
 void GTriangle::SetVertices(Vertex v0, Vertex v1, Vertex v2)
 {
-	mVertices.resize(3);
-	mVertices[0] = v0;
-	mVertices[1] = v1;
-	mVertices[2] = v2;
+	mMesh->Vertices.resize(3);
+	mMesh->Vertices[0] = v0;
+	mMesh->Vertices[1] = v1;
+	mMesh->Vertices[2] = v2;
 }
 
 void GTriangle::Update(void* data)
@@ -60,6 +60,6 @@ void GTriangle::Update(void* data)
 	Vertex* v = reinterpret_cast<Vertex*>(data);
 	for (UINT i = 0; i < 3; ++i)
 	{
-		v[i] = mVertices[i];
+		v[i] = mMesh->Vertices[i];
 	}
 }
\ No newline at end of file
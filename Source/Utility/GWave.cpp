@@ -8,11 +8,11 @@ GWave::GWave() : GObject()
 { 
 	mWaves.Init(160, 160, 1.0f, 0.03f, 5.0f, 0.3f);
 
-	mVertexCount = mWaves.VertexCount();
-	mIndexCount = mWaves.TriangleCount() * 3;
+	mMesh->VertexCount = mWaves.VertexCount();
+	mMesh->IndexCount = mWaves.TriangleCount() * 3;
 
-	mVertices.resize(mVertexCount);
-	mIndices.resize(mIndexCount);
+	mMesh->Vertices.resize(mMesh->VertexCount);
+	mMesh->Indices.resize(mMesh->IndexCount);
 	UINT m = mWaves.RowCount();
 	UINT n = mWaves.ColumnCount();
 	int k = 0;
@@ -20,13 +20,13 @@ GWave::GWave() : GObject()
 	{
 		for (DWORD j = 0; j < n - 1; ++j)
 		{
-			mIndices[k] = i*n + j;
-			mIndices[k + 1] = i*n + j + 1;
-			mIndices[k + 2] = (i + 1)*n + j;
+			mMesh->Indices[k] = i*n + j;
+			mMesh->Indices[k + 1] = i*n + j + 1;
+			mMesh->Indices[k + 2] = (i + 1)*n + j;
 
-			mIndices[k + 3] = (i + 1)*n + j;
-			mIndices[k + 4] = i*n + j + 1;
-			mIndices[k + 5] = (i + 1)*n + j + 1;
+			mMesh->Indices[k + 3] = (i + 1)*n + j;
+			mMesh->Indices[k + 4] = i*n + j + 1;
+			mMesh->Indices[k + 5] = (i + 1)*n + j + 1;
 
 			k += 6; // next quad
 		}
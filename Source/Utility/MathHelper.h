@@ -7,7 +7,7 @@
 #ifndef MATHHELPER_H
 #define MATHHELPER_H
 
-#include <Windows.h>
+#include <cstdlib>
 #include <DirectXMath.h>
 #include <DirectXPackedVector.h>
 
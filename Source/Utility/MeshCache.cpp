@@ -0,0 +1,122 @@
+/*  =======================
+	Summary: Shared mesh registry
+	=======================  */
+
+#include "MeshCache.h"
+#include "D3DUtil.h"
+
+#include <cstdio>
+
+MeshCache::MeshCache()
+{
+	mMeshCount = 0;
+	mAcquireCount = 0;
+	mBuildCount = 0;
+}
+
+MeshCache::~MeshCache()
+{
+	// Anything still registered outlived its objects, and maybe its storage; only
+	// drop the buffer references
+	for (auto it = mMeshes.begin(); it != mMeshes.end(); ++it)
+	{
+		ReleaseCOM(it->second->VertexBuffer);
+		ReleaseCOM(it->second->IndexBuffer);
+		delete it->second;
+	}
+}
+
+MeshCache& MeshCache::Shared()
+{
+	static MeshCache cache;
+	return cache;
+}
+
+Mesh* MeshCache::Acquire(const std::string& key, bool* isNew)
+{
+	++mAcquireCount;
+
+	if (!key.empty())
+	{
+		auto it = mMeshes.find(key);
+		if (it != mMeshes.end())
+		{
+			++it->second->RefCount;
+			if (isNew) { *isNew = false; }
+			return it->second;
+		}
+	}
+
+	Mesh* mesh = new Mesh();
+	mesh->VertexCount = 0;
+	mesh->IndexCount = 0;
+	mesh->VertexBuffer = nullptr;
+	mesh->IndexBuffer = nullptr;
+	mesh->BaseVertex = 0;
+	mesh->StartIndex = 0;
+	mesh->Storage = nullptr;
+	mesh->Key = key;
+	mesh->RefCount = 1;
+
+	if (!key.empty())
+	{
+		mMeshes[key] = mesh;
+	}
+
+	++mMeshCount;
+	++mBuildCount;
+
+	if (isNew) { *isNew = true; }
+	return mesh;
+}
+
+void MeshCache::Release(Mesh* mesh)
+{
+	if (!mesh || --mesh->RefCount > 0)
+	{
+		return;
+	}
+
+	if (!mesh->Key.empty())
+	{
+		mMeshes.erase(mesh->Key);
+	}
+
+	if (mesh->Storage)
+	{
+		mesh->Storage->Free(mesh);
+	}
+
+	ReleaseCOM(mesh->VertexBuffer);
+	ReleaseCOM(mesh->IndexBuffer);
+	delete mesh;
+
+	--mMeshCount;
+}
+
+UINT MeshCache::GetSharedBytes() const
+{
+	size_t bytes = 0;
+	for (auto it = mMeshes.begin(); it != mMeshes.end(); ++it)
+	{
+		bytes += it->second->Vertices.size() * sizeof(Vertex) + it->second->Indices.size() * sizeof(UINT);
+	}
+	return static_cast<UINT>(bytes);
+}
+
+std::string MeshCache::MakeKey(const char* generator, std::initializer_list<float> params)
+{
+	std::string key(generator);
+	key += '(';
+
+	char buffer[32];
+	for (auto it = params.begin(); it != params.end(); ++it)
+	{
+		// Nine significant digits round-trip any float, so distinct parameters never share a key
+		sprintf_s(buffer, "%s%.9g", it == params.begin() ? "" : ",", *it);
+		key += buffer;
+	}
+
+	key += ')';
+	return key;
+}
@@ -0,0 +1,97 @@
+/*  =======================
+	Summary: Shared mesh registry
+	=======================  */
+
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include "D3D11.h"
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Vertex.h"
+#include "BufferAllocator.h"
+
+struct Mesh;
+
+// Owner of buffers shared by many meshes. Gets back a mesh's ranges when the mesh is freed.
+class MeshStorage
+{
+public:
+	virtual ~MeshStorage() {}
+
+	virtual void Free(Mesh* mesh) = 0;
+};
+
+// Vertex and index data of one piece of geometry, and the GPU buffers made from it.
+// Every object drawing the geometry references the same Mesh.
+struct Mesh
+{
+	std::vector<Vertex> Vertices;
+	std::vector<UINT> Indices;
+	UINT VertexCount;
+	UINT IndexCount;
+
+	// Either buffers of the mesh's own, or references to shared buffers from Storage.
+	// Draws start at BaseVertex and StartIndex.
+	ID3D11Buffer* VertexBuffer;
+	ID3D11Buffer* IndexBuffer;
+	UINT BaseVertex;
+	UINT StartIndex;
+
+	MeshStorage* Storage;
+	BufferAllocation VertexRange;
+	BufferAllocation IndexRange;
+
+	// Empty for private meshes
+	std::string Key;
+	UINT RefCount;
+};
+
+// Registry of meshes keyed by how they were made: generator name and parameters, or
+// file path. Asking for a key again returns the existing mesh with another reference,
+// so geometry is generated, stored and uploaded once however many objects use it. The
+// last Release frees the mesh and its buffers. Meshes are created during setup on one
+// thread; the cache itself is not synchronised.
+class MeshCache
+{
+public:
+	MeshCache();
+	~MeshCache();
+
+	// Cache used by GObject.
+	static MeshCache& Shared();
+
+	// Returns the mesh registered under key with a new reference. If the call created
+	// it, the mesh is empty and isNew is set; the caller fills it before anything else
+	// acquires the key. An empty key gives a private mesh that is never shared, for
+	// geometry an object changes on its own.
+	Mesh* Acquire(const std::string& key, bool* isNew = nullptr);
+
+	// Drops a reference. The last one frees the mesh and releases its buffers.
+	void Release(Mesh* mesh);
+
+	inline UINT GetMeshCount() const { return mMeshCount; }
+	inline UINT GetSharedMeshCount() const { return static_cast<UINT>(mMeshes.size()); }
+	inline UINT GetAcquireCount() const { return mAcquireCount; }
+	inline UINT GetBuildCount() const { return mBuildCount; }
+
+	// CPU bytes of the vertex and index data of the shared meshes
+	UINT GetSharedBytes() const;
+
+	// Key for generated geometry, e.g. "Sphere(0.5,20,20)".
+	static std::string MakeKey(const char* generator, std::initializer_list<float> params);
+
+private:
+	std::unordered_map<std::string, Mesh*> mMeshes;
+
+	// Live meshes, shared and private
+	UINT mMeshCount;
+
+	UINT mAcquireCount;
+	UINT mBuildCount;
+};
+
+#endif // MESHCACHE_H
\ No newline at end of file
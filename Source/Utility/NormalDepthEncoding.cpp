@@ -0,0 +1,92 @@
+/*  =======================
+	Summary: Compact normal/depth encoding
+	=======================  */
+
+#include "NormalDepthEncoding.h"
+
+#include <cmath>
+
+namespace
+{
+	// Zero is folded to the positive side so the seams map back consistently
+	inline float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+}
+
+DirectX::XMFLOAT2 NormalDepthEncoding::EncodeNormal(const DirectX::XMFLOAT3& normal)
+{
+	float invLength = 1.0f / (fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z));
+
+	float x = normal.x * invLength;
+	float y = normal.y * invLength;
+
+	// The lower hemisphere is folded over the diagonals onto the corners
+	if (normal.z < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+		float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	return DirectX::XMFLOAT2(x, y);
+}
+
+DirectX::XMFLOAT3 NormalDepthEncoding::DecodeNormal(const DirectX::XMFLOAT2& encoded)
+{
+	float x = encoded.x;
+	float y = encoded.y;
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	if (z < 0.0f)
+	{
+		float unfoldedX = (1.0f - fabsf(encoded.y)) * SignNotZero(encoded.x);
+		float unfoldedY = (1.0f - fabsf(encoded.x)) * SignNotZero(encoded.y);
+		x = unfoldedX;
+		y = unfoldedY;
+	}
+
+	float invLength = 1.0f / sqrtf(x * x + y * y + z * z);
+
+	return DirectX::XMFLOAT3(x * invLength, y * invLength, z * invLength);
+}
+
+float NormalDepthEncoding::QuantizeSnorm(float value, uint32_t bits)
+{
+	float scale = static_cast<float>((1u << (bits - 1)) - 1);
+
+	value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+	float stored = floorf(value * scale + 0.5f);
+
+	// Both the lowest and second lowest codes read back as -1
+	float decoded = stored / scale;
+	return decoded < -1.0f ? -1.0f : decoded;
+}
+
+float NormalDepthEncoding::QuantizeUnorm(float value, uint32_t bits)
+{
+	// 24 bits leave no room for the rounding in float, so round in double
+	double scale = static_cast<double>((1u << bits) - 1);
+
+	value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	return static_cast<float>(floor(value * scale + 0.5) / scale);
+}
+
+DirectX::XMFLOAT2 NormalDepthEncoding::GetDepthParams(float nearZ, float farZ)
+{
+	// _33 and _43 of XMMatrixPerspectiveFovLH
+	float range = farZ / (farZ - nearZ);
+	return DirectX::XMFLOAT2(range, -range * nearZ);
+}
+
+float NormalDepthEncoding::HardwareDepthFromView(float viewDepth, const DirectX::XMFLOAT2& depthParams)
+{
+	return depthParams.x + depthParams.y / viewDepth;
+}
+
+float NormalDepthEncoding::ViewDepthFromHardware(float depth, const DirectX::XMFLOAT2& depthParams)
+{
+	return depthParams.y / (depth - depthParams.x);
+}
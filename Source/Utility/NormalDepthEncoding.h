@@ -0,0 +1,36 @@
+/*  =======================
+	Summary: Compact normal/depth encoding
+	=======================  */
+
+#ifndef NORMALDEPTHENCODING_H
+#define NORMALDEPTHENCODING_H
+
+#include <cstdint>
+#include <DirectXMath.h>
+
+// CPU side of the compact SSAO normal/depth target. Unit normals are folded onto an
+// octahedron and stored as two signed values in [-1,1], and view space depth is recovered
+// from the hardware depth buffer instead of being written alongside them. Mirrors
+// NormalDepthEncoding.hlsl. Has no D3D dependencies so it can be driven without a device.
+class NormalDepthEncoding
+{
+public:
+	// Octahedral mapping of a unit vector onto the [-1,1] square
+	static DirectX::XMFLOAT2 EncodeNormal(const DirectX::XMFLOAT3& normal);
+	static DirectX::XMFLOAT3 DecodeNormal(const DirectX::XMFLOAT2& encoded);
+
+	// Rounds a value in [-1,1] as a bits wide SNORM texture channel stores it
+	static float QuantizeSnorm(float value, uint32_t bits);
+
+	// Rounds a value in [0,1] as a bits wide UNORM depth buffer stores it
+	static float QuantizeUnorm(float value, uint32_t bits);
+
+	// Terms of a left handed perspective projection that map view depth to hardware
+	// depth: d = x + y / z.
+	static DirectX::XMFLOAT2 GetDepthParams(float nearZ, float farZ);
+
+	static float HardwareDepthFromView(float viewDepth, const DirectX::XMFLOAT2& depthParams);
+	static float ViewDepthFromHardware(float depth, const DirectX::XMFLOAT2& depthParams);
+};
+
+#endif // NORMALDEPTHENCODING_H
\ No newline at end of file
@@ -0,0 +1,93 @@
+/*  =======================
+	Summary: Reflection probe placement and lookup
+	=======================  */
+
+#include "ReflectionProbeVolume.h"
+
+#include <cfloat>
+#include <cmath>
+
+ReflectionProbeVolume::ReflectionProbeVolume()
+{
+}
+
+ReflectionProbeVolume::~ReflectionProbeVolume()
+{
+}
+
+UINT ReflectionProbeVolume::AddProbe(const DirectX::XMFLOAT3& position, float radius)
+{
+	Probe probe;
+	probe.Position = position;
+	probe.Radius = radius;
+
+	mProbes.push_back(probe);
+	return static_cast<UINT>(mProbes.size()) - 1;
+}
+
+ProbeBlend ReflectionProbeVolume::Lookup(const DirectX::XMFLOAT3& point) const
+{
+	UINT best[2] = { 0, 0 };
+	float influence[2] = { -1.0f, -1.0f };
+
+	UINT nearest = 0;
+	float nearestDistance = FLT_MAX;
+
+	for (UINT i = 0; i < mProbes.size(); ++i)
+	{
+		const Probe& probe = mProbes[i];
+
+		float dx = point.x - probe.Position.x;
+		float dy = point.y - probe.Position.y;
+		float dz = point.z - probe.Position.z;
+		float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+		if (distance < nearestDistance)
+		{
+			nearest = i;
+			nearestDistance = distance;
+		}
+
+		float weight = 1.0f - distance / probe.Radius;
+		if (weight <= 0.0f)
+		{
+			continue;
+		}
+
+		if (weight > influence[0])
+		{
+			best[1] = best[0];
+			influence[1] = influence[0];
+			best[0] = i;
+			influence[0] = weight;
+		}
+		else if (weight > influence[1])
+		{
+			best[1] = i;
+			influence[1] = weight;
+		}
+	}
+
+	ProbeBlend blend;
+
+	if (influence[0] <= 0.0f)
+	{
+		blend.Probe[0] = nearest;
+		blend.Probe[1] = nearest;
+		blend.Weight = 0.0f;
+	}
+	else if (influence[1] <= 0.0f)
+	{
+		blend.Probe[0] = best[0];
+		blend.Probe[1] = best[0];
+		blend.Weight = 0.0f;
+	}
+	else
+	{
+		blend.Probe[0] = best[0];
+		blend.Probe[1] = best[1];
+		blend.Weight = influence[1] / (influence[0] + influence[1]);
+	}
+
+	return blend;
+}
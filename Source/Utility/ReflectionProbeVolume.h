@@ -0,0 +1,48 @@
+/*  =======================
+	Summary: Reflection probe placement and lookup
+	=======================  */
+
+#ifndef REFLECTIONPROBEVOLUME_H
+#define REFLECTIONPROBEVOLUME_H
+
+#include <Windows.h>
+#include <vector>
+#include <DirectXMath.h>
+
+// The probes a point reflects, and how much of the second one to mix in. Points with a
+// single probe in reach use it for both.
+struct ProbeBlend
+{
+	UINT Probe[2];
+	float Weight;
+};
+
+// Reflection probes placed in the world independently of the objects that reflect them.
+// Each probe's influence falls off linearly to zero at its radius; a point blends the
+// two probes with the most influence on it. Has no D3D dependencies.
+class ReflectionProbeVolume
+{
+public:
+	ReflectionProbeVolume();
+	~ReflectionProbeVolume();
+
+	UINT AddProbe(const DirectX::XMFLOAT3& position, float radius);
+
+	inline UINT GetProbeCount() const { return static_cast<UINT>(mProbes.size()); }
+	inline const DirectX::XMFLOAT3& GetProbePosition(UINT probe) const { return mProbes[probe].Position; }
+	inline float GetProbeRadius(UINT probe) const { return mProbes[probe].Radius; }
+
+	// Points outside every probe's radius get the nearest probe alone. Requires at least one probe.
+	ProbeBlend Lookup(const DirectX::XMFLOAT3& point) const;
+
+private:
+	struct Probe
+	{
+		DirectX::XMFLOAT3 Position;
+		float Radius;
+	};
+
+	std::vector<Probe> mProbes;
+};
+
+#endif // REFLECTIONPROBEVOLUME_H
\ No newline at end of file
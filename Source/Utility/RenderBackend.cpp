@@ -0,0 +1,68 @@
+/*  =======================
+	Summary: Command stream backends
+	=======================  */
+
+#include "RenderBackend.h"
+
+NullRenderBackend::NullRenderBackend()
+{
+	ResetStats();
+}
+
+NullRenderBackend::~NullRenderBackend()
+{
+}
+
+void NullRenderBackend::Execute(const CommandBuffer& commands)
+{
+	for (const CmdHeader* cmd = commands.Begin(); cmd != commands.End(); cmd = CommandBuffer::Next(cmd))
+	{
+		++mCommandCount;
+		++mCommandCounts[cmd->Type];
+
+		switch (cmd->Type)
+		{
+		case CMD_DRAW:
+		case CMD_DRAW_INDEXED:
+		case CMD_DRAW_AUTO:
+			++mDrawCount;
+			++mInstanceCount;
+			break;
+		case CMD_DISPATCH:
+			++mDispatchCount;
+			break;
+		case CMD_DRAW_INSTANCED:
+			++mDrawCount;
+			mInstanceCount += reinterpret_cast<const CmdDrawInstanced*>(cmd)->InstanceCount;
+			break;
+		case CMD_DRAW_INDEXED_INSTANCED:
+			++mDrawCount;
+			mInstanceCount += reinterpret_cast<const CmdDrawIndexedInstanced*>(cmd)->InstanceCount;
+			break;
+		case CMD_SET_VERTEX_DATA:
+			mVertexBytes += reinterpret_cast<const CmdSetVertexData*>(cmd)->DataSize;
+			break;
+		case CMD_UPDATE_CONSTANTS:
+			mConstantBytes += reinterpret_cast<const CmdUpdateConstants*>(cmd)->DataSize;
+			break;
+		}
+	}
+
+	mStreamBytes += commands.GetSize();
+}
+
+void NullRenderBackend::ResetStats()
+{
+	mCommandCount = 0;
+	mDrawCount = 0;
+	mDispatchCount = 0;
+	mInstanceCount = 0;
+	mConstantBytes = 0;
+	mVertexBytes = 0;
+	mStreamBytes = 0;
+
+	for (int i = 0; i < CMD_COUNT; ++i)
+	{
+		mCommandCounts[i] = 0;
+	}
+}
@@ -0,0 +1,56 @@
+/*  =======================
+	Summary: Command stream backends
+	=======================  */
+
+#ifndef RENDERBACKEND_H
+#define RENDERBACKEND_H
+
+#include "CommandBuffer.h"
+
+// Consumes a recorded command stream.
+class RenderBackend
+{
+public:
+	RenderBackend() {}
+	virtual ~RenderBackend() {}
+
+	// Called once before the first stream of a frame is executed.
+	virtual void BeginFrame() {}
+
+	virtual void Execute(const CommandBuffer& commands) = 0;
+};
+
+// Walks the stream without touching a device, counting what would have been submitted.
+// Lets the application record its frames without submitting them, which isolates the
+// CPU cost of recording.
+class NullRenderBackend : public RenderBackend
+{
+public:
+	NullRenderBackend();
+	~NullRenderBackend();
+
+	void Execute(const CommandBuffer& commands) override;
+
+	void ResetStats();
+
+	inline uint32_t GetCommandCount() const { return mCommandCount; }
+	inline uint32_t GetCommandCount(CommandType type) const { return mCommandCounts[type]; }
+	inline uint32_t GetDrawCount() const { return mDrawCount; }
+	inline uint32_t GetDispatchCount() const { return mDispatchCount; }
+	inline uint32_t GetInstanceCount() const { return mInstanceCount; }
+	inline uint32_t GetConstantBytes() const { return mConstantBytes; }
+	inline uint32_t GetVertexBytes() const { return mVertexBytes; }
+	inline uint32_t GetStreamBytes() const { return mStreamBytes; }
+
+private:
+	uint32_t mCommandCount;
+	uint32_t mCommandCounts[CMD_COUNT];
+	uint32_t mDrawCount;
+	uint32_t mDispatchCount;
+	uint32_t mInstanceCount;
+	uint32_t mConstantBytes;
+	uint32_t mVertexBytes;
+	uint32_t mStreamBytes;
+};
+
+#endif // RENDERBACKEND_H
\ No newline at end of file
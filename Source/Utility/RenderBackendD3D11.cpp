@@ -0,0 +1,470 @@
+/*  =======================
+	Summary: Direct3D 11 command stream backend
+	=======================  */
+
+#include "RenderBackendD3D11.h"
+
+#include <cstring>
+
+RenderBackendD3D11::RenderBackendD3D11(ID3D11DeviceContext* context)
+	: mConstantRing(1024 * 1024),
+	mVertexRing(1024 * 1024)
+{
+	mContext = context;
+	mContext1 = nullptr;
+	mRingBuffer = nullptr;
+	mRingBufferSize = 0;
+	mVertexRingBuffer = nullptr;
+	mVertexRingBufferSize = 0;
+	mBlockCursor = ConstantRing::InvalidOffset;
+
+	memset(mBoundConstantBuffers, 0, sizeof(mBoundConstantBuffers));
+
+	// Offset binding and no-overwrite maps of constant buffers need a D3D11.1 runtime
+	// and driver support
+	ID3D11Device* device = nullptr;
+	mContext->GetDevice(&device);
+
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	HRESULT hr = device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+	device->Release();
+
+	if (SUCCEEDED(hr) && options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer)
+	{
+		if (FAILED(mContext->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&mContext1))))
+		{
+			mContext1 = nullptr;
+		}
+	}
+
+	if (mContext1)
+	{
+		CreateRingBuffer();
+	}
+
+	CreateVertexRingBuffer();
+}
+
+RenderBackendD3D11::~RenderBackendD3D11()
+{
+	if (mRingBuffer) { mRingBuffer->Release(); }
+	if (mVertexRingBuffer) { mVertexRingBuffer->Release(); }
+	if (mContext1) { mContext1->Release(); }
+}
+
+void RenderBackendD3D11::CreateRingBuffer()
+{
+	if (mRingBuffer)
+	{
+		mRingBuffer->Release();
+		mRingBuffer = nullptr;
+	}
+
+	ID3D11Device* device = nullptr;
+	mContext->GetDevice(&device);
+
+	D3D11_BUFFER_DESC desc;
+	desc.ByteWidth = mConstantRing.GetCapacity();
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+
+	HRESULT hr = device->CreateBuffer(&desc, nullptr, &mRingBuffer);
+	device->Release();
+
+	if (FAILED(hr))
+	{
+		// Fall back to mapping each buffer
+		mRingBuffer = nullptr;
+		mContext1->Release();
+		mContext1 = nullptr;
+		return;
+	}
+
+	mRingBufferSize = desc.ByteWidth;
+}
+
+void RenderBackendD3D11::CreateVertexRingBuffer()
+{
+	if (mVertexRingBuffer)
+	{
+		mVertexRingBuffer->Release();
+		mVertexRingBuffer = nullptr;
+	}
+
+	ID3D11Device* device = nullptr;
+	mContext->GetDevice(&device);
+
+	D3D11_BUFFER_DESC desc;
+	desc.ByteWidth = mVertexRing.GetCapacity();
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+
+	HRESULT hr = device->CreateBuffer(&desc, nullptr, &mVertexRingBuffer);
+	device->Release();
+
+	if (FAILED(hr))
+	{
+		mVertexRingBuffer = nullptr;
+		mVertexRingBufferSize = 0;
+		return;
+	}
+
+	mVertexRingBufferSize = desc.ByteWidth;
+}
+
+void RenderBackendD3D11::BeginFrame()
+{
+	// State may have been set directly on the context between frames, e.g. on resize
+	mStateFilter.Invalidate();
+
+	mVertexRing.BeginFrame();
+
+	if (mVertexRing.GetCapacity() != mVertexRingBufferSize)
+	{
+		CreateVertexRingBuffer();
+	}
+
+	if (!mContext1)
+	{
+		return;
+	}
+
+	mConstantRing.BeginFrame();
+
+	if (mConstantRing.GetCapacity() != mRingBufferSize)
+	{
+		CreateRingBuffer();
+	}
+
+	// The discard at the start of the frame invalidates every offset handed out before
+	mRingSlots.clear();
+}
+
+void RenderBackendD3D11::UploadConstants(const CommandBuffer& commands)
+{
+	mBlockCursor = ConstantRing::InvalidOffset;
+
+	UINT blockSize = 0;
+	for (const CmdHeader* cmd = commands.Begin(); cmd != commands.End(); cmd = CommandBuffer::Next(cmd))
+	{
+		if (cmd->Type == CMD_UPDATE_CONSTANTS)
+		{
+			blockSize += ConstantRing::AlignSize(reinterpret_cast<const CmdUpdateConstants*>(cmd)->DataSize);
+		}
+	}
+
+	if (blockSize == 0)
+	{
+		return;
+	}
+
+	D3D11_MAP mapType = mConstantRing.IsFrameStart() ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+	UINT offset = mConstantRing.Allocate(blockSize);
+	if (offset == ConstantRing::InvalidOffset)
+	{
+		return;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(mContext->Map(mRingBuffer, 0, mapType, 0, &mapped)))
+	{
+		return;
+	}
+
+	UINT8* dest = static_cast<UINT8*>(mapped.pData) + offset;
+	for (const CmdHeader* cmd = commands.Begin(); cmd != commands.End(); cmd = CommandBuffer::Next(cmd))
+	{
+		if (cmd->Type == CMD_UPDATE_CONSTANTS)
+		{
+			const CmdUpdateConstants* c = reinterpret_cast<const CmdUpdateConstants*>(cmd);
+			memcpy(dest, CommandBuffer::GetConstantData(c), c->DataSize);
+			dest += ConstantRing::AlignSize(c->DataSize);
+		}
+	}
+
+	mContext->Unmap(mRingBuffer, 0);
+	mBlockCursor = offset;
+}
+
+void RenderBackendD3D11::UpdateConstants(const CmdUpdateConstants* cmd)
+{
+	if (mBlockCursor != ConstantRing::InvalidOffset)
+	{
+		// Already in the ring; only the window moves
+		RingSlot slot;
+		slot.FirstConstant = mBlockCursor / 16;
+		slot.NumConstants = ConstantRing::AlignSize(cmd->DataSize) / 16;
+		mRingSlots[cmd->Buffer] = slot;
+		mBlockCursor += ConstantRing::AlignSize(cmd->DataSize);
+	}
+	else
+	{
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		HRESULT hr = mContext->Map(cmd->Buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+		if (SUCCEEDED(hr))
+		{
+			memcpy(mapped.pData, CommandBuffer::GetConstantData(cmd), cmd->DataSize);
+			mContext->Unmap(cmd->Buffer, 0);
+		}
+
+		mRingSlots.erase(cmd->Buffer);
+	}
+
+	// Rebind every slot that refers to this buffer so it sees the new contents
+	for (UINT stage = 0; stage < STAGE_COUNT; ++stage)
+	{
+		for (UINT slot = 0; slot < D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT; ++slot)
+		{
+			if (mBoundConstantBuffers[stage][slot] == cmd->Buffer)
+			{
+				BindConstantBuffer(stage, slot, cmd->Buffer);
+			}
+		}
+	}
+}
+
+void RenderBackendD3D11::SetVertexData(const CmdSetVertexData* cmd)
+{
+	ID3D11Buffer* buffer = nullptr;
+	UINT offset = 0;
+
+	if (mVertexRingBuffer && cmd->DataSize <= mVertexRingBufferSize)
+	{
+		D3D11_MAP mapType = mVertexRing.IsFrameStart() ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+		offset = mVertexRing.Allocate(cmd->DataSize);
+		if (offset == ConstantRing::InvalidOffset)
+		{
+			// Out of room until the ring grows next frame; rename the buffer and start
+			// over at the front, leaving earlier draws their copy
+			mapType = D3D11_MAP_WRITE_DISCARD;
+			offset = 0;
+		}
+
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		if (SUCCEEDED(mContext->Map(mVertexRingBuffer, 0, mapType, 0, &mapped)))
+		{
+			memcpy(static_cast<UINT8*>(mapped.pData) + offset, CommandBuffer::GetVertexData(cmd), cmd->DataSize);
+			mContext->Unmap(mVertexRingBuffer, 0);
+			buffer = mVertexRingBuffer;
+		}
+	}
+
+	// Leave the slot empty rather than bound to stale data
+	mContext->IASetVertexBuffers(cmd->Slot, 1, &buffer, &cmd->Stride, &offset);
+}
+
+void RenderBackendD3D11::BindConstantBuffer(UINT stage, UINT slot, ID3D11Buffer* buffer)
+{
+	mBoundConstantBuffers[stage][slot] = buffer;
+
+	auto it = buffer ? mRingSlots.find(buffer) : mRingSlots.end();
+	if (it == mRingSlots.end())
+	{
+		switch (stage)
+		{
+		case STAGE_VS: mContext->VSSetConstantBuffers(slot, 1, &buffer); break;
+		case STAGE_GS: mContext->GSSetConstantBuffers(slot, 1, &buffer); break;
+		case STAGE_PS: mContext->PSSetConstantBuffers(slot, 1, &buffer); break;
+		case STAGE_CS: mContext->CSSetConstantBuffers(slot, 1, &buffer); break;
+		}
+		return;
+	}
+
+	const RingSlot& s = it->second;
+	switch (stage)
+	{
+	case STAGE_VS: mContext1->VSSetConstantBuffers1(slot, 1, &mRingBuffer, &s.FirstConstant, &s.NumConstants); break;
+	case STAGE_GS: mContext1->GSSetConstantBuffers1(slot, 1, &mRingBuffer, &s.FirstConstant, &s.NumConstants); break;
+	case STAGE_PS: mContext1->PSSetConstantBuffers1(slot, 1, &mRingBuffer, &s.FirstConstant, &s.NumConstants); break;
+	case STAGE_CS: mContext1->CSSetConstantBuffers1(slot, 1, &mRingBuffer, &s.FirstConstant, &s.NumConstants); break;
+	}
+}
+
+void RenderBackendD3D11::Execute(const CommandBuffer& recorded)
+{
+	mFiltered.Reset();
+	mStateFilter.Filter(recorded, mFiltered);
+
+	const CommandBuffer& commands = mFiltered;
+
+	if (mContext1)
+	{
+		UploadConstants(commands);
+	}
+
+	for (const CmdHeader* cmd = commands.Begin(); cmd != commands.End(); cmd = CommandBuffer::Next(cmd))
+	{
+		switch (cmd->Type)
+		{
+		case CMD_SET_RENDER_TARGETS:
+		{
+			const CmdSetRenderTargets* c = reinterpret_cast<const CmdSetRenderTargets*>(cmd);
+			mContext->OMSetRenderTargets(c->Count, c->RTVs, c->DSV);
+			break;
+		}
+		case CMD_CLEAR_RENDER_TARGET:
+		{
+			const CmdClearRenderTarget* c = reinterpret_cast<const CmdClearRenderTarget*>(cmd);
+			mContext->ClearRenderTargetView(c->RTV, c->Color);
+			break;
+		}
+		case CMD_CLEAR_DEPTH_STENCIL:
+		{
+			const CmdClearDepthStencil* c = reinterpret_cast<const CmdClearDepthStencil*>(cmd);
+			mContext->ClearDepthStencilView(c->DSV, c->Flags, c->Depth, c->Stencil);
+			break;
+		}
+		case CMD_SET_VIEWPORT:
+		{
+			const CmdSetViewport* c = reinterpret_cast<const CmdSetViewport*>(cmd);
+			D3D11_VIEWPORT vp = { c->TopLeftX, c->TopLeftY, c->Width, c->Height, c->MinDepth, c->MaxDepth };
+			mContext->RSSetViewports(1, &vp);
+			break;
+		}
+		case CMD_SET_INPUT_LAYOUT:
+			mContext->IASetInputLayout(reinterpret_cast<const CmdSetInputLayout*>(cmd)->Layout);
+			break;
+		case CMD_SET_PRIMITIVE_TOPOLOGY:
+			mContext->IASetPrimitiveTopology(static_cast<D3D11_PRIMITIVE_TOPOLOGY>(reinterpret_cast<const CmdSetPrimitiveTopology*>(cmd)->Topology));
+			break;
+		case CMD_SET_VERTEX_BUFFER:
+		{
+			const CmdSetVertexBuffer* c = reinterpret_cast<const CmdSetVertexBuffer*>(cmd);
+			mContext->IASetVertexBuffers(c->Slot, 1, &c->Buffer, &c->Stride, &c->Offset);
+			break;
+		}
+		case CMD_SET_VERTEX_DATA:
+			SetVertexData(reinterpret_cast<const CmdSetVertexData*>(cmd));
+			break;
+		case CMD_SET_INDEX_BUFFER:
+		{
+			const CmdSetIndexBuffer* c = reinterpret_cast<const CmdSetIndexBuffer*>(cmd);
+			mContext->IASetIndexBuffer(c->Buffer, static_cast<DXGI_FORMAT>(c->Format), c->Offset);
+			break;
+		}
+		case CMD_SET_VERTEX_SHADER:
+			mContext->VSSetShader(reinterpret_cast<const CmdSetVertexShader*>(cmd)->Shader, NULL, 0);
+			break;
+		case CMD_SET_GEOMETRY_SHADER:
+			mContext->GSSetShader(reinterpret_cast<const CmdSetGeometryShader*>(cmd)->Shader, NULL, 0);
+			break;
+		case CMD_SET_PIXEL_SHADER:
+			mContext->PSSetShader(reinterpret_cast<const CmdSetPixelShader*>(cmd)->Shader, NULL, 0);
+			break;
+		case CMD_SET_COMPUTE_SHADER:
+			mContext->CSSetShader(reinterpret_cast<const CmdSetComputeShader*>(cmd)->Shader, NULL, 0);
+			break;
+		case CMD_SET_CONSTANT_BUFFERS:
+		{
+			const CmdSetConstantBuffers* c = reinterpret_cast<const CmdSetConstantBuffers*>(cmd);
+			for (UINT i = 0; i < c->Count; ++i)
+			{
+				BindConstantBuffer(c->Stage, c->StartSlot + i, c->Buffers[i]);
+			}
+			break;
+		}
+		case CMD_SET_SHADER_RESOURCES:
+		{
+			const CmdSetShaderResources* c = reinterpret_cast<const CmdSetShaderResources*>(cmd);
+			switch (c->Stage)
+			{
+			case STAGE_VS: mContext->VSSetShaderResources(c->StartSlot, c->Count, c->Views); break;
+			case STAGE_GS: mContext->GSSetShaderResources(c->StartSlot, c->Count, c->Views); break;
+			case STAGE_PS: mContext->PSSetShaderResources(c->StartSlot, c->Count, c->Views); break;
+			case STAGE_CS: mContext->CSSetShaderResources(c->StartSlot, c->Count, c->Views); break;
+			}
+			break;
+		}
+		case CMD_SET_SAMPLERS:
+		{
+			const CmdSetSamplers* c = reinterpret_cast<const CmdSetSamplers*>(cmd);
+			switch (c->Stage)
+			{
+			case STAGE_VS: mContext->VSSetSamplers(c->StartSlot, c->Count, c->Samplers); break;
+			case STAGE_GS: mContext->GSSetSamplers(c->StartSlot, c->Count, c->Samplers); break;
+			case STAGE_PS: mContext->PSSetSamplers(c->StartSlot, c->Count, c->Samplers); break;
+			case STAGE_CS: mContext->CSSetSamplers(c->StartSlot, c->Count, c->Samplers); break;
+			}
+			break;
+		}
+		case CMD_SET_UNORDERED_ACCESS_VIEWS:
+		{
+			const CmdSetUnorderedAccessViews* c = reinterpret_cast<const CmdSetUnorderedAccessViews*>(cmd);
+			mContext->CSSetUnorderedAccessViews(c->StartSlot, c->Count, c->Views, nullptr);
+			break;
+		}
+		case CMD_SET_RASTERIZER_STATE:
+			mContext->RSSetState(reinterpret_cast<const CmdSetRasterizerState*>(cmd)->State);
+			break;
+		case CMD_SET_BLEND_STATE:
+		{
+			const CmdSetBlendState* c = reinterpret_cast<const CmdSetBlendState*>(cmd);
+			mContext->OMSetBlendState(c->State, c->BlendFactor, c->SampleMask);
+			break;
+		}
+		case CMD_SET_DEPTH_STENCIL_STATE:
+		{
+			const CmdSetDepthStencilState* c = reinterpret_cast<const CmdSetDepthStencilState*>(cmd);
+			mContext->OMSetDepthStencilState(c->State, c->StencilRef);
+			break;
+		}
+		case CMD_SET_STREAM_OUT_TARGET:
+		{
+			const CmdSetStreamOutTarget* c = reinterpret_cast<const CmdSetStreamOutTarget*>(cmd);
+			mContext->SOSetTargets(1, &c->Buffer, &c->Offset);
+			break;
+		}
+		case CMD_UPDATE_CONSTANTS:
+			UpdateConstants(reinterpret_cast<const CmdUpdateConstants*>(cmd));
+			break;
+		case CMD_DRAW:
+		{
+			const CmdDraw* c = reinterpret_cast<const CmdDraw*>(cmd);
+			mContext->Draw(c->VertexCount, c->StartVertex);
+			break;
+		}
+		case CMD_DRAW_INDEXED:
+		{
+			const CmdDrawIndexed* c = reinterpret_cast<const CmdDrawIndexed*>(cmd);
+			mContext->DrawIndexed(c->IndexCount, c->StartIndex, c->BaseVertex);
+			break;
+		}
+		case CMD_DRAW_INSTANCED:
+		{
+			const CmdDrawInstanced* c = reinterpret_cast<const CmdDrawInstanced*>(cmd);
+			mContext->DrawInstanced(c->VertexCount, c->InstanceCount, c->StartVertex, c->StartInstance);
+			break;
+		}
+		case CMD_DRAW_INDEXED_INSTANCED:
+		{
+			const CmdDrawIndexedInstanced* c = reinterpret_cast<const CmdDrawIndexedInstanced*>(cmd);
+			mContext->DrawIndexedInstanced(c->IndexCount, c->InstanceCount, c->StartIndex, c->BaseVertex, c->StartInstance);
+			break;
+		}
+		case CMD_DRAW_AUTO:
+			mContext->DrawAuto();
+			break;
+		case CMD_DISPATCH:
+		{
+			const CmdDispatch* c = reinterpret_cast<const CmdDispatch*>(cmd);
+			mContext->Dispatch(c->GroupCountX, c->GroupCountY, c->GroupCountZ);
+			break;
+		}
+		case CMD_COPY_RESOURCE:
+		{
+			const CmdCopyResource* c = reinterpret_cast<const CmdCopyResource*>(cmd);
+			mContext->CopyResource(c->Dest, c->Source);
+			break;
+		}
+		case CMD_GENERATE_MIPS:
+			mContext->GenerateMips(reinterpret_cast<const CmdGenerateMips*>(cmd)->View);
+			break;
+		}
+	}
+}
@@ -0,0 +1,79 @@
+/*  =======================
+	Summary: Direct3D 11 command stream backend
+	=======================  */
+
+#ifndef RENDERBACKEND_D3D11_H
+#define RENDERBACKEND_D3D11_H
+
+#include <d3d11_1.h>
+#include <unordered_map>
+
+#include "RenderBackend.h"
+#include "ConstantRing.h"
+#include "StateFilter.h"
+
+// Replays a command stream on a device context. Streams first pass through a
+// StateFilter, so state the device already has is not set again.
+//
+// Where the device can bind constant buffers at an offset, every constant update in
+// a stream is copied into a ConstantRing block with a single map before replay, and
+// the buffers the stream names are bound as windows into the ring instead. Otherwise
+// each update maps its own buffer with a discard.
+//
+// Vertex data recorded in a stream, such as per instance transforms, goes through a
+// second ring kept in a dynamic vertex buffer. That only needs plain D3D11, so it is
+// always available.
+class RenderBackendD3D11 : public RenderBackend
+{
+public:
+	RenderBackendD3D11(ID3D11DeviceContext* context);
+	~RenderBackendD3D11();
+
+	void BeginFrame() override;
+	void Execute(const CommandBuffer& commands) override;
+
+	inline bool IsConstantRingEnabled() const { return mContext1 != nullptr; }
+	inline const ConstantRing& GetConstantRing() const { return mConstantRing; }
+	inline const ConstantRing& GetVertexRing() const { return mVertexRing; }
+	inline const StateFilter& GetStateFilter() const { return mStateFilter; }
+
+private:
+	// Where a buffer's latest contents live in the ring
+	struct RingSlot
+	{
+		UINT FirstConstant;
+		UINT NumConstants;
+	};
+
+	void CreateRingBuffer();
+	void CreateVertexRingBuffer();
+	void SetVertexData(const CmdSetVertexData* cmd);
+	void UploadConstants(const CommandBuffer& commands);
+	void UpdateConstants(const CmdUpdateConstants* cmd);
+	void BindConstantBuffer(UINT stage, UINT slot, ID3D11Buffer* buffer);
+
+private:
+	ID3D11DeviceContext* mContext;
+	ID3D11DeviceContext1* mContext1;
+
+	StateFilter mStateFilter;
+	CommandBuffer mFiltered;
+
+	ConstantRing mConstantRing;
+	ID3D11Buffer* mRingBuffer;
+	UINT mRingBufferSize;
+
+	// Next ring offset of the stream being replayed, or InvalidOffset if its block
+	// did not fit
+	UINT mBlockCursor;
+
+	// The constant ring's 256 byte blocks also satisfy vertex buffer offset alignment
+	ConstantRing mVertexRing;
+	ID3D11Buffer* mVertexRingBuffer;
+	UINT mVertexRingBufferSize;
+
+	std::unordered_map<ID3D11Buffer*, RingSlot> mRingSlots;
+	ID3D11Buffer* mBoundConstantBuffers[STAGE_COUNT][D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+};
+
+#endif // RENDERBACKEND_D3D11_H
\ No newline at end of file
@@ -0,0 +1,423 @@
+/*  =======================
+	Summary: Frame render graph
+	=======================  */
+
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+RenderGraph::RenderGraph()
+{
+	Reset();
+}
+
+RenderGraph::~RenderGraph()
+{
+}
+
+void RenderGraph::Reset()
+{
+	mResources.clear();
+	mVersions.clear();
+	mPasses.clear();
+	mOutputs.clear();
+	mPublished.clear();
+
+	mOrder.clear();
+	mPhysical.clear();
+	mTransientBytes = 0;
+	mUnaliasedBytes = 0;
+	mUnbindCount = 0;
+}
+
+RGHandle RenderGraph::CreateTexture(const char* name, const RGTextureDesc& desc)
+{
+	Resource r;
+	r.Name = name;
+	r.Desc = desc;
+	r.isImported = false;
+	r.isWritten = false;
+	r.BindFlags = 0;
+	r.FirstUse = InvalidIndex;
+	r.LastUse = InvalidIndex;
+	r.Physical = InvalidIndex;
+	mResources.push_back(r);
+
+	return AddVersion(static_cast<uint32_t>(mResources.size()) - 1, InvalidIndex, InvalidHandle);
+}
+
+RGHandle RenderGraph::ImportTexture(const char* name)
+{
+	RGTextureDesc desc = { 0, 0, 0, 0 };
+	RGHandle handle = CreateTexture(name, desc);
+	mResources.back().isImported = true;
+
+	return handle;
+}
+
+uint32_t RenderGraph::AddPass(const char* name, const RGExecuteFunc& execute)
+{
+	Pass p;
+	p.Name = name;
+	p.Execute = execute;
+	p.isCulled = false;
+	p.isUnbindingTargets = false;
+	mPasses.push_back(p);
+
+	return static_cast<uint32_t>(mPasses.size()) - 1;
+}
+
+void RenderGraph::Read(uint32_t pass, RGHandle handle, ShaderStage stage, uint32_t slot)
+{
+	Access a = { handle, static_cast<uint32_t>(stage), slot, RG_BIND_SHADER_RESOURCE };
+	mPasses[pass].Reads.push_back(a);
+}
+
+RGHandle RenderGraph::Write(uint32_t pass, RGHandle handle, RGBindFlag bind, uint32_t slot)
+{
+	RGHandle written = AddVersion(mVersions[handle].Resource, pass, handle);
+
+	uint32_t stage = bind == RG_BIND_UNORDERED_ACCESS ? STAGE_CS : 0;
+	Access a = { written, stage, slot, static_cast<uint32_t>(bind) };
+	mPasses[pass].Writes.push_back(a);
+
+	return written;
+}
+
+void RenderGraph::MarkOutput(RGHandle handle)
+{
+	mOutputs.push_back(handle);
+}
+
+void RenderGraph::Publish(const char* name, RGHandle handle)
+{
+	mPublished[name] = handle;
+}
+
+RGHandle RenderGraph::Find(const char* name) const
+{
+	auto it = mPublished.find(name);
+	return it != mPublished.end() ? it->second : InvalidHandle;
+}
+
+RGHandle RenderGraph::AddVersion(uint32_t resource, uint32_t writer, RGHandle previous)
+{
+	Version v;
+	v.Resource = resource;
+	v.Writer = writer;
+	v.Previous = previous;
+	mVersions.push_back(v);
+
+	return static_cast<RGHandle>(mVersions.size()) - 1;
+}
+
+bool RenderGraph::Compile()
+{
+	mOrder.clear();
+	mPhysical.clear();
+	mTransientBytes = 0;
+	mUnaliasedBytes = 0;
+	mUnbindCount = 0;
+
+	CullPasses();
+
+	if (!SortPasses())
+	{
+		mOrder.clear();
+		return false;
+	}
+
+	AssignPhysicalTextures();
+	PlanUnbinds();
+
+	return true;
+}
+
+void RenderGraph::CullPasses()
+{
+	for (auto it = mPasses.begin(); it != mPasses.end(); ++it)
+	{
+		it->isCulled = true;
+	}
+
+	// Walk back from the outputs through every version a live pass consumes
+	std::vector<uint32_t> live;
+	for (auto it = mOutputs.begin(); it != mOutputs.end(); ++it)
+	{
+		uint32_t writer = mVersions[*it].Writer;
+		if (writer != InvalidIndex && mPasses[writer].isCulled)
+		{
+			mPasses[writer].isCulled = false;
+			live.push_back(writer);
+		}
+	}
+
+	while (!live.empty())
+	{
+		const Pass& p = mPasses[live.back()];
+		live.pop_back();
+
+		std::vector<RGHandle> consumed;
+		for (auto it = p.Reads.begin(); it != p.Reads.end(); ++it)
+		{
+			consumed.push_back(it->Handle);
+		}
+		for (auto it = p.Writes.begin(); it != p.Writes.end(); ++it)
+		{
+			if (mVersions[it->Handle].Previous != InvalidHandle)
+			{
+				consumed.push_back(mVersions[it->Handle].Previous);
+			}
+		}
+
+		for (auto it = consumed.begin(); it != consumed.end(); ++it)
+		{
+			uint32_t writer = mVersions[*it].Writer;
+			if (writer != InvalidIndex && mPasses[writer].isCulled)
+			{
+				mPasses[writer].isCulled = false;
+				live.push_back(writer);
+			}
+		}
+	}
+}
+
+bool RenderGraph::SortPasses()
+{
+	uint32_t passCount = GetPassCount();
+
+	std::vector<std::vector<uint32_t>> successors(passCount);
+	std::vector<uint32_t> inDegree(passCount, 0);
+
+	auto addEdge = [&](uint32_t from, uint32_t to)
+	{
+		if (from == InvalidIndex || from == to || mPasses[from].isCulled) { return; }
+
+		std::vector<uint32_t>& s = successors[from];
+		if (std::find(s.begin(), s.end(), to) == s.end())
+		{
+			s.push_back(to);
+			++inDegree[to];
+		}
+	};
+
+	for (uint32_t i = 0; i < passCount; ++i)
+	{
+		const Pass& p = mPasses[i];
+		if (p.isCulled) { continue; }
+
+		// Read after write
+		for (auto it = p.Reads.begin(); it != p.Reads.end(); ++it)
+		{
+			addEdge(mVersions[it->Handle].Writer, i);
+		}
+
+		for (auto it = p.Writes.begin(); it != p.Writes.end(); ++it)
+		{
+			RGHandle previous = mVersions[it->Handle].Previous;
+			if (previous == InvalidHandle) { continue; }
+
+			// Write after write: the pass builds on the previous contents
+			addEdge(mVersions[previous].Writer, i);
+
+			// Write after read: everyone sampling the previous contents goes first
+			for (uint32_t j = 0; j < passCount; ++j)
+			{
+				const std::vector<Access>& reads = mPasses[j].Reads;
+				for (auto r = reads.begin(); r != reads.end(); ++r)
+				{
+					if (r->Handle == previous) { addEdge(j, i); }
+				}
+			}
+		}
+	}
+
+	// Kahn's algorithm, taking the earliest declared ready pass so the order is stable
+	std::vector<uint32_t> ready;
+	uint32_t liveCount = 0;
+	for (uint32_t i = 0; i < passCount; ++i)
+	{
+		if (mPasses[i].isCulled) { continue; }
+		++liveCount;
+		if (inDegree[i] == 0) { ready.push_back(i); }
+	}
+
+	while (!ready.empty())
+	{
+		auto first = std::min_element(ready.begin(), ready.end());
+		uint32_t pass = *first;
+		ready.erase(first);
+		mOrder.push_back(pass);
+
+		for (auto it = successors[pass].begin(); it != successors[pass].end(); ++it)
+		{
+			if (--inDegree[*it] == 0) { ready.push_back(*it); }
+		}
+	}
+
+	return mOrder.size() == liveCount;
+}
+
+void RenderGraph::AssignPhysicalTextures()
+{
+	for (auto it = mResources.begin(); it != mResources.end(); ++it)
+	{
+		it->FirstUse = InvalidIndex;
+		it->LastUse = InvalidIndex;
+		it->BindFlags = 0;
+		it->isWritten = false;
+		it->Physical = InvalidIndex;
+	}
+
+	// Lifetime of each resource in execution order positions
+	for (uint32_t i = 0; i < mOrder.size(); ++i)
+	{
+		const Pass& p = mPasses[mOrder[i]];
+
+		std::vector<const Access*> accesses;
+		for (auto it = p.Reads.begin(); it != p.Reads.end(); ++it) { accesses.push_back(&*it); }
+		for (auto it = p.Writes.begin(); it != p.Writes.end(); ++it) { accesses.push_back(&*it); }
+
+		for (auto it = accesses.begin(); it != accesses.end(); ++it)
+		{
+			Resource& r = mResources[mVersions[(*it)->Handle].Resource];
+			if (r.FirstUse == InvalidIndex) { r.FirstUse = i; }
+			r.LastUse = i;
+			r.BindFlags |= (*it)->Bind;
+			r.isWritten = r.isWritten || (*it)->Bind != RG_BIND_SHADER_RESOURCE;
+		}
+	}
+
+	// Hand each transient the first free physical texture of the same shape, taking it
+	// when its lifetime starts and returning it after its last use
+	for (uint32_t i = 0; i < mOrder.size(); ++i)
+	{
+		for (auto it = mResources.begin(); it != mResources.end(); ++it)
+		{
+			Resource& r = *it;
+			if (r.isImported || r.FirstUse != i) { continue; }
+
+			uint32_t slot = InvalidIndex;
+			for (uint32_t j = 0; j < mPhysical.size(); ++j)
+			{
+				if (mPhysical[j].LastUse < i && IsAliasCompatible(mPhysical[j].Desc, r.Desc))
+				{
+					slot = j;
+					break;
+				}
+			}
+
+			if (slot == InvalidIndex)
+			{
+				Physical p;
+				p.Desc = r.Desc;
+				p.BindFlags = 0;
+				p.LastUse = 0;
+				mPhysical.push_back(p);
+				slot = static_cast<uint32_t>(mPhysical.size()) - 1;
+				mTransientBytes += GetTextureBytes(r.Desc);
+			}
+
+			r.Physical = slot;
+			mPhysical[slot].LastUse = r.LastUse;
+			mPhysical[slot].BindFlags |= r.BindFlags;
+			mUnaliasedBytes += GetTextureBytes(r.Desc);
+		}
+	}
+}
+
+void RenderGraph::PlanUnbinds()
+{
+	uint32_t keyCount = static_cast<uint32_t>(mPhysical.size() + mResources.size());
+	std::vector<bool> isWritten(keyCount, false);
+	std::vector<bool> isRead(keyCount, false);
+
+	for (auto it = mResources.begin(); it != mResources.end(); ++it)
+	{
+		if (it->FirstUse == InvalidIndex) { continue; }
+
+		uint32_t key = GetMemoryKey(static_cast<uint32_t>(it - mResources.begin()));
+		if (it->isWritten) { isWritten[key] = true; }
+		if (it->BindFlags & RG_BIND_SHADER_RESOURCE) { isRead[key] = true; }
+	}
+
+	// Anything sampled that some pass also renders to is unbound right after sampling,
+	// and the targets of a pass are unbound if anything samples them. Checking the whole
+	// frame rather than just later passes also covers the next frame and aliasing.
+	for (auto it = mOrder.begin(); it != mOrder.end(); ++it)
+	{
+		Pass& p = mPasses[*it];
+		p.Unbinds.clear();
+		p.isUnbindingTargets = false;
+
+		for (auto r = p.Reads.begin(); r != p.Reads.end(); ++r)
+		{
+			if (isWritten[GetMemoryKey(mVersions[r->Handle].Resource)])
+			{
+				p.Unbinds.push_back(*r);
+				++mUnbindCount;
+			}
+		}
+
+		for (auto w = p.Writes.begin(); w != p.Writes.end(); ++w)
+		{
+			if (!isRead[GetMemoryKey(mVersions[w->Handle].Resource)])
+			{
+				continue;
+			}
+
+			// Unordered access views are unbound one slot at a time
+			if (w->Bind == RG_BIND_UNORDERED_ACCESS)
+			{
+				p.Unbinds.push_back(*w);
+				++mUnbindCount;
+			}
+			else
+			{
+				p.isUnbindingTargets = true;
+			}
+		}
+
+		if (p.isUnbindingTargets) { ++mUnbindCount; }
+	}
+}
+
+uint32_t RenderGraph::GetMemoryKey(uint32_t resource) const
+{
+	const Resource& r = mResources[resource];
+	return r.isImported ? static_cast<uint32_t>(mPhysical.size()) + resource : r.Physical;
+}
+
+void RenderGraph::RecordPass(uint32_t orderIndex, CommandBuffer& commands) const
+{
+	const Pass& p = mPasses[mOrder[orderIndex]];
+
+	p.Execute(commands);
+
+	for (auto it = p.Unbinds.begin(); it != p.Unbinds.end(); ++it)
+	{
+		if (it->Bind == RG_BIND_UNORDERED_ACCESS)
+		{
+			commands.ClearUnorderedAccessViews(it->Slot, 1);
+		}
+		else
+		{
+			commands.ClearShaderResources(static_cast<ShaderStage>(it->Stage), it->Slot, 1);
+		}
+	}
+
+	if (p.isUnbindingTargets)
+	{
+		commands.SetRenderTargets(0, nullptr, nullptr);
+	}
+}
+
+uint64_t RenderGraph::GetTextureBytes(const RGTextureDesc& desc)
+{
+	return static_cast<uint64_t>(desc.Width) * desc.Height * desc.BytesPerTexel;
+}
+
+bool RenderGraph::IsAliasCompatible(const RGTextureDesc& a, const RGTextureDesc& b)
+{
+	return a.Width == b.Width && a.Height == b.Height && a.Format == b.Format;
+}
@@ -0,0 +1,181 @@
+/*  =======================
+	Summary: Frame render graph
+	=======================  */
+
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "CommandBuffer.h"
+
+// Names one version of a graph resource. Every write produces a new version, so a
+// reader states exactly which write it depends on and passes can be declared in any order.
+typedef uint32_t RGHandle;
+
+enum RGBindFlag
+{
+	RG_BIND_SHADER_RESOURCE = 1,
+	RG_BIND_RENDER_TARGET = 2,
+	RG_BIND_DEPTH_STENCIL = 4,
+	RG_BIND_UNORDERED_ACCESS = 8
+};
+
+// Transient textures with equal descriptions can share memory. Format is the DXGI
+// value and is only compared; BytesPerTexel is used for memory accounting.
+struct RGTextureDesc
+{
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t Format;
+	uint32_t BytesPerTexel;
+};
+
+typedef std::function<void(CommandBuffer&)> RGExecuteFunc;
+
+// Passes declare the textures they read and write along with a callback that records
+// their commands. Compile culls passes whose results are never consumed, orders the
+// rest by their dependencies, lets transient textures with disjoint lifetimes share
+// physical textures and works out where bindings must be cleared before a resource
+// changes role. Compiling touches no device, so it can be run and checked on the CPU.
+class RenderGraph
+{
+public:
+	static const RGHandle InvalidHandle = 0xffffffff;
+	static const uint32_t InvalidIndex = 0xffffffff;
+
+	RenderGraph();
+	~RenderGraph();
+
+	// Drops all passes, resources and compiled results.
+	void Reset();
+
+	// A texture whose memory is owned by the graph and only valid within a frame.
+	RGHandle CreateTexture(const char* name, const RGTextureDesc& desc);
+
+	// A texture owned elsewhere, such as the back buffer or a cached shadow map.
+	RGHandle ImportTexture(const char* name);
+
+	uint32_t AddPass(const char* name, const RGExecuteFunc& execute);
+
+	// The pass samples the given version at stage/slot.
+	void Read(uint32_t pass, RGHandle handle, ShaderStage stage, uint32_t slot);
+
+	// The pass binds the given version as a render target or depth stencil and produces
+	// a new version of it. The previous contents are kept, so the pass also depends on them.
+	// Unordered access writes bind to slot of the compute stage.
+	RGHandle Write(uint32_t pass, RGHandle handle, RGBindFlag bind, uint32_t slot = 0);
+
+	// Keeps the passes that produce this version, and everything they depend on, alive.
+	void MarkOutput(RGHandle handle);
+
+	// Named versions handed from one pass's setup to the next.
+	void Publish(const char* name, RGHandle handle);
+	RGHandle Find(const char* name) const;
+
+	// Returns false if the declared dependencies contain a cycle.
+	bool Compile();
+
+	inline uint32_t GetPassCount() const { return static_cast<uint32_t>(mPasses.size()); }
+	inline const std::vector<uint32_t>& GetExecutionOrder() const { return mOrder; }
+	inline bool IsPassCulled(uint32_t pass) const { return mPasses[pass].isCulled; }
+	inline const char* GetPassName(uint32_t pass) const { return mPasses[pass].Name.c_str(); }
+
+	inline uint32_t GetResourceIndex(RGHandle handle) const { return mVersions[handle].Resource; }
+	inline bool IsImported(RGHandle handle) const { return mResources[mVersions[handle].Resource].isImported; }
+
+	// Physical texture backing a transient version, or InvalidIndex if it is imported or unused.
+	inline uint32_t GetPhysicalTexture(RGHandle handle) const { return mResources[mVersions[handle].Resource].Physical; }
+	inline uint32_t GetPhysicalTextureCount() const { return static_cast<uint32_t>(mPhysical.size()); }
+	inline const RGTextureDesc& GetPhysicalTextureDesc(uint32_t i) const { return mPhysical[i].Desc; }
+	inline uint32_t GetPhysicalBindFlags(uint32_t i) const { return mPhysical[i].BindFlags; }
+
+	// Memory of all physical textures, and what the same transients would take unaliased.
+	inline uint64_t GetTransientBytes() const { return mTransientBytes; }
+	inline uint64_t GetUnaliasedBytes() const { return mUnaliasedBytes; }
+	inline uint32_t GetUnbindCount() const { return mUnbindCount; }
+
+	// Records the pass at position orderIndex of the execution order followed by the
+	// unbinds it needs. Passes may be recorded concurrently into separate buffers.
+	void RecordPass(uint32_t orderIndex, CommandBuffer& commands) const;
+
+	static uint64_t GetTextureBytes(const RGTextureDesc& desc);
+
+private:
+	struct Resource
+	{
+		std::string Name;
+		RGTextureDesc Desc;
+		bool isImported;
+		bool isWritten;
+		uint32_t BindFlags;
+		uint32_t FirstUse;
+		uint32_t LastUse;
+		uint32_t Physical;
+	};
+
+	struct Version
+	{
+		uint32_t Resource;
+		uint32_t Writer;
+		RGHandle Previous;
+	};
+
+	// Reads fill Stage and Slot, writes fill Bind, and Slot for unordered access.
+	struct Access
+	{
+		RGHandle Handle;
+		uint32_t Stage;
+		uint32_t Slot;
+		uint32_t Bind;
+	};
+
+	struct Pass
+	{
+		std::string Name;
+		RGExecuteFunc Execute;
+		std::vector<Access> Reads;
+		std::vector<Access> Writes;
+		std::vector<Access> Unbinds;
+		bool isCulled;
+		bool isUnbindingTargets;
+	};
+
+	struct Physical
+	{
+		RGTextureDesc Desc;
+		uint32_t BindFlags;
+		uint32_t LastUse;
+	};
+
+	RGHandle AddVersion(uint32_t resource, uint32_t writer, RGHandle previous);
+
+	void CullPasses();
+	bool SortPasses();
+	void AssignPhysicalTextures();
+	void PlanUnbinds();
+
+	// Identifies the memory behind a resource: its physical texture, or the import itself.
+	uint32_t GetMemoryKey(uint32_t resource) const;
+
+	static bool IsAliasCompatible(const RGTextureDesc& a, const RGTextureDesc& b);
+
+private:
+	std::vector<Resource> mResources;
+	std::vector<Version> mVersions;
+	std::vector<Pass> mPasses;
+	std::vector<RGHandle> mOutputs;
+	std::map<std::string, RGHandle> mPublished;
+
+	std::vector<uint32_t> mOrder;
+	std::vector<Physical> mPhysical;
+	uint64_t mTransientBytes;
+	uint64_t mUnaliasedBytes;
+	uint32_t mUnbindCount;
+};
+
+#endif // RENDERGRAPH_H
\ No newline at end of file
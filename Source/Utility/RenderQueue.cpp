@@ -0,0 +1,140 @@
+/*  =======================
+	Summary: Sort key based render queue
+	=======================  */
+
+#include "RenderQueue.h"
+
+#include <cstring>
+
+RenderQueue::RenderQueue()
+{
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::Reset()
+{
+	mItems.clear();
+}
+
+void RenderQueue::Add(uint64_t sortKey, uint32_t payload)
+{
+	RenderQueueItem item;
+	item.SortKey = sortKey;
+	item.Payload = payload;
+	mItems.push_back(item);
+}
+
+void RenderQueue::Sort()
+{
+	uint32_t count = static_cast<uint32_t>(mItems.size());
+	if (count < 2)
+	{
+		return;
+	}
+
+	mScratch.resize(count);
+
+	// Histograms for all eight bytes in one walk over the keys
+	uint32_t histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint64_t key = mItems[i].SortKey;
+		for (uint32_t b = 0; b < 8; ++b)
+		{
+			++histograms[b][(key >> (b * 8)) & 0xff];
+		}
+	}
+
+	RenderQueueItem* source = &mItems[0];
+	RenderQueueItem* dest = &mScratch[0];
+
+	for (uint32_t b = 0; b < 8; ++b)
+	{
+		uint32_t* histogram = histograms[b];
+		uint32_t shift = b * 8;
+
+		// All keys share this byte; the pass would not move anything
+		if (histogram[(source[0].SortKey >> shift) & 0xff] == count)
+		{
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t n = histogram[i];
+			histogram[i] = offset;
+			offset += n;
+		}
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			dest[histogram[(source[i].SortKey >> shift) & 0xff]++] = source[i];
+		}
+
+		RenderQueueItem* swap = source;
+		source = dest;
+		dest = swap;
+	}
+
+	if (source != &mItems[0])
+	{
+		mItems.swap(mScratch);
+	}
+}
+
+uint32_t RenderQueue::CountChanges(uint64_t mask) const
+{
+	uint32_t changes = 0;
+
+	for (uint32_t i = 0; i < mItems.size(); ++i)
+	{
+		if (i == 0 || ((mItems[i].SortKey ^ mItems[i - 1].SortKey) & mask) != 0)
+		{
+			++changes;
+		}
+	}
+
+	return changes;
+}
+
+void RenderQueue::BuildRuns(uint64_t mask, uint32_t maxCount, std::vector<RenderQueueRun>& runs) const
+{
+	runs.clear();
+
+	for (uint32_t i = 0; i < mItems.size(); ++i)
+	{
+		if (i == 0 || runs.back().Count == maxCount || ((mItems[i].SortKey ^ mItems[i - 1].SortKey) & mask) != 0)
+		{
+			RenderQueueRun run = { i, 0 };
+			runs.push_back(run);
+		}
+
+		++runs.back().Count;
+	}
+}
+
+uint64_t RenderQueue::MakeKey(uint32_t layer, uint32_t variant, uint32_t params, uint32_t textureSet, uint32_t depth)
+{
+	return ((static_cast<uint64_t>(layer) << LayerShift) & LayerMask) |
+		((static_cast<uint64_t>(variant) << VariantShift) & VariantMask) |
+		((static_cast<uint64_t>(params) << ParamsShift) & ParamsMask) |
+		((static_cast<uint64_t>(textureSet) << TextureSetShift) & TextureSetMask) |
+		((static_cast<uint64_t>(depth) << DepthShift) & DepthMask);
+}
+
+uint32_t RenderQueue::QuantizeDepth(float viewDepth, float nearZ, float farZ, bool isBackToFront)
+{
+	float t = (viewDepth - nearZ) / (farZ - nearZ);
+	t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+
+	uint32_t maxDepth = (1u << DepthBits) - 1;
+	uint32_t depth = static_cast<uint32_t>(t * maxDepth);
+
+	return isBackToFront ? maxDepth - depth : depth;
+}
@@ -0,0 +1,87 @@
+/*  =======================
+	Summary: Sort key based render queue
+	=======================  */
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <cstdint>
+#include <vector>
+
+// One draw in the queue. Payload indexes the caller's own draw records.
+struct RenderQueueItem
+{
+	uint64_t SortKey;
+	uint32_t Payload;
+};
+
+// A range of sorted items whose keys agree under some mask, e.g. one instanced draw.
+struct RenderQueueRun
+{
+	uint32_t First;
+	uint32_t Count;
+};
+
+// Draws are queued with a 64-bit key and radix sorted, so that draws sharing state
+// end up next to each other and a submitter only changes state where the key bits
+// for it differ from the previous draw. From the most significant bit down a key
+// holds the layer, shader variant, pixel shader parameters, texture set and depth,
+// so state changes are minimised first and depth orders draws within a state.
+// Touches no device, so building, sorting and walking a queue can be timed on the CPU.
+class RenderQueue
+{
+public:
+	static const uint32_t DepthBits = 24;
+	static const uint32_t TextureSetBits = 20;
+	static const uint32_t ParamsBits = 8;
+	static const uint32_t VariantBits = 8;
+	static const uint32_t LayerBits = 4;
+
+	static const uint32_t DepthShift = 0;
+	static const uint32_t TextureSetShift = DepthShift + DepthBits;
+	static const uint32_t ParamsShift = TextureSetShift + TextureSetBits;
+	static const uint32_t VariantShift = ParamsShift + ParamsBits;
+	static const uint32_t LayerShift = VariantShift + VariantBits;
+
+	static const uint64_t DepthMask = ((1ull << DepthBits) - 1) << DepthShift;
+	static const uint64_t TextureSetMask = ((1ull << TextureSetBits) - 1) << TextureSetShift;
+	static const uint64_t ParamsMask = ((1ull << ParamsBits) - 1) << ParamsShift;
+	static const uint64_t VariantMask = ((1ull << VariantBits) - 1) << VariantShift;
+	static const uint64_t LayerMask = ((1ull << LayerBits) - 1) << LayerShift;
+
+	RenderQueue();
+	~RenderQueue();
+
+	// Drops all items but keeps the memory.
+	void Reset();
+
+	void Add(uint64_t sortKey, uint32_t payload);
+
+	// Stable least significant digit radix sort on the keys, a byte per pass. Passes
+	// where every key has the same byte are skipped.
+	void Sort();
+
+	inline uint32_t GetItemCount() const { return static_cast<uint32_t>(mItems.size()); }
+	inline const RenderQueueItem& GetItem(uint32_t i) const { return mItems[i]; }
+
+	// Number of items whose key bits under mask differ from the previous item,
+	// counting the first. This is how often a submitter changes that state.
+	uint32_t CountChanges(uint64_t mask) const;
+
+	// Splits the sorted items into runs of equal key bits under mask, none longer
+	// than maxCount. Replaces the contents of runs.
+	void BuildRuns(uint64_t mask, uint32_t maxCount, std::vector<RenderQueueRun>& runs) const;
+
+	// Fields are truncated to their width.
+	static uint64_t MakeKey(uint32_t layer, uint32_t variant, uint32_t params, uint32_t textureSet, uint32_t depth);
+
+	// Maps a view space depth in [nearZ, farZ] to the key's depth bits, near first.
+	// Pass isBackToFront for blended draws that must be drawn far first.
+	static uint32_t QuantizeDepth(float viewDepth, float nearZ, float farZ, bool isBackToFront = false);
+
+private:
+	std::vector<RenderQueueItem> mItems;
+	std::vector<RenderQueueItem> mScratch;
+};
+
+#endif // RENDERQUEUE_H
\ No newline at end of file
@@ -0,0 +1,130 @@
+/*  =======================
+	Summary: Edge-aware SSAO blur
+	=======================  */
+
+#include "SSAOBlur.h"
+
+#include <cmath>
+
+const float SSAOBlur::NormalThreshold = 0.8f;
+const float SSAOBlur::DepthThreshold = 0.2f;
+
+namespace
+{
+	// BlurPS's kernel, as float literals so the products round as they do on the GPU
+	const float gWeights[11] = { 0.05f, 0.05f, 0.1f, 0.1f, 0.1f, 0.2f, 0.1f, 0.1f, 0.1f, 0.05f, 0.05f };
+	const int gBlurRadius = 5;
+
+	inline int Clamp(int i, int size)
+	{
+		return i < 0 ? 0 : (i >= size ? size - 1 : i);
+	}
+}
+
+void SSAOBlur::BuildWeights(int radius, float* weights)
+{
+	if (radius < 1)
+	{
+		radius = 1;
+	}
+	if (radius > MaxRadius)
+	{
+		radius = MaxRadius;
+	}
+
+	double sigma = radius / 3.0;
+	double raw[WeightCount];
+	double total = 0.0;
+
+	for (int i = 0; i < WeightCount; ++i)
+	{
+		raw[i] = i <= radius ? exp(-0.5 * i * i / (sigma * sigma)) : 0.0;
+		total += i == 0 ? raw[i] : 2.0 * raw[i];
+	}
+
+	for (int i = 0; i < WeightCount; ++i)
+	{
+		weights[i] = static_cast<float>(raw[i] / total);
+	}
+}
+
+void SSAOBlur::BlurPS(const float* ao, const float* normalDepth, uint32_t width, uint32_t height,
+	bool isHorizontal, float* blurred)
+{
+	int w = static_cast<int>(width);
+	int h = static_cast<int>(height);
+	int stepX = isHorizontal ? 1 : 0;
+	int stepY = isHorizontal ? 0 : 1;
+
+	for (int y = 0; y < h; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			const float* center = normalDepth + 4 * (y * w + x);
+
+			float color = gWeights[5] * ao[y * w + x];
+			float totalWeight = gWeights[5];
+
+			for (int i = -gBlurRadius; i <= gBlurRadius; ++i)
+			{
+				if (i == 0)
+				{
+					continue;
+				}
+
+				int index = Clamp(y + i * stepY, h) * w + Clamp(x + i * stepX, w);
+				if (IsSameSurface(center, normalDepth + 4 * index))
+				{
+					float weight = gWeights[i + gBlurRadius];
+					color += weight * ao[index];
+					totalWeight += weight;
+				}
+			}
+
+			blurred[y * w + x] = color / totalWeight;
+		}
+	}
+}
+
+void SSAOBlur::BlurSeparable(const float* ao, const float* normalDepth, uint32_t width, uint32_t height,
+	bool isHorizontal, int radius, const float* weights, float* blurred)
+{
+	int w = static_cast<int>(width);
+	int h = static_cast<int>(height);
+	int stepX = isHorizontal ? 1 : 0;
+	int stepY = isHorizontal ? 0 : 1;
+
+	if (radius > MaxRadius)
+	{
+		radius = MaxRadius;
+	}
+
+	for (int y = 0; y < h; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			const float* center = normalDepth + 4 * (y * w + x);
+
+			float color = weights[0] * ao[y * w + x];
+			float totalWeight = weights[0];
+
+			for (int i = -radius; i <= radius; ++i)
+			{
+				if (i == 0)
+				{
+					continue;
+				}
+
+				int index = Clamp(y + i * stepY, h) * w + Clamp(x + i * stepX, w);
+				if (IsSameSurface(center, normalDepth + 4 * index))
+				{
+					float weight = weights[i < 0 ? -i : i];
+					color += weight * ao[index];
+					totalWeight += weight;
+				}
+			}
+
+			blurred[y * w + x] = color / totalWeight;
+		}
+	}
+}
@@ -0,0 +1,59 @@
+/*  =======================
+	Summary: Edge-aware SSAO blur
+	=======================  */
+
+#ifndef SSAOBLUR_H
+#define SSAOBLUR_H
+
+#include <cstdint>
+
+// CPU reference for the SSAO blur. AO maps are one float per texel; normal/depth maps
+// are four floats per texel, view space normal then view space depth. Neighbours only
+// contribute where their normal and depth agree with the centre texel's.
+// Has no D3D dependencies so it can be driven without a device.
+class SSAOBlur
+{
+public:
+	// Widest kernel SSAOBlurCS supports, in texels either side of the centre
+	static const int MaxRadius = 16;
+
+	// Number of floats BuildWeights writes
+	static const int WeightCount = MaxRadius + 1;
+
+	// Edge test shared by BlurPS and SSAOBlurCS
+	static const float NormalThreshold;
+	static const float DepthThreshold;
+
+	// Radius whose single pass blurs about as much as four BlurPS iterations
+	static const int DefaultRadius = 16;
+
+	// Gaussian weights with sigma = radius / 3, indexed by distance from the centre and
+	// normalised over the whole kernel. Entries beyond radius are zero.
+	static void BuildWeights(int radius, float* weights);
+
+	// One step of BlurPS, evaluated with the shader's float operations in the shader's
+	// order. Samples land on texel centres, so the clamped linear sampler returns texels
+	// unfiltered; the result matches the shader bit for bit before it is stored, as long
+	// as neither side fuses the multiply-adds.
+	static void BlurPS(const float* ao, const float* normalDepth, uint32_t width, uint32_t height,
+		bool isHorizontal, float* blurred);
+
+	// One direction of SSAOBlurCS, with weights from BuildWeights.
+	static void BlurSeparable(const float* ao, const float* normalDepth, uint32_t width, uint32_t height,
+		bool isHorizontal, int radius, const float* weights, float* blurred);
+
+private:
+	static inline bool IsSameSurface(const float* center, const float* neighbor)
+	{
+		float normalDot = neighbor[0] * center[0] + neighbor[1] * center[1] + neighbor[2] * center[2];
+		float depthDiff = neighbor[3] - center[3];
+		if (depthDiff < 0.0f)
+		{
+			depthDiff = -depthDiff;
+		}
+
+		return normalDot >= NormalThreshold && depthDiff <= DepthThreshold;
+	}
+};
+
+#endif // SSAOBLUR_H
\ No newline at end of file
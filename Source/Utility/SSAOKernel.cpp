@@ -0,0 +1,230 @@
+/*  =======================
+	Summary: SSAO sample kernel and noise generation
+	=======================  */
+
+#include "SSAOKernel.h"
+
+#include <cmath>
+
+namespace
+{
+	const double GoldenAngle = 2.3999632297286533;
+	const double GoldenRatioFraction = 0.6180339887498949;
+
+	// Width of the void-and-cluster energy filter, in texels
+	const double NoiseSigma = 1.5;
+
+	// Fraction of texels set in the initial void-and-cluster pattern
+	const double InitialFill = 0.1;
+
+	const uint32_t SampleCounts[SSAO_QUALITY_COUNT] = { 4, 8, 16, 32 };
+
+	// Tracks how crowded every texel's neighbourhood is for a binary pattern on a torus
+	class NoiseEnergy
+	{
+	public:
+		NoiseEnergy(uint32_t size) : mSize(size), mFilter(size * size), mEnergy(size * size, 0.0), mIsSet(size * size, false)
+		{
+			for (uint32_t y = 0; y < size; ++y)
+			{
+				for (uint32_t x = 0; x < size; ++x)
+				{
+					double dx = x <= size / 2 ? x : static_cast<double>(size - x);
+					double dy = y <= size / 2 ? y : static_cast<double>(size - y);
+					mFilter[y * size + x] = exp(-(dx * dx + dy * dy) / (2.0 * NoiseSigma * NoiseSigma));
+				}
+			}
+		}
+
+		inline bool IsSet(uint32_t i) const { return mIsSet[i]; }
+
+		void Toggle(uint32_t i)
+		{
+			mIsSet[i] = !mIsSet[i];
+			double sign = mIsSet[i] ? 1.0 : -1.0;
+
+			uint32_t ix = i % mSize;
+			uint32_t iy = i / mSize;
+			for (uint32_t y = 0; y < mSize; ++y)
+			{
+				uint32_t fy = (y + mSize - iy) % mSize;
+				for (uint32_t x = 0; x < mSize; ++x)
+				{
+					uint32_t fx = (x + mSize - ix) % mSize;
+					mEnergy[y * mSize + x] += sign * mFilter[fy * mSize + fx];
+				}
+			}
+		}
+
+		// Set texel with the most set neighbours
+		uint32_t FindTightestCluster() const
+		{
+			uint32_t best = 0;
+			double bestEnergy = -1.0;
+			for (uint32_t i = 0; i < mEnergy.size(); ++i)
+			{
+				if (mIsSet[i] && mEnergy[i] > bestEnergy)
+				{
+					best = i;
+					bestEnergy = mEnergy[i];
+				}
+			}
+			return best;
+		}
+
+		// Unset texel with the fewest set neighbours
+		uint32_t FindLargestVoid() const
+		{
+			uint32_t best = 0;
+			double bestEnergy = 1e30;
+			for (uint32_t i = 0; i < mEnergy.size(); ++i)
+			{
+				if (!mIsSet[i] && mEnergy[i] < bestEnergy)
+				{
+					best = i;
+					bestEnergy = mEnergy[i];
+				}
+			}
+			return best;
+		}
+
+	private:
+		uint32_t mSize;
+		std::vector<double> mFilter;
+		std::vector<double> mEnergy;
+		std::vector<bool> mIsSet;
+	};
+}
+
+const float SSAOKernel::MinScale = 0.2f;
+
+uint32_t SSAOKernel::GetSampleCount(SSAOQuality quality)
+{
+	return quality >= 0 && quality < SSAO_QUALITY_COUNT ? SampleCounts[quality] : SampleCounts[SSAO_QUALITY_MEDIUM];
+}
+
+DirectX::XMFLOAT3 SSAOKernel::GetHemisphereDirection(uint32_t i, uint32_t count)
+{
+	// Uniform steps in z cover equal solid angles; successive points turn by the golden
+	// angle, so any run of them is spread around the axis
+	double z = 1.0 - (i + 0.5) / count;
+	double r = sqrt(1.0 - z * z);
+	double phi = i * GoldenAngle;
+
+	return DirectX::XMFLOAT3(static_cast<float>(r * cos(phi)), static_cast<float>(r * sin(phi)), static_cast<float>(z));
+}
+
+void SSAOKernel::BuildKernel(uint32_t count, DirectX::XMFLOAT4* offsets)
+{
+	if (count > MaxSampleCount)
+	{
+		count = MaxSampleCount;
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		DirectX::XMFLOAT3 direction = GetHemisphereDirection(i, count);
+
+		// Lengths follow a golden ratio sequence, so they are unrelated to direction and
+		// every interleaved slice of the kernel gets a spread of them. Squaring pulls
+		// most samples in towards the surface.
+		double u = 0.5 + i * GoldenRatioFraction;
+		u -= floor(u);
+		float scale = MinScale + (1.0f - MinScale) * static_cast<float>(u * u);
+
+		offsets[i] = DirectX::XMFLOAT4(direction.x * scale, direction.y * scale, direction.z * scale, 0.0f);
+	}
+}
+
+void SSAOKernel::BuildBlueNoise(uint32_t size, std::vector<uint32_t>& ranks)
+{
+	uint32_t count = size * size;
+	ranks.assign(count, 0);
+
+	NoiseEnergy energy(size);
+
+	// Seed a sparse pattern from a fixed LCG
+	uint32_t initialCount = static_cast<uint32_t>(count * InitialFill);
+	if (initialCount < 1)
+	{
+		initialCount = 1;
+	}
+
+	uint32_t state = 12345u;
+	for (uint32_t placed = 0; placed < initialCount;)
+	{
+		state = state * 1664525u + 1013904223u;
+		uint32_t i = (state >> 8) % count;
+		if (!energy.IsSet(i))
+		{
+			energy.Toggle(i);
+			++placed;
+		}
+	}
+
+	// Even it out by moving the tightest cluster into the largest void until that is
+	// a no-op
+	for (uint32_t iteration = 0; iteration < count; ++iteration)
+	{
+		uint32_t cluster = energy.FindTightestCluster();
+		energy.Toggle(cluster);
+		uint32_t largestVoid = energy.FindLargestVoid();
+		energy.Toggle(largestVoid);
+
+		if (largestVoid == cluster)
+		{
+			break;
+		}
+	}
+
+	std::vector<uint32_t> initial;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (energy.IsSet(i))
+		{
+			initial.push_back(i);
+		}
+	}
+
+	// Rank the initial texels by removing the tightest cluster first
+	for (uint32_t rank = static_cast<uint32_t>(initial.size()); rank > 0; --rank)
+	{
+		uint32_t cluster = energy.FindTightestCluster();
+		energy.Toggle(cluster);
+		ranks[cluster] = rank - 1;
+	}
+
+	for (auto it = initial.begin(); it != initial.end(); ++it)
+	{
+		energy.Toggle(*it);
+	}
+
+	// Rank the rest by filling the largest void. Past half full this is the same as
+	// removing the tightest cluster of unset texels.
+	for (uint32_t rank = static_cast<uint32_t>(initial.size()); rank < count; ++rank)
+	{
+		uint32_t largestVoid = energy.FindLargestVoid();
+		energy.Toggle(largestVoid);
+		ranks[largestVoid] = rank;
+	}
+}
+
+void SSAOKernel::BuildNoiseTexture(uint32_t size, std::vector<uint32_t>& texels)
+{
+	std::vector<uint32_t> ranks;
+	BuildBlueNoise(size, ranks);
+
+	uint32_t count = size * size;
+	texels.resize(count);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		DirectX::XMFLOAT3 v = GetHemisphereDirection(ranks[i], count);
+
+		uint32_t r = static_cast<uint32_t>((v.x * 0.5f + 0.5f) * 255.0f + 0.5f);
+		uint32_t g = static_cast<uint32_t>((v.y * 0.5f + 0.5f) * 255.0f + 0.5f);
+		uint32_t b = static_cast<uint32_t>((v.z * 0.5f + 0.5f) * 255.0f + 0.5f);
+
+		texels[i] = r | (g << 8) | (b << 16);
+	}
+}
@@ -0,0 +1,57 @@
+/*  =======================
+	Summary: SSAO sample kernel and noise generation
+	=======================  */
+
+#ifndef SSAOKERNEL_H
+#define SSAOKERNEL_H
+
+#include <cstdint>
+#include <DirectXMath.h>
+
+#include <vector>
+
+// Sample count presets for the SSAO kernel
+enum SSAOQuality
+{
+	SSAO_QUALITY_LOW = 0,
+	SSAO_QUALITY_MEDIUM = 1,
+	SSAO_QUALITY_HIGH = 2,
+	SSAO_QUALITY_ULTRA = 3,
+	SSAO_QUALITY_COUNT = 4
+};
+
+// Builds the SSAO sample offsets and the tiled random vector texture. Offsets cover a
+// hemisphere evenly and are mostly short, so more samples land near the surface; SSAOPS
+// reflects them about a per-pixel random vector and flips them in front of the surface.
+// The random vectors are placed by blue noise, so neighbouring pixels get unrelated
+// vectors and the leftover noise is fine grained enough for the blur to remove.
+// Everything is deterministic. Has no D3D dependencies so it can be driven without a device.
+class SSAOKernel
+{
+public:
+	static const uint32_t MaxSampleCount = 32;
+
+	// Width and height of the random vector tile
+	static const uint32_t NoiseSize = 32;
+
+	// Shortest offset, as a fraction of the occlusion radius
+	static const float MinScale;
+
+	static uint32_t GetSampleCount(SSAOQuality quality);
+
+	// Writes count offsets with z >= 0 and lengths in [MinScale, 1].
+	static void BuildKernel(uint32_t count, DirectX::XMFLOAT4* offsets);
+
+	// Ranks of a size x size tileable blue noise pattern, from the void-and-cluster method.
+	// Every rank in [0, size * size) appears once.
+	static void BuildBlueNoise(uint32_t size, std::vector<uint32_t>& ranks);
+
+	// R8G8B8A8 texels of unit vectors with z >= 0, stored as v * 0.5 + 0.5. Each texel
+	// takes the vector its blue noise rank indexes in an even spread over the hemisphere.
+	static void BuildNoiseTexture(uint32_t size, std::vector<uint32_t>& texels);
+
+	// Unit vector i of count spread evenly over the z >= 0 hemisphere
+	static DirectX::XMFLOAT3 GetHemisphereDirection(uint32_t i, uint32_t count);
+};
+
+#endif // SSAOKERNEL_H
\ No newline at end of file
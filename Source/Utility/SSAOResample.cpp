@@ -0,0 +1,135 @@
+/*  =======================
+	Summary: Reduced resolution SSAO resampling
+	=======================  */
+
+#include "SSAOResample.h"
+
+#include <cfloat>
+#include <cmath>
+
+const float SSAOResample::DepthTolerance = 0.05f;
+const float SSAOResample::NormalPower = 8.0f;
+
+void SSAOResample::DownsampleNormalDepth(const float* normalDepth, uint32_t width, uint32_t height, uint32_t factor,
+	SSAODownsampleMode mode, float* reducedNormalDepth)
+{
+	uint32_t reducedWidth = GetReducedSize(width, factor);
+	uint32_t reducedHeight = GetReducedSize(height, factor);
+
+	for (uint32_t j = 0; j < reducedHeight; ++j)
+	{
+		for (uint32_t i = 0; i < reducedWidth; ++i)
+		{
+			bool isMax = (mode == SSAO_DOWNSAMPLE_MAX) ||
+				(mode == SSAO_DOWNSAMPLE_CHECKERBOARD && ((i + j) & 1) != 0);
+
+			// Blocks on the right and bottom edges may be cut short
+			uint32_t endX = (i + 1) * factor < width ? (i + 1) * factor : width;
+			uint32_t endY = (j + 1) * factor < height ? (j + 1) * factor : height;
+
+			const float* best = nullptr;
+			for (uint32_t y = j * factor; y < endY; ++y)
+			{
+				for (uint32_t x = i * factor; x < endX; ++x)
+				{
+					const float* texel = normalDepth + 4 * (y * width + x);
+					if (best == nullptr || (isMax ? texel[3] > best[3] : texel[3] < best[3]))
+					{
+						best = texel;
+					}
+				}
+			}
+
+			float* out = reducedNormalDepth + 4 * (j * reducedWidth + i);
+			out[0] = best[0];
+			out[1] = best[1];
+			out[2] = best[2];
+			out[3] = best[3];
+		}
+	}
+}
+
+void SSAOResample::Upsample(const float* reducedAO, const float* reducedNormalDepth, uint32_t factor,
+	const float* normalDepth, uint32_t width, uint32_t height, float* ao)
+{
+	int reducedWidth = static_cast<int>(GetReducedSize(width, factor));
+	int reducedHeight = static_cast<int>(GetReducedSize(height, factor));
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const float* center = normalDepth + 4 * (y * width + x);
+
+			// Position of the texel centre in low resolution texels
+			float u = (x + 0.5f) / factor - 0.5f;
+			float v = (y + 0.5f) / factor - 0.5f;
+			int x0 = static_cast<int>(floorf(u));
+			int y0 = static_cast<int>(floorf(v));
+			float fx = u - x0;
+			float fy = v - y0;
+
+			float sum = 0.0f;
+			float totalWeight = 0.0f;
+
+			// Fall back to the sample nearest in depth when none of them agree with this texel
+			float nearestAO = 0.0f;
+			float nearestDistance = FLT_MAX;
+
+			for (int k = 0; k < 4; ++k)
+			{
+				int sx = x0 + (k & 1);
+				int sy = y0 + (k >> 1);
+				float bilinear = ((k & 1) ? fx : 1.0f - fx) * ((k >> 1) ? fy : 1.0f - fy);
+
+				sx = sx < 0 ? 0 : (sx >= reducedWidth ? reducedWidth - 1 : sx);
+				sy = sy < 0 ? 0 : (sy >= reducedHeight ? reducedHeight - 1 : sy);
+
+				const float* sample = reducedNormalDepth + 4 * (sy * reducedWidth + sx);
+				float sampleAO = reducedAO[sy * reducedWidth + sx];
+
+				float distance = fabsf(sample[3] - center[3]);
+				float relative = distance / (DepthTolerance * fabsf(center[3]) + FLT_EPSILON);
+				float depthWeight = 1.0f / (1.0f + relative * relative);
+
+				float agreement = sample[0] * center[0] + sample[1] * center[1] + sample[2] * center[2];
+				float normalWeight = powf(agreement > 0.0f ? (agreement < 1.0f ? agreement : 1.0f) : 0.0f, NormalPower);
+
+				float weight = bilinear * depthWeight * normalWeight;
+				sum += weight * sampleAO;
+				totalWeight += weight;
+
+				if (distance < nearestDistance)
+				{
+					nearestDistance = distance;
+					nearestAO = sampleAO;
+				}
+			}
+
+			ao[y * width + x] = totalWeight > 1e-4f ? sum / totalWeight : nearestAO;
+		}
+	}
+}
+
+SSAOErrorStats SSAOResample::Compare(const float* reference, const float* ao, uint32_t count, float tolerance)
+{
+	SSAOErrorStats stats = { 0.0f, 0.0f, 0.0f };
+	if (count == 0)
+	{
+		return stats;
+	}
+
+	uint32_t badCount = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		float error = fabsf(reference[i] - ao[i]);
+
+		stats.MeanError += error;
+		stats.MaxError = error > stats.MaxError ? error : stats.MaxError;
+		badCount += error > tolerance ? 1 : 0;
+	}
+
+	stats.MeanError /= count;
+	stats.BadFraction = static_cast<float>(badCount) / count;
+	return stats;
+}
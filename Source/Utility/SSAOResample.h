@@ -0,0 +1,60 @@
+/*  =======================
+	Summary: Reduced resolution SSAO resampling
+	=======================  */
+
+#ifndef SSAORESAMPLE_H
+#define SSAORESAMPLE_H
+
+#include <cstdint>
+
+// How a block of full resolution depths is reduced to one low resolution texel. Min keeps
+// the nearest surface, Max the farthest; Checkerboard alternates between them so both
+// sides of a depth edge survive in the low resolution map. Values match the shader.
+enum SSAODownsampleMode
+{
+	SSAO_DOWNSAMPLE_MIN = 0,
+	SSAO_DOWNSAMPLE_MAX = 1,
+	SSAO_DOWNSAMPLE_CHECKERBOARD = 2
+};
+
+// How far a reduced resolution AO map is from the full resolution one
+struct SSAOErrorStats
+{
+	float MeanError;
+	float MaxError;
+
+	// Fraction of texels off by more than the tolerance passed to Compare
+	float BadFraction;
+};
+
+// CPU reference for the SSAO downsample and joint bilateral upsample passes. Normal/depth
+// maps are four floats per texel, view space normal then view space depth, as in the
+// NormalDepth render target. Mirrors SSAODownsamplePS and SSAOUpsamplePS so the GPU path
+// can be checked against full resolution AO without a device. Has no D3D dependencies.
+class SSAOResample
+{
+public:
+	// Depth difference, relative to the full resolution depth, at which a low resolution
+	// sample's weight has halved
+	static const float DepthTolerance;
+
+	// Exponent applied to the normal agreement of a low resolution sample
+	static const float NormalPower;
+
+	static inline uint32_t GetReducedSize(uint32_t size, uint32_t factor) { return (size + factor - 1) / factor; }
+
+	// Picks one texel from every factor x factor block of normalDepth. The whole texel is
+	// kept rather than an average, so normals and depths stay consistent.
+	static void DownsampleNormalDepth(const float* normalDepth, uint32_t width, uint32_t height, uint32_t factor,
+		SSAODownsampleMode mode, float* reducedNormalDepth);
+
+	// Upsamples reducedAO to width x height. Each texel blends its four nearest low
+	// resolution texels by bilinear weight, scaled down where their depth or normal
+	// differs from the full resolution texel's own.
+	static void Upsample(const float* reducedAO, const float* reducedNormalDepth, uint32_t factor,
+		const float* normalDepth, uint32_t width, uint32_t height, float* ao);
+
+	static SSAOErrorStats Compare(const float* reference, const float* ao, uint32_t count, float tolerance);
+};
+
+#endif // SSAORESAMPLE_H
\ No newline at end of file
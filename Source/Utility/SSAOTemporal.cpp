@@ -0,0 +1,143 @@
+/*  =======================
+	Summary: Temporal accumulation of SSAO
+	=======================  */
+
+#include "SSAOTemporal.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Successive cycles through the kernel turn by the golden angle, so no two line up.
+	// Kept in double so long runs do not lose the fractional part.
+	const double GoldenAngle = 2.3999632297286533;
+	const double TwoPi = 6.2831853071795865;
+
+	// Inverse powers of the plastic number; successive noise offsets are spread evenly
+	// over the tile
+	const double NoiseStepU = 0.7548776662466927;
+	const double NoiseStepV = 0.5698402909980532;
+}
+
+const float SSAOTemporal::DepthRejectTolerance = 0.05f;
+const float SSAOTemporal::NormalRejectCosine = 0.9f;
+
+SSAOTemporal::SSAOTemporal()
+{
+	mKernelSize = 14;
+	mSamplesPerFrame = 4;
+	mBlendFactor = 0.2f;
+
+	mFrameIndex = 0;
+	isHistoryValid = false;
+	isFirstFrame = true;
+
+	DirectX::XMStoreFloat4x4(&mPreviousView, DirectX::XMMatrixIdentity());
+	DirectX::XMStoreFloat4x4(&mPreviousProj, DirectX::XMMatrixIdentity());
+	DirectX::XMStoreFloat4x4(&mCurrentToPreviousView, DirectX::XMMatrixIdentity());
+	DirectX::XMStoreFloat4x4(&mPreviousViewToTex, DirectX::XMMatrixIdentity());
+}
+
+SSAOTemporal::~SSAOTemporal()
+{
+}
+
+void SSAOTemporal::SetKernelSize(uint32_t count)
+{
+	mKernelSize = count < 1 ? 1 : (count > MaxKernelSize ? MaxKernelSize : count);
+
+	if (mSamplesPerFrame > mKernelSize)
+	{
+		mSamplesPerFrame = mKernelSize;
+	}
+}
+
+void SSAOTemporal::SetSamplesPerFrame(uint32_t count)
+{
+	mSamplesPerFrame = count < 1 ? 1 : (count > mKernelSize ? mKernelSize : count);
+}
+
+void SSAOTemporal::SetBlendFactor(float alpha)
+{
+	mBlendFactor = alpha < 0.01f ? 0.01f : (alpha > 1.0f ? 1.0f : alpha);
+}
+
+void SSAOTemporal::Reset()
+{
+	isHistoryValid = false;
+}
+
+void SSAOTemporal::BeginFrame(DirectX::CXMMATRIX view, DirectX::CXMMATRIX proj)
+{
+	++mFrameIndex;
+
+	static const DirectX::XMMATRIX T(
+		0.5f, 0.0f, 0.0f, 0.0f,
+		0.0f, -0.5f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.5f, 0.5f, 0.0f, 1.0f);
+
+	DirectX::XMFLOAT4X4 currentProj;
+	DirectX::XMStoreFloat4x4(&currentProj, proj);
+
+	// A new lens invalidates every reprojected depth
+	isHistoryValid = !isFirstFrame && memcmp(&currentProj, &mPreviousProj, sizeof(currentProj)) == 0;
+
+	DirectX::XMMATRIX previousView = DirectX::XMLoadFloat4x4(&mPreviousView);
+	DirectX::XMMATRIX previousProj = DirectX::XMLoadFloat4x4(&mPreviousProj);
+	DirectX::XMMATRIX invView = DirectX::XMMatrixInverse(nullptr, view);
+
+	DirectX::XMStoreFloat4x4(&mCurrentToPreviousView, DirectX::XMMatrixMultiply(invView, previousView));
+	DirectX::XMStoreFloat4x4(&mPreviousViewToTex, DirectX::XMMatrixMultiply(previousProj, T));
+
+	DirectX::XMStoreFloat4x4(&mPreviousView, view);
+	mPreviousProj = currentProj;
+	isFirstFrame = false;
+}
+
+uint32_t SSAOTemporal::GetFrameOffsets(const DirectX::XMFLOAT4* kernel, DirectX::XMFLOAT4* offsets) const
+{
+	uint32_t sliceCount = GetSliceCount();
+	uint32_t slice = mFrameIndex % sliceCount;
+
+	float angle = GetKernelRotation();
+	float c = cosf(angle);
+	float s = sinf(angle);
+
+	uint32_t count = 0;
+	for (uint32_t i = slice; i < mKernelSize; i += sliceCount)
+	{
+		const DirectX::XMFLOAT4& k = kernel[i];
+		offsets[count++] = DirectX::XMFLOAT4(c * k.x - s * k.y, s * k.x + c * k.y, k.z, k.w);
+	}
+
+	return count;
+}
+
+float SSAOTemporal::GetKernelRotation() const
+{
+	uint32_t cycle = mFrameIndex / GetSliceCount();
+	return static_cast<float>(fmod(cycle * GoldenAngle, TwoPi));
+}
+
+DirectX::XMFLOAT2 SSAOTemporal::GetNoiseOffset() const
+{
+	double u = 0.5 + mFrameIndex * NoiseStepU;
+	double v = 0.5 + mFrameIndex * NoiseStepV;
+	return DirectX::XMFLOAT2(static_cast<float>(u - floor(u)), static_cast<float>(v - floor(v)));
+}
+
+bool SSAOTemporal::IsHistoryValid(const DirectX::XMFLOAT3& previousPos, const DirectX::XMFLOAT3& previousNormal,
+	const DirectX::XMFLOAT4& historyNormalDepth)
+{
+	float depthError = fabsf(historyNormalDepth.w - previousPos.z);
+	if (depthError > DepthRejectTolerance * fabsf(previousPos.z))
+	{
+		return false;
+	}
+
+	float agreement = previousNormal.x * historyNormalDepth.x + previousNormal.y * historyNormalDepth.y +
+		previousNormal.z * historyNormalDepth.z;
+	return agreement >= NormalRejectCosine;
+}
@@ -0,0 +1,90 @@
+/*  =======================
+	Summary: Temporal accumulation of SSAO
+	=======================  */
+
+#ifndef SSAOTEMPORAL_H
+#define SSAOTEMPORAL_H
+
+#include <cstdint>
+#include <DirectXMath.h>
+
+// CPU side of temporally accumulated SSAO. Every frame samples a different slice of
+// the kernel, rotated about the view axis and with the random vectors shifted, and the
+// result is blended exponentially with the previous frame's AO reprojected through the
+// previous camera. Has no D3D dependencies so it can be driven without a device.
+class SSAOTemporal
+{
+public:
+	static const uint32_t MaxKernelSize = 32;
+
+	// History is rejected where its depth is off by more than this fraction of the
+	// reprojected depth, or its normal is further than this cosine from the current one.
+	static const float DepthRejectTolerance;
+	static const float NormalRejectCosine;
+
+	SSAOTemporal();
+	~SSAOTemporal();
+
+	// Number of offsets in the kernel passed to GetFrameOffsets.
+	void SetKernelSize(uint32_t count);
+
+	// The kernel is covered once every ceil(kernel size / count) frames.
+	void SetSamplesPerFrame(uint32_t count);
+
+	// Weight of the new frame in the exponential blend.
+	void SetBlendFactor(float alpha);
+
+	inline uint32_t GetKernelSize() const { return mKernelSize; }
+	inline uint32_t GetSamplesPerFrame() const { return mSamplesPerFrame; }
+	inline uint32_t GetSliceCount() const { return (mKernelSize + mSamplesPerFrame - 1) / mSamplesPerFrame; }
+	inline float GetBlendFactor() const { return mBlendFactor; }
+	inline uint32_t GetFrameIndex() const { return mFrameIndex; }
+
+	// Drops the history for the current frame, such as when its targets were recreated.
+	// The next frame blends with whatever this one writes.
+	void Reset();
+
+	// Moves on to the next frame, rendered with the given camera matrices. The history is
+	// dropped if the projection changed.
+	void BeginFrame(DirectX::CXMMATRIX view, DirectX::CXMMATRIX proj);
+
+	// Weight of the reprojected history this frame, or 0 if there is none.
+	inline float GetHistoryWeight() const { return isHistoryValid ? 1.0f - mBlendFactor : 0.0f; }
+
+	// This frame's view space to the previous frame's view space, and the previous
+	// frame's view space to its texture space, before the perspective divide.
+	inline const DirectX::XMFLOAT4X4& GetCurrentToPreviousView() const { return mCurrentToPreviousView; }
+	inline const DirectX::XMFLOAT4X4& GetPreviousViewToTex() const { return mPreviousViewToTex; }
+
+	// Writes this frame's slice of kernel to offsets, rotated about the view axis.
+	// Slices interleave the kernel, so each spans all directions. Returns their count.
+	uint32_t GetFrameOffsets(const DirectX::XMFLOAT4* kernel, DirectX::XMFLOAT4* offsets) const;
+
+	// Rotation about the view axis applied to the kernel this frame, in radians.
+	float GetKernelRotation() const;
+
+	// Shift of the random vector tiling this frame, in texture coordinates.
+	DirectX::XMFLOAT2 GetNoiseOffset() const;
+
+	// Whether a history texel matches the current surface. previousPos and previousNormal
+	// are the current texel's view space position and normal moved into the previous view.
+	static bool IsHistoryValid(const DirectX::XMFLOAT3& previousPos, const DirectX::XMFLOAT3& previousNormal,
+		const DirectX::XMFLOAT4& historyNormalDepth);
+
+private:
+	uint32_t mKernelSize;
+	uint32_t mSamplesPerFrame;
+	float mBlendFactor;
+
+	uint32_t mFrameIndex;
+	bool isHistoryValid;
+	bool isFirstFrame;
+
+	DirectX::XMFLOAT4X4 mPreviousView;
+	DirectX::XMFLOAT4X4 mPreviousProj;
+
+	DirectX::XMFLOAT4X4 mCurrentToPreviousView;
+	DirectX::XMFLOAT4X4 mPreviousViewToTex;
+};
+
+#endif // SSAOTEMPORAL_H
\ No newline at end of file
@@ -0,0 +1,130 @@
+/*  =======================
+	Summary: Static shadow map cache
+	=======================  */
+
+#include "ShadowCache.h"
+
+#include <cmath>
+#include <cstring>
+
+ShadowCache::ShadowCache()
+{
+	mCascadeCount = 0;
+	mRefreshInterval = 8;
+	mLightTolerance = 0.05f;
+	mFrame = 0;
+	mNextAmortized = 0;
+	mRefreshMask = 0;
+
+	Invalidate();
+}
+
+ShadowCache::~ShadowCache()
+{
+}
+
+void ShadowCache::SetRefreshInterval(uint32_t frames)
+{
+	mRefreshInterval = frames;
+}
+
+void ShadowCache::SetLightTolerance(float radians)
+{
+	mLightTolerance = radians;
+}
+
+void ShadowCache::Invalidate()
+{
+	for (int i = 0; i < ShadowCascades::MaxCascades; ++i)
+	{
+		mValid[i] = false;
+		mStaticVersion[i] = 0;
+	}
+}
+
+void ShadowCache::InvalidateBounds(const DirectX::BoundingBox& worldBox)
+{
+	for (int i = 0; i < mCascadeCount; ++i)
+	{
+		if (mValid[i] && mCached[i].CasterVolume.Intersects(worldBox))
+		{
+			mValid[i] = false;
+		}
+	}
+}
+
+uint32_t ShadowCache::Update(const ShadowCascades& desired, uint32_t staticVersion)
+{
+	if (desired.GetCascadeCount() != mCascadeCount)
+	{
+		mCascadeCount = desired.GetCascadeCount();
+		mNextAmortized = 0;
+		Invalidate();
+	}
+
+	mRefreshMask = 0;
+
+	for (int i = 0; i < mCascadeCount; ++i)
+	{
+		const ShadowCascade& d = desired.GetCascade(i);
+
+		// Cached depth is unusable if it was never rendered, static geometry changed,
+		// the camera moved the slice out of the guard band or the light turned too far.
+		bool mustRefresh = !mValid[i] ||
+			mStaticVersion[i] != staticVersion ||
+			!CoversSphere(mCached[i], d.Sphere) ||
+			!LightMatches(mCached[i].LightDir, d.LightDir, mLightTolerance);
+
+		if (mustRefresh)
+		{
+			mRefreshMask |= (1u << i);
+		}
+	}
+
+	// Amortized refresh so the cache keeps tracking small light and camera changes.
+	// Skip it when the cached fit is already identical to the desired one.
+	if (mRefreshInterval > 0 && (mFrame % mRefreshInterval) == 0)
+	{
+		int i = mNextAmortized;
+		mNextAmortized = (mNextAmortized + 1) % mCascadeCount;
+
+		const ShadowCascade& d = desired.GetCascade(i);
+		if (memcmp(&mCached[i].ShadowTransform, &d.ShadowTransform, sizeof(DirectX::XMFLOAT4X4)) != 0)
+		{
+			mRefreshMask |= (1u << i);
+		}
+	}
+
+	for (int i = 0; i < mCascadeCount; ++i)
+	{
+		if (NeedsRefresh(i))
+		{
+			mCached[i] = desired.GetCascade(i);
+			mValid[i] = true;
+			mStaticVersion[i] = staticVersion;
+		}
+	}
+
+	++mFrame;
+
+	return mRefreshMask;
+}
+
+bool ShadowCache::CoversSphere(const ShadowCascade& cached, const DirectX::BoundingSphere& sphere)
+{
+	DirectX::XMMATRIX V = DirectX::XMLoadFloat4x4(&cached.View);
+	DirectX::XMVECTOR center = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&sphere.Center), V);
+
+	DirectX::XMVECTOR offset = DirectX::XMVectorAbs(DirectX::XMVectorSubtract(center, DirectX::XMLoadFloat3(&cached.LightSpaceCenter)));
+	DirectX::XMVECTOR limit = DirectX::XMVectorReplicate(cached.Radius - sphere.Radius);
+
+	return DirectX::XMVector3LessOrEqual(offset, limit);
+}
+
+bool ShadowCache::LightMatches(const DirectX::XMFLOAT3& cachedDir, const DirectX::XMFLOAT3& lightDir, float tolerance)
+{
+	DirectX::XMVECTOR a = DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&cachedDir));
+	DirectX::XMVECTOR b = DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&lightDir));
+
+	return DirectX::XMVectorGetX(DirectX::XMVector3Dot(a, b)) >= cosf(tolerance);
+}
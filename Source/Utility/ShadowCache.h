@@ -0,0 +1,67 @@
+/*  =======================
+	Summary: Static shadow map cache
+	=======================  */
+
+#ifndef SHADOWCACHE_H
+#define SHADOWCACHE_H
+
+#include "ShadowCascades.h"
+
+// Decides when the cached static-caster depth of each cascade has to be re-rendered.
+// The cache keeps the cascade fit the static layer was rendered with; dynamic casters
+// are drawn on top of a copy using the same fit. Has no D3D dependencies.
+class ShadowCache
+{
+public:
+	ShadowCache();
+	~ShadowCache();
+
+	// Refresh one cascade every N frames in round-robin order, so the cache slowly
+	// follows an animated light. Zero disables the amortized refresh. Defaults to 8;
+	// light changes beyond the tolerance still refresh immediately.
+	void SetRefreshInterval(uint32_t frames);
+
+	// Maximum angle in radians between the cached and current light direction before
+	// a cascade must be refreshed immediately.
+	void SetLightTolerance(float radians);
+
+	// Forget all cached cascades; every cascade is refreshed on the next Update.
+	void Invalidate();
+
+	// Forget only the cached cascades whose caster volume overlaps the box. Call with
+	// the old and new bounds of a moved static caster instead of bumping the version.
+	void InvalidateBounds(const DirectX::BoundingBox& worldBox);
+
+	// Compares freshly fitted cascades against the cached ones and records which
+	// cascades must have their static layer re-rendered this frame. staticVersion must
+	// change whenever static geometry is added, removed or moved.
+	uint32_t Update(const ShadowCascades& desired, uint32_t staticVersion);
+
+	inline uint32_t GetRefreshMask() const { return mRefreshMask; }
+	inline bool NeedsRefresh(int i) const { return (mRefreshMask & (1u << i)) != 0; }
+	inline int GetCascadeCount() const { return mCascadeCount; }
+
+	// The cascade fit currently backing cached cascade i.
+	inline const ShadowCascade& GetCascade(int i) const { return mCached[i]; }
+
+	// True if the cached cascade's ortho volume still contains the sphere.
+	static bool CoversSphere(const ShadowCascade& cached, const DirectX::BoundingSphere& sphere);
+
+	// True if the light directions are within the given angle of each other.
+	static bool LightMatches(const DirectX::XMFLOAT3& cachedDir, const DirectX::XMFLOAT3& lightDir, float tolerance);
+
+private:
+	ShadowCascade mCached[ShadowCascades::MaxCascades];
+	bool mValid[ShadowCascades::MaxCascades];
+	uint32_t mStaticVersion[ShadowCascades::MaxCascades];
+
+	int mCascadeCount;
+	uint32_t mRefreshInterval;
+	float mLightTolerance;
+
+	uint32_t mFrame;
+	int mNextAmortized;
+	uint32_t mRefreshMask;
+};
+
+#endif // SHADOWCACHE_H
\ No newline at end of file
@@ -0,0 +1,190 @@
+/*  =======================
+	Summary: Cascaded shadow map fitting
+	=======================  */
+
+#include "ShadowCascades.h"
+
+#include <cmath>
+
+ShadowCascades::ShadowCascades()
+{
+	mCascadeCount = MaxCascades;
+	mSplitLambda = 0.95f;
+	mShadowMapSize = 1024;
+	mCasterPullback = 200.0f;
+	mGuardBand = 0.0f;
+}
+
+ShadowCascades::~ShadowCascades()
+{
+}
+
+void ShadowCascades::SetCascadeCount(int count)
+{
+	mCascadeCount = MathHelper::Clamp(count, 1, static_cast<int>(MaxCascades));
+}
+
+void ShadowCascades::SetSplitLambda(float lambda)
+{
+	mSplitLambda = MathHelper::Clamp(lambda, 0.0f, 1.0f);
+}
+
+void ShadowCascades::SetShadowMapSize(uint32_t size)
+{
+	mShadowMapSize = size;
+}
+
+void ShadowCascades::SetCasterPullback(float distance)
+{
+	mCasterPullback = distance;
+}
+
+void ShadowCascades::SetGuardBand(float fraction)
+{
+	mGuardBand = MathHelper::Max(fraction, 0.0f);
+}
+
+void ShadowCascades::Update(const GFirstPersonCamera& camera, const DirectX::XMFLOAT3& lightDir)
+{
+	float splits[MaxCascades + 1];
+	ComputeSplits(camera.GetNearZ(), camera.GetFarZ(), mCascadeCount, mSplitLambda, splits);
+
+	DirectX::XMMATRIX lightView = BuildLightView(lightDir);
+
+	for (int i = 0; i < mCascadeCount; ++i)
+	{
+		mCascades[i].SplitNear = splits[i];
+		mCascades[i].SplitFar = splits[i + 1];
+		FitCascade(mCascades[i], camera, lightDir, lightView);
+	}
+}
+
+bool ShadowCascades::IntersectsCascade(int i, const DirectX::BoundingBox& worldBox) const
+{
+	return mCascades[i].CasterVolume.Intersects(worldBox);
+}
+
+void ShadowCascades::ComputeSplits(float nearZ, float farZ, int count, float lambda, float* splits)
+{
+	for (int i = 0; i <= count; ++i)
+	{
+		float p = static_cast<float>(i) / static_cast<float>(count);
+
+		float logSplit = nearZ * powf(farZ / nearZ, p);
+		float uniformSplit = nearZ + (farZ - nearZ) * p;
+
+		splits[i] = MathHelper::Lerp(uniformSplit, logSplit, lambda);
+	}
+
+	// Pin the ends so rounding never leaves a gap at the near or far plane.
+	splits[0] = nearZ;
+	splits[count] = farZ;
+}
+
+DirectX::BoundingSphere ShadowCascades::FitSliceSphere(const GFirstPersonCamera& camera, float sliceNear, float sliceFar)
+{
+	// Squared distance from the view axis to a slice corner, per unit of depth.
+	float tanY = tanf(0.5f * camera.GetFovY());
+	float tanX = camera.GetAspect() * tanY;
+	float k2 = tanX * tanX + tanY * tanY;
+
+	// Place the center on the view axis so the near and far corners are equidistant.
+	// For wide slices that point lies beyond the far plane, and the far corners alone
+	// bound the slice.
+	float centerZ = 0.5f * (sliceNear + sliceFar) * (1.0f + k2);
+	float radius;
+
+	if (centerZ >= sliceFar)
+	{
+		centerZ = sliceFar;
+		radius = sliceFar * sqrtf(k2);
+	}
+	else
+	{
+		float dz = sliceFar - centerZ;
+		radius = sqrtf(sliceFar * sliceFar * k2 + dz * dz);
+	}
+
+	DirectX::XMVECTOR look = DirectX::XMVector3Normalize(camera.GetLookXM());
+	DirectX::XMVECTOR center = DirectX::XMVectorMultiplyAdd(DirectX::XMVectorReplicate(centerZ), look, camera.GetPositionXM());
+
+	DirectX::BoundingSphere sphere;
+	DirectX::XMStoreFloat3(&sphere.Center, center);
+	sphere.Radius = radius;
+	return sphere;
+}
+
+DirectX::XMMATRIX ShadowCascades::BuildLightView(const DirectX::XMFLOAT3& lightDir)
+{
+	DirectX::XMVECTOR dir = DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&lightDir));
+
+	// Avoid a degenerate basis when the light points straight up or down.
+	DirectX::XMVECTOR up = DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	if (fabsf(DirectX::XMVectorGetY(dir)) > 0.99f)
+	{
+		up = DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+	}
+
+	// The light sits at the origin so the view only encodes the rotation. Moving the
+	// camera then only translates the cascades in light space, which snapping absorbs.
+	return DirectX::XMMatrixLookToLH(DirectX::XMVectorZero(), dir, up);
+}
+
+DirectX::XMFLOAT3 ShadowCascades::SnapToTexel(const DirectX::XMFLOAT3& lightSpacePos, float radius, uint32_t shadowMapSize)
+{
+	float texelSize = 2.0f * radius / static_cast<float>(shadowMapSize);
+
+	return DirectX::XMFLOAT3(
+		floorf(lightSpacePos.x / texelSize) * texelSize,
+		floorf(lightSpacePos.y / texelSize) * texelSize,
+		lightSpacePos.z);
+}
+
+void ShadowCascades::FitCascade(ShadowCascade& cascade, const GFirstPersonCamera& camera, const DirectX::XMFLOAT3& lightDir, DirectX::CXMMATRIX lightView)
+{
+	cascade.Sphere = FitSliceSphere(camera, cascade.SplitNear, cascade.SplitFar);
+
+	// The guard band lets a cached cascade keep covering its slice while the camera
+	// moves a little. Quantize the radius so float noise cannot change the texel size
+	// between frames.
+	float radius = cascade.Sphere.Radius * (1.0f + mGuardBand);
+	radius = ceilf(radius * 16.0f) / 16.0f;
+
+	// Snap the sphere center to the texel grid in light space.
+	DirectX::XMFLOAT3 center;
+	DirectX::XMStoreFloat3(&center, DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&cascade.Sphere.Center), lightView));
+	center = SnapToTexel(center, radius, mShadowMapSize);
+
+	DirectX::XMMATRIX P = DirectX::XMMatrixOrthographicOffCenterLH(
+		center.x - radius, center.x + radius,
+		center.y - radius, center.y + radius,
+		center.z - radius, center.z + radius);
+
+	// Casters between the light and the near plane still throw shadows into the
+	// cascade. They are clamped onto the near plane by the shadow rasterizer state, so
+	// only the culling volume needs to reach back towards the light.
+	float halfPullback = 0.5f * mCasterPullback;
+	DirectX::BoundingOrientedBox lightSpaceVolume(
+		DirectX::XMFLOAT3(center.x, center.y, center.z - halfPullback),
+		DirectX::XMFLOAT3(radius, radius, radius + halfPullback),
+		DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+
+	DirectX::XMVECTOR det = DirectX::XMMatrixDeterminant(lightView);
+	DirectX::XMMATRIX invLightView = DirectX::XMMatrixInverse(&det, lightView);
+	lightSpaceVolume.Transform(cascade.CasterVolume, invLightView);
+
+	// Transform from NDC space to texture space.
+	static const DirectX::XMMATRIX T(
+		0.5f, 0.0f, 0.0f, 0.0f,
+		0.0f, -0.5f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.5f, 0.5f, 0.0f, 1.0f);
+
+	cascade.LightDir = lightDir;
+	cascade.LightSpaceCenter = center;
+	cascade.Radius = radius;
+
+	DirectX::XMStoreFloat4x4(&cascade.View, lightView);
+	DirectX::XMStoreFloat4x4(&cascade.Proj, P);
+	DirectX::XMStoreFloat4x4(&cascade.ShadowTransform, lightView*P*T);
+}
@@ -0,0 +1,92 @@
+/*  =======================
+	Summary: Cascaded shadow map fitting
+	=======================  */
+
+#ifndef SHADOWCASCADES_H
+#define SHADOWCASCADES_H
+
+#include <cstdint>
+#include <DirectXMath.h>
+#include "DirectXCollision.h"
+
+#include "GFirstPersonCamera.h"
+
+// CPU side of the cascaded shadow maps. Splits the camera frustum, fits each
+// slice with a bounding sphere and builds a texel-snapped light projection for
+// it. Has no D3D dependencies so it can be driven without a device.
+struct ShadowCascade
+{
+	// View space depth range of the camera frustum slice covered by this cascade.
+	float SplitNear;
+	float SplitFar;
+
+	// World space sphere enclosing the frustum slice.
+	DirectX::BoundingSphere Sphere;
+
+	// World space box used to cull shadow casters, extended towards the light.
+	DirectX::BoundingOrientedBox CasterVolume;
+
+	// Light the cascade was fitted for, and its snapped ortho bounds in light space.
+	DirectX::XMFLOAT3 LightDir;
+	DirectX::XMFLOAT3 LightSpaceCenter;
+	float Radius;
+
+	DirectX::XMFLOAT4X4 View;
+	DirectX::XMFLOAT4X4 Proj;
+
+	// World space to shadow map texture space.
+	DirectX::XMFLOAT4X4 ShadowTransform;
+};
+
+class ShadowCascades
+{
+public:
+	static const int MaxCascades = 4;
+
+	ShadowCascades();
+	~ShadowCascades();
+
+	void SetCascadeCount(int count);
+	void SetSplitLambda(float lambda);
+	void SetShadowMapSize(uint32_t size);
+	void SetCasterPullback(float distance);
+	void SetGuardBand(float fraction);
+
+	inline int GetCascadeCount() const { return mCascadeCount; }
+	inline uint32_t GetShadowMapSize() const { return mShadowMapSize; }
+	inline const ShadowCascade& GetCascade(int i) const { return mCascades[i]; }
+
+	// Refit all cascades to the camera frustum for the given light direction.
+	void Update(const GFirstPersonCamera& camera, const DirectX::XMFLOAT3& lightDir);
+
+	// Returns true if a world space bounding box may cast a shadow into cascade i.
+	bool IntersectsCascade(int i, const DirectX::BoundingBox& worldBox) const;
+
+	// Practical split scheme: blends logarithmic and uniform splits by lambda in [0,1].
+	// Writes count+1 distances to splits, starting at nearZ and ending at farZ.
+	static void ComputeSplits(float nearZ, float farZ, int count, float lambda, float* splits);
+
+	// Smallest sphere enclosing the frustum slice [sliceNear, sliceFar]. The radius
+	// depends only on the lens, so it does not change as the camera rotates.
+	static DirectX::BoundingSphere FitSliceSphere(const GFirstPersonCamera& camera, float sliceNear, float sliceFar);
+
+	// Light view matrix looking down lightDir from the origin.
+	static DirectX::XMMATRIX BuildLightView(const DirectX::XMFLOAT3& lightDir);
+
+	// Moves a light space position onto the shadow map texel grid.
+	static DirectX::XMFLOAT3 SnapToTexel(const DirectX::XMFLOAT3& lightSpacePos, float radius, uint32_t shadowMapSize);
+
+private:
+	void FitCascade(ShadowCascade& cascade, const GFirstPersonCamera& camera, const DirectX::XMFLOAT3& lightDir, DirectX::CXMMATRIX lightView);
+
+private:
+	ShadowCascade mCascades[MaxCascades];
+
+	int mCascadeCount;
+	float mSplitLambda;
+	uint32_t mShadowMapSize;
+	float mCasterPullback;
+	float mGuardBand;
+};
+
+#endif // SHADOWCASCADES_H
\ No newline at end of file
@@ -0,0 +1,322 @@
+/*  =======================
+	Summary: Redundant state filtering for command streams
+	=======================  */
+
+#include "StateFilter.h"
+
+#include <cstring>
+
+namespace
+{
+	inline bool IsSame(const CmdSetRenderTargets& a, const CmdSetRenderTargets& b)
+	{
+		if (a.Count != b.Count || a.DSV != b.DSV) { return false; }
+
+		for (uint32_t i = 0; i < a.Count; ++i)
+		{
+			if (a.RTVs[i] != b.RTVs[i]) { return false; }
+		}
+
+		return true;
+	}
+
+	inline bool IsSame(const CmdSetViewport& a, const CmdSetViewport& b)
+	{
+		return a.TopLeftX == b.TopLeftX && a.TopLeftY == b.TopLeftY && a.Width == b.Width &&
+			a.Height == b.Height && a.MinDepth == b.MinDepth && a.MaxDepth == b.MaxDepth;
+	}
+
+	inline bool IsSame(const CmdSetIndexBuffer& a, const CmdSetIndexBuffer& b)
+	{
+		return a.Buffer == b.Buffer && a.Format == b.Format && a.Offset == b.Offset;
+	}
+
+	inline bool IsSame(const CmdSetVertexBuffer& a, const CmdSetVertexBuffer& b)
+	{
+		return a.Buffer == b.Buffer && a.Stride == b.Stride && a.Offset == b.Offset;
+	}
+
+	inline bool IsSame(const CmdSetBlendState& a, const CmdSetBlendState& b)
+	{
+		return a.State == b.State && a.SampleMask == b.SampleMask && memcmp(a.BlendFactor, b.BlendFactor, sizeof(a.BlendFactor)) == 0;
+	}
+
+	inline bool IsSame(const CmdSetDepthStencilState& a, const CmdSetDepthStencilState& b)
+	{
+		return a.State == b.State && a.StencilRef == b.StencilRef;
+	}
+
+	inline bool IsSame(const CmdSetInputLayout& a, const CmdSetInputLayout& b) { return a.Layout == b.Layout; }
+	inline bool IsSame(const CmdSetPrimitiveTopology& a, const CmdSetPrimitiveTopology& b) { return a.Topology == b.Topology; }
+	inline bool IsSame(const CmdSetVertexShader& a, const CmdSetVertexShader& b) { return a.Shader == b.Shader; }
+	inline bool IsSame(const CmdSetGeometryShader& a, const CmdSetGeometryShader& b) { return a.Shader == b.Shader; }
+	inline bool IsSame(const CmdSetPixelShader& a, const CmdSetPixelShader& b) { return a.Shader == b.Shader; }
+	inline bool IsSame(const CmdSetComputeShader& a, const CmdSetComputeShader& b) { return a.Shader == b.Shader; }
+	inline bool IsSame(const CmdSetRasterizerState& a, const CmdSetRasterizerState& b) { return a.State == b.State; }
+}
+
+StateFilter::StateFilter()
+{
+	Invalidate();
+	ResetStats();
+}
+
+StateFilter::~StateFilter()
+{
+}
+
+void StateFilter::Invalidate()
+{
+	memset(mSlots, 0, sizeof(mSlots));
+	memset(isVertexBufferKnown, 0, sizeof(isVertexBufferKnown));
+	memset(isStateKnown, 0, sizeof(isStateKnown));
+}
+
+void StateFilter::ResetStats()
+{
+	mRequestedCount = 0;
+	mIssuedCount = 0;
+	memset(mRequestedCounts, 0, sizeof(mRequestedCounts));
+	memset(mIssuedCounts, 0, sizeof(mIssuedCounts));
+}
+
+void StateFilter::Filter(const CommandBuffer& commands, CommandBuffer& out)
+{
+	for (const CmdHeader* cmd = commands.Begin(); cmd != commands.End(); cmd = CommandBuffer::Next(cmd))
+	{
+		switch (cmd->Type)
+		{
+		case CMD_SET_RENDER_TARGETS:
+			// Bind pending resources first so they are resolved against the old targets
+			FlushSlots(out);
+			FilterState(cmd, mRenderTargets, out);
+			ForgetSlots(SLOT_SHADER_RESOURCE);
+			break;
+		case CMD_SET_VIEWPORT: FilterState(cmd, mViewport, out); break;
+		case CMD_SET_INPUT_LAYOUT: FilterState(cmd, mInputLayout, out); break;
+		case CMD_SET_PRIMITIVE_TOPOLOGY: FilterState(cmd, mTopology, out); break;
+		case CMD_SET_INDEX_BUFFER: FilterState(cmd, mIndexBuffer, out); break;
+		case CMD_SET_VERTEX_SHADER: FilterState(cmd, mVertexShader, out); break;
+		case CMD_SET_GEOMETRY_SHADER: FilterState(cmd, mGeometryShader, out); break;
+		case CMD_SET_PIXEL_SHADER: FilterState(cmd, mPixelShader, out); break;
+		case CMD_SET_COMPUTE_SHADER: FilterState(cmd, mComputeShader, out); break;
+		case CMD_SET_RASTERIZER_STATE: FilterState(cmd, mRasterizerState, out); break;
+		case CMD_SET_BLEND_STATE: FilterState(cmd, mBlendState, out); break;
+		case CMD_SET_DEPTH_STENCIL_STATE: FilterState(cmd, mDepthStencilState, out); break;
+		case CMD_SET_VERTEX_BUFFER:
+		{
+			const CmdSetVertexBuffer* c = reinterpret_cast<const CmdSetVertexBuffer*>(cmd);
+			if (c->Slot >= MaxSlots)
+			{
+				++mRequestedCount;
+				++mRequestedCounts[cmd->Type];
+				Issue(cmd, out);
+				break;
+			}
+
+			FilterState(cmd, mVertexBuffers[c->Slot], out);
+			break;
+		}
+		case CMD_SET_VERTEX_DATA:
+		{
+			// The backend binds fresh memory for every packet, so it is always issued
+			const CmdSetVertexData* c = reinterpret_cast<const CmdSetVertexData*>(cmd);
+			++mRequestedCount;
+			++mRequestedCounts[cmd->Type];
+			Issue(cmd, out);
+
+			if (c->Slot < MaxSlots)
+			{
+				isVertexBufferKnown[c->Slot] = false;
+			}
+			break;
+		}
+		case CMD_SET_CONSTANT_BUFFERS:
+		{
+			const CmdSetConstantBuffers* c = reinterpret_cast<const CmdSetConstantBuffers*>(cmd);
+			SetSlots(SLOT_CONSTANT_BUFFER, c->Stage, c->StartSlot, c->Count, reinterpret_cast<void* const*>(c->Buffers), cmd, out);
+			break;
+		}
+		case CMD_SET_SHADER_RESOURCES:
+		{
+			const CmdSetShaderResources* c = reinterpret_cast<const CmdSetShaderResources*>(cmd);
+			SetSlots(SLOT_SHADER_RESOURCE, c->Stage, c->StartSlot, c->Count, reinterpret_cast<void* const*>(c->Views), cmd, out);
+			break;
+		}
+		case CMD_SET_SAMPLERS:
+		{
+			const CmdSetSamplers* c = reinterpret_cast<const CmdSetSamplers*>(cmd);
+			SetSlots(SLOT_SAMPLER, c->Stage, c->StartSlot, c->Count, reinterpret_cast<void* const*>(c->Samplers), cmd, out);
+			break;
+		}
+		case CMD_SET_UNORDERED_ACCESS_VIEWS:
+			// Like render targets, resources bound here are unbound as shader resources
+			FlushSlots(out);
+			++mRequestedCount;
+			++mRequestedCounts[cmd->Type];
+			Issue(cmd, out);
+			ForgetSlots(SLOT_SHADER_RESOURCE);
+			break;
+		case CMD_SET_STREAM_OUT_TARGET:
+			// Appending depends on the offset, so stream output is always issued
+			FlushSlots(out);
+			++mRequestedCount;
+			++mRequestedCounts[cmd->Type];
+			Issue(cmd, out);
+			ForgetVertexBuffers();
+			ForgetSlots(SLOT_SHADER_RESOURCE);
+			break;
+		case CMD_DRAW:
+		case CMD_DRAW_INDEXED:
+		case CMD_DRAW_INSTANCED:
+		case CMD_DRAW_INDEXED_INSTANCED:
+		case CMD_DRAW_AUTO:
+		case CMD_DISPATCH:
+		case CMD_COPY_RESOURCE:
+		case CMD_GENERATE_MIPS:
+			FlushSlots(out);
+			out.AppendCommand(cmd);
+			break;
+		default:
+			out.AppendCommand(cmd);
+			break;
+		}
+	}
+
+	// Leave the stream complete; pending bindings must not leak into the next one
+	FlushSlots(out);
+}
+
+template<class T>
+void StateFilter::FilterState(const CmdHeader* cmd, T& last, CommandBuffer& out)
+{
+	const T* c = reinterpret_cast<const T*>(cmd);
+
+	++mRequestedCount;
+	++mRequestedCounts[cmd->Type];
+
+	// Vertex buffers share one flag per slot instead of one per command type
+	bool* isKnown = cmd->Type == CMD_SET_VERTEX_BUFFER ?
+		&isVertexBufferKnown[reinterpret_cast<const CmdSetVertexBuffer*>(cmd)->Slot] : &isStateKnown[cmd->Type];
+
+	if (*isKnown && IsSame(*c, last))
+	{
+		return;
+	}
+
+	last = *c;
+	*isKnown = true;
+	Issue(cmd, out);
+}
+
+void StateFilter::SetSlots(SlotKind kind, uint32_t stage, uint32_t startSlot, uint32_t count, void* const* values, const CmdHeader* cmd, CommandBuffer& out)
+{
+	++mRequestedCount;
+	++mRequestedCounts[cmd->Type];
+
+	SlotTable& table = mSlots[kind][stage];
+
+	if (startSlot + count > MaxSlots)
+	{
+		// Out of the tracked range; keep the order and forget what it may overwrite
+		FlushSlots(kind, stage, out);
+		Issue(cmd, out);
+		memset(table.isKnown, 0, sizeof(table.isKnown));
+		return;
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t slot = startSlot + i;
+		table.Pending[slot] = values[i];
+		table.isPending[slot] = true;
+	}
+
+	table.hasPending = true;
+}
+
+void StateFilter::FlushSlots(CommandBuffer& out)
+{
+	for (uint32_t kind = 0; kind < SLOT_KIND_COUNT; ++kind)
+	{
+		for (uint32_t stage = 0; stage < STAGE_COUNT; ++stage)
+		{
+			FlushSlots(static_cast<SlotKind>(kind), stage, out);
+		}
+	}
+}
+
+void StateFilter::FlushSlots(SlotKind kind, uint32_t stage, CommandBuffer& out)
+{
+	SlotTable& table = mSlots[kind][stage];
+	if (!table.hasPending)
+	{
+		return;
+	}
+
+	uint32_t slot = 0;
+	while (slot < MaxSlots)
+	{
+		// Find the next run of slots whose pending value differs from the device
+		if (!table.isPending[slot] || (table.isKnown[slot] && table.Applied[slot] == table.Pending[slot]))
+		{
+			++slot;
+			continue;
+		}
+
+		uint32_t start = slot;
+		while (slot < MaxSlots && slot - start < MaxCommandSlots && table.isPending[slot] &&
+			!(table.isKnown[slot] && table.Applied[slot] == table.Pending[slot]))
+		{
+			table.Applied[slot] = table.Pending[slot];
+			table.isKnown[slot] = true;
+			++slot;
+		}
+
+		uint32_t count = slot - start;
+		ShaderStage shaderStage = static_cast<ShaderStage>(stage);
+
+		switch (kind)
+		{
+		case SLOT_CONSTANT_BUFFER:
+			out.SetConstantBuffers(shaderStage, start, count, reinterpret_cast<ID3D11Buffer* const*>(&table.Pending[start]));
+			++mIssuedCounts[CMD_SET_CONSTANT_BUFFERS];
+			break;
+		case SLOT_SHADER_RESOURCE:
+			out.SetShaderResources(shaderStage, start, count, reinterpret_cast<ID3D11ShaderResourceView* const*>(&table.Pending[start]));
+			++mIssuedCounts[CMD_SET_SHADER_RESOURCES];
+			break;
+		case SLOT_SAMPLER:
+			out.SetSamplers(shaderStage, start, count, reinterpret_cast<ID3D11SamplerState* const*>(&table.Pending[start]));
+			++mIssuedCounts[CMD_SET_SAMPLERS];
+			break;
+		default:
+			break;
+		}
+
+		++mIssuedCount;
+	}
+
+	memset(table.isPending, 0, sizeof(table.isPending));
+	table.hasPending = false;
+}
+
+void StateFilter::ForgetSlots(SlotKind kind)
+{
+	for (uint32_t stage = 0; stage < STAGE_COUNT; ++stage)
+	{
+		memset(mSlots[kind][stage].isKnown, 0, sizeof(mSlots[kind][stage].isKnown));
+	}
+}
+
+void StateFilter::ForgetVertexBuffers()
+{
+	memset(isVertexBufferKnown, 0, sizeof(isVertexBufferKnown));
+}
+
+void StateFilter::Issue(const CmdHeader* cmd, CommandBuffer& out)
+{
+	out.AppendCommand(cmd);
+	++mIssuedCount;
+	++mIssuedCounts[cmd->Type];
+}
@@ -0,0 +1,102 @@
+/*  =======================
+	Summary: Redundant state filtering for command streams
+	=======================  */
+
+#ifndef STATEFILTER_H
+#define STATEFILTER_H
+
+#include "CommandBuffer.h"
+
+// Rewrites a command stream so that it only sets state that differs from what the
+// device already has. Pipeline state that matches the last issued value is dropped.
+// Constant buffer, shader resource and sampler slot changes are held back until the
+// next draw, copy or target change and then issued as one call per run of adjacent
+// changed slots. Bindings are remembered across streams, as they are on the device.
+//
+// The device silently unbinds shader resources that become render targets or unordered
+// access views and vertex buffers that become stream output targets, so those bindings
+// are forgotten whenever targets change. Unordered access views are always issued.
+// Anything that sets state behind the filter's back must be followed by Invalidate.
+//
+// Works purely on commands, so it can be checked on the CPU by filtering a recorded
+// stream and inspecting the output, e.g. with a NullRenderBackend.
+class StateFilter
+{
+public:
+	static const uint32_t MaxSlots = 16;
+
+	StateFilter();
+	~StateFilter();
+
+	// Forgets every binding; the next set of each state is issued.
+	void Invalidate();
+
+	// Appends the filtered form of commands to out.
+	void Filter(const CommandBuffer& commands, CommandBuffer& out);
+
+	void ResetStats();
+
+	// Calls are counted per command; a slot command counts once however many slots it sets.
+	inline uint32_t GetRequestedCount() const { return mRequestedCount; }
+	inline uint32_t GetIssuedCount() const { return mIssuedCount; }
+	inline uint32_t GetFilteredCount() const { return mRequestedCount > mIssuedCount ? mRequestedCount - mIssuedCount : 0; }
+	inline uint32_t GetRequestedCount(CommandType type) const { return mRequestedCounts[type]; }
+	inline uint32_t GetIssuedCount(CommandType type) const { return mIssuedCounts[type]; }
+
+private:
+	enum SlotKind
+	{
+		SLOT_CONSTANT_BUFFER,
+		SLOT_SHADER_RESOURCE,
+		SLOT_SAMPLER,
+		SLOT_KIND_COUNT
+	};
+
+	struct SlotTable
+	{
+		void* Applied[MaxSlots];
+		void* Pending[MaxSlots];
+		bool isKnown[MaxSlots];
+		bool isPending[MaxSlots];
+		bool hasPending;
+	};
+
+	template<class T>
+	void FilterState(const CmdHeader* cmd, T& last, CommandBuffer& out);
+
+	void SetSlots(SlotKind kind, uint32_t stage, uint32_t startSlot, uint32_t count, void* const* values, const CmdHeader* cmd, CommandBuffer& out);
+	void FlushSlots(CommandBuffer& out);
+	void FlushSlots(SlotKind kind, uint32_t stage, CommandBuffer& out);
+	void ForgetSlots(SlotKind kind);
+	void ForgetVertexBuffers();
+
+	void Issue(const CmdHeader* cmd, CommandBuffer& out);
+
+private:
+	SlotTable mSlots[SLOT_KIND_COUNT][STAGE_COUNT];
+
+	CmdSetVertexBuffer mVertexBuffers[MaxSlots];
+	bool isVertexBufferKnown[MaxSlots];
+
+	// Last issued packet of each single valued state
+	CmdSetRenderTargets mRenderTargets;
+	CmdSetViewport mViewport;
+	CmdSetInputLayout mInputLayout;
+	CmdSetPrimitiveTopology mTopology;
+	CmdSetIndexBuffer mIndexBuffer;
+	CmdSetVertexShader mVertexShader;
+	CmdSetGeometryShader mGeometryShader;
+	CmdSetPixelShader mPixelShader;
+	CmdSetComputeShader mComputeShader;
+	CmdSetRasterizerState mRasterizerState;
+	CmdSetBlendState mBlendState;
+	CmdSetDepthStencilState mDepthStencilState;
+	bool isStateKnown[CMD_COUNT];
+
+	uint32_t mRequestedCount;
+	uint32_t mIssuedCount;
+	uint32_t mRequestedCounts[CMD_COUNT];
+	uint32_t mIssuedCounts[CMD_COUNT];
+};
+
+#endif // STATEFILTER_H
\ No newline at end of file
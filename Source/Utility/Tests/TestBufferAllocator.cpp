@@ -0,0 +1,161 @@
+/*  =======================
+	Summary: Checks for the shared buffer range allocator
+	=======================  */
+
+#include "BufferAllocator.h"
+
+#include <random>
+#include <vector>
+
+#include "TestHelper.h"
+
+namespace
+{
+	bool IsAllocation(const BufferAllocation& a, uint32_t page, uint32_t offset, uint32_t count)
+	{
+		return a.Page == page && a.Offset == offset && a.Count == count;
+	}
+
+	void TestAllocate()
+	{
+		BufferAllocator allocator(100);
+		CHECK(allocator.GetPageCount() == 0);
+
+		// First fit packs ranges back to back
+		BufferAllocation a = allocator.Allocate(30);
+		BufferAllocation b = allocator.Allocate(50);
+		BufferAllocation c = allocator.Allocate(20);
+		CHECK(IsAllocation(a, 0, 0, 30));
+		CHECK(IsAllocation(b, 0, 30, 50));
+		CHECK(IsAllocation(c, 0, 80, 20));
+		CHECK(allocator.GetPageCount() == 1);
+		CHECK(allocator.GetUsedCount() == 100);
+		CHECK(allocator.GetLargestFreeRange() == 0);
+
+		// Zero elements take nothing, and freeing them changes nothing
+		BufferAllocation empty = allocator.Allocate(0);
+		CHECK(empty.Page == BufferAllocator::InvalidPage && empty.Count == 0);
+		allocator.Free(empty);
+		CHECK(allocator.GetUsedCount() == 100);
+
+		// A freed hole is filled by the next request that fits
+		allocator.Free(b);
+		CHECK(allocator.GetLargestFreeRange() == 50);
+		CHECK(IsAllocation(allocator.Allocate(40), 0, 30, 40));
+		CHECK(IsAllocation(allocator.Allocate(10), 0, 70, 10));
+		CHECK(allocator.GetPageCount() == 1);
+	}
+
+	void TestCoalesce()
+	{
+		BufferAllocator allocator(100);
+		BufferAllocation ranges[5];
+		for (int i = 0; i < 5; ++i)
+		{
+			ranges[i] = allocator.Allocate(20);
+		}
+
+		// Freed neighbours merge with the range after, before, and on both sides
+		allocator.Free(ranges[1]);
+		allocator.Free(ranges[3]);
+		CHECK(allocator.GetLargestFreeRange() == 20);
+
+		allocator.Free(ranges[0]);
+		CHECK(allocator.GetLargestFreeRange() == 40);
+
+		allocator.Free(ranges[4]);
+		CHECK(allocator.GetLargestFreeRange() == 40);
+
+		allocator.Free(ranges[2]);
+		CHECK(allocator.GetLargestFreeRange() == 100);
+		CHECK(allocator.GetUsedCount() == 0);
+
+		// The whole page is one range again
+		CHECK(IsAllocation(allocator.Allocate(100), 0, 0, 100));
+		CHECK(allocator.GetPageCount() == 1);
+	}
+
+	void TestOutOfSpace()
+	{
+		BufferAllocator allocator(100);
+		BufferAllocation a = allocator.Allocate(60);
+		allocator.Allocate(30);
+
+		// Ten elements are left in the first page, so a larger request opens a second
+		BufferAllocation b = allocator.Allocate(20);
+		CHECK(IsAllocation(b, 1, 0, 20));
+		CHECK(allocator.GetPageCount() == 2);
+		CHECK(allocator.GetCapacity() == 200);
+
+		// Smaller requests still go to the first page with room
+		CHECK(IsAllocation(allocator.Allocate(10), 0, 90, 10));
+
+		// Requests larger than a page get a page of exactly their size
+		BufferAllocation large = allocator.Allocate(250);
+		CHECK(IsAllocation(large, 2, 0, 250));
+		CHECK(allocator.GetPageSize(2) == 250);
+		CHECK(allocator.GetCapacity() == 450);
+
+		// Freed space is used before another page is opened
+		allocator.Free(a);
+		CHECK(IsAllocation(allocator.Allocate(60), 0, 0, 60));
+		allocator.Free(large);
+		CHECK(IsAllocation(allocator.Allocate(200), 2, 0, 200));
+		CHECK(allocator.GetPageCount() == 3);
+	}
+
+	// Random allocations and frees never overlap, and freeing everything leaves every
+	// page as a single free range
+	void TestRandom()
+	{
+		BufferAllocator allocator(1000);
+		std::mt19937 random(21);
+		std::vector<BufferAllocation> live;
+		uint32_t used = 0;
+
+		for (int step = 0; step < 5000; ++step)
+		{
+			if (live.empty() || random() % 3 != 0)
+			{
+				BufferAllocation a = allocator.Allocate(1 + random() % 300);
+				for (const BufferAllocation& other : live)
+				{
+					bool isApart = a.Page != other.Page || a.Offset + a.Count <= other.Offset || other.Offset + other.Count <= a.Offset;
+					CHECK(isApart);
+				}
+				CHECK(a.Offset + a.Count <= allocator.GetPageSize(a.Page));
+				live.push_back(a);
+				used += a.Count;
+			}
+			else
+			{
+				uint32_t i = random() % live.size();
+				allocator.Free(live[i]);
+				used -= live[i].Count;
+				live[i] = live.back();
+				live.pop_back();
+			}
+			CHECK(allocator.GetUsedCount() == used);
+		}
+
+		for (const BufferAllocation& a : live)
+		{
+			allocator.Free(a);
+		}
+		CHECK(allocator.GetUsedCount() == 0);
+		for (uint32_t page = 0; page < allocator.GetPageCount(); ++page)
+		{
+			CHECK(IsAllocation(allocator.Allocate(allocator.GetPageSize(page)), page, 0, allocator.GetPageSize(page)));
+		}
+	}
+}
+
+int main()
+{
+	TestAllocate();
+	TestCoalesce();
+	TestOutOfSpace();
+	TestRandom();
+
+	return ReportChecks("BufferAllocator");
+}
@@ -0,0 +1,104 @@
+/*  =======================
+	Summary: Checks for the per-frame constant upload ring
+	=======================  */
+
+#include "ConstantRing.h"
+
+#include "TestHelper.h"
+
+namespace
+{
+	void TestAlignment()
+	{
+		CHECK(ConstantRing::AlignSize(1) == 256);
+		CHECK(ConstantRing::AlignSize(256) == 256);
+		CHECK(ConstantRing::AlignSize(257) == 512);
+
+		// Capacities are rounded up too
+		ConstantRing odd(1000);
+		CHECK(odd.GetCapacity() == 1024);
+
+		// Every block starts on a 256 byte boundary whatever the sizes before it
+		ConstantRing ring(64 * 1024);
+		ring.BeginFrame();
+
+		const uint32_t sizes[] = { 16, 64, 208, 256, 272, 1, 4096, 80 };
+		uint32_t expected = 0;
+		for (uint32_t size : sizes)
+		{
+			uint32_t offset = ring.Allocate(size);
+			CHECK(offset % ConstantRing::Alignment == 0);
+			CHECK(offset == expected);
+			expected += ConstantRing::AlignSize(size);
+		}
+		CHECK(ring.GetUsedBytes() == expected);
+		CHECK(ring.GetAllocationCount() == 8);
+	}
+
+	// Each frame wraps back to the front, and only its first block discards
+	void TestWrap()
+	{
+		ConstantRing ring(1024);
+
+		for (int frame = 0; frame < 3; ++frame)
+		{
+			ring.BeginFrame();
+			CHECK(ring.IsFrameStart());
+			CHECK(ring.Allocate(300) == 0);
+			CHECK(!ring.IsFrameStart());
+			CHECK(ring.Allocate(200) == 512);
+			CHECK(ring.Allocate(256) == 768);
+		}
+
+		// The ring filled exactly, so it never needed to grow
+		CHECK(ring.GetCapacity() == 1024);
+		CHECK(ring.GetPeakBytes() == 1024);
+		CHECK(ring.GetOverflowCount() == 0);
+	}
+
+	void TestOverflow()
+	{
+		ConstantRing ring(1024);
+		ring.BeginFrame();
+		CHECK(ring.Allocate(768) == 0);
+
+		// What does not fit is refused without moving the head; a smaller block may still fit
+		CHECK(ring.Allocate(512) == ConstantRing::InvalidOffset);
+		CHECK(ring.GetOverflowCount() == 1);
+		CHECK(ring.GetUsedBytes() == 768);
+		CHECK(ring.Allocate(200) == 768);
+		CHECK(ring.Allocate(1) == ConstantRing::InvalidOffset);
+		CHECK(ring.GetOverflowCount() == 2);
+
+		// The next frame grows to everything that was asked for and starts with a discard,
+		// which also hands the driver a buffer of the new size
+		ring.BeginFrame();
+		CHECK(ring.GetCapacity() == 2048);
+		CHECK(ring.IsFrameStart());
+		CHECK(ring.Allocate(768) == 0);
+		CHECK(ring.Allocate(512) == 768);
+		CHECK(ring.Allocate(200) == 1280);
+		CHECK(ring.Allocate(1) == 1536);
+		CHECK(ring.GetOverflowCount() == 2);
+
+		// A first block that does not fit leaves the discard for the next one
+		ConstantRing small(256);
+		small.BeginFrame();
+		CHECK(small.Allocate(1024) == ConstantRing::InvalidOffset);
+		CHECK(small.IsFrameStart());
+		CHECK(small.Allocate(64) == 0);
+		CHECK(!small.IsFrameStart());
+
+		small.BeginFrame();
+		CHECK(small.GetCapacity() == 2048);
+	}
+}
+
+int main()
+{
+	TestAlignment();
+	TestWrap();
+	TestOverflow();
+
+	return ReportChecks("ConstantRing");
+}
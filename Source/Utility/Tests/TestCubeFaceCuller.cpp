@@ -0,0 +1,138 @@
+/*  =======================
+	Summary: Checks for the six-face cube capture culling
+	=======================  */
+
+#include "CubeFaceCuller.h"
+
+#include <random>
+#include <vector>
+
+#include "TestHelper.h"
+
+namespace
+{
+	const float FarZ = 100.0f;
+
+	// Culls the boxes both ways and counts the masks that differ
+	int CountMismatches(const DirectX::XMFLOAT3& position, const std::vector<DirectX::BoundingBox>& boxes)
+	{
+		CubeFaceCuller culler;
+		for (const DirectX::BoundingBox& box : boxes)
+		{
+			culler.AddBox(box);
+		}
+
+		std::vector<uint8_t> masks;
+		culler.Cull(position, FarZ, masks);
+		if (masks.size() != boxes.size())
+		{
+			return static_cast<int>(boxes.size());
+		}
+
+		int mismatches = 0;
+		for (uint32_t i = 0; i < boxes.size(); ++i)
+		{
+			mismatches += masks[i] != CubeFaceCuller::CullBox(position, FarZ, boxes[i]) ? 1 : 0;
+		}
+		return mismatches;
+	}
+
+	void TestKnownBoxes()
+	{
+		DirectX::XMFLOAT3 probe(1.0f, 2.0f, 3.0f);
+		DirectX::XMFLOAT3 small(0.5f, 0.5f, 0.5f);
+
+		// Straight ahead of +Z only, on the +X/+Y diagonal both, around the probe all
+		CHECK(CubeFaceCuller::CullBox(probe, FarZ, DirectX::BoundingBox(DirectX::XMFLOAT3(1.0f, 2.0f, 13.0f), small)) == 16);
+		CHECK(CubeFaceCuller::CullBox(probe, FarZ, DirectX::BoundingBox(DirectX::XMFLOAT3(6.0f, 7.0f, 3.0f), small)) == (1 | 4));
+		CHECK(CubeFaceCuller::CullBox(probe, FarZ, DirectX::BoundingBox(probe, small)) == CubeFaceCuller::AllFaces);
+
+		// Beyond the far plane along the axis nothing sees it
+		CHECK(CubeFaceCuller::CullBox(probe, FarZ, DirectX::BoundingBox(DirectX::XMFLOAT3(1.0f, 2.0f, 3.0f - FarZ - 1.0f), small)) == 0);
+	}
+
+	void TestRandomBoxes()
+	{
+		std::mt19937 random(19);
+		std::uniform_real_distribution<float> coordinate(-60.0f, 60.0f);
+		std::uniform_real_distribution<float> size(0.0f, 5.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		const DirectX::XMFLOAT3 probes[] =
+		{
+			DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f),
+			DirectX::XMFLOAT3(0.0f, 3.5f, -10.0f),
+			DirectX::XMFLOAT3(-7.25f, 1.0f, 12.5f)
+		};
+
+		for (const DirectX::XMFLOAT3& p : probes)
+		{
+			std::vector<DirectX::BoundingBox> boxes;
+			for (int i = 0; i < 1000; ++i)
+			{
+				DirectX::XMFLOAT3 extents(size(random), size(random), size(random));
+
+				// Anywhere around the probe
+				DirectX::XMFLOAT3 c(p.x + coordinate(random), p.y + coordinate(random), p.z + coordinate(random));
+				boxes.push_back(DirectX::BoundingBox(c, extents));
+
+				// Straddling the planes between faces: a corner point on a diagonal, where
+				// two or three coordinates have equal magnitude
+				float d = coordinate(random);
+				float sx = unit(random) < 0.0f ? -1.0f : 1.0f;
+				float sz = unit(random) < 0.0f ? -1.0f : 1.0f;
+				DirectX::XMFLOAT3 onDiagonal(p.x + sx * d, p.y + d, p.z + (i % 2 ? sz * d : 0.5f * d));
+				boxes.push_back(DirectX::BoundingBox(onDiagonal, DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f)));
+				boxes.push_back(DirectX::BoundingBox(onDiagonal, extents));
+
+				// Containing or touching the probe position
+				DirectX::XMFLOAT3 nearProbe(p.x + unit(random) * extents.x, p.y + unit(random) * extents.y, p.z + extents.z);
+				boxes.push_back(DirectX::BoundingBox(nearProbe, extents));
+
+				// Straddling the far plane of one face
+				DirectX::XMFLOAT3 atFar(p.x + FarZ * (i % 2 ? 1.0f : -1.0f) + unit(random), p.y + unit(random), p.z);
+				boxes.push_back(DirectX::BoundingBox(atFar, DirectX::XMFLOAT3(0.5f, 0.5f, 0.5f)));
+			}
+
+			CHECK(CountMismatches(p, boxes) == 0);
+
+			// Counts that leave the last group of four partly empty
+			for (uint32_t count = 1; count <= 7; ++count)
+			{
+				std::vector<DirectX::BoundingBox> few(boxes.begin(), boxes.begin() + count);
+				CHECK(CountMismatches(p, few) == 0);
+			}
+		}
+	}
+
+	// Reset empties the culler for the next frame's boxes
+	void TestReset()
+	{
+		CubeFaceCuller culler;
+		DirectX::XMFLOAT3 probe(0.0f, 0.0f, 0.0f);
+		DirectX::XMFLOAT3 small(0.5f, 0.5f, 0.5f);
+
+		for (int i = 0; i < 6; ++i)
+		{
+			culler.AddBox(DirectX::BoundingBox(DirectX::XMFLOAT3(5.0f, 0.0f, 0.0f), small));
+		}
+
+		culler.Reset();
+		CHECK(culler.GetBoxCount() == 0);
+		CHECK(culler.AddBox(DirectX::BoundingBox(DirectX::XMFLOAT3(-5.0f, 0.0f, 0.0f), small)) == 0);
+
+		std::vector<uint8_t> masks;
+		culler.Cull(probe, FarZ, masks);
+		CHECK(masks.size() == 1);
+		CHECK(masks[0] == 2);
+	}
+}
+
+int main()
+{
+	TestKnownBoxes();
+	TestRandomBoxes();
+	TestReset();
+
+	return ReportChecks("CubeFaceCuller");
+}
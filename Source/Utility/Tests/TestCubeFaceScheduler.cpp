@@ -0,0 +1,179 @@
+/*  =======================
+	Summary: Checks for the dynamic cube map update scheduling
+	=======================  */
+
+#include "CubeFaceScheduler.h"
+
+#include <vector>
+
+#include "TestHelper.h"
+
+namespace
+{
+	const DirectX::XMFLOAT3 Origin(0.0f, 0.0f, 0.0f);
+
+	// Bit i set if face i sees the box from the origin
+	uint32_t GetSeeingFaces(const DirectX::BoundingBox& box)
+	{
+		uint32_t faces = 0;
+		for (uint32_t i = 0; i < CubeFaceScheduler::FaceCount; ++i)
+		{
+			faces |= CubeFaceScheduler::FaceSeesBox(Origin, i, box) ? (1u << i) : 0;
+		}
+		return faces;
+	}
+
+	void TestFaceSeesBox()
+	{
+		const DirectX::XMFLOAT3 small(0.5f, 0.5f, 0.5f);
+
+		// A box straight ahead of each face, in D3D face order, is seen by that face only
+		const DirectX::XMFLOAT3 ahead[6] =
+		{
+			DirectX::XMFLOAT3(5.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(-5.0f, 0.0f, 0.0f),
+			DirectX::XMFLOAT3(0.0f, 5.0f, 0.0f), DirectX::XMFLOAT3(0.0f, -5.0f, 0.0f),
+			DirectX::XMFLOAT3(0.0f, 0.0f, 5.0f), DirectX::XMFLOAT3(0.0f, 0.0f, -5.0f)
+		};
+		for (uint32_t i = 0; i < 6; ++i)
+		{
+			CHECK(GetSeeingFaces(DirectX::BoundingBox(ahead[i], small)) == (1u << i));
+		}
+
+		// Off axis but inside the +X frustum
+		CHECK(GetSeeingFaces(DirectX::BoundingBox(DirectX::XMFLOAT3(5.0f, 3.0f, -3.0f), small)) == 1u);
+
+		// On the diagonal between +X and +Y both faces see it, and on the corner of
+		// +X, +Y and -Z all three do
+		CHECK(GetSeeingFaces(DirectX::BoundingBox(DirectX::XMFLOAT3(5.0f, 5.0f, 0.0f), small)) == (1u | 4u));
+		CHECK(GetSeeingFaces(DirectX::BoundingBox(DirectX::XMFLOAT3(5.0f, 5.0f, -5.0f), small)) == (1u | 4u | 32u));
+
+		// A box around the probe is seen by every face, a floor below it by every face
+		// but +Y
+		CHECK(GetSeeingFaces(DirectX::BoundingBox(Origin, small)) == 63u);
+		CHECK(GetSeeingFaces(DirectX::BoundingBox(DirectX::XMFLOAT3(0.0f, -2.0f, 0.0f), DirectX::XMFLOAT3(50.0f, 0.1f, 50.0f))) == 63u - 4u);
+
+		// The probe position is taken into account
+		DirectX::XMFLOAT3 probe(10.0f, 0.0f, 0.0f);
+		DirectX::BoundingBox box(DirectX::XMFLOAT3(5.0f, 0.0f, 0.0f), small);
+		CHECK(CubeFaceScheduler::FaceSeesBox(probe, 1, box));
+		CHECK(!CubeFaceScheduler::FaceSeesBox(probe, 0, box));
+	}
+
+	void TestInvalidateBounds()
+	{
+		CubeFaceScheduler scheduler;
+		uint32_t probe = scheduler.AddProbe(Origin, 20.0f);
+		CHECK(scheduler.GetDirtyFaceCount() == 6);
+
+		std::vector<CubeFaceUpdate> faces;
+		scheduler.Schedule(Origin, 6, faces);
+		CHECK(scheduler.GetDirtyFaceCount() == 0);
+
+		// Only the face that sees the change, and nothing beyond the capture range
+		DirectX::XMFLOAT3 small(0.5f, 0.5f, 0.5f);
+		scheduler.InvalidateBounds(DirectX::BoundingBox(DirectX::XMFLOAT3(0.0f, 0.0f, -10.0f), small));
+		CHECK(scheduler.GetDirtyFaceCount() == 1);
+		CHECK(scheduler.IsFaceDirty(probe, 5));
+
+		scheduler.InvalidateBounds(DirectX::BoundingBox(DirectX::XMFLOAT3(0.0f, 30.0f, 0.0f), small));
+		CHECK(scheduler.GetDirtyFaceCount() == 1);
+
+		// Setting the same position changes nothing; moving dirties every face
+		scheduler.SetProbePosition(probe, Origin);
+		CHECK(scheduler.GetDirtyFaceCount() == 1);
+		scheduler.SetProbePosition(probe, DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f));
+		CHECK(scheduler.GetDirtyFaceCount() == 6);
+	}
+
+	void TestBudget()
+	{
+		CubeFaceScheduler scheduler;
+		scheduler.AddProbe(Origin, 100.0f);
+		scheduler.AddProbe(DirectX::XMFLOAT3(10.0f, 0.0f, 0.0f), 100.0f);
+
+		// No more than the budget per frame, each face once, until all are clean
+		std::vector<CubeFaceUpdate> faces;
+		bool isCaptured[2][6] = {};
+		int captured = 0;
+		for (int frame = 0; frame < 3; ++frame)
+		{
+			scheduler.Schedule(Origin, 5, faces);
+			CHECK(faces.size() == (frame < 2 ? 5u : 2u));
+			for (const CubeFaceUpdate& face : faces)
+			{
+				CHECK(!isCaptured[face.Probe][face.Face]);
+				CHECK(!scheduler.IsFaceDirty(face.Probe, face.Face));
+				isCaptured[face.Probe][face.Face] = true;
+				++captured;
+			}
+		}
+		CHECK(captured == 12);
+		CHECK(scheduler.GetDirtyFaceCount() == 0);
+
+		scheduler.Schedule(Origin, 5, faces);
+		CHECK(faces.empty());
+
+		// A zero budget hands out nothing and leaves the faces dirty
+		scheduler.InvalidateAll();
+		scheduler.Schedule(Origin, 0, faces);
+		CHECK(faces.empty());
+		CHECK(scheduler.GetDirtyFaceCount() == 12);
+	}
+
+	// Two probes 10 units apart with the camera at the near one. Near faces dirtied now
+	// compete with far faces dirtied waited frames ago, at one unit per frame.
+	bool IsFarProbeFirst(uint32_t waited, bool isFarDirtiedAgain)
+	{
+		CubeFaceScheduler scheduler;
+		uint32_t near = scheduler.AddProbe(Origin, 100.0f);
+		uint32_t far = scheduler.AddProbe(DirectX::XMFLOAT3(0.0f, 0.0f, 10.0f), 100.0f);
+		scheduler.SetStalenessWeight(1.0f);
+
+		std::vector<CubeFaceUpdate> faces;
+		scheduler.Schedule(Origin, 12, faces);
+
+		scheduler.InvalidateProbe(far);
+		for (uint32_t frame = 0; frame < waited; ++frame)
+		{
+			scheduler.Schedule(Origin, 0, faces);
+		}
+
+		// Further changes to a face that is already dirty keep its first dirty frame
+		if (isFarDirtiedAgain)
+		{
+			scheduler.InvalidateAll();
+		}
+		scheduler.InvalidateProbe(near);
+
+		scheduler.Schedule(Origin, 6, faces);
+		bool isFarFirst = faces.size() == 6;
+		for (const CubeFaceUpdate& face : faces)
+		{
+			isFarFirst = isFarFirst && face.Probe == far;
+		}
+		return isFarFirst;
+	}
+
+	void TestStaleness()
+	{
+		// Dirtied together, the nearer probe goes first
+		CHECK(!IsFarProbeFirst(0, false));
+
+		// A face dirty for longer than its extra distance is worth overtakes
+		CHECK(!IsFarProbeFirst(5, false));
+		CHECK(IsFarProbeFirst(20, false));
+
+		// Dirtying it again does not reset how long it has waited
+		CHECK(IsFarProbeFirst(20, true));
+	}
+}
+
+int main()
+{
+	TestFaceSeesBox();
+	TestInvalidateBounds();
+	TestBudget();
+	TestStaleness();
+
+	return ReportChecks("CubeFaceScheduler");
+}
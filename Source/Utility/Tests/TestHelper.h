@@ -0,0 +1,42 @@
+/*  =======================
+	Summary: Checks shared by the CPU tests
+	=======================  */
+
+#ifndef TESTHELPER_H
+#define TESTHELPER_H
+
+#include <cmath>
+#include <cstdio>
+
+// Every test is its own executable; main returns the number of failed checks.
+static int sFailedChecks = 0;
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); \
+			++sFailedChecks; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do \
+	{ \
+		double checkA = (a); \
+		double checkB = (b); \
+		if (!(fabs(checkA - checkB) <= (tolerance))) \
+		{ \
+			printf("%s(%d): check failed: %s = %g, %s = %g\n", __FILE__, __LINE__, #a, checkA, #b, checkB); \
+			++sFailedChecks; \
+		} \
+	} while (0)
+
+inline int ReportChecks(const char* name)
+{
+	printf("%s: %s\n", name, sFailedChecks == 0 ? "passed" : "FAILED");
+	return sFailedChecks;
+}
+
+#endif // TESTHELPER_H
\ No newline at end of file
@@ -0,0 +1,139 @@
+/*  =======================
+	Summary: Checks for the compact normal/depth encoding
+	=======================  */
+
+#include "NormalDepthEncoding.h"
+
+#include <cmath>
+#include <random>
+
+#include "TestHelper.h"
+
+namespace
+{
+	const double DegreesPerRadian = 57.295779513082321;
+
+	// Angle in degrees between a normal and the decode of its encoding stored at the
+	// given precision, or unquantized for 0 bits
+	double GetRoundTripAngle(const DirectX::XMFLOAT3& normal, uint32_t bits)
+	{
+		DirectX::XMFLOAT2 encoded = NormalDepthEncoding::EncodeNormal(normal);
+		if (bits > 0)
+		{
+			encoded.x = NormalDepthEncoding::QuantizeSnorm(encoded.x, bits);
+			encoded.y = NormalDepthEncoding::QuantizeSnorm(encoded.y, bits);
+		}
+
+		DirectX::XMFLOAT3 decoded = NormalDepthEncoding::DecodeNormal(encoded);
+		double cosine = decoded.x * normal.x + decoded.y * normal.y + decoded.z * normal.z;
+		return acos(cosine < 1.0 ? cosine : 1.0) * DegreesPerRadian;
+	}
+
+	void TestAxes()
+	{
+		const DirectX::XMFLOAT3 axes[] =
+		{
+			DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(-1.0f, 0.0f, 0.0f),
+			DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f), DirectX::XMFLOAT3(0.0f, -1.0f, 0.0f),
+			DirectX::XMFLOAT3(0.0f, 0.0f, 1.0f), DirectX::XMFLOAT3(0.0f, 0.0f, -1.0f)
+		};
+
+		// The axes sit on the octahedron's corners and survive even 8-bit storage exactly
+		for (const DirectX::XMFLOAT3& axis : axes)
+		{
+			CHECK(GetRoundTripAngle(axis, 0) == 0.0);
+			CHECK(GetRoundTripAngle(axis, 8) == 0.0);
+		}
+	}
+
+	void TestRandomNormals()
+	{
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+
+		const uint32_t bits[] = { 0, 16, 8 };
+		double maxAngle[3] = { 0.0, 0.0, 0.0 };
+		double meanAngle[3] = { 0.0, 0.0, 0.0 };
+		const int count = 100000;
+
+		for (int k = 0; k < count; ++k)
+		{
+			float x, y, z, lengthSq;
+			do
+			{
+				x = coordinate(random);
+				y = coordinate(random);
+				z = coordinate(random);
+				lengthSq = x * x + y * y + z * z;
+			} while (lengthSq > 1.0f || lengthSq < 1e-4f);
+
+			float invLength = 1.0f / sqrtf(lengthSq);
+			DirectX::XMFLOAT3 normal(x * invLength, y * invLength, z * invLength);
+
+			DirectX::XMFLOAT2 encoded = NormalDepthEncoding::EncodeNormal(normal);
+			CHECK(fabsf(encoded.x) <= 1.0f && fabsf(encoded.y) <= 1.0f);
+
+			for (int b = 0; b < 3; ++b)
+			{
+				double angle = GetRoundTripAngle(normal, bits[b]);
+				meanAngle[b] += angle / count;
+				maxAngle[b] = angle > maxAngle[b] ? angle : maxAngle[b];
+			}
+		}
+
+		// 16 bits lose nothing over unquantized floats; 8 bits stay under a degree
+		CHECK(maxAngle[0] < 0.05);
+		CHECK(maxAngle[1] < 0.05);
+		CHECK(maxAngle[2] < 1.0);
+		CHECK(meanAngle[2] < 0.4);
+	}
+
+	void TestQuantize()
+	{
+		CHECK(NormalDepthEncoding::QuantizeSnorm(1.0f, 8) == 1.0f);
+		CHECK(NormalDepthEncoding::QuantizeSnorm(-1.0f, 8) == -1.0f);
+		CHECK(NormalDepthEncoding::QuantizeSnorm(0.0f, 16) == 0.0f);
+		CHECK(NormalDepthEncoding::QuantizeSnorm(2.0f, 16) == 1.0f);
+		CHECK_NEAR(NormalDepthEncoding::QuantizeSnorm(0.5f, 8), 64.0 / 127.0, 1e-7);
+
+		CHECK(NormalDepthEncoding::QuantizeUnorm(0.0f, 24) == 0.0f);
+		CHECK(NormalDepthEncoding::QuantizeUnorm(1.0f, 24) == 1.0f);
+		CHECK(NormalDepthEncoding::QuantizeUnorm(-0.5f, 24) == 0.0f);
+	}
+
+	void TestDepth()
+	{
+		const float nearZ = 1.0f;
+		const float farZ = 1000.0f;
+
+		// The parameters are the projection's own depth terms
+		DirectX::XMFLOAT2 params = NormalDepthEncoding::GetDepthParams(nearZ, farZ);
+		DirectX::XMFLOAT4X4 proj;
+		DirectX::XMStoreFloat4x4(&proj, DirectX::XMMatrixPerspectiveFovLH(0.785f, 1.5f, nearZ, farZ));
+		CHECK_NEAR(params.x, proj.m[2][2], 1e-6);
+		CHECK_NEAR(params.y, proj.m[3][2], 1e-6);
+
+		CHECK_NEAR(NormalDepthEncoding::HardwareDepthFromView(nearZ, params), 0.0, 1e-6);
+		CHECK_NEAR(NormalDepthEncoding::HardwareDepthFromView(farZ, params), 1.0, 1e-6);
+
+		// Through a D24 buffer view depth comes back within 0.008% over the whole range
+		double maxRelativeError = 0.0;
+		for (float z = nearZ; z < farZ; z *= 1.01f)
+		{
+			float depth = NormalDepthEncoding::QuantizeUnorm(NormalDepthEncoding::HardwareDepthFromView(z, params), 24);
+			double error = fabs(NormalDepthEncoding::ViewDepthFromHardware(depth, params) - z) / z;
+			maxRelativeError = error > maxRelativeError ? error : maxRelativeError;
+		}
+		CHECK(maxRelativeError < 8e-5);
+	}
+}
+
+int main()
+{
+	TestAxes();
+	TestRandomNormals();
+	TestQuantize();
+	TestDepth();
+
+	return ReportChecks("NormalDepthEncoding");
+}
@@ -0,0 +1,223 @@
+/*  =======================
+	Summary: Checks for the frame render graph
+	=======================  */
+
+#include "RenderGraph.h"
+
+#include <vector>
+
+#include "TestHelper.h"
+
+namespace
+{
+	const RGTextureDesc ColorDesc = { 1280, 720, 28, 4 };
+	const RGTextureDesc HalfDesc = { 640, 360, 28, 4 };
+
+	void RecordNothing(CommandBuffer&)
+	{
+	}
+
+	bool IsOrder(const RenderGraph& graph, const std::vector<uint32_t>& expected)
+	{
+		return graph.GetExecutionOrder() == expected;
+	}
+
+	// A pass stays alive when a later live pass builds on the version it wrote, even if
+	// nothing reads that version directly
+	void TestCulling()
+	{
+		RenderGraph graph;
+		RGHandle scene = graph.CreateTexture("Scene", ColorDesc);
+		RGHandle unused = graph.CreateTexture("Unused", ColorDesc);
+
+		uint32_t opaque = graph.AddPass("Opaque", RecordNothing);
+		RGHandle lit = graph.Write(opaque, scene, RG_BIND_RENDER_TARGET);
+
+		uint32_t sky = graph.AddPass("Sky", RecordNothing);
+		RGHandle withSky = graph.Write(sky, lit, RG_BIND_RENDER_TARGET);
+
+		uint32_t debug = graph.AddPass("Debug", RecordNothing);
+		graph.Read(debug, lit, STAGE_PS, 0);
+		graph.Write(debug, unused, RG_BIND_RENDER_TARGET);
+
+		graph.MarkOutput(withSky);
+		CHECK(graph.Compile());
+
+		CHECK(!graph.IsPassCulled(opaque));
+		CHECK(!graph.IsPassCulled(sky));
+		CHECK(graph.IsPassCulled(debug));
+		CHECK(IsOrder(graph, { opaque, sky }));
+
+		// Unused transients get no memory
+		CHECK(graph.GetPhysicalTexture(unused) == RenderGraph::InvalidIndex);
+		CHECK(graph.GetPhysicalTextureCount() == 1);
+	}
+
+	// Passes sampling a version run before the pass that overwrites it, even when the
+	// overwriting pass was declared first
+	void TestWriteAfterRead()
+	{
+		RenderGraph graph;
+		RGHandle depth = graph.CreateTexture("Depth", ColorDesc);
+		RGHandle ao = graph.CreateTexture("AO", ColorDesc);
+		RGHandle backBuffer = graph.ImportTexture("BackBuffer");
+
+		uint32_t prepass = graph.AddPass("Prepass", RecordNothing);
+		RGHandle depth1 = graph.Write(prepass, depth, RG_BIND_DEPTH_STENCIL);
+
+		uint32_t decals = graph.AddPass("Decals", RecordNothing);
+		RGHandle depth2 = graph.Write(decals, depth1, RG_BIND_DEPTH_STENCIL);
+
+		uint32_t ssao = graph.AddPass("SSAO", RecordNothing);
+		graph.Read(ssao, depth1, STAGE_PS, 0);
+		RGHandle ao1 = graph.Write(ssao, ao, RG_BIND_RENDER_TARGET);
+
+		uint32_t shade = graph.AddPass("Shade", RecordNothing);
+		graph.Read(shade, ao1, STAGE_PS, 1);
+		graph.Write(shade, depth2, RG_BIND_DEPTH_STENCIL);
+		RGHandle presented = graph.Write(shade, backBuffer, RG_BIND_RENDER_TARGET);
+
+		graph.MarkOutput(presented);
+		CHECK(graph.Compile());
+		CHECK(IsOrder(graph, { prepass, ssao, decals, shade }));
+	}
+
+	void TestCycle()
+	{
+		RenderGraph graph;
+		RGHandle a = graph.CreateTexture("A", ColorDesc);
+		RGHandle b = graph.CreateTexture("B", ColorDesc);
+
+		uint32_t first = graph.AddPass("First", RecordNothing);
+		uint32_t second = graph.AddPass("Second", RecordNothing);
+
+		RGHandle a1 = graph.Write(first, a, RG_BIND_RENDER_TARGET);
+		RGHandle b1 = graph.Write(second, b, RG_BIND_RENDER_TARGET);
+		graph.Read(first, b1, STAGE_PS, 0);
+		graph.Read(second, a1, STAGE_PS, 0);
+
+		graph.MarkOutput(a1);
+		CHECK(!graph.Compile());
+		CHECK(graph.GetExecutionOrder().empty());
+
+		// Starting over gives a usable graph again
+		graph.Reset();
+		RGHandle c = graph.CreateTexture("C", ColorDesc);
+		uint32_t only = graph.AddPass("Only", RecordNothing);
+		graph.MarkOutput(graph.Write(only, c, RG_BIND_RENDER_TARGET));
+		CHECK(graph.Compile());
+		CHECK(IsOrder(graph, { only }));
+	}
+
+	// A chain of full screen passes: each transient lives from the pass that writes it
+	// to the pass that reads it
+	void TestAliasing()
+	{
+		RenderGraph graph;
+		RGHandle a = graph.CreateTexture("A", ColorDesc);
+		RGHandle b = graph.CreateTexture("B", ColorDesc);
+		RGHandle c = graph.CreateTexture("C", ColorDesc);
+		RGHandle half = graph.CreateTexture("Half", HalfDesc);
+		RGHandle backBuffer = graph.ImportTexture("BackBuffer");
+
+		uint32_t p0 = graph.AddPass("P0", RecordNothing);
+		RGHandle a1 = graph.Write(p0, a, RG_BIND_RENDER_TARGET);
+
+		uint32_t p1 = graph.AddPass("P1", RecordNothing);
+		graph.Read(p1, a1, STAGE_PS, 0);
+		RGHandle b1 = graph.Write(p1, b, RG_BIND_RENDER_TARGET);
+
+		uint32_t p2 = graph.AddPass("P2", RecordNothing);
+		graph.Read(p2, b1, STAGE_PS, 0);
+		RGHandle c1 = graph.Write(p2, c, RG_BIND_RENDER_TARGET);
+		RGHandle half1 = graph.Write(p2, half, RG_BIND_RENDER_TARGET, 1);
+
+		uint32_t p3 = graph.AddPass("P3", RecordNothing);
+		graph.Read(p3, c1, STAGE_PS, 0);
+		graph.Read(p3, half1, STAGE_PS, 1);
+		RGHandle presented = graph.Write(p3, backBuffer, RG_BIND_RENDER_TARGET);
+
+		graph.MarkOutput(presented);
+		CHECK(graph.Compile());
+		CHECK(IsOrder(graph, { p0, p1, p2, p3 }));
+
+		// A's last use is B's first, so B cannot take A's memory; C starts after A ends
+		// and can. Half has another shape and gets its own.
+		CHECK(graph.GetPhysicalTexture(a1) != graph.GetPhysicalTexture(b1));
+		CHECK(graph.GetPhysicalTexture(c1) == graph.GetPhysicalTexture(a1));
+		CHECK(graph.GetPhysicalTexture(half1) != graph.GetPhysicalTexture(a1));
+		CHECK(graph.GetPhysicalTexture(half1) != graph.GetPhysicalTexture(b1));
+		CHECK(graph.GetPhysicalTexture(presented) == RenderGraph::InvalidIndex);
+		CHECK(graph.GetPhysicalTextureCount() == 3);
+
+		uint32_t shared = graph.GetPhysicalTexture(a1);
+		CHECK(graph.GetPhysicalBindFlags(shared) == (RG_BIND_RENDER_TARGET | RG_BIND_SHADER_RESOURCE));
+		CHECK(graph.GetPhysicalTextureDesc(shared).Width == ColorDesc.Width);
+
+		uint64_t full = RenderGraph::GetTextureBytes(ColorDesc);
+		uint64_t small = RenderGraph::GetTextureBytes(HalfDesc);
+		CHECK(graph.GetTransientBytes() == 2 * full + small);
+		CHECK(graph.GetUnaliasedBytes() == 3 * full + small);
+	}
+
+	// History is sampled by one pass and rendered to by a later one: the sampling pass
+	// clears its slot and the rendering pass clears its targets
+	void TestUnbinds()
+	{
+		RenderGraph graph;
+		RGHandle history = graph.ImportTexture("History");
+		RGHandle diffuse = graph.ImportTexture("Diffuse");
+		RGHandle backBuffer = graph.ImportTexture("BackBuffer");
+
+		uint32_t resolve = graph.AddPass("Resolve", RecordNothing);
+		graph.Read(resolve, history, STAGE_PS, 3);
+		graph.Read(resolve, diffuse, STAGE_PS, 0);
+		RGHandle presented = graph.Write(resolve, backBuffer, RG_BIND_RENDER_TARGET);
+
+		uint32_t store = graph.AddPass("Store", RecordNothing);
+		RGHandle stored = graph.Write(store, history, RG_BIND_RENDER_TARGET);
+
+		graph.MarkOutput(presented);
+		graph.MarkOutput(stored);
+		CHECK(graph.Compile());
+		CHECK(IsOrder(graph, { resolve, store }));
+
+		// Diffuse is never written, and nothing samples the back buffer
+		CHECK(graph.GetUnbindCount() == 2);
+
+		CommandBuffer commands;
+		graph.RecordPass(0, commands);
+		int count = 0;
+		for (const CmdHeader* cmd = commands.Begin(); cmd != commands.End(); cmd = CommandBuffer::Next(cmd))
+		{
+			const CmdSetShaderResources* clear = reinterpret_cast<const CmdSetShaderResources*>(cmd);
+			CHECK(cmd->Type == CMD_SET_SHADER_RESOURCES);
+			CHECK(clear->Stage == STAGE_PS && clear->StartSlot == 3 && clear->Count == 1);
+			++count;
+		}
+		CHECK(count == 1);
+
+		commands.Reset();
+		graph.RecordPass(1, commands);
+		count = 0;
+		for (const CmdHeader* cmd = commands.Begin(); cmd != commands.End(); cmd = CommandBuffer::Next(cmd))
+		{
+			const CmdSetRenderTargets* clear = reinterpret_cast<const CmdSetRenderTargets*>(cmd);
+			CHECK(cmd->Type == CMD_SET_RENDER_TARGETS);
+			CHECK(clear->Count == 0 && clear->DSV == nullptr);
+			++count;
+		}
+		CHECK(count == 1);
+	}
+}
+
+int main()
+{
+	TestCulling();
+	TestWriteAfterRead();
+	TestCycle();
+	TestAliasing();
+	TestUnbinds();
+
+	return ReportChecks("RenderGraph");
+}
@@ -0,0 +1,223 @@
+/*  =======================
+	Summary: Checks for the sort key render queue
+	=======================  */
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "TestHelper.h"
+
+namespace
+{
+	// The payload is the order of adding, so stability shows in the payloads
+	void FillQueue(RenderQueue& queue, const std::vector<uint64_t>& keys)
+	{
+		queue.Reset();
+		for (uint32_t i = 0; i < keys.size(); ++i)
+		{
+			queue.Add(keys[i], i);
+		}
+	}
+
+	bool IsStableSorted(RenderQueue& queue, const std::vector<uint64_t>& keys)
+	{
+		std::vector<RenderQueueItem> expected;
+		for (uint32_t i = 0; i < keys.size(); ++i)
+		{
+			RenderQueueItem item = { keys[i], i };
+			expected.push_back(item);
+		}
+		std::stable_sort(expected.begin(), expected.end(),
+			[](const RenderQueueItem& a, const RenderQueueItem& b) { return a.SortKey < b.SortKey; });
+
+		FillQueue(queue, keys);
+		queue.Sort();
+
+		bool isSame = queue.GetItemCount() == expected.size();
+		for (uint32_t i = 0; isSame && i < expected.size(); ++i)
+		{
+			isSame = queue.GetItem(i).SortKey == expected[i].SortKey && queue.GetItem(i).Payload == expected[i].Payload;
+		}
+		return isSame;
+	}
+
+	void TestRandomKeys()
+	{
+		std::mt19937_64 random(5);
+		RenderQueue queue;
+
+		// Full 64-bit keys, and scene-like keys with few distinct states and many ties
+		std::vector<uint64_t> keys(5000);
+		for (uint64_t& key : keys)
+		{
+			key = random();
+		}
+		CHECK(IsStableSorted(queue, keys));
+
+		for (uint64_t& key : keys)
+		{
+			key = RenderQueue::MakeKey(random() % 3, random() % 4, random() % 8, random() % 50, random() % 16);
+		}
+		CHECK(IsStableSorted(queue, keys));
+
+		// Odd and tiny sizes
+		keys.resize(7);
+		CHECK(IsStableSorted(queue, keys));
+		keys.resize(1);
+		CHECK(IsStableSorted(queue, keys));
+		keys.clear();
+		CHECK(IsStableSorted(queue, keys));
+	}
+
+	// Only the top byte differs: seven passes are skipped and the one that runs must
+	// leave the result in the queue, not the scratch buffer
+	void TestHighByte()
+	{
+		std::mt19937_64 random(9);
+		std::vector<uint64_t> keys(1000);
+		for (uint64_t& key : keys)
+		{
+			key = ((random() & 0xff) << 56) | 0x0012345678abcdefull;
+		}
+
+		RenderQueue queue;
+		CHECK(IsStableSorted(queue, keys));
+
+		// Layers sit in the top byte, so layer order alone decides the draw order
+		for (uint32_t i = 0; i < keys.size(); ++i)
+		{
+			keys[i] = RenderQueue::MakeKey(static_cast<uint32_t>(keys.size() - i) % 16, 0, 0, 0, 0);
+		}
+		CHECK(IsStableSorted(queue, keys));
+		CHECK(queue.GetItem(0).SortKey == 0);
+		CHECK(queue.GetItem(queue.GetItemCount() - 1).SortKey == RenderQueue::MakeKey(15, 0, 0, 0, 0));
+	}
+
+	// Bytes shared by every key are skipped without disturbing the order
+	void TestSharedBytes()
+	{
+		// All keys equal: nothing moves at all
+		std::vector<uint64_t> keys(100, 0xdeadbeefcafef00dull);
+		RenderQueue queue;
+		CHECK(IsStableSorted(queue, keys));
+		for (uint32_t i = 0; i < keys.size(); ++i)
+		{
+			CHECK(queue.GetItem(i).Payload == i);
+		}
+
+		// Two differing bytes with shared bytes between and around them
+		std::mt19937_64 random(13);
+		for (uint64_t& key : keys)
+		{
+			key = 0x1100220033004400ull | ((random() & 0xff) << 48) | ((random() & 0xff) << 8);
+		}
+		CHECK(IsStableSorted(queue, keys));
+	}
+
+	bool IsRun(const RenderQueueRun& run, uint32_t first, uint32_t count)
+	{
+		return run.First == first && run.Count == count;
+	}
+
+	void TestBuildRuns()
+	{
+		RenderQueue queue;
+		std::vector<RenderQueueRun> runs(3);
+
+		// Nothing queued gives no runs, and clears what was passed in
+		queue.BuildRuns(~0ull, 16, runs);
+		CHECK(runs.empty());
+
+		// Depth is masked off, so draws of one state form a run whatever their depth
+		const uint64_t stateMask = ~RenderQueue::DepthMask;
+		for (uint32_t i = 0; i < 5; ++i)
+		{
+			queue.Add(RenderQueue::MakeKey(0, 1, 0, 7, 100 + i), i);
+		}
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			queue.Add(RenderQueue::MakeKey(0, 1, 0, 8, 50 + i), 5 + i);
+		}
+		queue.Add(RenderQueue::MakeKey(0, 2, 0, 8, 0), 8);
+		queue.Sort();
+
+		queue.BuildRuns(stateMask, 16, runs);
+		CHECK(runs.size() == 3);
+		CHECK(IsRun(runs[0], 0, 5));
+		CHECK(IsRun(runs[1], 5, 3));
+		CHECK(IsRun(runs[2], 8, 1));
+
+		// With depth in the mask every draw differs
+		queue.BuildRuns(~0ull, 16, runs);
+		CHECK(runs.size() == 9);
+
+		// Long runs are cut at maxCount and continue in a new run of the same state
+		queue.BuildRuns(stateMask, 2, runs);
+		CHECK(runs.size() == 6);
+		CHECK(IsRun(runs[0], 0, 2));
+		CHECK(IsRun(runs[1], 2, 2));
+		CHECK(IsRun(runs[2], 4, 1));
+		CHECK(IsRun(runs[3], 5, 2));
+		CHECK(IsRun(runs[4], 7, 1));
+		CHECK(IsRun(runs[5], 8, 1));
+
+		// A run that fills maxCount exactly is not followed by an empty one
+		queue.BuildRuns(stateMask, 5, runs);
+		CHECK(runs.size() == 3);
+		CHECK(IsRun(runs[0], 0, 5));
+
+		// The runs add up to the queue and the number of state changes
+		uint32_t total = 0;
+		for (const RenderQueueRun& run : runs)
+		{
+			total += run.Count;
+		}
+		CHECK(total == queue.GetItemCount());
+		CHECK(queue.CountChanges(stateMask) == 3);
+	}
+
+	// Sorting 10k random keys should take well under half a millisecond in an optimised
+	// build. The time is printed rather than checked, as debug builds and busy machines
+	// are slower.
+	void TimeSort()
+	{
+		const int keyCount = 10000;
+		const int repeats = 50;
+
+		std::mt19937_64 random(17);
+		std::vector<uint64_t> keys(keyCount);
+		RenderQueue queue;
+		double seconds = 0.0;
+
+		for (int r = 0; r < repeats; ++r)
+		{
+			for (uint64_t& key : keys)
+			{
+				key = random();
+			}
+			FillQueue(queue, keys);
+
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			queue.Sort();
+			std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+			seconds += std::chrono::duration<double>(end - start).count();
+		}
+
+		printf("RenderQueue: %d random keys sorted in %.3f ms\n", keyCount, 1000.0 * seconds / repeats);
+	}
+}
+
+int main()
+{
+	TestRandomKeys();
+	TestHighByte();
+	TestSharedBytes();
+	TestBuildRuns();
+	TimeSort();
+
+	return ReportChecks("RenderQueue");
+}
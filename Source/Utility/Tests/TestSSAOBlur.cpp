@@ -0,0 +1,218 @@
+/*  =======================
+	Summary: Checks for the edge-aware SSAO blur
+	=======================  */
+
+#include "SSAOBlur.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "TestHelper.h"
+
+namespace
+{
+	const int Width = 160;
+	const int Height = 90;
+
+	// A disc facing the camera in front of a floor, with noisy AO on both
+	void BuildScene(std::vector<float>& normalDepth, std::vector<float>& ao, float noise)
+	{
+		normalDepth.resize(4 * Width * Height);
+		ao.resize(Width * Height);
+		srand(3);
+
+		for (int y = 0; y < Height; ++y)
+		{
+			for (int x = 0; x < Width; ++x)
+			{
+				bool isForeground = (x - 80) * (x - 80) + (y - 45) * (y - 45) < 900;
+
+				float* texel = &normalDepth[4 * (y * Width + x)];
+				texel[0] = 0.0f;
+				texel[1] = isForeground ? 0.0f : 1.0f;
+				texel[2] = isForeground ? -1.0f : 0.0f;
+				texel[3] = isForeground ? 5.0f : 20.0f + 0.01f * y;
+
+				float random = static_cast<float>(rand()) / RAND_MAX - 0.5f;
+				ao[y * Width + x] = (isForeground ? 0.4f : 0.8f) + noise * random;
+			}
+		}
+	}
+
+	// One horizontal step of BlurPS.hlsl, transcribed statement by statement
+	void BlurPSShader(const float* ao, const float* normalDepth, float* blurred)
+	{
+		const float weights[11] = { 0.05f, 0.05f, 0.1f, 0.1f, 0.1f, 0.2f, 0.1f, 0.1f, 0.1f, 0.05f, 0.05f };
+
+		for (int y = 0; y < Height; ++y)
+		{
+			for (int x = 0; x < Width; ++x)
+			{
+				const float* center = &normalDepth[4 * (y * Width + x)];
+				float color = weights[5] * ao[y * Width + x];
+				float totalWeight = weights[5];
+
+				for (float i = -5.0f; i <= 5.0f; ++i)
+				{
+					if (i == 0.0f)
+					{
+						continue;
+					}
+
+					int sx = x + static_cast<int>(i);
+					sx = sx < 0 ? 0 : (sx >= Width ? Width - 1 : sx);
+					const float* neighbor = &normalDepth[4 * (y * Width + sx)];
+
+					if ((neighbor[0] * center[0] + neighbor[1] * center[1] + neighbor[2] * center[2] >= 0.8f) &&
+						(fabsf(neighbor[3] - center[3]) <= 0.2f))
+					{
+						float weight = weights[static_cast<int>(i) + 5];
+						color += weight * ao[y * Width + sx];
+						totalWeight += weight;
+					}
+				}
+
+				blurred[y * Width + x] = color / totalWeight;
+			}
+		}
+	}
+
+	// Standard deviation from the surface's noise-free AO, inside the floor
+	double GetFloorNoise(const std::vector<float>& ao)
+	{
+		double sum = 0.0;
+		int count = 0;
+		for (int y = 10; y < 80; ++y)
+		{
+			for (int x = 120; x < 150; ++x)
+			{
+				double error = ao[y * Width + x] - 0.8;
+				sum += error * error;
+				++count;
+			}
+		}
+
+		return sqrt(sum / count);
+	}
+
+	void TestBuildWeights()
+	{
+		float weights[SSAOBlur::WeightCount];
+
+		for (int radius = 1; radius <= SSAOBlur::MaxRadius; ++radius)
+		{
+			SSAOBlur::BuildWeights(radius, weights);
+
+			double total = weights[0];
+			for (int i = 1; i < SSAOBlur::WeightCount; ++i)
+			{
+				total += 2.0 * weights[i];
+				CHECK(i <= radius ? weights[i] > 0.0f && weights[i] < weights[i - 1] : weights[i] == 0.0f);
+			}
+			CHECK_NEAR(total, 1.0, 1e-5);
+		}
+
+		// Out of range radii are clamped
+		float clamped[SSAOBlur::WeightCount];
+		SSAOBlur::BuildWeights(100, clamped);
+		SSAOBlur::BuildWeights(SSAOBlur::MaxRadius, weights);
+		CHECK(memcmp(clamped, weights, sizeof(weights)) == 0);
+	}
+
+	void TestMatchesShader()
+	{
+		std::vector<float> normalDepth;
+		std::vector<float> ao;
+		BuildScene(normalDepth, ao, 0.3f);
+
+		std::vector<float> expected(Width * Height);
+		std::vector<float> blurred(Width * Height);
+		BlurPSShader(ao.data(), normalDepth.data(), expected.data());
+		SSAOBlur::BlurPS(ao.data(), normalDepth.data(), Width, Height, true, blurred.data());
+		CHECK(memcmp(expected.data(), blurred.data(), expected.size() * sizeof(float)) == 0);
+
+		// The compute path with BlurPS's kernel does the same operations in the same order
+		float weights[SSAOBlur::WeightCount] = { 0.2f, 0.1f, 0.1f, 0.1f, 0.05f, 0.05f };
+		std::vector<float> separable(Width * Height);
+		SSAOBlur::BlurSeparable(ao.data(), normalDepth.data(), Width, Height, true, 5, weights, separable.data());
+		CHECK(memcmp(expected.data(), separable.data(), expected.size() * sizeof(float)) == 0);
+	}
+
+	void TestEdges()
+	{
+		// Without noise each surface is constant, so no surface may bleed into the other
+		std::vector<float> normalDepth;
+		std::vector<float> ao;
+		BuildScene(normalDepth, ao, 0.0f);
+
+		float weights[SSAOBlur::WeightCount];
+		SSAOBlur::BuildWeights(SSAOBlur::MaxRadius, weights);
+
+		std::vector<float> horizontal(Width * Height);
+		std::vector<float> blurred(Width * Height);
+		SSAOBlur::BlurSeparable(ao.data(), normalDepth.data(), Width, Height, true, SSAOBlur::MaxRadius, weights, horizontal.data());
+		SSAOBlur::BlurSeparable(horizontal.data(), normalDepth.data(), Width, Height, false, SSAOBlur::MaxRadius, weights, blurred.data());
+
+		float maxError = 0.0f;
+		for (int i = 0; i < Width * Height; ++i)
+		{
+			maxError = fmaxf(maxError, fabsf(blurred[i] - ao[i]));
+		}
+		CHECK(maxError < 1e-5f);
+	}
+
+	// One pass at the default radius replaces four BlurPS iterations
+	void TestDefaultRadius()
+	{
+		std::vector<float> normalDepth;
+		std::vector<float> ao;
+		BuildScene(normalDepth, ao, 0.3f);
+
+		std::vector<float> iterated = ao;
+		std::vector<float> scratch(Width * Height);
+		for (int i = 0; i < 4; ++i)
+		{
+			SSAOBlur::BlurPS(iterated.data(), normalDepth.data(), Width, Height, true, scratch.data());
+			SSAOBlur::BlurPS(scratch.data(), normalDepth.data(), Width, Height, false, iterated.data());
+		}
+
+		float weights[SSAOBlur::WeightCount];
+		SSAOBlur::BuildWeights(SSAOBlur::DefaultRadius, weights);
+
+		std::vector<float> blurred(Width * Height);
+		SSAOBlur::BlurSeparable(ao.data(), normalDepth.data(), Width, Height, true, SSAOBlur::DefaultRadius, weights, scratch.data());
+		SSAOBlur::BlurSeparable(scratch.data(), normalDepth.data(), Width, Height, false, SSAOBlur::DefaultRadius, weights, blurred.data());
+
+		double meanError = 0.0;
+		double maxError = 0.0;
+		for (int i = 0; i < Width * Height; ++i)
+		{
+			double error = fabs(iterated[i] - blurred[i]);
+			meanError += error;
+			maxError = error > maxError ? error : maxError;
+		}
+		meanError /= Width * Height;
+
+		CHECK(meanError < 0.001);
+		CHECK(maxError < 0.015);
+
+		// And removes about as much noise
+		double noise = GetFloorNoise(ao);
+		double iteratedNoise = GetFloorNoise(iterated);
+		double blurredNoise = GetFloorNoise(blurred);
+		CHECK(blurredNoise < 0.2 * noise);
+		CHECK(blurredNoise < 1.25 * iteratedNoise);
+	}
+}
+
+int main()
+{
+	TestBuildWeights();
+	TestMatchesShader();
+	TestEdges();
+	TestDefaultRadius();
+
+	return ReportChecks("SSAOBlur");
+}
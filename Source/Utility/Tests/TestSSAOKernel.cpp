@@ -0,0 +1,162 @@
+/*  =======================
+	Summary: Checks for the SSAO kernel and noise generation
+	=======================  */
+
+#include "SSAOKernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "TestHelper.h"
+
+namespace
+{
+	const double TwoPi = 6.2831853071795865;
+
+	// Fraction of a size x size pattern's spectral power at frequencies up to 4 cycles
+	// per tile, leaving out the mean
+	double GetLowFrequencyPower(const std::vector<double>& values, int size)
+	{
+		double mean = 0.0;
+		for (double value : values)
+		{
+			mean += value;
+		}
+		mean /= values.size();
+
+		double low = 0.0;
+		double total = 0.0;
+
+		for (int fy = -size / 2; fy < size / 2; ++fy)
+		{
+			for (int fx = -size / 2; fx < size / 2; ++fx)
+			{
+				if (fx == 0 && fy == 0)
+				{
+					continue;
+				}
+
+				double re = 0.0;
+				double im = 0.0;
+				for (int y = 0; y < size; ++y)
+				{
+					for (int x = 0; x < size; ++x)
+					{
+						double angle = TwoPi * (fx * x + fy * y) / size;
+						re += (values[y * size + x] - mean) * cos(angle);
+						im -= (values[y * size + x] - mean) * sin(angle);
+					}
+				}
+
+				double power = re * re + im * im;
+				total += power;
+				low += fx * fx + fy * fy <= 16 ? power : 0.0;
+			}
+		}
+
+		return low / total;
+	}
+
+	void TestBlueNoise()
+	{
+		const int size = SSAOKernel::NoiseSize;
+
+		std::vector<uint32_t> ranks;
+		SSAOKernel::BuildBlueNoise(size, ranks);
+		CHECK(ranks.size() == static_cast<size_t>(size * size));
+
+		// Every rank appears once
+		std::vector<uint32_t> sorted = ranks;
+		std::sort(sorted.begin(), sorted.end());
+		for (uint32_t i = 0; i < sorted.size(); ++i)
+		{
+			CHECK(sorted[i] == i);
+		}
+
+		// Almost no power at low frequencies, where white noise has its share of it
+		std::mt19937 random(1);
+		std::vector<double> blue(size * size);
+		std::vector<double> white(size * size);
+		for (int i = 0; i < size * size; ++i)
+		{
+			blue[i] = ranks[i];
+			white[i] = random();
+		}
+
+		CHECK(GetLowFrequencyPower(blue, size) < 1e-4);
+		CHECK(GetLowFrequencyPower(white, size) > 0.02);
+	}
+
+	void TestNoiseTexture()
+	{
+		std::vector<uint32_t> texels;
+		SSAOKernel::BuildNoiseTexture(SSAOKernel::NoiseSize, texels);
+		CHECK(texels.size() == SSAOKernel::NoiseSize * SSAOKernel::NoiseSize);
+
+		// Unit vectors up to 8-bit rounding, all in the z >= 0 hemisphere
+		float maxDeviation = 0.0f;
+		for (uint32_t texel : texels)
+		{
+			float x = (texel & 255) / 255.0f * 2.0f - 1.0f;
+			float y = ((texel >> 8) & 255) / 255.0f * 2.0f - 1.0f;
+			float z = ((texel >> 16) & 255) / 255.0f * 2.0f - 1.0f;
+
+			maxDeviation = std::max(maxDeviation, fabsf(sqrtf(x * x + y * y + z * z) - 1.0f));
+			CHECK(z > -0.01f);
+		}
+		CHECK(maxDeviation < 0.01f);
+	}
+
+	void TestKernel()
+	{
+		for (int q = 0; q < SSAO_QUALITY_COUNT; ++q)
+		{
+			uint32_t count = SSAOKernel::GetSampleCount(static_cast<SSAOQuality>(q));
+			CHECK(count >= 4 && count <= SSAOKernel::MaxSampleCount);
+
+			DirectX::XMFLOAT4 offsets[SSAOKernel::MaxSampleCount];
+			SSAOKernel::BuildKernel(count, offsets);
+
+			// Directions average out close to the hemisphere's mean, whose z is one half
+			double meanX = 0.0;
+			double meanY = 0.0;
+			double meanZ = 0.0;
+
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const DirectX::XMFLOAT4& o = offsets[i];
+				double length = sqrt(o.x * o.x + o.y * o.y + o.z * o.z);
+				CHECK(o.z >= 0.0f);
+				CHECK(length >= SSAOKernel::MinScale - 1e-5 && length <= 1.0 + 1e-5);
+
+				meanX += o.x / length / count;
+				meanY += o.y / length / count;
+				meanZ += o.z / length / count;
+
+				// No two directions coincide
+				for (uint32_t j = 0; j < i; ++j)
+				{
+					const DirectX::XMFLOAT4& p = offsets[j];
+					double cosine = (o.x * p.x + o.y * p.y + o.z * p.z) / (length * sqrt(p.x * p.x + p.y * p.y + p.z * p.z));
+					CHECK(cosine < 0.999);
+				}
+			}
+
+			// Four directions cannot balance sideways exactly; the per-pixel reflection
+			// averages that out
+			double sideways = sqrt(meanX * meanX + meanY * meanY);
+			CHECK(sideways < (count < 8 ? 0.2 : 0.06));
+			CHECK_NEAR(meanZ, 0.5, 1e-3);
+		}
+	}
+}
+
+int main()
+{
+	TestBlueNoise();
+	TestNoiseTexture();
+	TestKernel();
+
+	return ReportChecks("SSAOKernel");
+}
@@ -0,0 +1,149 @@
+/*  =======================
+	Summary: Checks for the reduced resolution SSAO resampling
+	=======================  */
+
+#include "SSAOResample.h"
+
+#include <cmath>
+#include <vector>
+
+#include "TestHelper.h"
+
+namespace
+{
+	const uint32_t Width = 641;
+	const uint32_t Height = 363;
+
+	// AO that varies smoothly over each surface but differs between them
+	float GetSurfaceAO(bool isForeground, float x, float y)
+	{
+		return isForeground ? 0.2f + 0.1f * cosf(x * 0.05f) : 0.6f + 0.3f * sinf(x * 0.03f) * cosf(y * 0.02f);
+	}
+
+	// A tilted disc at depth 5 in front of a wall at depth 20, with full resolution AO
+	void BuildScene(std::vector<float>& normalDepth, std::vector<float>& ao)
+	{
+		normalDepth.resize(4 * Width * Height);
+		ao.resize(Width * Height);
+
+		for (uint32_t y = 0; y < Height; ++y)
+		{
+			for (uint32_t x = 0; x < Width; ++x)
+			{
+				float dx = x - 320.0f;
+				float dy = y - 180.0f;
+				bool isForeground = dx * dx + dy * dy < 100.0f * 100.0f;
+
+				float* texel = &normalDepth[4 * (y * Width + x)];
+				texel[0] = 0.0f;
+				texel[1] = isForeground ? 0.6f : 0.0f;
+				texel[2] = isForeground ? -0.8f : -1.0f;
+				texel[3] = isForeground ? 5.0f : 20.0f + 0.01f * y;
+
+				ao[y * Width + x] = GetSurfaceAO(isForeground, static_cast<float>(x), static_cast<float>(y));
+			}
+		}
+	}
+
+	// Downsamples the scene, evaluates AO at the kept texels and upsamples it again. Also
+	// returns the nearest texel upsample of the same low resolution AO.
+	void Resample(const std::vector<float>& normalDepth, uint32_t factor, SSAODownsampleMode mode,
+		std::vector<float>& bilateral, std::vector<float>& nearest)
+	{
+		uint32_t reducedWidth = SSAOResample::GetReducedSize(Width, factor);
+		uint32_t reducedHeight = SSAOResample::GetReducedSize(Height, factor);
+
+		std::vector<float> reducedNormalDepth(4 * reducedWidth * reducedHeight);
+		std::vector<float> reducedAO(reducedWidth * reducedHeight);
+		SSAOResample::DownsampleNormalDepth(normalDepth.data(), Width, Height, factor, mode, reducedNormalDepth.data());
+
+		for (uint32_t j = 0; j < reducedHeight; ++j)
+		{
+			for (uint32_t i = 0; i < reducedWidth; ++i)
+			{
+				bool isForeground = reducedNormalDepth[4 * (j * reducedWidth + i) + 3] < 10.0f;
+				reducedAO[j * reducedWidth + i] = GetSurfaceAO(isForeground, (i + 0.5f) * factor, (j + 0.5f) * factor);
+			}
+		}
+
+		bilateral.resize(Width * Height);
+		SSAOResample::Upsample(reducedAO.data(), reducedNormalDepth.data(), factor, normalDepth.data(), Width, Height, bilateral.data());
+
+		nearest.resize(Width * Height);
+		for (uint32_t y = 0; y < Height; ++y)
+		{
+			for (uint32_t x = 0; x < Width; ++x)
+			{
+				nearest[y * Width + x] = reducedAO[(y / factor) * reducedWidth + x / factor];
+			}
+		}
+	}
+
+	void TestDownsample()
+	{
+		CHECK(SSAOResample::GetReducedSize(641, 2) == 321);
+		CHECK(SSAOResample::GetReducedSize(640, 4) == 160);
+		CHECK(SSAOResample::GetReducedSize(641, 4) == 161);
+
+		// 3x2 texels with increasing depth, reduced by 2: the right block is cut short
+		float normalDepth[4 * 6];
+		for (int i = 0; i < 6; ++i)
+		{
+			normalDepth[4 * i + 0] = static_cast<float>(i);
+			normalDepth[4 * i + 1] = 0.0f;
+			normalDepth[4 * i + 2] = -1.0f;
+			normalDepth[4 * i + 3] = 1.0f + i;
+		}
+
+		float reduced[4 * 2];
+		SSAOResample::DownsampleNormalDepth(normalDepth, 3, 2, 2, SSAO_DOWNSAMPLE_MIN, reduced);
+		CHECK(reduced[3] == 1.0f && reduced[7] == 3.0f);
+
+		SSAOResample::DownsampleNormalDepth(normalDepth, 3, 2, 2, SSAO_DOWNSAMPLE_MAX, reduced);
+		CHECK(reduced[3] == 5.0f && reduced[7] == 6.0f);
+
+		// Checkerboard alternates, and the whole texel is kept with its depth
+		SSAOResample::DownsampleNormalDepth(normalDepth, 3, 2, 2, SSAO_DOWNSAMPLE_CHECKERBOARD, reduced);
+		CHECK(reduced[3] == 1.0f && reduced[7] == 6.0f);
+		CHECK(reduced[4] == 5.0f);
+	}
+
+	void TestUpsample()
+	{
+		std::vector<float> normalDepth;
+		std::vector<float> reference;
+		BuildScene(normalDepth, reference);
+
+		std::vector<float> bilateral;
+		std::vector<float> nearest;
+
+		for (uint32_t factor = 2; factor <= 4; factor *= 2)
+		{
+			// Both sides of the disc edge survive, so the upsample stays close everywhere
+			Resample(normalDepth, factor, SSAO_DOWNSAMPLE_CHECKERBOARD, bilateral, nearest);
+			SSAOErrorStats stats = SSAOResample::Compare(reference.data(), bilateral.data(), Width * Height, 0.05f);
+			CHECK(stats.MaxError < 0.03f);
+			CHECK(stats.MeanError < 0.005f);
+			CHECK(stats.BadFraction == 0.0f);
+
+			// Taking the nearest low resolution texel bleeds one surface into the other
+			SSAOErrorStats nearestStats = SSAOResample::Compare(reference.data(), nearest.data(), Width * Height, 0.05f);
+			CHECK(nearestStats.MaxError > 0.5f);
+			CHECK(nearestStats.BadFraction > stats.BadFraction);
+		}
+
+		// At quarter resolution keeping only the nearest or farthest depth loses one side
+		Resample(normalDepth, 4, SSAO_DOWNSAMPLE_MIN, bilateral, nearest);
+		CHECK(SSAOResample::Compare(reference.data(), bilateral.data(), Width * Height, 0.05f).MaxError > 0.5f);
+		Resample(normalDepth, 4, SSAO_DOWNSAMPLE_MAX, bilateral, nearest);
+		CHECK(SSAOResample::Compare(reference.data(), bilateral.data(), Width * Height, 0.05f).MaxError > 0.5f);
+	}
+}
+
+int main()
+{
+	TestDownsample();
+	TestUpsample();
+
+	return ReportChecks("SSAOResample");
+}
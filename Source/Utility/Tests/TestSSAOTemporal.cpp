@@ -0,0 +1,164 @@
+/*  =======================
+	Summary: Checks for the temporal SSAO accumulation
+	=======================  */
+
+#include "SSAOTemporal.h"
+
+#include <cmath>
+
+#include "TestHelper.h"
+
+namespace
+{
+	DirectX::XMMATRIX GetView(float x, float y, float z, float yaw)
+	{
+		DirectX::XMVECTOR eye = DirectX::XMVectorSet(x, y, z, 1.0f);
+		DirectX::XMVECTOR look = DirectX::XMVectorSet(sinf(yaw), 0.0f, cosf(yaw), 0.0f);
+		return DirectX::XMMatrixLookToLH(eye, look, DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	}
+
+	DirectX::XMMATRIX GetProj(float fovY)
+	{
+		return DirectX::XMMatrixPerspectiveFovLH(fovY, 1.5f, 1.0f, 1000.0f);
+	}
+
+	void TestReprojection()
+	{
+		DirectX::XMMATRIX proj = GetProj(0.785f);
+		DirectX::XMMATRIX previousView = GetView(0.0f, 2.0f, -10.0f, 0.1f);
+		DirectX::XMMATRIX view = GetView(0.5f, 2.0f, -9.0f, 0.15f);
+
+		SSAOTemporal temporal;
+		temporal.BeginFrame(previousView, proj);
+		CHECK(temporal.GetHistoryWeight() == 0.0f);
+
+		temporal.BeginFrame(view, proj);
+		CHECK_NEAR(temporal.GetHistoryWeight(), 0.8, 1e-6);
+
+		// Moving a point from this view into the previous one and on to texture space
+		// lands where the previous camera projected it
+		DirectX::XMVECTOR world = DirectX::XMVectorSet(1.0f, 0.5f, 3.0f, 1.0f);
+		DirectX::XMVECTOR current = DirectX::XMVector4Transform(world, view);
+		DirectX::XMVECTOR previous = DirectX::XMVector4Transform(world, previousView);
+		DirectX::XMVECTOR clip = DirectX::XMVector4Transform(previous, proj);
+		float expectedU = 0.5f + 0.5f * DirectX::XMVectorGetX(clip) / DirectX::XMVectorGetW(clip);
+		float expectedV = 0.5f - 0.5f * DirectX::XMVectorGetY(clip) / DirectX::XMVectorGetW(clip);
+
+		DirectX::XMVECTOR moved = DirectX::XMVector4Transform(current, DirectX::XMLoadFloat4x4(&temporal.GetCurrentToPreviousView()));
+		DirectX::XMVECTOR tex = DirectX::XMVector4Transform(moved, DirectX::XMLoadFloat4x4(&temporal.GetPreviousViewToTex()));
+		CHECK_NEAR(DirectX::XMVectorGetX(tex) / DirectX::XMVectorGetW(tex), expectedU, 1e-4);
+		CHECK_NEAR(DirectX::XMVectorGetY(tex) / DirectX::XMVectorGetW(tex), expectedV, 1e-4);
+		CHECK_NEAR(DirectX::XMVectorGetZ(moved), DirectX::XMVectorGetZ(previous), 1e-3);
+
+		// History is kept only where it shows the same surface
+		DirectX::XMFLOAT3 position(DirectX::XMVectorGetX(moved), DirectX::XMVectorGetY(moved), DirectX::XMVectorGetZ(moved));
+		DirectX::XMFLOAT3 normal(0.0f, 0.0f, -1.0f);
+		CHECK(SSAOTemporal::IsHistoryValid(position, normal, DirectX::XMFLOAT4(0.0f, 0.0f, -1.0f, position.z * 1.01f)));
+		CHECK(!SSAOTemporal::IsHistoryValid(position, normal, DirectX::XMFLOAT4(0.0f, 0.0f, -1.0f, position.z * 1.2f)));
+		CHECK(!SSAOTemporal::IsHistoryValid(position, normal, DirectX::XMFLOAT4(0.0f, 1.0f, 0.0f, position.z)));
+	}
+
+	void TestHistoryReset()
+	{
+		DirectX::XMMATRIX view = GetView(0.0f, 2.0f, -10.0f, 0.0f);
+
+		SSAOTemporal temporal;
+		temporal.BeginFrame(view, GetProj(0.785f));
+		temporal.BeginFrame(view, GetProj(0.785f));
+		CHECK(temporal.GetHistoryWeight() > 0.0f);
+
+		// A lens change drops the history for one frame
+		temporal.BeginFrame(view, GetProj(0.9f));
+		CHECK(temporal.GetHistoryWeight() == 0.0f);
+		temporal.BeginFrame(view, GetProj(0.9f));
+		CHECK(temporal.GetHistoryWeight() > 0.0f);
+
+		// So does a reset, such as after the targets were rebuilt; the next frame blends
+		// with what this one writes
+		temporal.Reset();
+		CHECK(temporal.GetHistoryWeight() == 0.0f);
+		temporal.BeginFrame(view, GetProj(0.9f));
+		CHECK(temporal.GetHistoryWeight() > 0.0f);
+	}
+
+	// Every cycle covers the kernel exactly once, at one rotation that changes between cycles
+	void TestKernelSchedule()
+	{
+		const uint32_t kernelSize = 14;
+		DirectX::XMFLOAT4 kernel[kernelSize];
+		DirectX::XMFLOAT4 offsets[kernelSize];
+
+		// Offsets on the x axis with their index as length, which rotation keeps
+		for (uint32_t i = 0; i < kernelSize; ++i)
+		{
+			kernel[i] = DirectX::XMFLOAT4(static_cast<float>(i + 1), 0.0f, 0.5f, 0.0f);
+		}
+
+		DirectX::XMMATRIX view = GetView(0.0f, 2.0f, -10.0f, 0.0f);
+		DirectX::XMMATRIX proj = GetProj(0.785f);
+
+		SSAOTemporal temporal;
+		temporal.SetKernelSize(kernelSize);
+
+		for (uint32_t samplesPerFrame = 1; samplesPerFrame <= kernelSize; ++samplesPerFrame)
+		{
+			temporal.SetSamplesPerFrame(samplesPerFrame);
+			uint32_t sliceCount = temporal.GetSliceCount();
+
+			while (temporal.GetFrameIndex() % sliceCount != 0)
+			{
+				temporal.BeginFrame(view, proj);
+			}
+
+			int seen[kernelSize] = {};
+			float rotation = temporal.GetKernelRotation();
+
+			for (uint32_t frame = 0; frame < sliceCount; ++frame)
+			{
+				uint32_t count = temporal.GetFrameOffsets(kernel, offsets);
+				CHECK(count >= 1 && count <= samplesPerFrame);
+				CHECK(temporal.GetKernelRotation() == rotation);
+
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					float length = sqrtf(offsets[i].x * offsets[i].x + offsets[i].y * offsets[i].y);
+					int index = static_cast<int>(floorf(length + 0.5f)) - 1;
+					CHECK(index >= 0 && index < static_cast<int>(kernelSize));
+					CHECK(offsets[i].z == 0.5f);
+					if (index >= 0 && index < static_cast<int>(kernelSize))
+					{
+						++seen[index];
+					}
+				}
+
+				temporal.BeginFrame(view, proj);
+			}
+
+			for (uint32_t i = 0; i < kernelSize; ++i)
+			{
+				CHECK(seen[i] == 1);
+			}
+
+			if (sliceCount > 1)
+			{
+				CHECK(fabsf(temporal.GetKernelRotation() - rotation) > 1e-3f);
+			}
+		}
+
+		// The noise tiling moves every frame and stays within the tile
+		DirectX::XMFLOAT2 before = temporal.GetNoiseOffset();
+		temporal.BeginFrame(view, proj);
+		DirectX::XMFLOAT2 after = temporal.GetNoiseOffset();
+		CHECK(before.x != after.x && before.y != after.y);
+		CHECK(after.x >= 0.0f && after.x < 1.0f && after.y >= 0.0f && after.y < 1.0f);
+	}
+}
+
+int main()
+{
+	TestReprojection();
+	TestHistoryReset();
+	TestKernelSchedule();
+
+	return ReportChecks("SSAOTemporal");
+}
@@ -0,0 +1,148 @@
+/*  =======================
+	Summary: Checks for the static shadow map cache
+	=======================  */
+
+#include "ShadowCache.h"
+
+#include "TestHelper.h"
+
+namespace
+{
+	const DirectX::XMFLOAT3 LightDir(0.57735f, -0.57735f, 0.57735f);
+
+	// The shadow pass's guard band, which lets small camera moves keep the cached fits
+	const float GuardBand = 0.1f;
+
+	void SetupCamera(GFirstPersonCamera& camera)
+	{
+		camera.SetLens(0.25f * MathHelper::Pi, 16.0f / 9.0f, 1.0f, 1000.0f);
+		camera.LookAt(DirectX::XMFLOAT3(0.0f, 2.0f, -15.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f));
+		camera.UpdateViewMatrix();
+	}
+
+	uint32_t GetFullMask(const ShadowCascades& cascades)
+	{
+		return (1u << cascades.GetCascadeCount()) - 1;
+	}
+
+	// Without the amortized refresh, a still camera and light leave only dynamic
+	// casters to draw, on top of the cached static depth
+	void TestSteadyState()
+	{
+		GFirstPersonCamera camera;
+		SetupCamera(camera);
+
+		ShadowCascades cascades;
+		cascades.SetGuardBand(GuardBand);
+		cascades.Update(camera, LightDir);
+
+		ShadowCache cache;
+		cache.SetRefreshInterval(0);
+		CHECK(cache.Update(cascades, 1) == GetFullMask(cascades));
+
+		for (int frame = 0; frame < 20; ++frame)
+		{
+			cascades.Update(camera, LightDir);
+			CHECK(cache.Update(cascades, 1) == 0);
+		}
+
+		// Small camera moves stay inside the guard band
+		camera.Strafe(0.05f);
+		camera.UpdateViewMatrix();
+		cascades.Update(camera, LightDir);
+		CHECK(cache.Update(cascades, 1) == 0);
+
+		// The amortized refresh only redraws cascades whose fit actually changed
+		cache.SetRefreshInterval(1);
+		for (int frame = 0; frame < 8; ++frame)
+		{
+			uint32_t mask = cache.Update(cascades, 1);
+			cascades.Update(camera, LightDir);
+			CHECK((mask & (mask - 1)) == 0);
+		}
+		CHECK(cache.Update(cascades, 1) == 0);
+	}
+
+	void TestStaticChanges()
+	{
+		GFirstPersonCamera camera;
+		SetupCamera(camera);
+
+		ShadowCascades cascades;
+		cascades.SetGuardBand(GuardBand);
+		cascades.Update(camera, LightDir);
+
+		ShadowCache cache;
+		cache.SetRefreshInterval(0);
+		cache.Update(cascades, 1);
+
+		// Adding or removing static objects bumps the version, which redraws everything
+		CHECK(cache.Update(cascades, 2) == GetFullMask(cascades));
+		CHECK(cache.Update(cascades, 2) == 0);
+
+		// A static caster moving inside the last cascade's slice only redraws the
+		// cascades whose caster volume it overlaps
+		int last = cascades.GetCascadeCount() - 1;
+		DirectX::BoundingBox moved(cascades.GetCascade(last).Sphere.Center, DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f));
+
+		uint32_t expected = 0;
+		for (int i = 0; i < cascades.GetCascadeCount(); ++i)
+		{
+			expected |= cascades.IntersectsCascade(i, moved) ? (1u << i) : 0;
+		}
+		CHECK((expected & (1u << last)) != 0);
+		CHECK((expected & 1u) == 0);
+
+		cache.InvalidateBounds(moved);
+		CHECK(cache.Update(cascades, 2) == expected);
+		CHECK(cache.Update(cascades, 2) == 0);
+
+		// Far from every slice nothing is redrawn
+		DirectX::BoundingBox outside(DirectX::XMFLOAT3(5000.0f, 0.0f, -5000.0f), DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f));
+		cache.InvalidateBounds(outside);
+		CHECK(cache.Update(cascades, 2) == 0);
+	}
+
+	void TestLightChanges()
+	{
+		GFirstPersonCamera camera;
+		SetupCamera(camera);
+
+		ShadowCascades cascades;
+		cascades.SetGuardBand(GuardBand);
+		cascades.Update(camera, LightDir);
+
+		ShadowCache cache;
+		cache.SetRefreshInterval(0);
+		cache.Update(cascades, 1);
+
+		// Within the tolerance the cached depth is kept
+		DirectX::XMFLOAT3 nudged(0.58f, -0.57735f, 0.57735f);
+		cascades.Update(camera, nudged);
+		CHECK(cache.Update(cascades, 1) == 0);
+
+		// Beyond it every cascade is redrawn at once
+		DirectX::XMFLOAT3 turned(-0.57735f, -0.57735f, 0.57735f);
+		cascades.Update(camera, turned);
+		CHECK(cache.Update(cascades, 1) == GetFullMask(cascades));
+		CHECK(cache.Update(cascades, 1) == 0);
+
+		for (int i = 0; i < cache.GetCascadeCount(); ++i)
+		{
+			CHECK(cache.GetCascade(i).LightDir.x == turned.x);
+		}
+
+		// Forgetting the cache does the same
+		cache.Invalidate();
+		CHECK(cache.Update(cascades, 1) == GetFullMask(cascades));
+	}
+}
+
+int main()
+{
+	TestSteadyState();
+	TestStaticChanges();
+	TestLightChanges();
+
+	return ReportChecks("ShadowCache");
+}
@@ -0,0 +1,230 @@
+/*  =======================
+	Summary: Checks for the cascaded shadow map fitting
+	=======================  */
+
+#include "ShadowCascades.h"
+
+#include <cmath>
+
+#include "TestHelper.h"
+
+namespace
+{
+	void SetupCamera(GFirstPersonCamera& camera)
+	{
+		camera.SetLens(0.25f * MathHelper::Pi, 16.0f / 9.0f, 1.0f, 1000.0f);
+		camera.LookAt(DirectX::XMFLOAT3(0.0f, 2.0f, -15.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f));
+		camera.UpdateViewMatrix();
+	}
+
+	// Largest distance from the sphere center to a corner of the frustum slice.
+	float GetFarthestCorner(const GFirstPersonCamera& camera, const DirectX::BoundingSphere& sphere, float sliceNear, float sliceFar)
+	{
+		DirectX::XMVECTOR position = camera.GetPositionXM();
+		DirectX::XMVECTOR right = DirectX::XMVector3Normalize(camera.GetRightXM());
+		DirectX::XMVECTOR up = DirectX::XMVector3Normalize(camera.GetUpXM());
+		DirectX::XMVECTOR look = DirectX::XMVector3Normalize(camera.GetLookXM());
+		DirectX::XMVECTOR center = DirectX::XMLoadFloat3(&sphere.Center);
+
+		float tanY = tanf(0.5f * camera.GetFovY());
+		float tanX = camera.GetAspect() * tanY;
+		float farthest = 0.0f;
+
+		for (int i = 0; i < 8; ++i)
+		{
+			float z = (i & 4) ? sliceFar : sliceNear;
+			float x = (i & 1) ? z * tanX : -z * tanX;
+			float y = (i & 2) ? z * tanY : -z * tanY;
+
+			DirectX::XMVECTOR corner = DirectX::XMVectorMultiplyAdd(DirectX::XMVectorReplicate(z), look, position);
+			corner = DirectX::XMVectorMultiplyAdd(DirectX::XMVectorReplicate(x), right, corner);
+			corner = DirectX::XMVectorMultiplyAdd(DirectX::XMVectorReplicate(y), up, corner);
+
+			float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(corner, center)));
+			farthest = MathHelper::Max(farthest, distance);
+		}
+
+		return farthest;
+	}
+
+	void TestComputeSplits()
+	{
+		float splits[ShadowCascades::MaxCascades + 1];
+
+		// The ends are pinned and the splits increase for every blend
+		for (int l = 0; l <= 4; ++l)
+		{
+			float lambda = 0.25f * static_cast<float>(l);
+			ShadowCascades::ComputeSplits(1.0f, 1000.0f, ShadowCascades::MaxCascades, lambda, splits);
+
+			CHECK(splits[0] == 1.0f);
+			CHECK(splits[ShadowCascades::MaxCascades] == 1000.0f);
+			for (int i = 0; i < ShadowCascades::MaxCascades; ++i)
+			{
+				CHECK(splits[i] < splits[i + 1]);
+			}
+		}
+
+		// Lambda 0 is uniform, lambda 1 logarithmic
+		ShadowCascades::ComputeSplits(1.0f, 1000.0f, 4, 0.0f, splits);
+		CHECK_NEAR(splits[1], 250.75, 1e-3);
+		CHECK_NEAR(splits[2], 500.5, 1e-3);
+
+		ShadowCascades::ComputeSplits(1.0f, 1000.0f, 3, 1.0f, splits);
+		CHECK_NEAR(splits[1], 10.0, 1e-3);
+		CHECK_NEAR(splits[2], 100.0, 1e-2);
+
+		// A single cascade covers the whole range
+		ShadowCascades::ComputeSplits(1.0f, 1000.0f, 1, 0.95f, splits);
+		CHECK(splits[0] == 1.0f && splits[1] == 1000.0f);
+	}
+
+	void TestFitSliceSphere()
+	{
+		GFirstPersonCamera camera;
+		SetupCamera(camera);
+
+		const float slices[][2] = { { 1.0f, 10.0f }, { 10.0f, 40.0f }, { 40.0f, 200.0f }, { 200.0f, 1000.0f }, { 900.0f, 1000.0f } };
+
+		for (const float* slice : slices)
+		{
+			DirectX::BoundingSphere sphere = ShadowCascades::FitSliceSphere(camera, slice[0], slice[1]);
+
+			// Encloses the slice and touches its farthest corner
+			float farthest = GetFarthestCorner(camera, sphere, slice[0], slice[1]);
+			CHECK(farthest <= sphere.Radius * 1.0001f);
+			CHECK(farthest >= sphere.Radius * 0.9999f);
+
+			// The radius only depends on the lens, not on where the camera looks
+			GFirstPersonCamera turned;
+			SetupCamera(turned);
+			turned.RotateY(1.3f);
+			turned.Pitch(-0.4f);
+			turned.SetPosition(25.0f, 7.0f, -3.0f);
+			turned.UpdateViewMatrix();
+
+			DirectX::BoundingSphere turnedSphere = ShadowCascades::FitSliceSphere(turned, slice[0], slice[1]);
+			CHECK_NEAR(turnedSphere.Radius, sphere.Radius, sphere.Radius * 1e-5);
+			CHECK(GetFarthestCorner(turned, turnedSphere, slice[0], slice[1]) <= turnedSphere.Radius * 1.0001f);
+		}
+	}
+
+	void TestSnapToTexel()
+	{
+		const float radius = 37.5f;
+		const uint32_t size = 1024;
+		const float texelSize = 2.0f * radius / static_cast<float>(size);
+
+		// Snapped positions lie on the grid, and snapping is idempotent
+		DirectX::XMFLOAT3 p(13.37f, -4.21f, 7.0f);
+		DirectX::XMFLOAT3 snapped = ShadowCascades::SnapToTexel(p, radius, size);
+		CHECK_NEAR(snapped.x / texelSize, floor(snapped.x / texelSize + 0.5), 1e-3);
+		CHECK_NEAR(snapped.y / texelSize, floor(snapped.y / texelSize + 0.5), 1e-3);
+		CHECK(snapped.z == p.z);
+		CHECK(snapped.x <= p.x && p.x - snapped.x < texelSize);
+
+		DirectX::XMFLOAT3 twice = ShadowCascades::SnapToTexel(snapped, radius, size);
+		CHECK_NEAR(twice.x, snapped.x, 1e-5);
+		CHECK_NEAR(twice.y, snapped.y, 1e-5);
+	}
+
+	// A world point must land on the same sub-texel position of every cascade while
+	// the camera moves, otherwise shadow edges shimmer.
+	void TestSnapStability()
+	{
+		GFirstPersonCamera camera;
+		SetupCamera(camera);
+
+		ShadowCascades cascades;
+		cascades.SetGuardBand(0.1f);
+		DirectX::XMFLOAT3 lightDir(0.57735f, -0.57735f, 0.57735f);
+		cascades.Update(camera, lightDir);
+
+		const float size = static_cast<float>(cascades.GetShadowMapSize());
+		const DirectX::XMFLOAT3 point(3.0f, 0.5f, 4.0f);
+
+		float fraction[ShadowCascades::MaxCascades][2];
+		float radius[ShadowCascades::MaxCascades];
+
+		for (int frame = 0; frame < 200; ++frame)
+		{
+			for (int i = 0; i < cascades.GetCascadeCount(); ++i)
+			{
+				const ShadowCascade& c = cascades.GetCascade(i);
+
+				DirectX::XMMATRIX S = DirectX::XMLoadFloat4x4(&c.ShadowTransform);
+				DirectX::XMFLOAT3 uv;
+				DirectX::XMStoreFloat3(&uv, DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&point), S));
+
+				float texelX = uv.x * size;
+				float texelY = uv.y * size;
+				float fractionX = texelX - floorf(texelX);
+				float fractionY = texelY - floorf(texelY);
+
+				if (frame == 0)
+				{
+					fraction[i][0] = fractionX;
+					fraction[i][1] = fractionY;
+					radius[i] = c.Radius;
+					continue;
+				}
+
+				// Translation keeps the quantized radius, and so the texel size
+				CHECK(c.Radius == radius[i]);
+
+				// Compare on the circle so 0.999 and 0.001 count as close
+				float dx = fabsf(fractionX - fraction[i][0]);
+				float dy = fabsf(fractionY - fraction[i][1]);
+				CHECK(MathHelper::Min(dx, 1.0f - dx) < 0.01f);
+				CHECK(MathHelper::Min(dy, 1.0f - dy) < 0.01f);
+			}
+
+			camera.Strafe(0.173f);
+			camera.Walk(0.311f);
+			camera.UpdateViewMatrix();
+			cascades.Update(camera, lightDir);
+		}
+	}
+
+	void TestIntersectsCascade()
+	{
+		GFirstPersonCamera camera;
+		SetupCamera(camera);
+
+		ShadowCascades cascades;
+		DirectX::XMFLOAT3 lightDir(0.57735f, -0.57735f, 0.57735f);
+		cascades.Update(camera, lightDir);
+
+		for (int i = 0; i < cascades.GetCascadeCount(); ++i)
+		{
+			const ShadowCascade& c = cascades.GetCascade(i);
+
+			// A box inside the slice casts, one far to the side does not
+			DirectX::BoundingBox inside(c.Sphere.Center, DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f));
+			CHECK(cascades.IntersectsCascade(i, inside));
+
+			DirectX::XMFLOAT3 farAway(c.Sphere.Center.x + 4.0f * c.Radius, c.Sphere.Center.y, c.Sphere.Center.z - 4.0f * c.Radius);
+			DirectX::BoundingBox outside(farAway, DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f));
+			CHECK(!cascades.IntersectsCascade(i, outside));
+
+			// A caster between the light and the slice is kept by the pullback
+			DirectX::XMFLOAT3 towardsLight(
+				c.Sphere.Center.x - lightDir.x * (c.Radius + 50.0f),
+				c.Sphere.Center.y - lightDir.y * (c.Radius + 50.0f),
+				c.Sphere.Center.z - lightDir.z * (c.Radius + 50.0f));
+			DirectX::BoundingBox caster(towardsLight, DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f));
+			CHECK(cascades.IntersectsCascade(i, caster));
+		}
+	}
+}
+
+int main()
+{
+	TestComputeSplits();
+	TestFitSliceSphere();
+	TestSnapToTexel();
+	TestSnapStability();
+	TestIntersectsCascade();
+
+	return ReportChecks("ShadowCascades");
+}
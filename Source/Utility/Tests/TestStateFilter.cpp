@@ -0,0 +1,474 @@
+/*  =======================
+	Summary: Checks for the redundant state filter
+	=======================  */
+
+#include "StateFilter.h"
+#include "RenderBackend.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "TestHelper.h"
+
+namespace
+{
+	// Stand-ins for device objects; index 0 is null
+	char sObjects[64];
+
+	template<class T>
+	T* GetPlaceholder(uint32_t index)
+	{
+		return index == 0 ? nullptr : reinterpret_cast<T*>(&sObjects[index]);
+	}
+
+	inline uint64_t Word(const void* p) { return reinterpret_cast<uintptr_t>(p); }
+
+	inline uint64_t Word(float f)
+	{
+		uint32_t bits;
+		memcpy(&bits, &f, sizeof(bits));
+		return bits;
+	}
+
+	// What the device would have bound. Only 64-bit words, so two states compare with memcmp.
+	struct BoundState
+	{
+		uint64_t States[CMD_COUNT][10];
+		uint64_t VertexBuffers[StateFilter::MaxSlots][3];
+		uint64_t Slots[3][STAGE_COUNT][StateFilter::MaxSlots];
+		uint64_t UnorderedAccessViews[MaxCommandSlots];
+	};
+
+	// Applies a stream the way a device context would and keeps the bound state at every
+	// draw and dispatch, so a filtered stream can be compared with the one it came from.
+	class MockContext : public RenderBackend
+	{
+	public:
+		MockContext() { memset(&mState, 0, sizeof(mState)); }
+
+		virtual void Execute(const CommandBuffer& commands)
+		{
+			for (const CmdHeader* cmd = commands.Begin(); cmd != commands.End(); cmd = CommandBuffer::Next(cmd))
+			{
+				Apply(cmd);
+			}
+
+			// Slots still pending at the end of the stream must be bound as well
+			mSnapshots.push_back(mState);
+		}
+
+		inline const std::vector<BoundState>& GetSnapshots() const { return mSnapshots; }
+
+	private:
+		void Apply(const CmdHeader* cmd)
+		{
+			uint64_t* row = mState.States[cmd->Type];
+
+			switch (cmd->Type)
+			{
+			case CMD_SET_RENDER_TARGETS:
+			{
+				const CmdSetRenderTargets* c = reinterpret_cast<const CmdSetRenderTargets*>(cmd);
+				memset(row, 0, sizeof(mState.States[0]));
+				row[0] = c->Count;
+				for (uint32_t i = 0; i < c->Count; ++i)
+				{
+					row[1 + i] = Word(c->RTVs[i]);
+				}
+				row[9] = Word(c->DSV);
+				break;
+			}
+			case CMD_SET_VIEWPORT:
+			{
+				const CmdSetViewport* c = reinterpret_cast<const CmdSetViewport*>(cmd);
+				row[0] = Word(c->TopLeftX);
+				row[1] = Word(c->TopLeftY);
+				row[2] = Word(c->Width);
+				row[3] = Word(c->Height);
+				row[4] = Word(c->MinDepth);
+				row[5] = Word(c->MaxDepth);
+				break;
+			}
+			case CMD_SET_INPUT_LAYOUT: row[0] = Word(reinterpret_cast<const CmdSetInputLayout*>(cmd)->Layout); break;
+			case CMD_SET_PRIMITIVE_TOPOLOGY: row[0] = reinterpret_cast<const CmdSetPrimitiveTopology*>(cmd)->Topology; break;
+			case CMD_SET_VERTEX_SHADER: row[0] = Word(reinterpret_cast<const CmdSetVertexShader*>(cmd)->Shader); break;
+			case CMD_SET_GEOMETRY_SHADER: row[0] = Word(reinterpret_cast<const CmdSetGeometryShader*>(cmd)->Shader); break;
+			case CMD_SET_PIXEL_SHADER: row[0] = Word(reinterpret_cast<const CmdSetPixelShader*>(cmd)->Shader); break;
+			case CMD_SET_COMPUTE_SHADER: row[0] = Word(reinterpret_cast<const CmdSetComputeShader*>(cmd)->Shader); break;
+			case CMD_SET_RASTERIZER_STATE: row[0] = Word(reinterpret_cast<const CmdSetRasterizerState*>(cmd)->State); break;
+			case CMD_SET_INDEX_BUFFER:
+			{
+				const CmdSetIndexBuffer* c = reinterpret_cast<const CmdSetIndexBuffer*>(cmd);
+				row[0] = Word(c->Buffer);
+				row[1] = c->Format;
+				row[2] = c->Offset;
+				break;
+			}
+			case CMD_SET_BLEND_STATE:
+			{
+				const CmdSetBlendState* c = reinterpret_cast<const CmdSetBlendState*>(cmd);
+				row[0] = Word(c->State);
+				row[1] = c->SampleMask;
+				for (int i = 0; i < 4; ++i)
+				{
+					row[2 + i] = Word(c->BlendFactor[i]);
+				}
+				break;
+			}
+			case CMD_SET_DEPTH_STENCIL_STATE:
+			{
+				const CmdSetDepthStencilState* c = reinterpret_cast<const CmdSetDepthStencilState*>(cmd);
+				row[0] = Word(c->State);
+				row[1] = c->StencilRef;
+				break;
+			}
+			case CMD_SET_STREAM_OUT_TARGET:
+			{
+				const CmdSetStreamOutTarget* c = reinterpret_cast<const CmdSetStreamOutTarget*>(cmd);
+				row[0] = Word(c->Buffer);
+				row[1] = c->Offset;
+				break;
+			}
+			case CMD_SET_VERTEX_BUFFER:
+			{
+				const CmdSetVertexBuffer* c = reinterpret_cast<const CmdSetVertexBuffer*>(cmd);
+				mState.VertexBuffers[c->Slot][0] = Word(c->Buffer);
+				mState.VertexBuffers[c->Slot][1] = c->Stride;
+				mState.VertexBuffers[c->Slot][2] = c->Offset;
+				break;
+			}
+			case CMD_SET_VERTEX_DATA:
+			{
+				// Bound from the backend's own ring
+				const CmdSetVertexData* c = reinterpret_cast<const CmdSetVertexData*>(cmd);
+				mState.VertexBuffers[c->Slot][0] = ~0ull;
+				mState.VertexBuffers[c->Slot][1] = c->Stride;
+				mState.VertexBuffers[c->Slot][2] = 0;
+				break;
+			}
+			case CMD_SET_CONSTANT_BUFFERS:
+			{
+				const CmdSetConstantBuffers* c = reinterpret_cast<const CmdSetConstantBuffers*>(cmd);
+				for (uint32_t i = 0; i < c->Count; ++i)
+				{
+					mState.Slots[0][c->Stage][c->StartSlot + i] = Word(c->Buffers[i]);
+				}
+				break;
+			}
+			case CMD_SET_SHADER_RESOURCES:
+			{
+				const CmdSetShaderResources* c = reinterpret_cast<const CmdSetShaderResources*>(cmd);
+				for (uint32_t i = 0; i < c->Count; ++i)
+				{
+					mState.Slots[1][c->Stage][c->StartSlot + i] = Word(c->Views[i]);
+				}
+				break;
+			}
+			case CMD_SET_SAMPLERS:
+			{
+				const CmdSetSamplers* c = reinterpret_cast<const CmdSetSamplers*>(cmd);
+				for (uint32_t i = 0; i < c->Count; ++i)
+				{
+					mState.Slots[2][c->Stage][c->StartSlot + i] = Word(c->Samplers[i]);
+				}
+				break;
+			}
+			case CMD_SET_UNORDERED_ACCESS_VIEWS:
+			{
+				const CmdSetUnorderedAccessViews* c = reinterpret_cast<const CmdSetUnorderedAccessViews*>(cmd);
+				for (uint32_t i = 0; i < c->Count; ++i)
+				{
+					mState.UnorderedAccessViews[c->StartSlot + i] = Word(c->Views[i]);
+				}
+				break;
+			}
+			case CMD_DRAW:
+			case CMD_DRAW_INDEXED:
+			case CMD_DRAW_INSTANCED:
+			case CMD_DRAW_INDEXED_INSTANCED:
+			case CMD_DRAW_AUTO:
+			case CMD_DISPATCH:
+				mSnapshots.push_back(mState);
+				break;
+			default:
+				break;
+			}
+		}
+
+	private:
+		BoundState mState;
+		std::vector<BoundState> mSnapshots;
+	};
+
+	// Two pixel shader sets of which one is redundant, two adjacent constant buffers and a
+	// constant buffer that is set again to the same value.
+	void RecordRedundantState(CommandBuffer& commands)
+	{
+		ID3D11Buffer* buffers[] = { GetPlaceholder<ID3D11Buffer>(1), GetPlaceholder<ID3D11Buffer>(2) };
+		ID3D11ShaderResourceView* view = GetPlaceholder<ID3D11ShaderResourceView>(3);
+
+		commands.SetPixelShader(GetPlaceholder<ID3D11PixelShader>(4));
+		commands.SetPixelShader(GetPlaceholder<ID3D11PixelShader>(4));
+		commands.SetVertexShader(GetPlaceholder<ID3D11VertexShader>(5));
+		commands.SetConstantBuffers(STAGE_PS, 0, 1, &buffers[0]);
+		commands.SetConstantBuffers(STAGE_PS, 1, 1, &buffers[1]);
+		commands.SetShaderResources(STAGE_PS, 0, 1, &view);
+		commands.Draw(3, 0);
+
+		commands.SetPixelShader(GetPlaceholder<ID3D11PixelShader>(4));
+		commands.SetConstantBuffers(STAGE_PS, 0, 1, &buffers[0]);
+		commands.Draw(3, 0);
+
+		commands.SetPixelShader(GetPlaceholder<ID3D11PixelShader>(6));
+		commands.Draw(3, 0);
+	}
+
+	void TestRedundantState()
+	{
+		CommandBuffer commands;
+		RecordRedundantState(commands);
+
+		StateFilter filter;
+		CommandBuffer filtered;
+		filter.Filter(commands, filtered);
+
+		CHECK(filter.GetRequestedCount() == 9);
+		CHECK(filter.GetIssuedCount() == 5);
+		CHECK(filter.GetFilteredCount() == 4);
+		CHECK(filter.GetRequestedCount(CMD_SET_PIXEL_SHADER) == 4);
+		CHECK(filter.GetIssuedCount(CMD_SET_PIXEL_SHADER) == 2);
+		CHECK(filter.GetRequestedCount(CMD_SET_CONSTANT_BUFFERS) == 3);
+		CHECK(filter.GetIssuedCount(CMD_SET_CONSTANT_BUFFERS) == 1);
+
+		// Draws pass through untouched
+		NullRenderBackend backend;
+		backend.Execute(filtered);
+		CHECK(backend.GetDrawCount() == 3);
+		CHECK(backend.GetCommandCount() == 8);
+		CHECK(backend.GetCommandCount(CMD_SET_CONSTANT_BUFFERS) == 1);
+
+		// The next stream starts from what the last one left bound: only the switch back
+		// to the first pixel shader and the switch to the second are issued
+		filter.ResetStats();
+		CommandBuffer next;
+		filter.Filter(commands, next);
+		CHECK(filter.GetRequestedCount() == 9);
+		CHECK(filter.GetIssuedCount() == 2);
+		CHECK(filter.GetIssuedCount(CMD_SET_PIXEL_SHADER) == 2);
+
+		// After Invalidate nothing is assumed to be bound
+		filter.Invalidate();
+		filter.ResetStats();
+		CommandBuffer invalidated;
+		filter.Filter(commands, invalidated);
+		CHECK(filter.GetIssuedCount() == 5);
+	}
+
+	void TestSlotRuns()
+	{
+		ID3D11Buffer* buffers[10];
+		for (uint32_t i = 0; i < 10; ++i)
+		{
+			buffers[i] = GetPlaceholder<ID3D11Buffer>(1 + i);
+		}
+
+		// Ten adjacent slots set one by one go out as two calls of at most eight slots
+		CommandBuffer commands;
+		for (uint32_t i = 0; i < 10; ++i)
+		{
+			commands.SetConstantBuffers(STAGE_VS, i, 1, &buffers[i]);
+		}
+		commands.Draw(3, 0);
+
+		StateFilter filter;
+		CommandBuffer filtered;
+		filter.Filter(commands, filtered);
+		CHECK(filter.GetRequestedCount(CMD_SET_CONSTANT_BUFFERS) == 10);
+		CHECK(filter.GetIssuedCount(CMD_SET_CONSTANT_BUFFERS) == 2);
+
+		// Changing slots 2, 3 and 5 leaves a gap, so two runs
+		CommandBuffer changes;
+		changes.SetConstantBuffers(STAGE_VS, 2, 2, &buffers[6]);
+		changes.SetConstantBuffers(STAGE_VS, 5, 1, &buffers[0]);
+		changes.SetConstantBuffers(STAGE_VS, 0, 1, &buffers[0]);
+		changes.Draw(3, 0);
+
+		filter.ResetStats();
+		CommandBuffer filteredChanges;
+		filter.Filter(changes, filteredChanges);
+		CHECK(filter.GetRequestedCount() == 3);
+		CHECK(filter.GetIssuedCount() == 2);
+	}
+
+	void TestForgottenBindings()
+	{
+		ID3D11RenderTargetView* rtvs[] = { GetPlaceholder<ID3D11RenderTargetView>(1), GetPlaceholder<ID3D11RenderTargetView>(2) };
+		ID3D11DepthStencilView* dsv = GetPlaceholder<ID3D11DepthStencilView>(3);
+		ID3D11ShaderResourceView* view = GetPlaceholder<ID3D11ShaderResourceView>(4);
+		ID3D11UnorderedAccessView* uav = GetPlaceholder<ID3D11UnorderedAccessView>(5);
+
+		// A view read before the targets change may have been unbound by the device
+		CommandBuffer commands;
+		commands.SetRenderTargets(1, &rtvs[0], dsv);
+		commands.SetShaderResources(STAGE_PS, 0, 1, &view);
+		commands.Draw(3, 0);
+		commands.SetRenderTargets(1, &rtvs[1], dsv);
+		commands.SetShaderResources(STAGE_PS, 0, 1, &view);
+		commands.Draw(3, 0);
+
+		StateFilter filter;
+		CommandBuffer filtered;
+		filter.Filter(commands, filtered);
+		CHECK(filter.GetIssuedCount(CMD_SET_RENDER_TARGETS) == 2);
+		CHECK(filter.GetIssuedCount(CMD_SET_SHADER_RESOURCES) == 2);
+		CHECK(filter.GetFilteredCount() == 0);
+
+		// Unordered access views are always issued and unbind shader resources too
+		CommandBuffer compute;
+		compute.SetShaderResources(STAGE_CS, 0, 1, &view);
+		compute.Dispatch(1, 1, 1);
+		compute.SetUnorderedAccessViews(0, 1, &uav);
+		compute.SetShaderResources(STAGE_CS, 0, 1, &view);
+		compute.Dispatch(1, 1, 1);
+		compute.SetUnorderedAccessViews(0, 1, &uav);
+		compute.Dispatch(1, 1, 1);
+
+		filter.ResetStats();
+		CommandBuffer filteredCompute;
+		filter.Filter(compute, filteredCompute);
+		CHECK(filter.GetRequestedCount(CMD_SET_UNORDERED_ACCESS_VIEWS) == 2);
+		CHECK(filter.GetIssuedCount(CMD_SET_UNORDERED_ACCESS_VIEWS) == 2);
+		CHECK(filter.GetIssuedCount(CMD_SET_SHADER_RESOURCES) == 2);
+
+		NullRenderBackend backend;
+		backend.Execute(filteredCompute);
+		CHECK(backend.GetDispatchCount() == 3);
+	}
+
+	void RecordRandomStream(std::mt19937& random, uint32_t commandCount, CommandBuffer& commands)
+	{
+		// Small pools so that most sets repeat what is already bound
+		std::uniform_int_distribution<uint32_t> pick(0, 3);
+		std::uniform_int_distribution<uint32_t> kind(0, 21);
+		std::uniform_int_distribution<uint32_t> stage(0, STAGE_COUNT - 1);
+		std::uniform_int_distribution<uint32_t> slot(0, 5);
+		std::uniform_int_distribution<uint32_t> count(1, 3);
+
+		for (uint32_t i = 0; i < commandCount; ++i)
+		{
+			switch (kind(random))
+			{
+			case 0:
+			{
+				ID3D11RenderTargetView* rtvs[] = { GetPlaceholder<ID3D11RenderTargetView>(1 + pick(random)), GetPlaceholder<ID3D11RenderTargetView>(5 + pick(random)) };
+				commands.SetRenderTargets(pick(random) % 3, rtvs, GetPlaceholder<ID3D11DepthStencilView>(pick(random)));
+				break;
+			}
+			case 1: commands.SetViewport(0.0f, 0.0f, 256.0f * (1 + pick(random)), 256.0f, 0.0f, 1.0f); break;
+			case 2: commands.SetInputLayout(GetPlaceholder<ID3D11InputLayout>(pick(random))); break;
+			case 3: commands.SetPrimitiveTopology(pick(random)); break;
+			case 4: commands.SetVertexBuffer(pick(random), GetPlaceholder<ID3D11Buffer>(pick(random)), 16 * (1 + pick(random) % 2), 0); break;
+			case 5: commands.SetIndexBuffer(GetPlaceholder<ID3D11Buffer>(pick(random)), 42, 0); break;
+			case 6: commands.SetVertexShader(GetPlaceholder<ID3D11VertexShader>(pick(random))); break;
+			case 7: commands.SetPixelShader(GetPlaceholder<ID3D11PixelShader>(pick(random))); break;
+			case 8: commands.SetComputeShader(GetPlaceholder<ID3D11ComputeShader>(pick(random))); break;
+			case 9:
+			case 10:
+			{
+				ID3D11Buffer* buffers[] = { GetPlaceholder<ID3D11Buffer>(pick(random)), GetPlaceholder<ID3D11Buffer>(pick(random)), GetPlaceholder<ID3D11Buffer>(pick(random)) };
+				commands.SetConstantBuffers(static_cast<ShaderStage>(stage(random)), slot(random), count(random), buffers);
+				break;
+			}
+			case 11:
+			case 12:
+			{
+				ID3D11ShaderResourceView* views[] = { GetPlaceholder<ID3D11ShaderResourceView>(pick(random)), GetPlaceholder<ID3D11ShaderResourceView>(pick(random)), GetPlaceholder<ID3D11ShaderResourceView>(pick(random)) };
+				commands.SetShaderResources(static_cast<ShaderStage>(stage(random)), slot(random), count(random), views);
+				break;
+			}
+			case 13:
+			{
+				ID3D11SamplerState* samplers[] = { GetPlaceholder<ID3D11SamplerState>(pick(random)), GetPlaceholder<ID3D11SamplerState>(pick(random)) };
+				commands.SetSamplers(static_cast<ShaderStage>(stage(random)), slot(random), 2, samplers);
+				break;
+			}
+			case 14: commands.ClearShaderResources(static_cast<ShaderStage>(stage(random)), slot(random), count(random)); break;
+			case 15:
+			{
+				ID3D11UnorderedAccessView* views[] = { GetPlaceholder<ID3D11UnorderedAccessView>(pick(random)) };
+				commands.SetUnorderedAccessViews(pick(random), 1, views);
+				break;
+			}
+			case 16:
+			{
+				const float blendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				commands.SetBlendState(GetPlaceholder<ID3D11BlendState>(pick(random)), blendFactor, 0xffffffff);
+				break;
+			}
+			case 17: commands.SetDepthStencilState(GetPlaceholder<ID3D11DepthStencilState>(pick(random)), pick(random)); break;
+			case 18: commands.SetRasterizerState(GetPlaceholder<ID3D11RasterizerState>(pick(random))); break;
+			case 19: commands.Dispatch(1, 1, 1); break;
+			default: commands.DrawIndexed(36, 0, 0); break;
+			}
+		}
+	}
+
+	// Every draw of a filtered stream must see exactly the state the original stream binds.
+	void TestRandomStreams()
+	{
+		std::mt19937 random(1234);
+		StateFilter filter;
+		MockContext reference;
+		MockContext context;
+
+		for (int frame = 0; frame < 8; ++frame)
+		{
+			// Halfway through, something binds state behind the filter's back
+			if (frame == 4)
+			{
+				CommandBuffer external;
+				RecordRandomStream(random, 200, external);
+				reference.Execute(external);
+				context.Execute(external);
+				filter.Invalidate();
+			}
+
+			CommandBuffer commands;
+			RecordRandomStream(random, 2000, commands);
+
+			CommandBuffer filtered;
+			filter.Filter(commands, filtered);
+
+			reference.Execute(commands);
+			context.Execute(filtered);
+		}
+
+		const std::vector<BoundState>& expected = reference.GetSnapshots();
+		const std::vector<BoundState>& actual = context.GetSnapshots();
+
+		CHECK(expected.size() == actual.size());
+		uint32_t mismatches = 0;
+		for (size_t i = 0; i < expected.size() && i < actual.size(); ++i)
+		{
+			if (memcmp(&expected[i], &actual[i], sizeof(BoundState)) != 0)
+			{
+				++mismatches;
+			}
+		}
+		CHECK(mismatches == 0);
+
+		CHECK(filter.GetIssuedCount() + filter.GetFilteredCount() == filter.GetRequestedCount());
+		CHECK(filter.GetFilteredCount() > filter.GetRequestedCount() / 10);
+	}
+}
+
+int main()
+{
+	TestRedundantState();
+	TestSlotRuns();
+	TestForgottenBindings();
+	TestRandomStreams();
+
+	return ReportChecks("StateFilter");
+}
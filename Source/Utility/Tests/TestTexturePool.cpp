@@ -0,0 +1,181 @@
+/*  =======================
+	Summary: Checks for the texture pool
+	=======================  */
+
+#include "TexturePool.h"
+
+#include "TestHelper.h"
+
+namespace
+{
+	const PoolTextureDesc ColorDesc = { 1280, 720, 28, 4, 1, 2, false };
+	const PoolTextureDesc DepthDesc = { 1280, 720, 45, 4, 1, 4, false };
+
+	// Among idle matches the most recently released is handed out
+	void TestAcquire()
+	{
+		TexturePool pool;
+		uint32_t a = pool.Acquire(ColorDesc);
+		uint32_t b = pool.Acquire(ColorDesc);
+		CHECK(a != b);
+		CHECK(pool.GetCreateCount() == 2);
+
+		pool.Release(a);
+		pool.EndFrame();
+		pool.Release(b);
+		CHECK(pool.Acquire(ColorDesc) == b);
+		CHECK(pool.Acquire(ColorDesc) == a);
+		CHECK(pool.GetReuseCount() == 2);
+
+		// Another description never matches, even with idle entries around
+		pool.Release(a);
+		uint32_t depth = pool.Acquire(DepthDesc);
+		CHECK(depth != a);
+		CHECK(pool.GetCreateCount() == 3);
+		CHECK(!pool.IsInUse(a) && pool.IsResident(a));
+
+		// A full chain asked for with zero mips matches the same chain spelled out
+		PoolTextureDesc implicitMips = { 256, 256, 28, 4, 0, 1, false };
+		PoolTextureDesc explicitMips = { 256, 256, 28, 4, 9, 1, false };
+		uint32_t mipped = pool.Acquire(implicitMips);
+		pool.Release(mipped);
+		CHECK(pool.Acquire(explicitMips) == mipped);
+	}
+
+	void TestEviction()
+	{
+		TexturePool pool;
+		pool.SetRetainFrames(2);
+
+		uint32_t a = pool.Acquire(ColorDesc);
+		pool.Release(a);
+
+		// Kept for the retain limit, then evicted on the next frame
+		pool.EndFrame();
+		pool.EndFrame();
+		CHECK(pool.IsResident(a));
+		CHECK(pool.GetSteadyStateBytes() == TexturePool::GetTextureBytes(ColorDesc));
+
+		pool.EndFrame();
+		CHECK(!pool.IsResident(a));
+		CHECK(pool.GetEvictCount() == 1);
+		CHECK(pool.GetSteadyStateBytes() == 0);
+
+		// Acquiring again within the limit restarts the count
+		uint32_t b = pool.Acquire(ColorDesc);
+		pool.Release(b);
+		pool.EndFrame();
+		pool.EndFrame();
+		CHECK(pool.Acquire(ColorDesc) == b);
+		pool.Release(b);
+		pool.EndFrame();
+		pool.EndFrame();
+		CHECK(pool.IsResident(b));
+
+		// Entries in use never age
+		uint32_t held = pool.Acquire(DepthDesc);
+		for (int frame = 0; frame < 10; ++frame)
+		{
+			pool.EndFrame();
+		}
+		CHECK(pool.IsResident(held) && pool.IsInUse(held));
+		CHECK(!pool.IsResident(b));
+	}
+
+	// Evicted slots are filled before the entry list grows
+	void TestFreeSlots()
+	{
+		TexturePool pool;
+		pool.SetRetainFrames(0);
+
+		uint32_t a = pool.Acquire(ColorDesc);
+		uint32_t b = pool.Acquire(ColorDesc);
+		pool.Release(a);
+		pool.EndFrame();
+		CHECK(!pool.IsResident(a));
+		CHECK(pool.GetEntryCount() == 2);
+
+		uint32_t depth = pool.Acquire(DepthDesc);
+		CHECK(depth == a);
+		CHECK(pool.GetEntryCount() == 2);
+		CHECK(pool.GetDesc(depth).Format == DepthDesc.Format);
+		CHECK(pool.IsInUse(b));
+
+		pool.Acquire(ColorDesc);
+		CHECK(pool.GetEntryCount() == 3);
+	}
+
+	void TestTextureBytes()
+	{
+		// A single level is the base image
+		CHECK(TexturePool::GetMipCount(ColorDesc) == 1);
+		CHECK(TexturePool::GetTextureBytes(ColorDesc) == 1280ull * 720 * 4);
+
+		// A full square chain adds a third: 256^2 + 128^2 + ... + 1 = (4^9 - 1) / 3 texels
+		PoolTextureDesc square = { 256, 256, 28, 4, 0, 1, false };
+		CHECK(TexturePool::GetMipCount(square) == 9);
+		CHECK(TexturePool::GetTextureBytes(square) == 87381ull * 4);
+
+		// A wide chain follows the larger side, the short side stopping at one texel
+		PoolTextureDesc wide = { 256, 64, 28, 4, 0, 1, false };
+		CHECK(TexturePool::GetMipCount(wide) == 9);
+		uint64_t wideTexels = 16384 + 4096 + 1024 + 256 + 64 + 16 + 4 + 2 + 1;
+		CHECK(TexturePool::GetTextureBytes(wide) == wideTexels * 4);
+
+		// Cube maps hold six faces, with or without mips
+		PoolTextureDesc cube = { 256, 256, 28, 4, 0, 1, true };
+		CHECK(TexturePool::GetTextureBytes(cube) == 6 * 87381ull * 4);
+		PoolTextureDesc cubeDepth = { 1024, 1024, 45, 4, 1, 4, true };
+		CHECK(TexturePool::GetTextureBytes(cubeDepth) == 6ull * 1024 * 1024 * 4);
+
+		CHECK(!TexturePool::IsSameDesc(square, cube));
+	}
+
+	void TestAccounting()
+	{
+		TexturePool pool;
+		uint64_t color = TexturePool::GetTextureBytes(ColorDesc);
+		uint64_t depth = TexturePool::GetTextureBytes(DepthDesc);
+
+		uint32_t a = pool.Acquire(ColorDesc);
+		uint32_t b = pool.Acquire(DepthDesc);
+		CHECK(pool.GetResidentBytes() == color + depth);
+		CHECK(pool.GetInUseBytes() == color + depth);
+
+		// Releasing keeps the memory resident
+		pool.Release(a);
+		CHECK(pool.GetResidentBytes() == color + depth);
+		CHECK(pool.GetInUseBytes() == depth);
+
+		// Releasing twice changes nothing
+		pool.Release(a);
+		CHECK(pool.GetInUseBytes() == depth);
+
+		// Trim gives back only what is idle
+		pool.Trim();
+		CHECK(!pool.IsResident(a) && pool.IsResident(b));
+		CHECK(pool.GetResidentBytes() == depth);
+		CHECK(pool.GetInUseBytes() == depth);
+
+		pool.Release(b);
+		CHECK(pool.GetInUseBytes() == 0);
+		pool.Trim();
+		CHECK(pool.GetResidentBytes() == 0);
+		CHECK(pool.GetEvictCount() == 2);
+
+		// Peaks remember the high point
+		CHECK(pool.GetPeakResidentBytes() == color + depth);
+		CHECK(pool.GetPeakInUseBytes() == color + depth);
+	}
+}
+
+int main()
+{
+	TestAcquire();
+	TestEviction();
+	TestFreeSlots();
+	TestTextureBytes();
+	TestAccounting();
+
+	return ReportChecks("TexturePool");
+}
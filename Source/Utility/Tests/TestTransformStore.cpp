@@ -0,0 +1,201 @@
+/*  =======================
+	Summary: Checks for the transform storage
+	=======================  */
+
+#include "TransformStore.h"
+#include "WorkerPool.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "TestHelper.h"
+
+namespace
+{
+	DirectX::XMMATRIX GetLocal(const TransformStore& store, TransformHandle handle)
+	{
+		DirectX::XMFLOAT3 s = store.GetScale(handle);
+		DirectX::XMFLOAT4 r = store.GetRotation(handle);
+		DirectX::XMFLOAT3 t = store.GetPosition(handle);
+
+		return DirectX::XMMatrixScaling(s.x, s.y, s.z) *
+			DirectX::XMMatrixRotationQuaternion(DirectX::XMLoadFloat4(&r)) *
+			DirectX::XMMatrixTranslation(t.x, t.y, t.z);
+	}
+
+	float GetMaxDifference(const DirectX::XMFLOAT4X4& a, DirectX::CXMMATRIX b)
+	{
+		DirectX::XMFLOAT4X4 expected;
+		DirectX::XMStoreFloat4x4(&expected, b);
+
+		float difference = 0.0f;
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				difference = fmaxf(difference, fabsf(a.m[r][c] - expected.m[r][c]));
+			}
+		}
+		return difference;
+	}
+
+	// World = Local * ParentWorld for every transform in the store
+	bool IsPropagated(TransformStore& store, const TransformHandle* handles, int count)
+	{
+		store.UpdateWorldMatrices();
+
+		bool isPropagated = true;
+		for (int i = 0; i < count; ++i)
+		{
+			DirectX::XMMATRIX expected = GetLocal(store, handles[i]);
+			TransformHandle parent = store.GetParent(handles[i]);
+			if (parent != TransformStore::InvalidHandle)
+			{
+				expected = expected * DirectX::XMLoadFloat4x4(&store.GetWorld(parent));
+			}
+
+			isPropagated = isPropagated && GetMaxDifference(store.GetWorld(handles[i]), expected) < 1e-4f;
+		}
+		return isPropagated;
+	}
+
+	void TestReparent()
+	{
+		TransformStore store;
+
+		TransformHandle handles[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			handles[i] = store.Create();
+		}
+		TransformHandle a = handles[0];
+		TransformHandle b = handles[1];
+		TransformHandle child = handles[2];
+		TransformHandle grandchild = handles[3];
+
+		store.SetPosition(a, DirectX::XMFLOAT3(10.0f, 0.0f, 0.0f));
+		store.SetScale(a, DirectX::XMFLOAT3(2.0f, 2.0f, 2.0f));
+
+		DirectX::XMFLOAT4 rotation;
+		DirectX::XMStoreFloat4(&rotation, DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), 0.7f));
+		store.SetPosition(b, DirectX::XMFLOAT3(-3.0f, 5.0f, 1.0f));
+		store.SetRotation(b, rotation);
+
+		store.SetPosition(child, DirectX::XMFLOAT3(1.0f, 2.0f, 3.0f));
+		store.SetScale(child, DirectX::XMFLOAT3(0.5f, 1.0f, 1.5f));
+		store.SetPosition(grandchild, DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f));
+
+		CHECK(store.SetParent(child, a));
+		CHECK(store.SetParent(grandchild, child));
+		CHECK(IsPropagated(store, handles, 4));
+
+		// Moving to another parent keeps the local transform and follows the new parent,
+		// down to the grandchild
+		CHECK(store.SetParent(child, b));
+		CHECK(store.GetParent(child) == b);
+		CHECK(IsPropagated(store, handles, 4));
+
+		DirectX::XMMATRIX expected = GetLocal(store, grandchild) * GetLocal(store, child) * GetLocal(store, b);
+		CHECK(GetMaxDifference(store.GetWorld(grandchild), expected) < 1e-4f);
+
+		// Changing only the parent afterwards still reaches the children
+		store.SetPosition(b, DirectX::XMFLOAT3(4.0f, -2.0f, 8.0f));
+		CHECK(IsPropagated(store, handles, 4));
+
+		// A transform cannot become its own ancestor
+		CHECK(!store.SetParent(b, grandchild));
+		CHECK(store.GetParent(b) == TransformStore::InvalidHandle);
+
+		// Detached, the world matrix is the local one
+		CHECK(store.SetParent(child, TransformStore::InvalidHandle));
+		CHECK(IsPropagated(store, handles, 4));
+		CHECK(GetMaxDifference(store.GetWorld(child), GetLocal(store, child)) < 1e-6f);
+	}
+
+	void TestRelease()
+	{
+		TransformStore store;
+
+		TransformHandle handles[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			handles[i] = store.Create();
+			store.SetPosition(handles[i], DirectX::XMFLOAT3(static_cast<float>(i), 1.0f, 0.0f));
+		}
+		store.SetParent(handles[1], handles[0]);
+		store.SetParent(handles[2], handles[1]);
+		CHECK(IsPropagated(store, handles, 3));
+
+		// Releasing a parent detaches its children, which keep their local transform
+		store.Release(handles[1]);
+		CHECK(store.GetCount() == 2);
+		CHECK(store.GetParent(handles[2]) == TransformStore::InvalidHandle);
+		CHECK(store.GetPosition(handles[2]).x == 2.0f);
+
+		TransformHandle remaining[2] = { handles[0], handles[2] };
+		CHECK(IsPropagated(store, remaining, 2));
+
+		// The freed handle is handed out again
+		CHECK(store.Create() == handles[1]);
+	}
+
+	// One large hierarchy is split into subtrees that update on several threads
+	void TestParallelUpdate()
+	{
+		WorkerPool pool(3);
+		TransformStore store;
+		store.SetWorkerPool(&pool);
+		store.SetParallelThreshold(0);
+
+		// A random tree below a single root, a short chain above it and a separate
+		// small hierarchy
+		std::mt19937 random(11);
+		std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+		std::vector<TransformHandle> handles;
+
+		for (int i = 0; i < 2000; ++i)
+		{
+			TransformHandle handle = store.Create();
+			store.SetPosition(handle, DirectX::XMFLOAT3(offset(random), offset(random), offset(random)));
+			store.SetScale(handle, DirectX::XMFLOAT3(1.0f + 0.01f * offset(random), 1.0f, 1.0f));
+
+			if (i > 0 && i < 4)
+			{
+				store.SetParent(handle, handles[i - 1]);
+			}
+			else if (i >= 4 && i < 1990)
+			{
+				store.SetParent(handle, handles[3 + random() % (i - 3)]);
+			}
+			else if (i > 1990)
+			{
+				store.SetParent(handle, handles[1990]);
+			}
+			handles.push_back(handle);
+		}
+
+		int count = static_cast<int>(handles.size());
+		CHECK(IsPropagated(store, handles.data(), count));
+		CHECK(store.GetJobCount() > 1);
+
+		// A change deep inside reaches its subtree, however the hierarchy was split
+		store.SetPosition(handles[500], DirectX::XMFLOAT3(5.0f, 0.0f, 0.0f));
+		store.SetRotation(handles[3], DirectX::XMFLOAT4(0.0f, 0.38268f, 0.0f, 0.92388f));
+		CHECK(IsPropagated(store, handles.data(), count));
+		CHECK(store.GetDirtyCount() == 0);
+
+		// Reparenting across hierarchies rebuilds the order and keeps the results
+		store.SetParent(handles[1990], handles[1000]);
+		CHECK(IsPropagated(store, handles.data(), count));
+	}
+}
+
+int main()
+{
+	TestReparent();
+	TestRelease();
+	TestParallelUpdate();
+
+	return ReportChecks("TransformStore");
+}
@@ -0,0 +1,181 @@
+/*  =======================
+	Summary: Texture pool keyed by description
+	=======================  */
+
+#include "TexturePool.h"
+
+TexturePool::TexturePool()
+{
+	mRetainFrames = 2;
+
+	mResidentBytes = 0;
+	mInUseBytes = 0;
+	mPeakResidentBytes = 0;
+	mPeakInUseBytes = 0;
+	mSteadyStateBytes = 0;
+
+	mCreateCount = 0;
+	mReuseCount = 0;
+	mEvictCount = 0;
+}
+
+TexturePool::~TexturePool()
+{
+}
+
+void TexturePool::SetRetainFrames(uint32_t frames)
+{
+	mRetainFrames = frames;
+}
+
+uint32_t TexturePool::Acquire(const PoolTextureDesc& desc)
+{
+	// Prefer the most recently released match so a texture that is handed back and
+	// asked for again every frame keeps its views
+	uint32_t best = InvalidEntry;
+	uint32_t freeSlot = InvalidEntry;
+
+	for (uint32_t i = 0; i < mEntries.size(); ++i)
+	{
+		const Entry& e = mEntries[i];
+
+		if (!e.isResident)
+		{
+			if (freeSlot == InvalidEntry) { freeSlot = i; }
+			continue;
+		}
+
+		if (e.isInUse || !IsSameDesc(e.Desc, desc))
+		{
+			continue;
+		}
+
+		if (best == InvalidEntry || e.IdleFrames < mEntries[best].IdleFrames)
+		{
+			best = i;
+		}
+	}
+
+	if (best != InvalidEntry)
+	{
+		++mReuseCount;
+	}
+	else
+	{
+		if (freeSlot == InvalidEntry)
+		{
+			freeSlot = static_cast<uint32_t>(mEntries.size());
+			mEntries.push_back(Entry());
+		}
+
+		best = freeSlot;
+		Entry& e = mEntries[best];
+		e.Desc = desc;
+		e.Bytes = GetTextureBytes(desc);
+		e.isResident = true;
+
+		mResidentBytes += e.Bytes;
+		if (mResidentBytes > mPeakResidentBytes) { mPeakResidentBytes = mResidentBytes; }
+		++mCreateCount;
+	}
+
+	Entry& e = mEntries[best];
+	e.isInUse = true;
+	e.IdleFrames = 0;
+
+	mInUseBytes += e.Bytes;
+	if (mInUseBytes > mPeakInUseBytes) { mPeakInUseBytes = mInUseBytes; }
+
+	return best;
+}
+
+void TexturePool::Release(uint32_t entry)
+{
+	Entry& e = mEntries[entry];
+	if (!e.isInUse)
+	{
+		return;
+	}
+
+	e.isInUse = false;
+	e.IdleFrames = 0;
+	mInUseBytes -= e.Bytes;
+}
+
+void TexturePool::EndFrame()
+{
+	for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		if (!it->isResident || it->isInUse)
+		{
+			continue;
+		}
+
+		if (++it->IdleFrames > mRetainFrames)
+		{
+			Evict(*it);
+		}
+	}
+
+	mSteadyStateBytes = mResidentBytes;
+}
+
+void TexturePool::Trim()
+{
+	for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		if (it->isResident && !it->isInUse)
+		{
+			Evict(*it);
+		}
+	}
+}
+
+void TexturePool::Evict(Entry& entry)
+{
+	entry.isResident = false;
+	mResidentBytes -= entry.Bytes;
+	++mEvictCount;
+}
+
+uint32_t TexturePool::GetMipCount(const PoolTextureDesc& desc)
+{
+	if (desc.MipLevels != 0)
+	{
+		return desc.MipLevels;
+	}
+
+	uint32_t size = desc.Width > desc.Height ? desc.Width : desc.Height;
+	uint32_t count = 1;
+
+	while (size > 1)
+	{
+		size >>= 1;
+		++count;
+	}
+
+	return count;
+}
+
+uint64_t TexturePool::GetTextureBytes(const PoolTextureDesc& desc)
+{
+	uint64_t bytes = 0;
+	uint32_t width = desc.Width;
+	uint32_t height = desc.Height;
+	uint32_t mips = GetMipCount(desc);
+
+	for (uint32_t i = 0; i < mips; ++i)
+	{
+		bytes += static_cast<uint64_t>(width) * height * desc.BytesPerTexel;
+		width = width > 1 ? width >> 1 : 1;
+		height = height > 1 ? height >> 1 : 1;
+	}
+
+	return desc.isCube ? bytes * 6 : bytes;
+}
+
+bool TexturePool::IsSameDesc(const PoolTextureDesc& a, const PoolTextureDesc& b)
+{
+	return a.Width == b.Width && a.Height == b.Height && a.Format == b.Format &&
+		GetMipCount(a) == GetMipCount(b) && a.BindFlags == b.BindFlags && a.isCube == b.isCube;
+}
@@ -0,0 +1,98 @@
+/*  =======================
+	Summary: Texture pool keyed by description
+	=======================  */
+
+#ifndef TEXTUREPOOL_H
+#define TEXTUREPOOL_H
+
+#include <cstdint>
+#include <vector>
+
+// Everything that decides whether two textures are interchangeable. Format is the
+// DXGI value and is only compared. MipLevels of zero means a full chain, and BindFlags
+// uses the RGBindFlag bits.
+struct PoolTextureDesc
+{
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t Format;
+	uint32_t BytesPerTexel;
+	uint32_t MipLevels;
+	uint32_t BindFlags;
+	bool isCube;
+};
+
+// Bookkeeping for a pool of textures handed out by description. A released texture
+// is kept for a few frames and returned to the next request with the same description;
+// once it has been idle for longer it is evicted and its memory given back. Tracks how
+// much memory is resident and in use, the peak of both and what is still resident at
+// the end of a frame. Touches no device, so it can be driven and checked on the CPU;
+// the owner creates a texture for every entry that becomes resident and releases it
+// once the entry is evicted.
+class TexturePool
+{
+public:
+	static const uint32_t InvalidEntry = 0xffffffff;
+
+	TexturePool();
+	~TexturePool();
+
+	// Number of EndFrame calls a released texture survives before it is evicted.
+	void SetRetainFrames(uint32_t frames);
+
+	// Returns an idle entry with an equal description, or a new resident entry.
+	uint32_t Acquire(const PoolTextureDesc& desc);
+	void Release(uint32_t entry);
+
+	// Ages idle entries and evicts those past the retain limit.
+	void EndFrame();
+
+	// Evicts every idle entry now.
+	void Trim();
+
+	inline uint32_t GetEntryCount() const { return static_cast<uint32_t>(mEntries.size()); }
+	inline bool IsResident(uint32_t entry) const { return mEntries[entry].isResident; }
+	inline bool IsInUse(uint32_t entry) const { return mEntries[entry].isInUse; }
+	inline const PoolTextureDesc& GetDesc(uint32_t entry) const { return mEntries[entry].Desc; }
+
+	inline uint64_t GetResidentBytes() const { return mResidentBytes; }
+	inline uint64_t GetInUseBytes() const { return mInUseBytes; }
+	inline uint64_t GetPeakResidentBytes() const { return mPeakResidentBytes; }
+	inline uint64_t GetPeakInUseBytes() const { return mPeakInUseBytes; }
+	inline uint64_t GetSteadyStateBytes() const { return mSteadyStateBytes; }
+	inline uint32_t GetCreateCount() const { return mCreateCount; }
+	inline uint32_t GetReuseCount() const { return mReuseCount; }
+	inline uint32_t GetEvictCount() const { return mEvictCount; }
+
+	static uint32_t GetMipCount(const PoolTextureDesc& desc);
+	static uint64_t GetTextureBytes(const PoolTextureDesc& desc);
+	static bool IsSameDesc(const PoolTextureDesc& a, const PoolTextureDesc& b);
+
+private:
+	struct Entry
+	{
+		PoolTextureDesc Desc;
+		uint64_t Bytes;
+		uint32_t IdleFrames;
+		bool isResident;
+		bool isInUse;
+	};
+
+	void Evict(Entry& entry);
+
+private:
+	std::vector<Entry> mEntries;
+	uint32_t mRetainFrames;
+
+	uint64_t mResidentBytes;
+	uint64_t mInUseBytes;
+	uint64_t mPeakResidentBytes;
+	uint64_t mPeakInUseBytes;
+	uint64_t mSteadyStateBytes;
+
+	uint32_t mCreateCount;
+	uint32_t mReuseCount;
+	uint32_t mEvictCount;
+};
+
+#endif // TEXTUREPOOL_H
\ No newline at end of file
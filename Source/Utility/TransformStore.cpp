@@ -0,0 +1,434 @@
+/*  =======================
+	Summary: Data-oriented transform storage
+	=======================  */
+
+#include "TransformStore.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <xmmintrin.h>
+
+// Out of class definition, as push_back binds the constant by reference
+const TransformHandle TransformStore::InvalidHandle;
+
+TransformStore::TransformStore()
+{
+	mWorlds = nullptr;
+	mNormals = nullptr;
+	mCapacity = 0;
+	mDirtyCount = 0;
+	isOrderDirty = false;
+	mJobCount = 0;
+	mPool = &WorkerPool::Shared();
+	mParallelThreshold = 1024;
+}
+
+TransformStore::~TransformStore()
+{
+	_mm_free(mWorlds);
+	_mm_free(mNormals);
+}
+
+TransformStore& TransformStore::Shared()
+{
+	static TransformStore store;
+	return store;
+}
+
+TransformHandle TransformStore::Create()
+{
+	uint32_t slot = GetCount();
+	if (slot == mCapacity)
+	{
+		Reserve(mCapacity == 0 ? 64 : mCapacity * 2);
+	}
+
+	TransformHandle handle;
+	if (!mFreeHandles.empty())
+	{
+		handle = mFreeHandles.back();
+		mFreeHandles.pop_back();
+	}
+	else
+	{
+		handle = static_cast<TransformHandle>(mSlots.size());
+		mSlots.push_back(0);
+	}
+	mSlots[handle] = slot;
+
+	mPositions.push_back(DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+	mRotations.push_back(DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+	mScales.push_back(DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f));
+	mParents.push_back(InvalidHandle);
+	mHandles.push_back(handle);
+	mDirty.push_back(0);
+
+	// A new root forms its own group
+	isOrderDirty = true;
+	MarkDirty(slot);
+	return handle;
+}
+
+void TransformStore::Release(TransformHandle handle)
+{
+	uint32_t slot = mSlots[handle];
+	uint32_t last = GetCount() - 1;
+
+	for (uint32_t i = 0; i <= last; ++i)
+	{
+		if (mParents[i] == handle) { mParents[i] = InvalidHandle; }
+	}
+
+	if (mDirty[slot]) { --mDirtyCount; }
+
+	// Swap the last slot into the hole to keep the arrays dense
+	if (slot != last)
+	{
+		mPositions[slot] = mPositions[last];
+		mRotations[slot] = mRotations[last];
+		mScales[slot] = mScales[last];
+		mParents[slot] = mParents[last];
+		mHandles[slot] = mHandles[last];
+		mDirty[slot] = mDirty[last];
+		mSlots[mHandles[slot]] = slot;
+	}
+
+	mPositions.pop_back();
+	mRotations.pop_back();
+	mScales.pop_back();
+	mParents.pop_back();
+	mHandles.pop_back();
+	mDirty.pop_back();
+
+	mSlots[handle] = InvalidHandle;
+	mFreeHandles.push_back(handle);
+
+	isOrderDirty = true;
+}
+
+bool TransformStore::SetParent(TransformHandle handle, TransformHandle parent)
+{
+	for (TransformHandle p = parent; p != InvalidHandle; p = mParents[mSlots[p]])
+	{
+		if (p == handle) { return false; }
+	}
+
+	mParents[mSlots[handle]] = parent;
+	isOrderDirty = true;
+	return true;
+}
+
+void TransformStore::SetPosition(TransformHandle handle, const DirectX::XMFLOAT3& position)
+{
+	uint32_t slot = mSlots[handle];
+	mPositions[slot] = position;
+	MarkDirty(slot);
+}
+
+void TransformStore::SetRotation(TransformHandle handle, const DirectX::XMFLOAT4& rotation)
+{
+	uint32_t slot = mSlots[handle];
+	mRotations[slot] = rotation;
+	MarkDirty(slot);
+}
+
+void TransformStore::SetScale(TransformHandle handle, const DirectX::XMFLOAT3& scale)
+{
+	uint32_t slot = mSlots[handle];
+	mScales[slot] = scale;
+	MarkDirty(slot);
+}
+
+const DirectX::XMFLOAT4X4& TransformStore::GetWorld(TransformHandle handle) const
+{
+	assert(!isOrderDirty && mDirtyCount == 0);
+	return mWorlds[mSlots[handle]];
+}
+
+const DirectX::XMFLOAT4X4& TransformStore::GetNormal(TransformHandle handle) const
+{
+	assert(!isOrderDirty && mDirtyCount == 0);
+	return mNormals[mSlots[handle]];
+}
+
+DirectX::XMMATRIX TransformStore::ComputeInverseWorld(TransformHandle handle) const
+{
+	uint32_t slot = mSlots[handle];
+	DirectX::XMVECTOR S = DirectX::XMLoadFloat3(&mScales[slot]);
+	DirectX::XMVECTOR R = DirectX::XMLoadFloat4(&mRotations[slot]);
+	DirectX::XMVECTOR T = DirectX::XMLoadFloat3(&mPositions[slot]);
+
+	// Local^-1 = T^-1 * R^T * S^-1
+	DirectX::XMMATRIX invT = DirectX::XMMatrixTranslationFromVector(DirectX::XMVectorNegate(T));
+	DirectX::XMMATRIX invR = DirectX::XMMatrixRotationQuaternion(DirectX::XMQuaternionConjugate(R));
+	DirectX::XMMATRIX invS = DirectX::XMMatrixScalingFromVector(DirectX::XMVectorReciprocal(S));
+	DirectX::XMMATRIX invLocal = DirectX::XMMatrixMultiply(DirectX::XMMatrixMultiply(invT, invR), invS);
+
+	// World = Local * ParentWorld, so World^-1 = ParentWorld^-1 * Local^-1
+	if (mParents[slot] == InvalidHandle) { return invLocal; }
+	return DirectX::XMMatrixMultiply(ComputeInverseWorld(mParents[slot]), invLocal);
+}
+
+void TransformStore::UpdateWorldMatrices()
+{
+	mJobCount = 0;
+
+	if (isOrderDirty) { RebuildOrder(); }
+	if (mDirtyCount == 0) { return; }
+
+	// Collect the hierarchies that contain a change
+	uint32_t work = 0;
+	mDirtyGroups.clear();
+	for (uint32_t g = 0; g < mGroups.size(); ++g)
+	{
+		if (mGroupDirty[g])
+		{
+			mDirtyGroups.push_back(g);
+			work += mGroups[g].End - mGroups[g].Begin;
+			mGroupDirty[g] = 0;
+		}
+	}
+
+	uint32_t groupCount = static_cast<uint32_t>(mDirtyGroups.size());
+
+	if (work < mParallelThreshold || mPool->GetWorkerCount() == 0)
+	{
+		for (uint32_t i = 0; i < groupCount; ++i)
+		{
+			UpdateGroup(mGroups[mDirtyGroups[i]]);
+		}
+	}
+	else
+	{
+		// Aim for a few jobs per thread with similar slot counts
+		uint32_t batchCount = (mPool->GetWorkerCount() + 1) * 4;
+		uint32_t target = (work + batchCount - 1) / batchCount;
+
+		// Hierarchies larger than that are split at the roots of subtrees that fit. The
+		// few slots above those subtrees are updated here first, so every job only reads
+		// parents that are already final.
+		mWorkItems.clear();
+		for (uint32_t i = 0; i < groupCount; ++i)
+		{
+			const Group& group = mGroups[mDirtyGroups[i]];
+			uint32_t slot = group.Begin;
+			while (slot < group.End)
+			{
+				Group item = { slot, slot + mSubtreeSizes[slot] };
+				if (mSubtreeSizes[slot] <= target)
+				{
+					mWorkItems.push_back(item);
+					slot = item.End;
+				}
+				else
+				{
+					item.End = slot + 1;
+					UpdateGroup(item);
+					++slot;
+				}
+			}
+		}
+
+		// Batch neighbouring items into jobs of about the target size
+		uint32_t itemCount = static_cast<uint32_t>(mWorkItems.size());
+		mBatchStarts.clear();
+		mBatchStarts.push_back(0);
+		uint32_t batchWork = 0;
+		for (uint32_t i = 0; i < itemCount; ++i)
+		{
+			batchWork += mWorkItems[i].End - mWorkItems[i].Begin;
+			if (batchWork >= target && i + 1 < itemCount)
+			{
+				mBatchStarts.push_back(i + 1);
+				batchWork = 0;
+			}
+		}
+		mBatchStarts.push_back(itemCount);
+
+		mJobCount = static_cast<uint32_t>(mBatchStarts.size()) - 1;
+		mPool->ParallelFor(mJobCount, [this](uint32_t batch)
+		{
+			for (uint32_t i = mBatchStarts[batch]; i < mBatchStarts[batch + 1]; ++i)
+			{
+				UpdateGroup(mWorkItems[i]);
+			}
+		});
+	}
+
+	mDirtyCount = 0;
+}
+
+void TransformStore::Reserve(uint32_t capacity)
+{
+	// Matrices are rebuilt after any structural change, so the old contents are not kept
+	_mm_free(mWorlds);
+	_mm_free(mNormals);
+
+	mWorlds = static_cast<DirectX::XMFLOAT4X4A*>(_mm_malloc(capacity * sizeof(DirectX::XMFLOAT4X4A), 16));
+	mNormals = static_cast<DirectX::XMFLOAT4X4A*>(_mm_malloc(capacity * sizeof(DirectX::XMFLOAT4X4A), 16));
+	mCapacity = capacity;
+
+	mPositions.reserve(capacity);
+	mRotations.reserve(capacity);
+	mScales.reserve(capacity);
+	mParents.reserve(capacity);
+	mHandles.reserve(capacity);
+	mDirty.reserve(capacity);
+}
+
+void TransformStore::MarkDirty(uint32_t slot)
+{
+	if (!mDirty[slot])
+	{
+		mDirty[slot] = 1;
+		++mDirtyCount;
+	}
+
+	if (!isOrderDirty)
+	{
+		mGroupDirty[mGroupOfSlot[slot]] = 1;
+	}
+}
+
+void TransformStore::RebuildOrder()
+{
+	uint32_t count = GetCount();
+
+	// Children of every slot, in slot order
+	std::vector<uint32_t> childStarts(count + 1, 0);
+	for (uint32_t slot = 0; slot < count; ++slot)
+	{
+		if (mParents[slot] != InvalidHandle) { ++childStarts[mSlots[mParents[slot]] + 1]; }
+	}
+	for (uint32_t slot = 0; slot < count; ++slot)
+	{
+		childStarts[slot + 1] += childStarts[slot];
+	}
+
+	std::vector<uint32_t> children(childStarts[count]);
+	std::vector<uint32_t> childEnds(childStarts.begin(), childStarts.end() - 1);
+	for (uint32_t slot = 0; slot < count; ++slot)
+	{
+		if (mParents[slot] != InvalidHandle) { children[childEnds[mSlots[mParents[slot]]]++] = slot; }
+	}
+
+	// Depth-first from every root, so each subtree follows its root as one run
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> stack;
+	order.reserve(count);
+	for (uint32_t root = 0; root < count; ++root)
+	{
+		if (mParents[root] != InvalidHandle) { continue; }
+
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			uint32_t slot = stack.back();
+			stack.pop_back();
+			order.push_back(slot);
+
+			// Pushed in reverse so children are visited in slot order
+			for (uint32_t c = childStarts[slot + 1]; c > childStarts[slot]; --c)
+			{
+				stack.push_back(children[c - 1]);
+			}
+		}
+	}
+
+	std::vector<DirectX::XMFLOAT3> positions(count);
+	std::vector<DirectX::XMFLOAT4> rotations(count);
+	std::vector<DirectX::XMFLOAT3> scales(count);
+	std::vector<TransformHandle> parents(count);
+	std::vector<TransformHandle> handles(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		positions[i] = mPositions[order[i]];
+		rotations[i] = mRotations[order[i]];
+		scales[i] = mScales[order[i]];
+		parents[i] = mParents[order[i]];
+		handles[i] = mHandles[order[i]];
+	}
+	mPositions.swap(positions);
+	mRotations.swap(rotations);
+	mScales.swap(scales);
+	mParents.swap(parents);
+	mHandles.swap(handles);
+
+	for (uint32_t slot = 0; slot < count; ++slot)
+	{
+		mSlots[mHandles[slot]] = slot;
+	}
+
+	// Parent slots, and subtree sizes accumulated from the leaves up
+	mParentSlots.resize(count);
+	mSubtreeSizes.assign(count, 1);
+	for (uint32_t slot = 0; slot < count; ++slot)
+	{
+		TransformHandle parent = mParents[slot];
+		mParentSlots[slot] = parent == InvalidHandle ? InvalidHandle : mSlots[parent];
+	}
+	for (uint32_t slot = count; slot > 0; --slot)
+	{
+		if (mParentSlots[slot - 1] != InvalidHandle) { mSubtreeSizes[mParentSlots[slot - 1]] += mSubtreeSizes[slot - 1]; }
+	}
+
+	// Each hierarchy is its root's subtree
+	mGroupOfSlot.resize(count);
+	mGroups.clear();
+	for (uint32_t slot = 0; slot < count; slot += mSubtreeSizes[slot])
+	{
+		Group group = { slot, slot + mSubtreeSizes[slot] };
+		std::fill(mGroupOfSlot.begin() + group.Begin, mGroupOfSlot.begin() + group.End, static_cast<uint32_t>(mGroups.size()));
+		mGroups.push_back(group);
+	}
+
+	// Everything is recomputed after a structural change
+	mDirty.assign(count, 1);
+	mChanged.assign(count, 0);
+	mGroupDirty.assign(mGroups.size(), 1);
+	mDirtyCount = count;
+
+	isOrderDirty = false;
+}
+
+void TransformStore::UpdateGroup(const Group& group)
+{
+	for (uint32_t slot = group.Begin; slot < group.End; ++slot)
+	{
+		uint32_t parent = mParentSlots[slot];
+		bool parentChanged = parent != InvalidHandle && mChanged[parent];
+
+		// Unchanged branches keep their matrices
+		if (!mDirty[slot] && !parentChanged)
+		{
+			mChanged[slot] = 0;
+			continue;
+		}
+
+		DirectX::XMVECTOR S = DirectX::XMLoadFloat3(&mScales[slot]);
+		DirectX::XMVECTOR R = DirectX::XMLoadFloat4(&mRotations[slot]);
+		DirectX::XMVECTOR T = DirectX::XMLoadFloat3(&mPositions[slot]);
+
+		// Local = S * R * T
+		DirectX::XMMATRIX rotation = DirectX::XMMatrixRotationQuaternion(R);
+		DirectX::XMMATRIX world = DirectX::XMMatrixMultiply(DirectX::XMMatrixScalingFromVector(S), rotation);
+		world.r[3] = DirectX::XMVectorSelect(DirectX::g_XMIdentityR3, T, DirectX::g_XMSelect1110);
+
+		// Normal = ((S * R)^-1)^T = S^-1 * R
+		DirectX::XMMATRIX normal = DirectX::XMMatrixMultiply(DirectX::XMMatrixScalingFromVector(DirectX::XMVectorReciprocal(S)), rotation);
+
+		// Parents were updated earlier in this pass
+		if (parent != InvalidHandle)
+		{
+			world = DirectX::XMMatrixMultiply(world, DirectX::XMLoadFloat4x4A(&mWorlds[parent]));
+			normal = DirectX::XMMatrixMultiply(normal, DirectX::XMLoadFloat4x4A(&mNormals[parent]));
+		}
+
+		DirectX::XMStoreFloat4x4A(&mWorlds[slot], world);
+		DirectX::XMStoreFloat4x4A(&mNormals[slot], normal);
+
+		mDirty[slot] = 0;
+		mChanged[slot] = 1;
+	}
+}
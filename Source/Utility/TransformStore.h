@@ -0,0 +1,131 @@
+/*  =======================
+	Summary: Data-oriented transform storage
+	=======================  */
+
+#ifndef TRANSFORMSTORE_H
+#define TRANSFORMSTORE_H
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+typedef uint32_t TransformHandle;
+
+class WorkerPool;
+
+// Owns the transforms of all objects in structure-of-arrays form. Local position,
+// rotation and scale live in dense parallel arrays; world and normal matrices live in
+// 16-byte aligned contiguous arrays so a batch update streams through memory. Handles
+// stay valid while the dense slots behind them are compacted or reordered.
+//
+// Transforms may have a parent. Slots are kept in depth-first order per hierarchy, so
+// every subtree is a contiguous run of slots behind its root. Propagation is a single
+// parent-before-child pass, and large hierarchies split into subtrees that can be
+// updated on different threads.
+class TransformStore
+{
+public:
+	static const TransformHandle InvalidHandle = 0xffffffff;
+
+	TransformStore();
+	~TransformStore();
+
+	// Store used by GObject.
+	static TransformStore& Shared();
+
+	TransformHandle Create();
+
+	// Releasing a parent detaches its children, which keep their local transform.
+	void Release(TransformHandle handle);
+
+	// Attaches handle below parent, or detaches it for InvalidHandle. Fails if that
+	// would create a cycle.
+	bool SetParent(TransformHandle handle, TransformHandle parent);
+	inline TransformHandle GetParent(TransformHandle handle) const { return mParents[mSlots[handle]]; }
+
+	// Local transform relative to the parent, or to the world for roots.
+	void SetPosition(TransformHandle handle, const DirectX::XMFLOAT3& position);
+	void SetRotation(TransformHandle handle, const DirectX::XMFLOAT4& rotation);
+	void SetScale(TransformHandle handle, const DirectX::XMFLOAT3& scale);
+
+	inline const DirectX::XMFLOAT3& GetPosition(TransformHandle handle) const { return mPositions[mSlots[handle]]; }
+	inline const DirectX::XMFLOAT4& GetRotation(TransformHandle handle) const { return mRotations[mSlots[handle]]; }
+	inline const DirectX::XMFLOAT3& GetScale(TransformHandle handle) const { return mScales[mSlots[handle]]; }
+
+	// World and normal (inverse-transpose, no translation) matrices as of the last
+	// UpdateWorldMatrices. Plain reads, safe from any thread while nothing changes; debug
+	// builds assert that no change is pending.
+	const DirectX::XMFLOAT4X4& GetWorld(TransformHandle handle) const;
+	const DirectX::XMFLOAT4X4& GetNormal(TransformHandle handle) const;
+
+	// Inverse world matrix composed from the inverted local transforms up the hierarchy.
+	DirectX::XMMATRIX ComputeInverseWorld(TransformHandle handle) const;
+
+	// Propagates every changed transform to its world matrices. Hierarchies without
+	// changes are skipped; the rest are spread over the worker pool once there is enough
+	// work. Call from one thread, before anything reads the matrices.
+	void UpdateWorldMatrices();
+
+	// Pool the update is spread over. Defaults to WorkerPool::Shared().
+	inline void SetWorkerPool(WorkerPool* pool) { mPool = pool; }
+
+	// Minimum number of slots in changed hierarchies before the update goes parallel.
+	inline void SetParallelThreshold(uint32_t slots) { mParallelThreshold = slots; }
+
+	inline uint32_t GetCount() const { return static_cast<uint32_t>(mPositions.size()); }
+	inline uint32_t GetDirtyCount() const { return mDirtyCount; }
+
+	// Number of jobs the last parallel update was split into, zero if it ran inline.
+	inline uint32_t GetJobCount() const { return mJobCount; }
+
+private:
+	// Contiguous run of slots: a whole hierarchy, or one subtree of it
+	struct Group
+	{
+		uint32_t Begin;
+		uint32_t End;
+	};
+
+	void Reserve(uint32_t capacity);
+	void MarkDirty(uint32_t slot);
+	void RebuildOrder();
+	void UpdateGroup(const Group& group);
+
+private:
+	// Dense SoA arrays, indexed by slot
+	std::vector<DirectX::XMFLOAT3> mPositions;
+	std::vector<DirectX::XMFLOAT4> mRotations;
+	std::vector<DirectX::XMFLOAT3> mScales;
+	std::vector<TransformHandle> mParents;
+	std::vector<TransformHandle> mHandles;
+	std::vector<uint8_t> mDirty;
+
+	DirectX::XMFLOAT4X4A* mWorlds;
+	DirectX::XMFLOAT4X4A* mNormals;
+	uint32_t mCapacity;
+	uint32_t mDirtyCount;
+
+	// Derived from the hierarchy by RebuildOrder, valid while isOrderDirty is false
+	std::vector<uint32_t> mParentSlots;
+	std::vector<uint32_t> mSubtreeSizes;
+	std::vector<uint32_t> mGroupOfSlot;
+	std::vector<Group> mGroups;
+	std::vector<uint8_t> mGroupDirty;
+	std::vector<uint8_t> mChanged;
+	bool isOrderDirty;
+
+	// Scratch lists for UpdateWorldMatrices
+	std::vector<uint32_t> mDirtyGroups;
+	std::vector<Group> mWorkItems;
+	std::vector<uint32_t> mBatchStarts;
+	uint32_t mJobCount;
+
+	WorkerPool* mPool;
+	uint32_t mParallelThreshold;
+
+	// Handle to slot indirection and recycled handles
+	std::vector<uint32_t> mSlots;
+	std::vector<TransformHandle> mFreeHandles;
+};
+
+#endif // TRANSFORMSTORE_H
\ No newline at end of file
@@ -0,0 +1,105 @@
+/*  =======================
+	Summary: Persistent worker threads
+	=======================  */
+
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(uint32_t threadCount)
+{
+	mJob = nullptr;
+	mNext = 0;
+	mCount = 0;
+	mBusy = 0;
+	mGeneration = 0;
+	isQuitting = false;
+
+	if (threadCount == 0)
+	{
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		mThreads.push_back(std::thread(&WorkerPool::WorkerLoop, this));
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		isQuitting = true;
+	}
+	mWake.notify_all();
+
+	for (auto it = mThreads.begin(); it != mThreads.end(); ++it)
+	{
+		it->join();
+	}
+}
+
+WorkerPool& WorkerPool::Shared()
+{
+	static WorkerPool pool;
+	return pool;
+}
+
+void WorkerPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& job)
+{
+	if (count == 0) { return; }
+
+	// Not worth waking anyone for a single job
+	if (mThreads.empty() || count == 1)
+	{
+		for (uint32_t i = 0; i < count; ++i) { job(i); }
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJob = &job;
+		mCount = count;
+		mNext = 0;
+		mBusy = GetWorkerCount();
+		++mGeneration;
+	}
+	mWake.notify_all();
+
+	RunJobs();
+
+	// Workers still hold a pointer to job until they report back
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDone.wait(lock, [this]() { return mBusy == 0; });
+	mJob = nullptr;
+}
+
+void WorkerPool::WorkerLoop()
+{
+	uint32_t seenGeneration = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWake.wait(lock, [this, seenGeneration]() { return isQuitting || mGeneration != seenGeneration; });
+			if (isQuitting) { return; }
+			seenGeneration = mGeneration;
+		}
+
+		RunJobs();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (--mBusy == 0) { mDone.notify_one(); }
+		}
+	}
+}
+
+void WorkerPool::RunJobs()
+{
+	for (uint32_t i = mNext++; i < mCount; i = mNext++)
+	{
+		(*mJob)(i);
+	}
+}
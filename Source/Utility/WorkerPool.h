@@ -0,0 +1,53 @@
+/*  =======================
+	Summary: Persistent worker threads
+	=======================  */
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <cstdint>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads that sleep until ParallelFor hands them work. The calling
+// thread takes part in the loop, so a pool with zero workers runs everything inline.
+// ParallelFor is not reentrant and must only be called from one thread at a time.
+class WorkerPool
+{
+public:
+	// threadCount of zero uses one worker per hardware thread besides the caller.
+	explicit WorkerPool(uint32_t threadCount = 0);
+	~WorkerPool();
+
+	// Pool shared by engine systems.
+	static WorkerPool& Shared();
+
+	// Runs job(i) for every i in [0, count) and returns once all of them have finished.
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& job);
+
+	inline uint32_t GetWorkerCount() const { return static_cast<uint32_t>(mThreads.size()); }
+
+private:
+	void WorkerLoop();
+	void RunJobs();
+
+private:
+	std::vector<std::thread> mThreads;
+
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::condition_variable mDone;
+
+	const std::function<void(uint32_t)>* mJob;
+	std::atomic<uint32_t> mNext;
+	uint32_t mCount;
+	uint32_t mBusy;
+	uint32_t mGeneration;
+	bool isQuitting;
+};
+
+#endif // WORKERPOOL_H
\ No newline at end of file
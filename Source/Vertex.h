@@ -23,6 +23,32 @@ struct VertexPosition
 	DirectX::XMFLOAT3 Pos;
 };
 
+// Per instance vertex data, bound next to the mesh's vertices when repeated geometry
+// is drawn instanced. Matrices are row major, as stored on the CPU.
+struct InstanceTransform
+{
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 WorldInvTranspose;
+};
+
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 WorldInvTranspose;
+	DirectX::XMFLOAT4X4 TexTransform;
+	DirectX::XMFLOAT4 Ambient;
+	DirectX::XMFLOAT4 Diffuse;
+	DirectX::XMFLOAT4 Specular;
+	DirectX::XMFLOAT4 Reflect;
+
+	// Reflection probes in the cube array and the blend between them: x, y, weight of y
+	DirectX::XMFLOAT4 ProbeBlend;
+};
+
+// Upper bound on the instances of one draw, keeping each upload well inside the
+// backend's vertex ring.
+static const UINT MaxInstancesPerDraw = 512;
+
 struct Particle
 {
 	DirectX::XMFLOAT3 InitialPos;